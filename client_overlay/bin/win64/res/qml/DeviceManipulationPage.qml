@@ -207,9 +207,23 @@ MyStackViewPage
                 }
             }
 
+            // Telemetry button
+            MyPushButton
+            {
+                Layout.preferredWidth: 200
+                Layout.leftMargin: 20
+                Layout.topMargin: 20
+                Layout.bottomMargin: 35
+                text: "Telemetry"
+                onClicked:
+                {
+                    var res = mainView.push(telemetryPage)
+                }
+            }
+
             Item
             {
-               Layout.preferredWidth: 710
+               Layout.preferredWidth: 490
             }
 
             // Apply button
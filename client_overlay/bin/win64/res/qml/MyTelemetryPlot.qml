@@ -0,0 +1,157 @@
+import QtQuick 2.9
+import QtQuick.Layouts 1.3
+import ovrmc.motioncompensation 1.0
+
+// Line plot of some TelemetryTabController channels over its history, dropouts are marked with red lines
+Rectangle
+{
+    id: telemetryPlot
+    color: "#22354a"
+
+    property string title: ""
+    property string unit: ""
+    property var channels: []
+    property var labels: []
+    property var colors: ["#ff7070", "#70ff70", "#70a0ff", "#ffff70"]
+    property bool fromZero: false
+
+    function refresh()
+    {
+        plotCanvas.requestPaint()
+    }
+
+    RowLayout
+    {
+        id: plotHeader
+        x: 10
+        y: 4
+        width: parent.width - 20
+        spacing: 14
+
+        MyText
+        {
+            font.pointSize: 12
+            text: telemetryPlot.title + (telemetryPlot.unit !== "" ? " [" + telemetryPlot.unit + "]" : "")
+        }
+
+        Repeater
+        {
+            model: telemetryPlot.labels
+            MyText
+            {
+                font.pointSize: 12
+                color: telemetryPlot.colors[index % telemetryPlot.colors.length]
+                text: modelData
+            }
+        }
+
+        Item
+        {
+            Layout.fillWidth: true
+        }
+
+        MyText
+        {
+            id: plotRangeText
+            font.pointSize: 12
+            color: "#aaaaaa"
+        }
+    }
+
+    Canvas
+    {
+        id: plotCanvas
+        anchors.fill: parent
+        anchors.topMargin: 34
+        anchors.leftMargin: 10
+        anchors.rightMargin: 10
+        anchors.bottomMargin: 8
+
+        onPaint:
+        {
+            var ctx = getContext("2d")
+            ctx.reset()
+
+            var times = TelemetryTabController.getTimes()
+            if (times.length < 2)
+            {
+                plotRangeText.text = ""
+                return
+            }
+
+            var series = []
+            var min = Number.POSITIVE_INFINITY
+            var max = Number.NEGATIVE_INFINITY
+            for (var c = 0; c < channels.length; c++)
+            {
+                var values = TelemetryTabController.getChannel(channels[c])
+                for (var i = 0; i < values.length; i++)
+                {
+                    min = Math.min(min, values[i])
+                    max = Math.max(max, values[i])
+                }
+                series.push(values)
+            }
+
+            if (fromZero)
+            {
+                min = Math.min(min, 0)
+            }
+            if (max - min < 1e-6)
+            {
+                max += 0.5
+                if (!fromZero)
+                {
+                    min -= 0.5
+                }
+            }
+            max += (max - min) * 0.05
+            plotRangeText.text = min.toPrecision(3) + " .. " + max.toPrecision(3)
+
+            var span = TelemetryTabController.getHistorySeconds()
+            var w = width
+            var h = height
+            function px(t) { return (t + span) / span * w }
+            function py(v) { return h - (v - min) / (max - min) * h }
+
+            // Zero line
+            if (min < 0 && max > 0)
+            {
+                ctx.strokeStyle = "#607890"
+                ctx.lineWidth = 1
+                ctx.beginPath()
+                ctx.moveTo(0, py(0))
+                ctx.lineTo(w, py(0))
+                ctx.stroke()
+            }
+
+            // Dropouts
+            var dropouts = TelemetryTabController.getChannel(TelemetryTabController.Dropouts)
+            ctx.strokeStyle = "#ff3030"
+            ctx.lineWidth = 1
+            ctx.beginPath()
+            for (var d = 0; d < dropouts.length; d++)
+            {
+                if (dropouts[d] > 0)
+                {
+                    ctx.moveTo(px(times[d]), 0)
+                    ctx.lineTo(px(times[d]), h)
+                }
+            }
+            ctx.stroke()
+
+            for (var s = 0; s < series.length; s++)
+            {
+                ctx.strokeStyle = colors[s % colors.length]
+                ctx.lineWidth = 2
+                ctx.beginPath()
+                ctx.moveTo(px(times[0]), py(series[s][0]))
+                for (var p = 1; p < series[s].length; p++)
+                {
+                    ctx.lineTo(px(times[p]), py(series[s][p]))
+                }
+                ctx.stroke()
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -786,6 +786,106 @@ MyStackViewPage
 			}
         }
 
+        GridLayout
+        {
+			columns: 3
+
+            MyText
+            {
+                Layout.preferredWidth: 360
+                Layout.leftMargin: 0
+                Layout.rightMargin: 0
+                horizontalAlignment: Text.AlignLeft
+                text: "Save Flight Recorder:"
+            }
+
+			MyPushButton
+			{
+				id: btn_dumpFlightRecorder
+				Layout.preferredWidth: 200
+				Layout.topMargin: 0
+				Layout.bottomMargin: 0
+				text: ""
+				onClicked:
+				{
+					if (DeviceManipulationTabController.isDesktopModeActive())
+					{
+						keybinding.showPopup(2);
+					}
+					else
+					{
+						deviceManipulationMessageDialog.showMessage("Shortcuts", "Due to SteamVR limitations, shortcuts\ncan only be set in desktop mode!")
+					}
+				}
+			}
+
+			MyPushButtonIcon
+			{
+				id: btn_dumpFlightRecorder_Remove
+				Layout.preferredWidth: 45
+				Layout.preferredHeight: 45
+				Layout.leftMargin: 20
+				Layout.topMargin: 0
+				Layout.bottomMargin: 0
+				imagesource : "octicons-trashcan.png"
+				onClicked:
+				{
+					DeviceManipulationTabController.removeKey(2);
+					refreshButtonText();
+				}
+			}
+        }
+
+        GridLayout
+        {
+			columns: 3
+
+            MyText
+            {
+                Layout.preferredWidth: 360
+                Layout.leftMargin: 0
+                Layout.rightMargin: 0
+                horizontalAlignment: Text.AlignLeft
+                text: "Record Timing Trace:"
+            }
+
+			MyPushButton
+			{
+				id: btn_toggleTracing
+				Layout.preferredWidth: 200
+				Layout.topMargin: 0
+				Layout.bottomMargin: 0
+				text: ""
+				onClicked:
+				{
+					if (DeviceManipulationTabController.isDesktopModeActive())
+					{
+						keybinding.showPopup(3);
+					}
+					else
+					{
+						deviceManipulationMessageDialog.showMessage("Shortcuts", "Due to SteamVR limitations, shortcuts\ncan only be set in desktop mode!")
+					}
+				}
+			}
+
+			MyPushButtonIcon
+			{
+				id: btn_toggleTracing_Remove
+				Layout.preferredWidth: 45
+				Layout.preferredHeight: 45
+				Layout.leftMargin: 20
+				Layout.topMargin: 0
+				Layout.bottomMargin: 0
+				imagesource : "octicons-trashcan.png"
+				onClicked:
+				{
+					DeviceManipulationTabController.removeKey(3);
+					refreshButtonText();
+				}
+			}
+        }
+
         Item
         {
             Layout.fillWidth: true
@@ -839,5 +939,7 @@ MyStackViewPage
 	{
 		btn_enableMC.text = DeviceManipulationTabController.getModifiers_AsString(0) + DeviceManipulationTabController.getKey_AsString(0);
 		btn_setZeroPose.text = DeviceManipulationTabController.getModifiers_AsString(1) + DeviceManipulationTabController.getKey_AsString(1);
+		btn_dumpFlightRecorder.text = DeviceManipulationTabController.getModifiers_AsString(2) + DeviceManipulationTabController.getKey_AsString(2);
+		btn_toggleTracing.text = DeviceManipulationTabController.getModifiers_AsString(3) + DeviceManipulationTabController.getKey_AsString(3);
 	}
 }
@@ -0,0 +1,181 @@
+import QtQuick 2.9
+import QtQuick.Controls 2.0
+import QtQuick.Layouts 1.3
+import ovrmc.motioncompensation 1.0
+
+MyStackViewPage
+{
+    id: telemetryPage
+	width: 1200
+	height: 800
+    headerText: "Telemetry"
+
+	// Only polls while the page is shown, the controller also skips polls while the dashboard is closed
+	Timer
+	{
+		id: pollTimer
+		interval: 200
+		repeat: true
+		running: telemetryPage.visible
+		onTriggered:
+		{
+			if (!TelemetryTabController.poll() && TelemetryTabController.getErrorString() !== "")
+			{
+				stateText.text = TelemetryTabController.getErrorString()
+				stateText.color = "#ff7070"
+			}
+		}
+	}
+
+    content: ColumnLayout
+    {
+        spacing: 10
+
+        RowLayout
+        {
+            spacing: 40
+
+            MyText
+            {
+                id: stateText
+                font.pointSize: 16
+                text: TelemetryTabController.getStateText()
+            }
+
+            MyText
+            {
+                id: jitterText
+                font.pointSize: 16
+            }
+
+            MyText
+            {
+                id: dropoutText
+                font.pointSize: 16
+            }
+        }
+
+        RowLayout
+        {
+            spacing: 40
+
+            MyText
+            {
+                id: rateText
+                font.pointSize: 16
+            }
+
+            MyText
+            {
+                id: latencyText
+                font.pointSize: 16
+            }
+        }
+
+        GridLayout
+        {
+            columns: 2
+            rowSpacing: 10
+            columnSpacing: 10
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+
+            MyTelemetryPlot
+            {
+                id: offsetPlot
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                title: "Reference offset"
+                unit: "mm"
+                channels: [TelemetryTabController.RefOffsetX, TelemetryTabController.RefOffsetY, TelemetryTabController.RefOffsetZ]
+                labels: ["X", "Y", "Z"]
+            }
+
+            MyTelemetryPlot
+            {
+                id: rotationPlot
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                title: "Reference rotation"
+                unit: "deg"
+                channels: [TelemetryTabController.RefRoll, TelemetryTabController.RefPitch, TelemetryTabController.RefYaw]
+                labels: ["Roll", "Pitch", "Yaw"]
+            }
+
+            MyTelemetryPlot
+            {
+                id: jitterPlot
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                title: "Reference jitter"
+                unit: "mm RMS"
+                channels: [TelemetryTabController.RefJitter]
+                fromZero: true
+            }
+
+            MyTelemetryPlot
+            {
+                id: latencyPlot
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                title: "Hook latency"
+                unit: "µs"
+                channels: [TelemetryTabController.HookLatencyP50, TelemetryTabController.HookLatencyP90, TelemetryTabController.HookLatencyP99]
+                labels: ["p50", "p90", "p99"]
+                fromZero: true
+            }
+
+            MyTelemetryPlot
+            {
+                id: ratePlot
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                title: "Pose rates"
+                unit: "Hz"
+                channels: [TelemetryTabController.RefPoseRate, TelemetryTabController.CompensatedRate, TelemetryTabController.PoseRate]
+                labels: ["Reference", "Compensated", "All"]
+                fromZero: true
+            }
+
+            MyTelemetryPlot
+            {
+                id: dropoutPlot
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                title: "Dropouts"
+                unit: "per sample"
+                channels: [TelemetryTabController.Dropouts]
+                fromZero: true
+            }
+        }
+
+        Connections
+        {
+            target: TelemetryTabController
+            onTelemetryUpdated:
+            {
+                updateTexts()
+                offsetPlot.refresh()
+                rotationPlot.refresh()
+                jitterPlot.refresh()
+                latencyPlot.refresh()
+                ratePlot.refresh()
+                dropoutPlot.refresh()
+            }
+        }
+    }
+
+	function updateTexts()
+	{
+		stateText.text = TelemetryTabController.getStateText()
+		stateText.color = TelemetryTabController.isCompensationActive() ? "#70ff70" : "#ffffff"
+		jitterText.text = "Jitter: " + TelemetryTabController.getValue(TelemetryTabController.RefJitter).toFixed(2) + " mm"
+		dropoutText.text = TelemetryTabController.getDropoutText()
+		rateText.text = "Reference: " + TelemetryTabController.getValue(TelemetryTabController.RefPoseRate).toFixed(0) + " Hz"
+			+ "   Compensated: " + TelemetryTabController.getValue(TelemetryTabController.CompensatedRate).toFixed(0) + " Hz"
+			+ "   All: " + TelemetryTabController.getValue(TelemetryTabController.PoseRate).toFixed(0) + " Hz"
+		latencyText.text = "Hook p50 / p99 / max: " + TelemetryTabController.getValue(TelemetryTabController.HookLatencyP50).toFixed(1)
+			+ " / " + TelemetryTabController.getValue(TelemetryTabController.HookLatencyP99).toFixed(1)
+			+ " / " + TelemetryTabController.getValue(TelemetryTabController.HookLatencyMax).toFixed(1) + " µs"
+	}
+}
\ No newline at end of file
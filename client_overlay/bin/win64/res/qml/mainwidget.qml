@@ -21,6 +21,11 @@ Rectangle
         stackView: mainView
     }
 
+	property TelemetryPage telemetryPage: TelemetryPage
+	{
+        stackView: mainView
+    }
+
     StackView
 	{
         id: mainView
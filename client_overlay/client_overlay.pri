@@ -10,8 +10,10 @@ message("You are running qmake on a generated .pro file. This may not work!")
 HEADERS += ./src/logging.h \
     ./src/overlaycontroller.h \
     ./src/tabcontrollers/DeviceManipulationTabController.h \
+    ./src/tabcontrollers/TelemetryTabController.h \
     ./src/QGlobalShortcut/qglobalshortcut.h
 SOURCES += ./src/main.cpp \
     ./src/overlaycontroller.cpp \
     ./src/tabcontrollers/DeviceManipulationTabController.cpp \
+    ./src/tabcontrollers/TelemetryTabController.cpp \
     ./src/QGlobalShortcut/qglobalshortcut.cpp
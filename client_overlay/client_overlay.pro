@@ -46,10 +46,12 @@ DISTFILES += \
     bin/win64/res/qml/MyResources.qml \
     bin/win64/res/qml/MySlider.qml \
     bin/win64/res/qml/MyStackViewPage.qml \
+    bin/win64/res/qml/MyTelemetryPlot.qml \
     bin/win64/res/qml/MyText.qml \
     bin/win64/res/qml/MyTextField.qml \
     bin/win64/res/qml/MyToggleButton.qml \
     bin/win64/res/qml/SettingsPage.qml \
+    bin/win64/res/qml/TelemetryPage.qml \
     bin/win64/res/qml/backarrow.svg \
     bin/win64/res/qml/mainwidget.qml \
     bin/win64/res/qml/octicons-trashcan.png \
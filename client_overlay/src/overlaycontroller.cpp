@@ -15,6 +15,7 @@
 #include "logging.h"
 #include <vrmotioncompensation_types.h>
 #include <ipc_protocol.h>
+#include <tracespans.h>
 #include <codecvt>
 #include "openvr_math.h"
 
@@ -173,6 +174,12 @@ namespace motioncompensation
 																	  QQmlEngine::setObjectOwnership(obj, QQmlEngine::CppOwnership);
 																	  return obj;
 																  });
+		qmlRegisterSingletonType<TelemetryTabController>("ovrmc.motioncompensation", 1, 0, "TelemetryTabController", [](QQmlEngine*, QJSEngine*)
+														 {
+															 QObject* obj = &getInstance()->telemetryTabController;
+															 QQmlEngine::setObjectOwnership(obj, QQmlEngine::CppOwnership);
+															 return obj;
+														 });
 	}
 
 	void OverlayController::Shutdown()
@@ -268,6 +275,7 @@ namespace motioncompensation
 		}
 
 		deviceManipulationTabController.initStage2(this, m_pWindow.get());
+		telemetryTabController.initStage2(this);
 	}
 
 	void OverlayController::OnRenderRequest()
@@ -280,6 +288,8 @@ namespace motioncompensation
 	
 	void OverlayController::renderOverlay()
 	{
+		TRACE_SPAN("renderOverlay");
+
 		if (!desktopMode)
 		{
 			// skip rendering if the overlay isn't visible
@@ -306,6 +316,8 @@ namespace motioncompensation
 	
 	void OverlayController::OnTimeoutPumpEvents()
 	{
+		TRACE_SPAN("OnTimeoutPumpEvents");
+
 		if (!vr::VRSystem())
 			return;
 
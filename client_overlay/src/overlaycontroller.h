@@ -17,6 +17,7 @@
 #include "logging.h"
 
 #include "tabcontrollers/DeviceManipulationTabController.h"
+#include "tabcontrollers/TelemetryTabController.h"
 
 // application namespace
 namespace motioncompensation
@@ -62,6 +63,7 @@ namespace motioncompensation
 
 	public: // I know it's an ugly hack to make them public to enable external access, but I am too lazy to implement getters.
 		DeviceManipulationTabController deviceManipulationTabController;
+		TelemetryTabController telemetryTabController;
 
 	private:
 		OverlayController(bool desktopMode, bool noSound) : QObject(), desktopMode(desktopMode), noSound(noSound)
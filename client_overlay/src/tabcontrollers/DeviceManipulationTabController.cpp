@@ -4,14 +4,30 @@
 #include "../overlaycontroller.h"
 #include <openvr_math.h>
 #include <ipc_protocol.h>
+#include <tracespans.h>
 #include <chrono>
 #include <QQmlProperty>
+#include <QDir>
+#include <QStandardPaths>
 
 // application namespace
 namespace motioncompensation
 {
 	DeviceManipulationTabController::~DeviceManipulationTabController()
 	{
+		// The handler points at this object
+		if (_driverEventsActive)
+		{
+			try
+			{
+				parent->vrMotionCompensation().subscribeEvents(0, nullptr);
+			}
+			catch (std::exception& e)
+			{
+				LOG(ERROR) << "Could not end the driver event subscription: " << e.what();
+			}
+		}
+
 		if (identifyThread.joinable())
 		{
 			identifyThread.join();
@@ -43,18 +59,133 @@ namespace motioncompensation
 		LOG(DEBUG) << "deviceInfos size: " << deviceInfos.size();
 
 		SearchDevices();
+		subscribeDriverEvents();
 
 		parent->vrMotionCompensation().setOffsets(_offset);
 	}
 
+	void DeviceManipulationTabController::subscribeDriverEvents()
+	{
+		try
+		{
+			parent->vrMotionCompensation().subscribeEvents(DRIVER_EVENT_MASK_ALL, [this](const vrmotioncompensation::DriverEvent_OVRMC_v1& event)
+			{
+				// Called on the ipc thread, only one queued call is needed for a burst of events
+				bool wasEmpty;
+				{
+					std::lock_guard<std::mutex> lock(_driverEventMutex);
+					wasEmpty = _driverEvents.empty();
+					_driverEvents.push_back(event);
+				}
+
+				if (wasEmpty)
+				{
+					QMetaObject::invokeMethod(this, [this]() { processDriverEvents(); }, Qt::QueuedConnection);
+				}
+			});
+			_driverEventsActive = true;
+			LOG(INFO) << "Subscribed to driver events";
+		}
+		catch (std::exception& e)
+		{
+			_driverEventsActive = false;
+			LOG(ERROR) << "Could not subscribe to driver events, falling back to polling: " << e.what();
+		}
+	}
+
+	void DeviceManipulationTabController::processDriverEvents()
+	{
+		std::deque<vrmotioncompensation::DriverEvent_OVRMC_v1> events;
+		{
+			std::lock_guard<std::mutex> lock(_driverEventMutex);
+			events.swap(_driverEvents);
+		}
+
+		bool searchDevices = false;
+		uint32_t dropped = 0;
+		for (auto& event : events)
+		{
+			// Lost events are made up for once after the batch, not once per event that reports them
+			dropped += event.Dropped;
+
+			switch (event.Type)
+			{
+			case vrmotioncompensation::DriverEventType::DeviceAdded:
+			case vrmotioncompensation::DriverEventType::DeviceActivated:
+				searchDevices = true;
+				break;
+
+			case vrmotioncompensation::DriverEventType::DeviceModeChanged:
+				if (event.OpenVRId < deviceInfos.size())
+				{
+					auto mode = (vrmotioncompensation::MotionCompensationDeviceMode)event.Value;
+					auto& info = deviceInfos[event.OpenVRId];
+					if (info->deviceClass != vr::TrackedDeviceClass_Invalid && info->deviceMode != mode)
+					{
+						info->deviceMode = mode;
+						emit deviceInfoChanged(event.OpenVRId);
+					}
+				}
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		if (dropped > 0)
+		{
+			LOG(WARNING) << "Driver dropped " << dropped << " events, reading all device modes";
+			searchDevices = true;
+			for (uint32_t i = 0; i < deviceInfos.size(); ++i)
+			{
+				if (updateDeviceInfo(i))
+				{
+					emit deviceInfoChanged(i);
+				}
+			}
+		}
+
+		if (searchDevices)
+		{
+			SearchDevices();
+		}
+	}
+
+	bool DeviceManipulationTabController::updateConnectionStatus(uint32_t OpenVRId)
+	{
+		if (OpenVRId >= deviceInfos.size())
+		{
+			return false;
+		}
+
+		auto& info = deviceInfos[OpenVRId];
+		unsigned status = vr::VRSystem()->IsTrackedDeviceConnected(OpenVRId) ? 0 : 1;
+		if (info->deviceMode == vrmotioncompensation::MotionCompensationDeviceMode::Default && info->deviceStatus != status)
+		{
+			info->deviceStatus = status;
+			return true;
+		}
+		return false;
+	}
+
 	void DeviceManipulationTabController::eventLoopTick(vr::TrackedDevicePose_t* devicePoses)
 	{
+		// Device changes arrive as driver and OpenVR events
+		if (_driverEventsActive)
+		{
+			return;
+		}
+
 		if (settingsUpdateCounter >= 50)
 		{
 			settingsUpdateCounter = 0;			
 
 			if (parent->isDashboardVisible() || parent->isDesktopMode())
 			{
+				readDeviceStates();
+				_deviceStatesFresh = true;
+
 				unsigned i = 0;
 				for (auto info : deviceInfos)
 				{
@@ -79,6 +210,7 @@ namespace motioncompensation
 				}
 
 				SearchDevices();
+				_deviceStatesFresh = false;
 			}
 		}
 		else
@@ -91,6 +223,11 @@ namespace motioncompensation
 	{
 		bool newDeviceAdded = false;
 
+		if (!_deviceStatesFresh)
+		{
+			readDeviceStates();
+		}
+
 		try
 		{
 			// Get some infos about the found devices
@@ -121,16 +258,7 @@ namespace motioncompensation
 						}
 
 						// Get and save the current device mode
-						try
-						{
-							vrmotioncompensation::DeviceInfo info2;
-							parent->vrMotionCompensation().getDeviceInfo(info->openvrId, info2);
-							info->deviceMode = info2.deviceMode;
-						}
-						catch (std::exception& e)
-						{
-							LOG(ERROR) << "Exception caught while getting device info: " << e.what();
-						}
+						getDriverDeviceMode(info->openvrId, info->deviceMode);
 
 						// Store the found info
 						deviceInfos[id] = info;
@@ -159,9 +287,33 @@ namespace motioncompensation
 		return newDeviceAdded;
 	}
 	
-	void DeviceManipulationTabController::handleEvent(const vr::VREvent_t&)
+	void DeviceManipulationTabController::handleEvent(const vr::VREvent_t& vrEvent)
 	{
+		switch (vrEvent.eventType)
+		{
+		case vr::VREvent_TrackedDeviceActivated:
+		{
+			SearchDevices();
+			if (updateConnectionStatus(vrEvent.trackedDeviceIndex))
+			{
+				emit deviceInfoChanged(vrEvent.trackedDeviceIndex);
+			}
+		}
+		break;
 
+		case vr::VREvent_TrackedDeviceDeactivated:
+		case vr::VREvent_TrackedDeviceUpdated:
+		{
+			if (updateConnectionStatus(vrEvent.trackedDeviceIndex))
+			{
+				emit deviceInfoChanged(vrEvent.trackedDeviceIndex);
+			}
+		}
+		break;
+
+		default:
+			break;
+		}
 	}
 
 	void DeviceManipulationTabController::reloadMotionCompensationSettings()
@@ -198,6 +350,14 @@ namespace motioncompensation
 		Qt::KeyboardModifiers shortcutMod_2 = settings->value("shortcut_1_mod", Qt::KeyboardModifier::NoModifier).toInt();
 		newKey(1, shortcutKey, shortcutMod_2);
 
+		shortcutKey = (Qt::Key)settings->value("shortcut_2_key", Qt::Key::Key_unknown).toInt();
+		Qt::KeyboardModifiers shortcutMod_3 = settings->value("shortcut_2_mod", Qt::KeyboardModifier::NoModifier).toInt();
+		newKey(2, shortcutKey, shortcutMod_3);
+
+		shortcutKey = (Qt::Key)settings->value("shortcut_3_key", Qt::Key::Key_unknown).toInt();
+		Qt::KeyboardModifiers shortcutMod_4 = settings->value("shortcut_3_mod", Qt::KeyboardModifier::NoModifier).toInt();
+		newKey(3, shortcutKey, shortcutMod_4);
+
 		settings->endGroup();
 		LOG(INFO) << "Loading saved Settings";
 	}
@@ -241,6 +401,10 @@ namespace motioncompensation
 		settings->setValue("shortcut_0_mod", (int)getModifiers_AsModifiers(0));
 		settings->setValue("shortcut_1_key", getKey_AsKey(1));
 		settings->setValue("shortcut_1_mod", (int)getModifiers_AsModifiers(1));
+		settings->setValue("shortcut_2_key", getKey_AsKey(2));
+		settings->setValue("shortcut_2_mod", (int)getModifiers_AsModifiers(2));
+		settings->setValue("shortcut_3_key", getKey_AsKey(3));
+		settings->setValue("shortcut_3_mod", (int)getModifiers_AsModifiers(3));
 
 		settings->endGroup();
 		settings->sync();
@@ -250,6 +414,8 @@ namespace motioncompensation
 	{
 		NewShortcut(0, &DeviceManipulationTabController::toggleMotionCompensationMode, "Enable / Disable Motion Compensation");
 		NewShortcut(1, &DeviceManipulationTabController::resetRefZeroPose, "Reset reference zero pose");
+		NewShortcut(2, &DeviceManipulationTabController::dumpFlightRecorder, "Save the last seconds of poses to disk");
+		NewShortcut(3, &DeviceManipulationTabController::toggleTracing, "Start / Stop the timing trace");
 	}
 
 	void DeviceManipulationTabController::NewShortcut(int id, void (DeviceManipulationTabController::* method)(), QString description)
@@ -455,26 +621,74 @@ namespace motioncompensation
 
 		if (OpenVRId < deviceInfos.size())
 		{
-			try
+			if (!_deviceStatesFresh)
 			{
-				vrmotioncompensation::DeviceInfo info;
-
-				parent->vrMotionCompensation().getDeviceInfo(deviceInfos[OpenVRId]->openvrId, info);
-				if (deviceInfos[OpenVRId]->deviceMode != info.deviceMode)
-				{
-					deviceInfos[OpenVRId]->deviceMode = info.deviceMode;
-					retval = true;
-				}
+				readDeviceStates();
 			}
-			catch (std::exception& e)
+
+			vrmotioncompensation::MotionCompensationDeviceMode deviceMode;
+			if (getDriverDeviceMode(deviceInfos[OpenVRId]->openvrId, deviceMode) && deviceInfos[OpenVRId]->deviceMode != deviceMode)
 			{
-				LOG(ERROR) << "Exception caught while getting device info: " << e.what();
+				deviceInfos[OpenVRId]->deviceMode = deviceMode;
+				retval = true;
 			}
 		}
 
 		return retval;
 	}
 
+	void DeviceManipulationTabController::readDeviceStates()
+	{
+		if (!_deviceStates)
+		{
+			_deviceStates.reset(new vrmotioncompensation::DeviceStates_OVRMC_v1);
+		}
+
+		try
+		{
+			parent->vrMotionCompensation().getDeviceStates(*_deviceStates);
+			_deviceStatesValid = true;
+			_deviceStatesErrorLogged = false;
+		}
+		catch (std::exception& e)
+		{
+			// Falls back to asking the driver for every device
+			_deviceStatesValid = false;
+			if (!_deviceStatesErrorLogged)
+			{
+				LOG(ERROR) << "Could not read the device states of the driver: " << e.what();
+				_deviceStatesErrorLogged = true;
+			}
+		}
+	}
+
+	bool DeviceManipulationTabController::getDriverDeviceMode(uint32_t OpenVRId, vrmotioncompensation::MotionCompensationDeviceMode& DeviceMode)
+	{
+		if (_deviceStatesValid && OpenVRId < vr::k_unMaxTrackedDeviceCount)
+		{
+			const vrmotioncompensation::DeviceState_OVRMC_v1& state = _deviceStates->Devices[OpenVRId];
+			if (!state.Valid)
+			{
+				return false;
+			}
+			DeviceMode = state.DeviceMode;
+			return true;
+		}
+
+		try
+		{
+			vrmotioncompensation::DeviceInfo info;
+			parent->vrMotionCompensation().getDeviceInfo(OpenVRId, info);
+			DeviceMode = info.deviceMode;
+			return true;
+		}
+		catch (std::exception& e)
+		{
+			LOG(ERROR) << "Exception caught while getting device info: " << e.what();
+		}
+		return false;
+	}
+
 	void DeviceManipulationTabController::toggleMotionCompensationMode()
 	{
 		int MCid = -1;
@@ -844,6 +1058,70 @@ namespace motioncompensation
 		}
 	}
 
+	void DeviceManipulationTabController::dumpFlightRecorder()
+	{
+		try
+		{
+			LOG(INFO) << "Dumping flight recorder";
+			parent->vrMotionCompensation().dumpFlightRecorder();
+		}
+		catch (vrmotioncompensation::vrmotioncompensation_exception& e)
+		{
+			m_deviceModeErrorString = "Could not save the flight recorder";
+			LOG(ERROR) << "Exception caught while dumping flight recorder: " << e.what();
+		}
+		catch (std::exception& e)
+		{
+			m_deviceModeErrorString = "Unknown exception";
+			LOG(ERROR) << "Exception caught while dumping flight recorder: " << e.what();
+		}
+	}
+
+	// The driver writes its spans first, the overlay appends its own, so both processes end up on one timeline
+	void DeviceManipulationTabController::toggleTracing()
+	{
+		vrmotioncompensation::trace::SpanTracer& tracer = vrmotioncompensation::trace::SpanTracer::instance();
+
+		try
+		{
+			if (!tracer.IsRunning())
+			{
+				LOG(INFO) << "Starting timing trace";
+				parent->vrMotionCompensation().setTracing(true);
+				tracer.Start();
+			}
+			else
+			{
+				tracer.Stop();
+				QString fileName = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).absoluteFilePath("VRMotionCompensation_trace.json");
+				std::string nativeFileName = QDir::toNativeSeparators(fileName).toStdString();
+
+				parent->vrMotionCompensation().setTracing(false, nativeFileName);
+				if (tracer.Export(nativeFileName, "client_overlay", true))
+				{
+					LOG(INFO) << "Timing trace written to " << nativeFileName;
+				}
+				else
+				{
+					m_deviceModeErrorString = "Could not write the timing trace";
+					LOG(ERROR) << "Could not append the overlay spans to " << nativeFileName;
+				}
+			}
+		}
+		catch (vrmotioncompensation::vrmotioncompensation_exception& e)
+		{
+			tracer.Stop();
+			m_deviceModeErrorString = "Could not record the timing trace";
+			LOG(ERROR) << "Exception caught while toggling the timing trace: " << e.what();
+		}
+		catch (std::exception& e)
+		{
+			tracer.Stop();
+			m_deviceModeErrorString = "Unknown exception";
+			LOG(ERROR) << "Exception caught while toggling the timing trace: " << e.what();
+		}
+	}
+
 	QString DeviceManipulationTabController::getDeviceModeErrorString()
 	{
 		return m_deviceModeErrorString;
@@ -938,13 +1216,29 @@ namespace motioncompensation
 	void DeviceManipulationTabController::setHMDtoRefTranslationOffset(unsigned axis, double value)
 	{
 		_offset.Translation.v[axis] = value;
-		parent->vrMotionCompensation().setOffsets(_offset);
+		sendOffsets();
 	}
 
 	void DeviceManipulationTabController::setHMDtoRefRotationOffset(unsigned axis, double value)
 	{
 		_offset.Rotation.v[axis] = value;
-		parent->vrMotionCompensation().setOffsets(_offset);
+		sendOffsets();
+	}
+
+	void DeviceManipulationTabController::sendOffsets()
+	{
+		// Sliders send a request per step, waiting for each reply would stall the UI
+		parent->vrMotionCompensation().setOffsetsAsync(_offset, [](std::future<void> result)
+		{
+			try
+			{
+				result.get();
+			}
+			catch (std::exception& e)
+			{
+				LOG(ERROR) << "Exception caught while setting offsets: " << e.what();
+			}
+		});
 	}
 
 	void DeviceManipulationTabController::increaseRefTranslationOffset(unsigned axis, double value)
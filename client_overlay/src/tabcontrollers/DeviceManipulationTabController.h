@@ -2,7 +2,9 @@
 
 #include <QObject>
 #include <QString>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <openvr.h>
 #include <vrmotioncompensation.h>
 #include <vrmotioncompensation_types.h>
@@ -55,7 +57,7 @@ namespace motioncompensation
 		QQuickWindow* widget;
 
 		// Shortcut related
-		ShortcutStruct shortcut[2];
+		ShortcutStruct shortcut[4];
 
 		// Device and ID storage
 		std::vector<std::shared_ptr<DeviceInfo>> deviceInfos;		// Holds all device infos. The index represents the OpenVR ID. Therefore there are many empty fields in this array
@@ -84,6 +86,25 @@ namespace motioncompensation
 		std::thread identifyThread;
 		unsigned settingsUpdateCounter = 0;
 
+		// Device modes published by the driver in shared memory, replaces one getDeviceInfo request per device
+		std::unique_ptr<vrmotioncompensation::DeviceStates_OVRMC_v1> _deviceStates;
+		bool _deviceStatesValid = false;
+		bool _deviceStatesFresh = false;		// Read during this event loop tick
+		bool _deviceStatesErrorLogged = false;
+
+		// Events pushed by the driver, they arrive on the ipc thread and are handled in the Qt thread.
+		// Polling the device modes is only the fallback for drivers without events.
+		std::deque<vrmotioncompensation::DriverEvent_OVRMC_v1> _driverEvents;
+		std::mutex _driverEventMutex;
+		bool _driverEventsActive = false;
+
+		void readDeviceStates();
+		bool getDriverDeviceMode(uint32_t OpenVRId, vrmotioncompensation::MotionCompensationDeviceMode& DeviceMode);
+		void subscribeDriverEvents();
+		void processDriverEvents();
+		bool updateConnectionStatus(uint32_t OpenVRId);
+		void sendOffsets();
+
 	public:
 
 		~DeviceManipulationTabController();
@@ -148,6 +169,8 @@ namespace motioncompensation
 		bool sendMCSettings();
 		//bool applySettings_ovrid(unsigned MCid, unsigned RTid, bool EnableMotionCompensation);
 		void resetRefZeroPose();
+		void dumpFlightRecorder();
+		void toggleTracing();
 		Q_INVOKABLE QString getDeviceModeErrorString();
 		Q_INVOKABLE bool isDesktopModeActive();
 
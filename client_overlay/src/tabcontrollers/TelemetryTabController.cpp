@@ -0,0 +1,178 @@
+#include "TelemetryTabController.h"
+#include "../overlaycontroller.h"
+
+// application namespace
+namespace motioncompensation
+{
+	void TelemetryTabController::initStage2(OverlayController* parent)
+	{
+		this->parent = parent;
+	}
+
+	bool TelemetryTabController::poll()
+	{
+		// Nobody can see the plots, so don't bother the driver
+		if (!parent || (!parent->isDashboardVisible() && !parent->isDesktopMode()))
+		{
+			return false;
+		}
+
+		vrmotioncompensation::Telemetry_OVRMC_v1 telemetry;
+		try
+		{
+			parent->vrMotionCompensation().getTelemetry(telemetry);
+		}
+		catch (vrmotioncompensation::vrmotioncompensation_exception& e)
+		{
+			_errorString = "Could not get telemetry from the driver";
+			LOG(ERROR) << "Exception caught while getting telemetry: " << e.what();
+			return false;
+		}
+		catch (std::exception& e)
+		{
+			_errorString = "Unknown exception";
+			LOG(ERROR) << "Exception caught while getting telemetry: " << e.what();
+			return false;
+		}
+		_errorString = "";
+
+		// Rates need two snapshots. Counters going backwards mean the driver was restarted.
+		if (!_lastTelemetryValid || telemetry.TimestampMicroseconds <= _lastTelemetry.TimestampMicroseconds || telemetry.PosesSeen < _lastTelemetry.PosesSeen)
+		{
+			_lastTelemetry = telemetry;
+			_lastTelemetryValid = true;
+			return true;
+		}
+
+		double interval = (double)(telemetry.TimestampMicroseconds - _lastTelemetry.TimestampMicroseconds) / 1.0E6;
+		uint64_t dropouts = (telemetry.RefPoseRejected - _lastTelemetry.RefPoseRejected)
+			+ (telemetry.RefPoseTimeGaps - _lastTelemetry.RefPoseTimeGaps)
+			+ (telemetry.RefPoseStale - _lastTelemetry.RefPoseStale);
+
+		Sample sample;
+		sample.Time = (double)telemetry.TimestampMicroseconds / 1.0E6;
+		for (int i = 0; i < 3; i++)
+		{
+			sample.Values[RefOffsetX + i] = telemetry.RefOffset[i] * 1000.0;
+			sample.Values[RefRoll + i] = telemetry.RefRotation[i];
+		}
+		sample.Values[RefJitter] = telemetry.RefJitter * 1000.0;
+		sample.Values[RefPoseRate] = (double)(telemetry.RefPoseUpdates - _lastTelemetry.RefPoseUpdates) / interval;
+		sample.Values[CompensatedRate] = (double)(telemetry.Compensated - _lastTelemetry.Compensated) / interval;
+		sample.Values[PoseRate] = (double)(telemetry.PosesSeen - _lastTelemetry.PosesSeen) / interval;
+		sample.Values[HookLatencyP50] = (double)telemetry.HookLatencyP50 / 1000.0;
+		sample.Values[HookLatencyP90] = (double)telemetry.HookLatencyP90 / 1000.0;
+		sample.Values[HookLatencyP99] = (double)telemetry.HookLatencyP99 / 1000.0;
+		sample.Values[HookLatencyMax] = (double)telemetry.HookLatencyMax / 1000.0;
+		sample.Values[Dropouts] = (double)dropouts;
+
+		if (dropouts > 0)
+		{
+			_totalDropouts += dropouts;
+			_lastDropoutTime = sample.Time;
+		}
+
+		_samples.push_back(sample);
+		while (_samples.front().Time < sample.Time - _historySeconds)
+		{
+			_samples.pop_front();
+		}
+
+		_lastTelemetry = telemetry;
+		emit telemetryUpdated();
+
+		return true;
+	}
+
+	void TelemetryTabController::clearHistory()
+	{
+		_samples.clear();
+		_totalDropouts = 0;
+		_lastDropoutTime = -1.0;
+		emit telemetryUpdated();
+	}
+
+	double TelemetryTabController::getHistorySeconds()
+	{
+		return _historySeconds;
+	}
+
+	// Seconds relative to the newest sample, so the plots scroll from the left to 0 on the right
+	QVariantList TelemetryTabController::getTimes()
+	{
+		QVariantList times;
+		if (!_samples.empty())
+		{
+			double newest = _samples.back().Time;
+			for (auto& sample : _samples)
+			{
+				times.append(sample.Time - newest);
+			}
+		}
+		return times;
+	}
+
+	QVariantList TelemetryTabController::getChannel(int channel)
+	{
+		QVariantList values;
+		if (channel >= 0 && channel < ChannelCount)
+		{
+			for (auto& sample : _samples)
+			{
+				values.append(sample.Values[channel]);
+			}
+		}
+		return values;
+	}
+
+	double TelemetryTabController::getValue(int channel)
+	{
+		if (_samples.empty() || channel < 0 || channel >= ChannelCount)
+		{
+			return 0.0;
+		}
+		return _samples.back().Values[channel];
+	}
+
+	bool TelemetryTabController::isCompensationActive()
+	{
+		return _lastTelemetryValid && _lastTelemetry.Enabled && _lastTelemetry.ZeroPoseValid && _lastTelemetry.RefPoseValid;
+	}
+
+	QString TelemetryTabController::getStateText()
+	{
+		if (!_lastTelemetryValid)
+		{
+			return "No data from the driver";
+		}
+		else if (!_lastTelemetry.Enabled)
+		{
+			return "Motion compensation is disabled";
+		}
+		else if (!_lastTelemetry.RefPoseValid)
+		{
+			return "Waiting for the reference tracker";
+		}
+		else if (!_lastTelemetry.ZeroPoseValid)
+		{
+			return "Waiting for the zero pose";
+		}
+		return "Motion compensation is active";
+	}
+
+	QString TelemetryTabController::getDropoutText()
+	{
+		if (_totalDropouts == 0)
+		{
+			return "No dropouts";
+		}
+
+		double age = (double)_lastTelemetry.TimestampMicroseconds / 1.0E6 - _lastDropoutTime;
+		return QString("%1 dropouts, last %2 s ago").arg(_totalDropouts).arg(age, 0, 'f', 1);
+	}
+
+	QString TelemetryTabController::getErrorString()
+	{
+		return _errorString;
+	}
+} // namespace motioncompensation
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVariantList>
+#include <deque>
+#include <vrmotioncompensation.h>
+#include <vrmotioncompensation_types.h>
+
+// application namespace
+namespace motioncompensation
+{
+	// forward declaration
+	class OverlayController;
+
+	// Polls the telemetry snapshot of the driver and keeps a short history of it for the plots of the telemetry page
+	class TelemetryTabController : public QObject
+	{
+		Q_OBJECT
+
+	public:
+		// Plottable values of one sample
+		enum Channel
+		{
+			RefOffsetX,				// Millimeters
+			RefOffsetY,
+			RefOffsetZ,
+			RefRoll,				// Degrees, rotation about x
+			RefPitch,
+			RefYaw,
+			RefJitter,				// Millimeters RMS
+			RefPoseRate,			// Poses per second
+			CompensatedRate,
+			PoseRate,
+			HookLatencyP50,			// Microseconds
+			HookLatencyP90,
+			HookLatencyP99,
+			HookLatencyMax,
+			Dropouts,				// Rejected, time gap and stale reference poses since the previous sample
+			ChannelCount
+		};
+		Q_ENUM(Channel)
+
+	private:
+		struct Sample
+		{
+			double Time;			// Seconds, relative to the newest sample when handed to QML
+			double Values[ChannelCount];
+		};
+
+		OverlayController* parent;
+
+		std::deque<Sample> _samples;
+		vrmotioncompensation::Telemetry_OVRMC_v1 _lastTelemetry;
+		bool _lastTelemetryValid = false;
+		uint64_t _totalDropouts = 0;
+		double _lastDropoutTime = -1.0;
+		QString _errorString;
+
+		// Samples older than this are dropped
+		static constexpr double _historySeconds = 30.0;
+
+	public:
+		void initStage2(OverlayController* parent);
+
+		// Fetches a new snapshot from the driver. Does nothing while neither the dashboard nor the desktop window is visible.
+		Q_INVOKABLE bool poll();
+		Q_INVOKABLE void clearHistory();
+
+		Q_INVOKABLE double getHistorySeconds();
+		Q_INVOKABLE QVariantList getTimes();
+		Q_INVOKABLE QVariantList getChannel(int channel);
+		Q_INVOKABLE double getValue(int channel);
+
+		Q_INVOKABLE bool isCompensationActive();
+		Q_INVOKABLE QString getStateText();
+		Q_INVOKABLE QString getDropoutText();
+		Q_INVOKABLE QString getErrorString();
+
+	signals:
+		void telemetryUpdated();
+	};
+} // namespace motioncompensation
\ No newline at end of file
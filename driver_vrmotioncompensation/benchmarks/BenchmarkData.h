@@ -0,0 +1,73 @@
+#pragma once
+
+#include <devicemanipulation/MotionGenerator.h>
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <vector>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// Time one pose may take in the pose hook, the HMD pose rate of ~6000 updates per second across all hooked devices
+		static constexpr double PoseBudgetSeconds = 166e-6;
+
+		// Measures the wall time of a benchmark loop and reports it against the per-pose budget.
+		// BudgetUs is the budget, PoseBudgetPct the share of it one pose uses. Start it right before the loop.
+		class PoseBudget
+		{
+		public:
+			PoseBudget() : _start(std::chrono::steady_clock::now())
+			{
+			}
+
+			void Report(benchmark::State& State, int64_t PosesPerIteration = 1)
+			{
+				double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+				double Poses = (double)State.iterations() * (double)PosesPerIteration;
+
+				State.counters["BudgetUs"] = PoseBudgetSeconds * 1.0E6;
+				State.counters["PoseBudgetPct"] = Poses > 0 ? 100.0 * Seconds / (Poses * PoseBudgetSeconds) : 0.0;
+			}
+
+		private:
+			std::chrono::steady_clock::time_point _start;
+		};
+
+		// Reproducible poses of a swaying rig shared by all cases, HMD and reference tracker interleaved in time order
+		inline const GeneratedMotion& benchmarkMotion()
+		{
+			static const GeneratedMotion Motion = []()
+			{
+				MotionGeneratorSettings Settings;
+				Settings.Duration = 2.0;
+				Settings.SwayRoll = 0.05;
+				Settings.SwayPitch = 0.1;
+				Settings.SwayHeave = 0.05;
+				Settings.SwayFrequency = 0.5;
+				Settings.PositionNoise = 0.0005;
+				Settings.RotationNoise = 0.001;
+				return MotionGenerator(Settings).Generate();
+			}();
+
+			return Motion;
+		}
+
+		// Poses of one device out of benchmarkMotion()
+		inline std::vector<vr::DriverPose_t> benchmarkPoses(uint32_t OpenVRId)
+		{
+			std::vector<vr::DriverPose_t> Poses;
+			for (auto& Entry : benchmarkMotion().Input)
+			{
+				if (Entry.OpenVRId == OpenVRId)
+				{
+					Poses.push_back(Entry.Pose);
+				}
+			}
+
+			return Poses;
+		}
+	}
+}
@@ -0,0 +1,136 @@
+#include "BenchmarkData.h"
+
+#include <devicemanipulation/MotionCompensationManager.h>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		namespace
+		{
+			// A manager in reference tracker mode with a zero pose and a valid reference pose
+			struct CompensationFixture
+			{
+				MotionCompensationManager Manager;
+				std::vector<PoseRecord> Tracker;
+				std::vector<vr::DriverPose_t> Hmd;
+				MotionGeneratorSettings Settings;
+
+				CompensationFixture(uint32_t Samples, double LpfBeta) : Manager(nullptr)
+				{
+					for (auto& Entry : benchmarkMotion().Input)
+					{
+						if (Entry.OpenVRId == Settings.TrackerId)
+						{
+							Tracker.push_back(Entry);
+						}
+						else if (Entry.OpenVRId == Settings.HmdId)
+						{
+							Hmd.push_back(Entry.Pose);
+						}
+					}
+
+					Manager.setAlpha(Samples);
+					Manager.setLpfBeta(LpfBeta);
+					Manager.setMotionCompensationMode(MotionCompensationMode::ReferenceTracker, Settings.HmdId, Settings.TrackerId);
+					Manager.setZeroPose(Tracker.front().Pose);
+					for (auto& Entry : Tracker)
+					{
+						Manager.updateRefPose(Entry.Pose, timeOf(Entry));
+					}
+				}
+
+				// Recorded timestamps are nanoseconds, the manager takes microseconds
+				static long long timeOf(const PoseRecord& Entry)
+				{
+					return (long long)(Entry.Timestamp / 1000);
+				}
+			};
+		}
+
+		// Reference tracker pose through the anomaly detector, DEMA, both slerp stages and the velocity estimation.
+		// Arguments: DEMA samples, slerp beta in percent (100 bypasses the rotation filter)
+		static void BM_UpdateRefPose(benchmark::State& State)
+		{
+			CompensationFixture Fixture((uint32_t)State.range(0), (double)State.range(1) / 100.0);
+			const size_t Size = Fixture.Tracker.size();
+			const long long Period = CompensationFixture::timeOf(Fixture.Tracker.back()) - CompensationFixture::timeOf(Fixture.Tracker.front()) + 3000;
+			long long Offset = Period;
+			size_t i = 0;
+
+			PoseBudget Budget;
+			for (auto _ : State)
+			{
+				// Keep the time running forward when the trace wraps around, a jump back would count as a time gap
+				Fixture.Manager.updateRefPose(Fixture.Tracker[i].Pose, CompensationFixture::timeOf(Fixture.Tracker[i]) + Offset);
+				if (++i == Size)
+				{
+					i = 0;
+					Offset += Period;
+				}
+			}
+
+			Budget.Report(State);
+			State.SetItemsProcessed(State.iterations());
+		}
+		BENCHMARK(BM_UpdateRefPose)->Args({ 100, 20 })->Args({ 100, 100 })->Args({ 1, 100 });
+
+		// HMD pose compensated against the current reference pose
+		static void BM_ApplyMotionCompensation(benchmark::State& State)
+		{
+			CompensationFixture Fixture(100, 0.2);
+			const size_t Size = Fixture.Hmd.size();
+			size_t i = 0;
+
+			PoseBudget Budget;
+			for (auto _ : State)
+			{
+				vr::DriverPose_t Pose = Fixture.Hmd[i];
+				benchmark::DoNotOptimize(Fixture.Manager.applyMotionCompensation(Pose));
+				benchmark::DoNotOptimize(Pose);
+				if (++i == Size)
+				{
+					i = 0;
+				}
+			}
+
+			Budget.Report(State);
+			State.SetItemsProcessed(State.iterations());
+		}
+		BENCHMARK(BM_ApplyMotionCompensation);
+
+		// One reference pose followed by the HMD poses that arrive until the next one, the pose hook work of one tracker period
+		static void BM_TrackerPeriod(benchmark::State& State)
+		{
+			CompensationFixture Fixture(100, 0.2);
+			const size_t PerTracker = Fixture.Hmd.size() / Fixture.Tracker.size();
+			const size_t Size = Fixture.Tracker.size();
+			const long long Period = CompensationFixture::timeOf(Fixture.Tracker.back()) - CompensationFixture::timeOf(Fixture.Tracker.front()) + 3000;
+			long long Offset = Period;
+			size_t i = 0;
+
+			PoseBudget Budget;
+			for (auto _ : State)
+			{
+				Fixture.Manager.updateRefPose(Fixture.Tracker[i].Pose, CompensationFixture::timeOf(Fixture.Tracker[i]) + Offset);
+				for (size_t j = 0; j < PerTracker; j++)
+				{
+					vr::DriverPose_t Pose = Fixture.Hmd[i * PerTracker + j];
+					Fixture.Manager.applyMotionCompensation(Pose);
+					benchmark::DoNotOptimize(Pose);
+				}
+
+				if (++i == Size)
+				{
+					i = 0;
+					Offset += Period;
+				}
+			}
+
+			// Budget per pose, so count every pose of the period
+			Budget.Report(State, (int64_t)(PerTracker + 1));
+			State.SetItemsProcessed(State.iterations() * (int64_t)(PerTracker + 1));
+		}
+		BENCHMARK(BM_TrackerPeriod);
+	}
+}
@@ -0,0 +1,158 @@
+#include "BenchmarkData.h"
+
+#include <devicemanipulation/MotionCompensationManager.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// Wall time every contention run lasts
+		static constexpr double ContentionSeconds = 0.5;
+
+		// One thread feeds reference poses at the tracker rate while the reader threads compensate HMD poses, like the pose hook threads of SteamVR.
+		// All of them meet at the lock around the zero and reference pose. Reported are the latency percentiles of applyMotionCompensation,
+		// the contended lock() calls with the pause instructions they spun and the compensated poses per second of all readers together.
+		// Arguments: reader threads, HMD poses per second of every reader (0 runs the readers flat out)
+		static void BM_PoseLockContention(benchmark::State& State)
+		{
+			MotionCompensationManager Manager(nullptr);
+			MotionGeneratorSettings Settings;
+			std::vector<PoseRecord> Tracker;
+			std::vector<vr::DriverPose_t> Hmd;
+			for (auto& Entry : benchmarkMotion().Input)
+			{
+				if (Entry.OpenVRId == Settings.TrackerId)
+				{
+					Tracker.push_back(Entry);
+				}
+				else if (Entry.OpenVRId == Settings.HmdId)
+				{
+					Hmd.push_back(Entry.Pose);
+				}
+			}
+
+			// Recorded timestamps are nanoseconds, the manager takes microseconds
+			auto TimeOf = [](const PoseRecord& Entry)
+			{
+				return (long long)(Entry.Timestamp / 1000);
+			};
+
+			Manager.setMotionCompensationMode(MotionCompensationMode::ReferenceTracker, Settings.HmdId, Settings.TrackerId);
+			Manager.setZeroPose(Tracker.front().Pose);
+			for (auto& Entry : Tracker)
+			{
+				Manager.updateRefPose(Entry.Pose, TimeOf(Entry));
+			}
+
+			const uint32_t Readers = (uint32_t)State.range(0);
+			const double HmdRate = (double)State.range(1);
+			const long long Period = TimeOf(Tracker.back()) - TimeOf(Tracker.front()) + 3000;
+
+			std::vector<double> Latencies;
+			uint64_t Poses = 0;
+			double Seconds = 0.0;
+			uint64_t Contentions = Manager.poseLock().contentions();
+			uint64_t Spins = Manager.poseLock().spins();
+
+			for (auto _ : State)
+			{
+				std::atomic<bool> Running(true);
+				std::vector<std::vector<double>> Samples(Readers);
+
+				std::thread Writer([&]()
+				{
+					auto Interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / Settings.TrackerRate));
+					auto Next = std::chrono::steady_clock::now();
+					long long Offset = Period;
+					for (size_t i = 0; Running.load(std::memory_order_relaxed);)
+					{
+						// Keep the time running forward when the trace wraps around, a jump back would count as a time gap
+						Manager.updateRefPose(Tracker[i].Pose, TimeOf(Tracker[i]) + Offset);
+						if (++i == Tracker.size())
+						{
+							i = 0;
+							Offset += Period;
+						}
+
+						Next += Interval;
+						std::this_thread::sleep_until(Next);
+					}
+				});
+
+				std::vector<std::thread> Threads;
+				auto Start = std::chrono::steady_clock::now();
+				for (uint32_t Reader = 0; Reader < Readers; Reader++)
+				{
+					Threads.emplace_back([&, Reader]()
+					{
+						std::vector<double>& Own = Samples[Reader];
+						Own.reserve(HmdRate > 0.0 ? (size_t)(HmdRate * ContentionSeconds * 1.1) + 16 : 1 << 20);
+
+						auto Interval = HmdRate > 0.0 ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / HmdRate)) : std::chrono::steady_clock::duration::zero();
+						auto Next = std::chrono::steady_clock::now();
+						for (size_t i = Reader; Running.load(std::memory_order_relaxed); i++)
+						{
+							vr::DriverPose_t Pose = Hmd[i % Hmd.size()];
+
+							auto Before = std::chrono::steady_clock::now();
+							Manager.applyMotionCompensation(Pose);
+							benchmark::DoNotOptimize(Pose);
+							Own.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Before).count());
+
+							if (HmdRate > 0.0)
+							{
+								Next += Interval;
+								std::this_thread::sleep_until(Next);
+							}
+						}
+					});
+				}
+
+				std::this_thread::sleep_for(std::chrono::duration<double>(ContentionSeconds));
+				Running = false;
+				for (auto& Thread : Threads)
+				{
+					Thread.join();
+				}
+				Seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+				Writer.join();
+
+				for (auto& Own : Samples)
+				{
+					Poses += Own.size();
+					Latencies.insert(Latencies.end(), Own.begin(), Own.end());
+				}
+			}
+
+			std::sort(Latencies.begin(), Latencies.end());
+			auto Percentile = [&Latencies](double P)
+			{
+				return Latencies.empty() ? 0.0 : Latencies[std::min(Latencies.size() - 1, (size_t)(P * Latencies.size()))];
+			};
+
+			State.counters["p50_us"] = Percentile(0.5);
+			State.counters["p99_us"] = Percentile(0.99);
+			State.counters["p999_us"] = Percentile(0.999);
+			State.counters["Contentions"] = (double)(Manager.poseLock().contentions() - Contentions);
+			State.counters["Spins"] = (double)(Manager.poseLock().spins() - Spins);
+			State.counters["PosesPerSecond"] = Seconds > 0.0 ? (double)Poses / Seconds : 0.0;
+			State.SetItemsProcessed((int64_t)Poses);
+		}
+		BENCHMARK(BM_PoseLockContention)
+			->Apply([](benchmark::internal::Benchmark* Benchmark)
+			{
+				for (int64_t Readers : { 1, 2, 4, 8 })
+				{
+					Benchmark->Args({ Readers, 1100 });
+					Benchmark->Args({ Readers, 0 });
+				}
+			})
+			->Iterations(1)
+			->UseRealTime()
+			->Unit(benchmark::kMillisecond);
+	}
+}
@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+
+#include <ipc_benchmark.h>
+
+namespace vrmotioncompensation
+{
+	namespace ipc
+	{
+		static void _report(benchmark::State& State, const TransportBenchmarkResult& Result)
+		{
+			State.counters["mean_us"] = Result.Mean;
+			State.counters["p50_us"] = Result.P50;
+			State.counters["p99_us"] = Result.P99;
+			State.counters["max_us"] = Result.Max;
+			State.counters["RequestsPerSecond"] = Result.RequestsPerSecond;
+			State.SetItemsProcessed((int64_t)Result.RoundTrips);
+		}
+
+		// Round trips through the shared memory rings of the driver ipc with an echo thread on the other side.
+		// Argument: requests in flight, 1 is a blocking client call
+		static void BM_IpcShmRing(benchmark::State& State)
+		{
+			TransportBenchmark Benchmark(2000);
+			TransportBenchmarkResult Result;
+			for (auto _ : State)
+			{
+				try
+				{
+					Result = Benchmark.RunShmRing((uint32_t)State.range(0));
+				}
+				catch (std::exception& e)
+				{
+					State.SkipWithError(e.what());
+					return;
+				}
+			}
+			_report(State, Result);
+		}
+		BENCHMARK(BM_IpcShmRing)->Arg(1)->Arg(8)->Arg(32)->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+		// The boost::interprocess::message_queue the rings replaced, as the baseline
+		static void BM_IpcMessageQueue(benchmark::State& State)
+		{
+			TransportBenchmark Benchmark(2000);
+			TransportBenchmarkResult Result;
+			for (auto _ : State)
+			{
+				Result = Benchmark.RunMessageQueue();
+			}
+			_report(State, Result);
+		}
+		BENCHMARK(BM_IpcMessageQueue)->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+	}
+}
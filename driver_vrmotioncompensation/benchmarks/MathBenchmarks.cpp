@@ -0,0 +1,285 @@
+#include "BenchmarkData.h"
+
+#include <devicemanipulation/MotionFilter.h>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		namespace
+		{
+			// Rotations and positions of the reference tracker, cycled through so the inputs vary between iterations
+			struct MathInputs
+			{
+				std::vector<vr::HmdQuaternion_t> Rotations;
+				std::vector<vr::HmdVector3d_t> Positions;
+				vr::HmdMatrix34_t Matrix;
+
+				MathInputs()
+				{
+					for (auto& Pose : benchmarkPoses(benchmarkMotion().Input.back().OpenVRId))
+					{
+						Rotations.push_back(Pose.qRotation);
+						Positions.push_back({ Pose.vecPosition[0], Pose.vecPosition[1], Pose.vecPosition[2] });
+					}
+
+					Matrix = { { { 0.36f, 0.48f, -0.8f, 0.1f }, { -0.8f, 0.6f, 0.0f, 0.2f }, { 0.48f, 0.64f, 0.6f, 0.3f } } };
+				}
+
+				size_t Size() const
+				{
+					return Rotations.size();
+				}
+			};
+
+			const MathInputs& inputs()
+			{
+				static const MathInputs Inputs;
+				return Inputs;
+			}
+
+			// Runs Op(i) with a rolling input index and reports the pose budget share
+			template<typename Op> void runMath(benchmark::State& State, Op&& Operation)
+			{
+				const size_t Size = inputs().Size();
+				size_t i = 0;
+				PoseBudget Budget;
+				for (auto _ : State)
+				{
+					benchmark::DoNotOptimize(Operation(i));
+					if (++i == Size)
+					{
+						i = 0;
+					}
+				}
+				Budget.Report(State);
+			}
+		}
+
+		// Operators on the OpenVR types
+
+		static void BM_HmdQuaternionAdd(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return In.Rotations[i] + In.Rotations[In.Size() - 1 - i]; });
+		}
+		BENCHMARK(BM_HmdQuaternionAdd);
+
+		static void BM_HmdQuaternionSub(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return In.Rotations[i] - In.Rotations[In.Size() - 1 - i]; });
+		}
+		BENCHMARK(BM_HmdQuaternionSub);
+
+		static void BM_HmdQuaternionMul(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return In.Rotations[i] * In.Rotations[In.Size() - 1 - i]; });
+		}
+		BENCHMARK(BM_HmdQuaternionMul);
+
+		static void BM_HmdQuaternionConjugate(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return vrmath::quaternionConjugate(In.Rotations[i]); });
+		}
+		BENCHMARK(BM_HmdQuaternionConjugate);
+
+		static void BM_HmdVectorAdd(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return In.Positions[i] + In.Positions[In.Size() - 1 - i]; });
+		}
+		BENCHMARK(BM_HmdVectorAdd);
+
+		static void BM_HmdVectorAddArray(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return In.Positions[i] + In.Positions[In.Size() - 1 - i].v; });
+		}
+		BENCHMARK(BM_HmdVectorAddArray);
+
+		static void BM_HmdVectorSub(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return In.Positions[i] - In.Positions[In.Size() - 1 - i]; });
+		}
+		BENCHMARK(BM_HmdVectorSub);
+
+		static void BM_HmdVectorSubArray(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return In.Positions[i] - In.Positions[In.Size() - 1 - i].v; });
+		}
+		BENCHMARK(BM_HmdVectorSubArray);
+
+		static void BM_HmdVectorMulScalar(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return In.Positions[i] * 1.5; });
+		}
+		BENCHMARK(BM_HmdVectorMulScalar);
+
+		static void BM_HmdVectorDivScalar(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return In.Positions[i] / 1.5; });
+		}
+		BENCHMARK(BM_HmdVectorDivScalar);
+
+		static void BM_HmdQuaternionRotateVector(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return vrmath::quaternionRotateVector(In.Rotations[i], In.Positions[i]); });
+		}
+		BENCHMARK(BM_HmdQuaternionRotateVector);
+
+		static void BM_HmdQuaternionRotateVectorInverse(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return vrmath::quaternionRotateVector(In.Rotations[i], vrmath::quaternionConjugate(In.Rotations[i]), In.Positions[i], true); });
+		}
+		BENCHMARK(BM_HmdQuaternionRotateVectorInverse);
+
+		static void BM_HmdQuaternionRotateArray(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return vrmath::quaternionRotateVector(In.Rotations[i], In.Positions[i].v); });
+		}
+		BENCHMARK(BM_HmdQuaternionRotateArray);
+
+		static void BM_HmdQuaternionRotateArrayInverse(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return vrmath::quaternionRotateVector(In.Rotations[i], vrmath::quaternionConjugate(In.Rotations[i]), In.Positions[i].v, true); });
+		}
+		BENCHMARK(BM_HmdQuaternionRotateArrayInverse);
+
+		static void BM_HmdMatMul33(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return vrmath::matMul33(In.Matrix, In.Positions[i]); });
+		}
+		BENCHMARK(BM_HmdMatMul33);
+
+		static void BM_HmdMatMul33Transposed(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return vrmath::matMul33(In.Positions[i], In.Matrix); });
+		}
+		BENCHMARK(BM_HmdMatMul33Transposed);
+
+		// Scalar-generic types, run for the double and the float build of the math
+
+		template<typename T> static void BM_QuatMul(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return vrmath::toQuat<T>(In.Rotations[i]) * vrmath::toQuat<T>(In.Rotations[In.Size() - 1 - i]); });
+		}
+		BENCHMARK_TEMPLATE(BM_QuatMul, double);
+		BENCHMARK_TEMPLATE(BM_QuatMul, float);
+
+		template<typename T> static void BM_Vec3AddSub(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return vrmath::toVec3<T>(In.Positions[i]) + vrmath::toVec3<T>(In.Positions[In.Size() - 1 - i]) - vrmath::toVec3<T>(In.Positions[i]); });
+		}
+		BENCHMARK_TEMPLATE(BM_Vec3AddSub, double);
+		BENCHMARK_TEMPLATE(BM_Vec3AddSub, float);
+
+		template<typename T> static void BM_QuatRotateSandwich(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i)
+			{
+				auto q = vrmath::toQuat<T>(In.Rotations[i]);
+				return vrmath::quaternionRotateVector(q, vrmath::quaternionConjugate(q), vrmath::toVec3<T>(In.Positions[i]));
+			});
+		}
+		BENCHMARK_TEMPLATE(BM_QuatRotateSandwich, double);
+		BENCHMARK_TEMPLATE(BM_QuatRotateSandwich, float);
+
+		template<typename T> static void BM_QuatRotateCross(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return vrmath::quaternionRotateVector(vrmath::toQuat<T>(In.Rotations[i]), vrmath::toVec3<T>(In.Positions[i])); });
+		}
+		BENCHMARK_TEMPLATE(BM_QuatRotateCross, double);
+		BENCHMARK_TEMPLATE(BM_QuatRotateCross, float);
+
+		template<typename T> static void BM_QuaternionToMatrix33(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return vrmath::quaternionToMatrix33(vrmath::toQuat<T>(In.Rotations[i])); });
+		}
+		BENCHMARK_TEMPLATE(BM_QuaternionToMatrix33, double);
+		BENCHMARK_TEMPLATE(BM_QuaternionToMatrix33, float);
+
+		template<typename T> static void BM_Mat33Rotate(benchmark::State& State)
+		{
+			auto& In = inputs();
+			auto Matrix = vrmath::quaternionToMatrix33(vrmath::toQuat<T>(In.Rotations[0]));
+			runMath(State, [&](size_t i) { return vrmath::matMul33(Matrix, vrmath::toVec3<T>(In.Positions[i])); });
+		}
+		BENCHMARK_TEMPLATE(BM_Mat33Rotate, double);
+		BENCHMARK_TEMPLATE(BM_Mat33Rotate, float);
+
+		template<typename T> static void BM_Mat33RotateTransposed(benchmark::State& State)
+		{
+			auto& In = inputs();
+			auto Matrix = vrmath::quaternionToMatrix33(vrmath::toQuat<T>(In.Rotations[0]));
+			runMath(State, [&](size_t i) { return vrmath::matMul33(vrmath::toVec3<T>(In.Positions[i]), Matrix); });
+		}
+		BENCHMARK_TEMPLATE(BM_Mat33RotateTransposed, double);
+		BENCHMARK_TEMPLATE(BM_Mat33RotateTransposed, float);
+
+		// Reference filter building blocks
+
+		template<typename T> static void BM_Slerp(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return MotionFilter<T>::slerp(vrmath::toQuat<T>(In.Rotations[i]), vrmath::toQuat<T>(In.Rotations[In.Size() - 1 - i]), (T)0.2); });
+		}
+		BENCHMARK_TEMPLATE(BM_Slerp, double);
+		BENCHMARK_TEMPLATE(BM_Slerp, float);
+
+		template<typename T> static void BM_ToEulerAngles(benchmark::State& State)
+		{
+			auto& In = inputs();
+			runMath(State, [&](size_t i) { return MotionFilter<T>::toEulerAngles(vrmath::toQuat<T>(In.Rotations[i])); });
+		}
+		BENCHMARK_TEMPLATE(BM_ToEulerAngles, double);
+		BENCHMARK_TEMPLATE(BM_ToEulerAngles, float);
+
+		// All three axes, as updateRefPose runs it per reference pose
+		template<typename T> static void BM_DEMA(benchmark::State& State)
+		{
+			auto& In = inputs();
+			MotionFilter<T> Filter;
+			Filter.setAlpha(2.0 / (1.0 + 100.0));
+			runMath(State, [&](size_t i)
+			{
+				vrmath::vec3<T> Result;
+				for (int Axis = 0; Axis < 3; Axis++)
+				{
+					Result.v[Axis] = Filter.DEMA(In.Positions[i].v[Axis], Axis);
+				}
+				return Result;
+			});
+		}
+		BENCHMARK_TEMPLATE(BM_DEMA, double);
+		BENCHMARK_TEMPLATE(BM_DEMA, float);
+
+		template<typename T> static void BM_FilterRotation(benchmark::State& State)
+		{
+			auto& In = inputs();
+			MotionFilter<T> Filter;
+			Filter.setLpfBeta(0.2);
+			Filter.setRotation(In.Rotations[0]);
+			runMath(State, [&](size_t i) { return Filter.filterRotation(In.Rotations[i]); });
+		}
+		BENCHMARK_TEMPLATE(BM_FilterRotation, double);
+		BENCHMARK_TEMPLATE(BM_FilterRotation, float);
+	}
+}
@@ -0,0 +1,25 @@
+#include <logging.h>
+
+#include <benchmark/benchmark.h>
+
+INITIALIZE_EASYLOGGINGPP
+
+int main(int argc, char** argv)
+{
+	// Keep log output out of the measurements and the JSON on stdout
+	el::Configurations Conf;
+	Conf.setToDefault();
+	Conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureAllLoggers(Conf);
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+	{
+		return 1;
+	}
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	return 0;
+}
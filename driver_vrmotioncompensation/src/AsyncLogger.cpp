@@ -0,0 +1,195 @@
+#include "AsyncLogger.h"
+#include "logging.h"
+
+#include <chrono>
+#include <sstream>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		AsyncLogger& AsyncLogger::instance()
+		{
+			static AsyncLogger Instance;
+			return Instance;
+		}
+
+		AsyncLogger::AsyncLogger() : _records(new Record[ALOG_QUEUE_SIZE])
+		{
+			for (uint64_t i = 0; i < ALOG_QUEUE_SIZE; i++)
+			{
+				_records[i].Sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		AsyncLogger::~AsyncLogger()
+		{
+			Stop();
+		}
+
+		void AsyncLogger::Start()
+		{
+			if (_writerThread.joinable())
+			{
+				return;
+			}
+
+			// Levels disabled in the easylogging++ configuration are not even queued.
+			// Looked up in the registry directly, el::Loggers::getLogger() takes the storage lock before the registry lock, which LOG() takes in the opposite order.
+			el::Logger* Logger = ELPP->registeredLoggers()->get("default", false);
+			if (Logger)
+			{
+				const el::Level Levels[] = { el::Level::Trace, el::Level::Debug, el::Level::Info, el::Level::Warning, el::Level::Error };
+				uint32_t Enabled = 0;
+				for (int i = 0; i < 5; i++)
+				{
+					if (Logger->enabled(Levels[i]))
+					{
+						Enabled |= 1u << i;
+					}
+				}
+				_enabledLevels = Enabled;
+			}
+
+			_writerStopFlag = false;
+			_writerThread = std::thread(_writerThreadFunc, this);
+			_running = true;
+		}
+
+		void AsyncLogger::Stop()
+		{
+			if (_writerThread.joinable())
+			{
+				_running.store(false, std::memory_order_seq_cst);
+
+				// Callers that saw _running a moment ago may still be filling their record
+				while (_producers.load(std::memory_order_seq_cst) != 0)
+				{
+					std::this_thread::yield();
+				}
+				_writerStopFlag = true;
+				_writerThread.join();
+			}
+		}
+
+		// Bounded multi producer queue, every record carries the position it is free for (Sequence == position)
+		// or the position it was published at (Sequence == position + 1)
+		AsyncLogger::Record* AsyncLogger::_claim()
+		{
+			uint64_t Position = _enqueuePosition.load(std::memory_order_relaxed);
+			while (true)
+			{
+				Record* Entry = &_records[Position & (ALOG_QUEUE_SIZE - 1)];
+				int64_t Difference = (int64_t)Entry->Sequence.load(std::memory_order_acquire) - (int64_t)Position;
+				if (Difference == 0)
+				{
+					if (_enqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+					{
+						return Entry;
+					}
+				}
+				else if (Difference < 0)
+				{
+					return nullptr;
+				}
+				else
+				{
+					Position = _enqueuePosition.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		void AsyncLogger::_publish(Record* Entry)
+		{
+			Entry->Sequence.store(Entry->Sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		void AsyncLogger::_write(const Record& Entry)
+		{
+			std::ostringstream Message;
+			uint32_t Index = 0;
+			for (const char* Format = Entry.Format; *Format; Format++)
+			{
+				if (Format[0] != '{' || Format[1] != '}' || Index >= Entry.ArgumentCount)
+				{
+					Message << *Format;
+					continue;
+				}
+
+				const Argument& Value = Entry.Arguments[Index++];
+				switch (Value.Type)
+				{
+					case ArgumentType::Bool:
+						Message << (Value.UInt ? "true" : "false");
+						break;
+					case ArgumentType::Int:
+						Message << Value.Int;
+						break;
+					case ArgumentType::UInt:
+						Message << Value.UInt;
+						break;
+					case ArgumentType::Double:
+						Message << Value.Double;
+						break;
+					case ArgumentType::Pointer:
+						Message << Value.Pointer;
+						break;
+					case ArgumentType::Text:
+						Message << (Entry.Text + Value.Text);
+						break;
+				}
+				Format++;
+			}
+
+			switch (Entry.Level)
+			{
+				case ALOG_LEVEL_TRACE:
+					LOG(TRACE) << Message.str();
+					break;
+				case ALOG_LEVEL_DEBUG:
+					LOG(DEBUG) << Message.str();
+					break;
+				case ALOG_LEVEL_INFO:
+					LOG(INFO) << Message.str();
+					break;
+				case ALOG_LEVEL_WARNING:
+					LOG(WARNING) << Message.str();
+					break;
+				default:
+					LOG(ERROR) << Message.str();
+					break;
+			}
+		}
+
+		void AsyncLogger::_writerThreadFunc(AsyncLogger* _this)
+		{
+			uint64_t ReportedDrops = 0;
+
+			while (true)
+			{
+				Record* Entry = &_this->_records[_this->_dequeuePosition & (ALOG_QUEUE_SIZE - 1)];
+				if (Entry->Sequence.load(std::memory_order_acquire) == _this->_dequeuePosition + 1)
+				{
+					_write(*Entry);
+					Entry->Sequence.store(_this->_dequeuePosition + ALOG_QUEUE_SIZE, std::memory_order_release);
+					_this->_dequeuePosition++;
+					continue;
+				}
+
+				uint64_t Drops = _this->DroppedRecords();
+				if (Drops != ReportedDrops)
+				{
+					LOG(WARNING) << "Log queue full, " << Drops - ReportedDrops << " records dropped";
+					ReportedDrops = Drops;
+				}
+
+				// The queue is empty, callers log on their own thread once _running is cleared
+				if (_this->_writerStopFlag)
+				{
+					break;
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+// Levels of the asynchronous logger, in the order of easylogging++
+#define ALOG_LEVEL_TRACE 0
+#define ALOG_LEVEL_DEBUG 1
+#define ALOG_LEVEL_INFO 2
+#define ALOG_LEVEL_WARNING 3
+#define ALOG_LEVEL_ERROR 4
+
+// Records below this level are compiled out
+#ifndef ALOG_MIN_LEVEL
+#ifdef NDEBUG
+#define ALOG_MIN_LEVEL ALOG_LEVEL_DEBUG
+#else
+#define ALOG_MIN_LEVEL ALOG_LEVEL_TRACE
+#endif
+#endif
+
+#define ALOG_QUEUE_SIZE 4096			// Records, power of two
+#define ALOG_MAX_ARGUMENTS 8
+#define ALOG_TEXT_SIZE 128				// Bytes per record for copies of string arguments
+
+// Logs without blocking the calling thread, "{}" in the format is replaced by the next argument:
+//   ALOG(INFO, "ZeroPos set to x: {} y: {} z: {}", x, y, z);
+// The format has to be a string literal, the record only keeps its address.
+#define ALOG(LEVEL, FORMAT, ...) \
+	do \
+	{ \
+		if (ALOG_LEVEL_##LEVEL >= ALOG_MIN_LEVEL) \
+		{ \
+			vrmotioncompensation::driver::AsyncLogger::instance().log(ALOG_LEVEL_##LEVEL, "" FORMAT, ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// Logging backend for threads that must not wait for log I/O.
+		// log() stores the format address and the raw arguments in a bounded lock free queue, a background thread formats the records and writes them through easylogging++.
+		// Records are dropped and counted when the queue is full. Until Start() is called and after Stop() records are written on the calling thread.
+		class AsyncLogger
+		{
+		private:
+			enum class ArgumentType : uint8_t
+			{
+				Bool,
+				Int,
+				UInt,
+				Double,
+				Pointer,
+				Text			// Offset into Record::Text
+			};
+
+			struct Argument
+			{
+				ArgumentType Type;
+				union
+				{
+					int64_t Int;
+					uint64_t UInt;
+					double Double;
+					const void* Pointer;
+					uint32_t Text;
+				};
+			};
+
+			struct Record
+			{
+				std::atomic<uint64_t> Sequence;
+				const char* Format;
+				int Level;
+				uint32_t ArgumentCount;
+				uint32_t TextSize;
+				Argument Arguments[ALOG_MAX_ARGUMENTS];
+				char Text[ALOG_TEXT_SIZE];
+			};
+
+		public:
+			static AsyncLogger& instance();
+
+			~AsyncLogger();
+
+			void Start();
+
+			// Writes the queued records before it returns
+			void Stop();
+
+			bool IsRunning() const
+			{
+				return _running.load(std::memory_order_relaxed);
+			}
+
+			uint64_t DroppedRecords() const
+			{
+				return _dropped.load(std::memory_order_relaxed);
+			}
+
+			template<typename... Args> void log(int Level, const char* Format, const Args&... Arguments)
+			{
+				if (!(_enabledLevels.load(std::memory_order_relaxed) & (1u << Level)))
+				{
+					return;
+				}
+
+				Record Local;
+				bool Queued = _enter();
+				Record* Entry = Queued ? _claim() : &Local;
+				if (!Entry)
+				{
+					_dropped.fetch_add(1, std::memory_order_relaxed);
+					_leave();
+					return;
+				}
+
+				Entry->Format = Format;
+				Entry->Level = Level;
+				Entry->ArgumentCount = 0;
+				Entry->TextSize = 0;
+				int Unused[] = { 0, (_store(*Entry, Arguments), 0)... };
+				(void)Unused;
+
+				if (Queued)
+				{
+					_publish(Entry);
+					_leave();
+				}
+				else
+				{
+					_write(*Entry);
+				}
+			}
+
+		private:
+			AsyncLogger();
+
+			// Counts the caller as a producer while the queue is running, Stop() waits until no producer is left before the final drain
+			bool _enter()
+			{
+				if (!IsRunning())
+				{
+					return false;
+				}
+				_producers.fetch_add(1, std::memory_order_seq_cst);
+				if (!_running.load(std::memory_order_seq_cst))
+				{
+					_leave();
+					return false;
+				}
+				return true;
+			}
+
+			void _leave()
+			{
+				_producers.fetch_sub(1, std::memory_order_release);
+			}
+
+			Record* _claim();
+			void _publish(Record* Entry);
+			static void _write(const Record& Entry);
+			static void _writerThreadFunc(AsyncLogger* _this);
+
+			static Argument* _next(Record& Entry)
+			{
+				return Entry.ArgumentCount < ALOG_MAX_ARGUMENTS ? &Entry.Arguments[Entry.ArgumentCount++] : nullptr;
+			}
+
+			static void _store(Record& Entry, bool Value)
+			{
+				if (Argument* Slot = _next(Entry))
+				{
+					Slot->Type = ArgumentType::Bool;
+					Slot->UInt = Value ? 1 : 0;
+				}
+			}
+
+			template<typename T> static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type _store(Record& Entry, T Value)
+			{
+				if (Argument* Slot = _next(Entry))
+				{
+					if (std::is_signed<T>::value || std::is_enum<T>::value)
+					{
+						Slot->Type = ArgumentType::Int;
+						Slot->Int = (int64_t)Value;
+					}
+					else
+					{
+						Slot->Type = ArgumentType::UInt;
+						Slot->UInt = (uint64_t)Value;
+					}
+				}
+			}
+
+			template<typename T> static typename std::enable_if<std::is_floating_point<T>::value>::type _store(Record& Entry, T Value)
+			{
+				if (Argument* Slot = _next(Entry))
+				{
+					Slot->Type = ArgumentType::Double;
+					Slot->Double = (double)Value;
+				}
+			}
+
+			static void _store(Record& Entry, const void* Value)
+			{
+				if (Argument* Slot = _next(Entry))
+				{
+					Slot->Type = ArgumentType::Pointer;
+					Slot->Pointer = Value;
+				}
+			}
+
+			// Strings are copied, they may be gone before the record is written. Long strings are cut off.
+			static void _store(Record& Entry, const char* Value)
+			{
+				_storeText(Entry, Value ? Value : "(null)", Value ? strlen(Value) : 6);
+			}
+
+			static void _store(Record& Entry, const std::string& Value)
+			{
+				_storeText(Entry, Value.c_str(), Value.size());
+			}
+
+			static void _storeText(Record& Entry, const char* Value, size_t Size)
+			{
+				if (Argument* Slot = _next(Entry))
+				{
+					Size = std::min<size_t>(Size, ALOG_TEXT_SIZE - 1 - Entry.TextSize);
+					memcpy(Entry.Text + Entry.TextSize, Value, Size);
+					Entry.Text[Entry.TextSize + Size] = '\0';
+					Slot->Type = ArgumentType::Text;
+					Slot->Text = Entry.TextSize;
+					Entry.TextSize += (uint32_t)Size + (Entry.TextSize + Size + 1 < ALOG_TEXT_SIZE ? 1 : 0);
+				}
+			}
+
+			std::unique_ptr<Record[]> _records;
+			std::atomic<uint64_t> _enqueuePosition = { 0 };
+			uint64_t _dequeuePosition = 0;			// Only used by the writer thread
+
+			std::atomic<uint32_t> _enabledLevels = { 0xffffffff };
+			std::atomic<uint64_t> _dropped = { 0 };
+			std::atomic<bool> _running = { false };
+			std::atomic<uint32_t> _producers = { 0 };	// Callers between _enter() and _leave()
+			std::atomic<bool> _writerStopFlag = { false };
+			std::thread _writerThread;
+		};
+	}
+}
\ No newline at end of file
@@ -1,9 +1,11 @@
 #include "driver_ipc_shm.h"
 
-#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <algorithm>
+#include <vector>
 #include <openvr_driver.h>
 #include <ipc_protocol.h>
 #include <openvr_math.h>
+#include <tracespans.h>
 #include "../../driver/ServerDriver.h"
 #include "../../devicemanipulation/DeviceManipulationHandle.h"
 
@@ -12,15 +14,34 @@ namespace vrmotioncompensation
 {
 	namespace driver
 	{
+		IpcShmCommunicator::IpcShmCommunicator() : _postedEvents(new PostedEvent[DRIVER_EVENT_POST_QUEUE_SIZE])
+		{
+			for (uint64_t i = 0; i < DRIVER_EVENT_POST_QUEUE_SIZE; i++)
+			{
+				_postedEvents[i].Sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
 		void IpcShmCommunicator::init(ServerDriver* driver)
 		{
 			_driver = driver;
 			_ipcThreadStopFlag = false;
 			_ipcThread = std::thread(_ipcThreadFunc, this, driver);
+			_eventThreadStopFlag = false;
+			_eventThread = std::thread(_eventThreadFunc, this);
 		}
 
 		void IpcShmCommunicator::shutdown()
 		{
+			if (_eventThread.joinable())
+			{
+				{
+					std::lock_guard<std::mutex> lock(_eventMutex);
+					_eventThreadStopFlag = true;
+				}
+				_eventCondition.notify_one();
+				_eventThread.join();
+			}
 			if (_ipcThreadRunning)
 			{
 				_ipcThreadStopFlag = true;
@@ -28,413 +49,811 @@ namespace vrmotioncompensation
 			}
 		}
 
+		void IpcShmCommunicator::postEvent(const DriverEvent_OVRMC_v1& Event)
+		{
+			PostedEvent* Entry;
+			uint64_t Position = _postPosition.load(std::memory_order_relaxed);
+			while (true)
+			{
+				Entry = &_postedEvents[Position & (DRIVER_EVENT_POST_QUEUE_SIZE - 1)];
+				int64_t Difference = (int64_t)Entry->Sequence.load(std::memory_order_acquire) - (int64_t)Position;
+				if (Difference == 0)
+				{
+					if (_postPosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if (Difference < 0)
+				{
+					// The event thread reports it to every subscriber
+					_postDropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				else
+				{
+					Position = _postPosition.load(std::memory_order_relaxed);
+				}
+			}
+
+			Entry->Event = Event;
+			Entry->Sequence.store(Position + 1, std::memory_order_release);
+			_eventCondition.notify_one();
+		}
+
+		void IpcShmCommunicator::_sortPostedEvents()
+		{
+			uint64_t Lost = _postDropped.exchange(0, std::memory_order_relaxed);
+			if (Lost > 0)
+			{
+				for (auto& i : _eventSubscriptions)
+				{
+					i.second.Dropped += (uint32_t)Lost;
+				}
+			}
+
+			while (true)
+			{
+				PostedEvent* Entry = &_postedEvents[_sortPosition & (DRIVER_EVENT_POST_QUEUE_SIZE - 1)];
+				if (Entry->Sequence.load(std::memory_order_acquire) != _sortPosition + 1)
+				{
+					break;
+				}
+
+				const DriverEvent_OVRMC_v1& Event = Entry->Event;
+				for (auto& i : _eventSubscriptions)
+				{
+					EventSubscription& Subscription = i.second;
+					if (!(Subscription.Mask & DRIVER_EVENT_MASK(Event.Type)))
+					{
+						continue;
+					}
+
+					// Only the newest value counts, e.g. a tracker that flickers between valid and invalid
+					auto Pending = std::find_if(Subscription.Pending.begin(), Subscription.Pending.end(), [&Event](const DriverEvent_OVRMC_v1& Other)
+					{
+						return Other.Type == Event.Type && Other.OpenVRId == Event.OpenVRId;
+					});
+					if (Pending != Subscription.Pending.end())
+					{
+						uint32_t Coalesced = Pending->Coalesced + Event.Coalesced + 1;
+						*Pending = Event;
+						Pending->Coalesced = Coalesced;
+					}
+					else
+					{
+						if (Subscription.Pending.size() >= DRIVER_EVENT_QUEUE_SIZE)
+						{
+							Subscription.Pending.pop_front();
+							Subscription.Dropped++;
+						}
+						Subscription.Pending.push_back(Event);
+					}
+				}
+
+				Entry->Sequence.store(_sortPosition + DRIVER_EVENT_POST_QUEUE_SIZE, std::memory_order_release);
+				_sortPosition++;
+			}
+		}
+
+		void IpcShmCommunicator::_subscribeEvents(uint32_t clientId, uint32_t eventMask)
+		{
+			std::lock_guard<std::mutex> lock(_eventMutex);
+			if (eventMask == 0)
+			{
+				_eventSubscriptions.erase(clientId);
+			}
+			else
+			{
+				_eventSubscriptions[clientId].Mask = eventMask;
+			}
+		}
+
+		void IpcShmCommunicator::_eventThreadFunc(IpcShmCommunicator* _this)
+		{
+			LOG(DEBUG) << "IpcShmCommunicator::_eventThreadFunc: thread started";
+			std::vector<std::pair<uint32_t, DriverEvent_OVRMC_v1>> Outgoing;
+			std::unique_lock<std::mutex> lock(_this->_eventMutex);
+			while (!_this->_eventThreadStopFlag)
+			{
+				_this->_sortPostedEvents();
+
+				Outgoing.clear();
+				for (auto& i : _this->_eventSubscriptions)
+				{
+					EventSubscription& Subscription = i.second;
+					while (!Subscription.Pending.empty())
+					{
+						Outgoing.push_back({ i.first, Subscription.Pending.front() });
+						Outgoing.back().second.Dropped += Subscription.Dropped;
+						Subscription.Dropped = 0;
+						Subscription.Pending.pop_front();
+					}
+				}
+
+				if (Outgoing.empty())
+				{
+					// postEvent() must not take a lock, so wake up regularly in case a notification was missed
+					_this->_eventCondition.wait_for(lock, std::chrono::milliseconds(DRIVER_EVENT_POLL_MS));
+					continue;
+				}
+
+				// Sending may wait for the ring of a client, posting events must not
+				lock.unlock();
+				std::map<uint32_t, uint32_t> Failed;
+				for (auto& Entry : Outgoing)
+				{
+					ipc::Reply reply(ipc::ReplyType::Event);
+					reply.messageId = 0;
+					reply.status = ipc::ReplyStatus::Ok;
+					reply.msg.ev_Event.event = Entry.second;
+
+					// A client that does not read its ring loses the event, the next one it gets reports it together with the losses this one carried
+					if (!_this->sendReply(Entry.first, reply, 0))
+					{
+						Failed[Entry.first] += 1 + Entry.second.Coalesced + Entry.second.Dropped;
+					}
+				}
+				lock.lock();
+
+				for (auto& Client : Failed)
+				{
+					auto i = _this->_eventSubscriptions.find(Client.first);
+					if (i != _this->_eventSubscriptions.end())
+					{
+						i->second.Dropped += Client.second;
+					}
+				}
+			}
+			LOG(DEBUG) << "IpcShmCommunicator::_eventThreadFunc: thread stopped";
+		}
+
 		void IpcShmCommunicator::_ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver* driver)
 		{
 			_this->_ipcThreadRunning = true;
 			LOG(DEBUG) << "CServerDriver::_ipcThreadFunc: thread started";
 			try
 			{
-		   // Create message queue
-				boost::interprocess::message_queue::remove(_this->_ipcQueueName.c_str());
-				boost::interprocess::message_queue messageQueue(
-					boost::interprocess::create_only,
-					_this->_ipcQueueName.c_str(),
-					100,					//max message number
-					sizeof(ipc::Request)    //max message size
-				);
+				// Create request ring
+				ipc::ServerRing serverRing(boost::interprocess::create_only, _this->_ipcQueueName);
 
 				while (!_this->_ipcThreadStopFlag)
 				{
 					try
 					{
 						ipc::Request message;
-						uint64_t recv_size;
-						unsigned priority;
-						boost::posix_time::ptime timeout = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(50);
-						if (messageQueue.timed_receive(&message, sizeof(ipc::Request), recv_size, priority, timeout))
+						if (serverRing.Pop(message, 50))
 						{
 							LOG(TRACE) << "CServerDriver::_ipcThreadFunc: IPC request received ( type " << (int)message.type << ")";
-							if (recv_size == sizeof(ipc::Request))
+
+							switch (message.type)
 							{
-								switch (message.type)
-								{
 
-								case ipc::RequestType::IPC_ClientConnect:
+							case ipc::RequestType::IPC_ClientConnect:
+							{
+								TRACE_SPAN("IPC_ClientConnect");
+								try
 								{
-									try
+									auto queue = std::make_shared<ipc::ClientRing>(boost::interprocess::open_only, message.msg.ipc_ClientConnect.queueName);
+									ipc::Reply reply(ipc::ReplyType::IPC_ClientConnect);
+									reply.messageId = message.msg.ipc_ClientConnect.messageId;
+									reply.msg.ipc_ClientConnect.ipcProcotolVersion = IPC_PROTOCOL_VERSION;
+									uint32_t clientId = 0;
+									if (message.msg.ipc_ClientConnect.ipcProcotolVersion == IPC_PROTOCOL_VERSION)
 									{
-										auto queue = std::make_shared<boost::interprocess::message_queue>(boost::interprocess::open_only, message.msg.ipc_ClientConnect.queueName);
-										ipc::Reply reply(ipc::ReplyType::IPC_ClientConnect);
-										reply.messageId = message.msg.ipc_ClientConnect.messageId;
-										reply.msg.ipc_ClientConnect.ipcProcotolVersion = IPC_PROTOCOL_VERSION;
-										uint32_t clientId = 0;
-										if (message.msg.ipc_ClientConnect.ipcProcotolVersion == IPC_PROTOCOL_VERSION)
+										clientId = _this->_ipcClientIdNext++;
 										{
-											clientId = _this->_ipcClientIdNext++;
+											std::lock_guard<std::mutex> guard(_this->_sendMutex);
 											_this->_ipcEndpoints.insert({ clientId, queue });
-											reply.msg.ipc_ClientConnect.clientId = clientId;
-											reply.status = ipc::ReplyStatus::Ok;
-											LOG(INFO) << "New client connected: endpoint \"" << message.msg.ipc_ClientConnect.queueName << "\", cliendId " << clientId;
-										}
-										else
-										{
-											reply.msg.ipc_ClientConnect.clientId = 0;
-											reply.status = ipc::ReplyStatus::InvalidVersion;
-											LOG(INFO) << "Client (endpoint \"" << message.msg.ipc_ClientConnect.queueName << "\") reports incompatible ipc version "
-												<< message.msg.ipc_ClientConnect.ipcProcotolVersion;
 										}
-										_this->sendReply(clientId, reply);
+										reply.msg.ipc_ClientConnect.clientId = clientId;
+										reply.status = ipc::ReplyStatus::Ok;
+										LOG(INFO) << "New client connected: endpoint \"" << message.msg.ipc_ClientConnect.queueName << "\", cliendId " << clientId;
 									}
-									catch (std::exception & e)
+									else
 									{
-										LOG(ERROR) << "Error during client connect: " << e.what();
+										reply.msg.ipc_ClientConnect.clientId = 0;
+										reply.status = ipc::ReplyStatus::InvalidVersion;
+										LOG(INFO) << "Client (endpoint \"" << message.msg.ipc_ClientConnect.queueName << "\") reports incompatible ipc version "
+											<< message.msg.ipc_ClientConnect.ipcProcotolVersion;
 									}
+									_this->sendReply(clientId, reply);
 								}
-								break;
+								catch (std::exception & e)
+								{
+									LOG(ERROR) << "Error during client connect: " << e.what();
+								}
+							}
+							break;
 
-								case ipc::RequestType::IPC_ClientDisconnect:
+							case ipc::RequestType::IPC_ClientDisconnect:
+							{
+								TRACE_SPAN("IPC_ClientDisconnect");
+								ipc::Reply reply(ipc::ReplyType::GenericReply);
+								reply.messageId = message.msg.ipc_ClientDisconnect.messageId;
+								_this->_subscribeEvents(message.msg.ipc_ClientDisconnect.clientId, 0);
+								bool known;
 								{
-									ipc::Reply reply(ipc::ReplyType::GenericReply);
-									reply.messageId = message.msg.ipc_ClientDisconnect.messageId;
-									auto i = _this->_ipcEndpoints.find(message.msg.ipc_ClientDisconnect.clientId);
-									if (i != _this->_ipcEndpoints.end())
-									{
-										reply.status = ipc::ReplyStatus::Ok;
-										LOG(INFO) << "Client disconnected: clientId " << message.msg.ipc_ClientDisconnect.clientId;
-										if (reply.messageId != 0)
-										{
-											_this->sendReply(message.msg.ipc_ClientDisconnect.clientId, reply);
-										}
-										_this->_ipcEndpoints.erase(i);
-									}
-									else
+									std::lock_guard<std::mutex> guard(_this->_sendMutex);
+									known = _this->_ipcEndpoints.find(message.msg.ipc_ClientDisconnect.clientId) != _this->_ipcEndpoints.end();
+								}
+								if (known)
+								{
+									reply.status = ipc::ReplyStatus::Ok;
+									LOG(INFO) << "Client disconnected: clientId " << message.msg.ipc_ClientDisconnect.clientId;
+									if (reply.messageId != 0)
 									{
-										LOG(ERROR) << "Error during client disconnect: unknown clientID " << message.msg.ipc_ClientDisconnect.clientId;
+										_this->sendReply(message.msg.ipc_ClientDisconnect.clientId, reply);
 									}
+									std::lock_guard<std::mutex> guard(_this->_sendMutex);
+									_this->_ipcEndpoints.erase(message.msg.ipc_ClientDisconnect.clientId);
 								}
-								break;
-
-								case ipc::RequestType::IPC_Ping:
+								else
 								{
-									LOG(TRACE) << "Ping received: clientId " << message.msg.ipc_Ping.clientId << ", nonce " << message.msg.ipc_Ping.nonce;
-									ipc::Reply reply(ipc::ReplyType::IPC_Ping);
-									reply.messageId = message.msg.ipc_Ping.messageId;
-									reply.status = ipc::ReplyStatus::Ok;
-									reply.msg.ipc_Ping.nonce = message.msg.ipc_Ping.nonce;
-									_this->sendReply(message.msg.ipc_ClientDisconnect.clientId, reply);
+									LOG(ERROR) << "Error during client disconnect: unknown clientID " << message.msg.ipc_ClientDisconnect.clientId;
 								}
-								break;
+							}
+							break;
 
-								case ipc::RequestType::DeviceManipulation_GetDeviceInfo:
-								{
-									ipc::Reply resp(ipc::ReplyType::GenericReply);
-									resp.messageId = message.msg.ovr_GenericDeviceIdMessage.messageId;
+							case ipc::RequestType::IPC_Ping:
+							{
+								TRACE_SPAN("IPC_Ping");
+								LOG(TRACE) << "Ping received: clientId " << message.msg.ipc_Ping.clientId << ", nonce " << message.msg.ipc_Ping.nonce;
+								ipc::Reply reply(ipc::ReplyType::IPC_Ping);
+								reply.messageId = message.msg.ipc_Ping.messageId;
+								reply.status = ipc::ReplyStatus::Ok;
+								reply.msg.ipc_Ping.nonce = message.msg.ipc_Ping.nonce;
+								_this->sendReply(message.msg.ipc_ClientDisconnect.clientId, reply);
+							}
+							break;
+
+							case ipc::RequestType::DeviceManipulation_GetDeviceInfo:
+							{
+								TRACE_SPAN("DeviceManipulation_GetDeviceInfo");
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.ovr_GenericDeviceIdMessage.messageId;
 
-									if (message.msg.ovr_GenericDeviceIdMessage.OpenVRId >= vr::k_unMaxTrackedDeviceCount)
+								if (message.msg.ovr_GenericDeviceIdMessage.OpenVRId >= vr::k_unMaxTrackedDeviceCount)
+								{
+									resp.status = ipc::ReplyStatus::InvalidId;
+								}
+								else
+								{
+									DeviceManipulationHandle* info = driver->getDeviceManipulationHandleById(message.msg.ovr_GenericDeviceIdMessage.OpenVRId);
+									if (!info)
 									{
-										resp.status = ipc::ReplyStatus::InvalidId;
+										resp.status = ipc::ReplyStatus::NotFound;
+										resp.msg.dm_deviceInfo.deviceClass = vr::ETrackedDeviceClass::TrackedDeviceClass_Invalid;
 									}
 									else
 									{
-										DeviceManipulationHandle* info = driver->getDeviceManipulationHandleById(message.msg.ovr_GenericDeviceIdMessage.OpenVRId);
-										if (!info)
-										{
-											resp.status = ipc::ReplyStatus::NotFound;
-											resp.msg.dm_deviceInfo.deviceClass = vr::ETrackedDeviceClass::TrackedDeviceClass_Invalid;
-										}
-										else
-										{
-											resp.status = ipc::ReplyStatus::Ok;
-											resp.msg.dm_deviceInfo.OpenVRId = message.msg.ovr_GenericDeviceIdMessage.OpenVRId;
-											resp.msg.dm_deviceInfo.deviceMode = info->getDeviceMode();
-											resp.msg.dm_deviceInfo.deviceClass = info->deviceClass();
-										}
+										resp.status = ipc::ReplyStatus::Ok;
+										resp.msg.dm_deviceInfo.OpenVRId = message.msg.ovr_GenericDeviceIdMessage.OpenVRId;
+										resp.msg.dm_deviceInfo.deviceMode = info->getDeviceMode();
+										resp.msg.dm_deviceInfo.deviceClass = info->deviceClass();
 									}
+								}
 
-									/*if (resp.status != ipc::ReplyStatus::Ok)
-									{
-										LOG(ERROR) << "Error while getting device info: Error code " << (int)resp.status;
-									}*/
+								/*if (resp.status != ipc::ReplyStatus::Ok)
+								{
+									LOG(ERROR) << "Error while getting device info: Error code " << (int)resp.status;
+								}*/
 
-									if (resp.messageId != 0)
-									{
-										_this->sendReply(message.msg.ovr_GenericDeviceIdMessage.clientId, resp);
-									}
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.ovr_GenericDeviceIdMessage.clientId, resp);
 								}
-								break;
+							}
+							break;
+
+							case ipc::RequestType::DeviceManipulation_MotionCompensationMode:
+							{
+								TRACE_SPAN("DeviceManipulation_MotionCompensationMode");
+								// Create reply message
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.dm_MotionCompensationMode.messageId;
 
-								case ipc::RequestType::DeviceManipulation_MotionCompensationMode:
+								if (message.msg.dm_MotionCompensationMode.MCdeviceId > vr::k_unMaxTrackedDeviceCount ||
+									(message.msg.dm_MotionCompensationMode.RTdeviceId > vr::k_unMaxTrackedDeviceCount && message.msg.dm_MotionCompensationMode.CompensationMode == MotionCompensationMode::ReferenceTracker))
 								{
-									// Create reply message
-									ipc::Reply resp(ipc::ReplyType::GenericReply);
-									resp.messageId = message.msg.dm_MotionCompensationMode.messageId;
+									resp.status = ipc::ReplyStatus::InvalidId;
+								}
+								else
+								{
+									DeviceManipulationHandle* MCdevice = driver->getDeviceManipulationHandleById(message.msg.dm_MotionCompensationMode.MCdeviceId);
+									DeviceManipulationHandle* RTdevice = driver->getDeviceManipulationHandleById(message.msg.dm_MotionCompensationMode.RTdeviceId);
+
+									int MCdeviceID = message.msg.dm_MotionCompensationMode.MCdeviceId;
+									int RTdeviceID = message.msg.dm_MotionCompensationMode.RTdeviceId;
 
-									if (message.msg.dm_MotionCompensationMode.MCdeviceId > vr::k_unMaxTrackedDeviceCount ||
-										(message.msg.dm_MotionCompensationMode.RTdeviceId > vr::k_unMaxTrackedDeviceCount && message.msg.dm_MotionCompensationMode.CompensationMode == MotionCompensationMode::ReferenceTracker))
+									if (!MCdevice)
+									{
+										LOG(ERROR) << "DeviceManipulation_MotionCompensationMode: MCdevice not found";
+										resp.status = ipc::ReplyStatus::NotFound;
+									}
+									else if (!RTdevice)
 									{
-										resp.status = ipc::ReplyStatus::InvalidId;
+										LOG(ERROR) << "DeviceManipulation_MotionCompensationMode: RTdevice not found";
+										resp.status = ipc::ReplyStatus::NotFound;
 									}
 									else
 									{
-										DeviceManipulationHandle* MCdevice = driver->getDeviceManipulationHandleById(message.msg.dm_MotionCompensationMode.MCdeviceId);
-										DeviceManipulationHandle* RTdevice = driver->getDeviceManipulationHandleById(message.msg.dm_MotionCompensationMode.RTdeviceId);
+										auto serverDriver = ServerDriver::getInstance();
 
-										int MCdeviceID = message.msg.dm_MotionCompensationMode.MCdeviceId;
-										int RTdeviceID = message.msg.dm_MotionCompensationMode.RTdeviceId;
-
-										if (!MCdevice)
-										{
-											LOG(ERROR) << "DeviceManipulation_MotionCompensationMode: MCdevice not found";
-											resp.status = ipc::ReplyStatus::NotFound;
-										}
-										else if (!RTdevice)
-										{
-											LOG(ERROR) << "DeviceManipulation_MotionCompensationMode: RTdevice not found";
-											resp.status = ipc::ReplyStatus::NotFound;
-										}
-										else
+										if (serverDriver)
 										{
-											auto serverDriver = ServerDriver::getInstance();
-
-											if (serverDriver)
+											if (message.msg.dm_MotionCompensationMode.CompensationMode == MotionCompensationMode::ReferenceTracker)
 											{
-												if (message.msg.dm_MotionCompensationMode.CompensationMode == MotionCompensationMode::ReferenceTracker)
+												LOG(INFO) << "Setting MCManager (ServerDriver) into motion compensation mode for device OpenVR ID: " << message.msg.dm_MotionCompensationMode.MCdeviceId;
+												LOG(INFO) << "Reference Tracker OpenVR ID: " << message.msg.dm_MotionCompensationMode.RTdeviceId;
+
+												// Check if an old device needs a mode change
+												// This should be False on first start because MotionCompensationMode is set to Disabled by default.
+												// THOMAS: This will break if we are adding multiple devices.
+												// THOMAS: The intended functionality here seems to be to let users change the MC or RT device and then press Apply.
+												// THOMAS: Solution to enable multiple devices: Remove the if/else and always add MC to the requested device. Client needs to disable all devices manually.
+												// THOMAS: In the future, submitting a list of MC devices from client would be better.
+												/*if (serverDriver->motionCompensation().getMotionCompensationMode() == MotionCompensationMode::ReferenceTracker)
 												{
-													LOG(INFO) << "Setting MCManager (ServerDriver) into motion compensation mode for device OpenVR ID: " << message.msg.dm_MotionCompensationMode.MCdeviceId;
-													LOG(INFO) << "Reference Tracker OpenVR ID: " << message.msg.dm_MotionCompensationMode.RTdeviceId;
-
-													// Check if an old device needs a mode change
-													// This should be False on first start because MotionCompensationMode is set to Disabled by default.
-													// THOMAS: This will break if we are adding multiple devices.
-													// THOMAS: The intended functionality here seems to be to let users change the MC or RT device and then press Apply.
-													// THOMAS: Solution to enable multiple devices: Remove the if/else and always add MC to the requested device. Client needs to disable all devices manually.
-													// THOMAS: In the future, submitting a list of MC devices from client would be better.
-													/*if (serverDriver->motionCompensation().getMotionCompensationMode() == MotionCompensationMode::ReferenceTracker)
+													// New MCdevice is different from old
+													if (serverDriver->motionCompensation().getMCdeviceID() != MCdeviceID)
 													{
-														// New MCdevice is different from old
-														if (serverDriver->motionCompensation().getMCdeviceID() != MCdeviceID)
-														{
-															// Set old MCdevice to default
-															DeviceManipulationHandle* OldMCdevice = driver->getDeviceManipulationHandleById(serverDriver->motionCompensation().getMCdeviceID());
-															OldMCdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::Default);
-
-															// Set new MCdevice to motion compensated
-															MCdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::MotionCompensated);
-															serverDriver->motionCompensation().setNewMotionCompensatedDevice(MCdeviceID);  // Bug? Was setNewReferenceTracker before. Fixed.
-														}
-
-														// New RTdevice is different from old
-														if (serverDriver->motionCompensation().getRTdeviceID() != RTdeviceID)
-														{
-															// Set old RTdevice to default
-															DeviceManipulationHandle* OldRTdevice = driver->getDeviceManipulationHandleById(serverDriver->motionCompensation().getRTdeviceID());
-															OldRTdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::Default);
-
-															// Set new RTdevice to reference tracker
-															RTdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::ReferenceTracker);
-															serverDriver->motionCompensation().setNewReferenceTracker(RTdeviceID);
-														}
+														// Set old MCdevice to default
+														DeviceManipulationHandle* OldMCdevice = driver->getDeviceManipulationHandleById(serverDriver->motionCompensation().getMCdeviceID());
+														OldMCdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::Default);
+
+														// Set new MCdevice to motion compensated
+														MCdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::MotionCompensated);
+														serverDriver->motionCompensation().setNewMotionCompensatedDevice(MCdeviceID);  // Bug? Was setNewReferenceTracker before. Fixed.
 													}
-													// THOMAS: This should always be called on first start, since the statement above is False.
-													// If we request MC for multiple devices, what happens to the RTdevice, which will have the same DeviceManipulationHandle?
-													else
+
+													// New RTdevice is different from old
+													if (serverDriver->motionCompensation().getRTdeviceID() != RTdeviceID)
 													{
-														// Activate motion compensation mode for specified device
-														MCdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::MotionCompensated);
-														RTdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::ReferenceTracker);
+														// Set old RTdevice to default
+														DeviceManipulationHandle* OldRTdevice = driver->getDeviceManipulationHandleById(serverDriver->motionCompensation().getRTdeviceID());
+														OldRTdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::Default);
 
-														// Set motion compensation mode
-														serverDriver->motionCompensation().setMotionCompensationMode(MotionCompensationMode::ReferenceTracker, MCdeviceID, RTdeviceID);
-													}*/
+														// Set new RTdevice to reference tracker
+														RTdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::ReferenceTracker);
+														serverDriver->motionCompensation().setNewReferenceTracker(RTdeviceID);
+													}
+												}
+												// THOMAS: This should always be called on first start, since the statement above is False.
+												// If we request MC for multiple devices, what happens to the RTdevice, which will have the same DeviceManipulationHandle?
+												else
+												{
 													// Activate motion compensation mode for specified device
 													MCdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::MotionCompensated);
 													RTdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::ReferenceTracker);
 
 													// Set motion compensation mode
-													// THOMAS: Technically, we only have to do this once.
 													serverDriver->motionCompensation().setMotionCompensationMode(MotionCompensationMode::ReferenceTracker, MCdeviceID, RTdeviceID);
-												}
-												else if (message.msg.dm_MotionCompensationMode.CompensationMode == MotionCompensationMode::Disabled)
-												{
-													LOG(INFO) << "Setting driver into default mode (Disable MC requested)";
-
-													MCdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::Default);
-													RTdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::Default);  // This should be fine to call multiple times.
-
-													// Reset and set some vars for every device
-													serverDriver->motionCompensation().setMotionCompensationMode(MotionCompensationMode::Disabled, -1, -1);
-												}
-
-												resp.status = ipc::ReplyStatus::Ok;
+												}*/
+												// Activate motion compensation mode for specified device
+												MCdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::MotionCompensated);
+												RTdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::ReferenceTracker);
+
+												// Set motion compensation mode
+												// THOMAS: Technically, we only have to do this once.
+												serverDriver->motionCompensation().setMotionCompensationMode(MotionCompensationMode::ReferenceTracker, MCdeviceID, RTdeviceID);
 											}
-											else
+											else if (message.msg.dm_MotionCompensationMode.CompensationMode == MotionCompensationMode::Disabled)
 											{
-												resp.status = ipc::ReplyStatus::UnknownError;
+												LOG(INFO) << "Setting driver into default mode (Disable MC requested)";
+
+												MCdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::Default);
+												RTdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::Default);  // This should be fine to call multiple times.
+
+												// Reset and set some vars for every device
+												serverDriver->motionCompensation().setMotionCompensationMode(MotionCompensationMode::Disabled, -1, -1);
 											}
+
+											resp.status = ipc::ReplyStatus::Ok;
+										}
+										else
+										{
+											resp.status = ipc::ReplyStatus::UnknownError;
 										}
 									}
+								}
 
-									if (resp.status != ipc::ReplyStatus::Ok)
-									{
-										LOG(ERROR) << "Error while setting device into motion compensation mode: Error code " << (int)resp.status;
-										LOG(ERROR) << "MCdeviceID: " << message.msg.dm_MotionCompensationMode.MCdeviceId << ", RTdeviceID: " << message.msg.dm_MotionCompensationMode.RTdeviceId;
-									}
+								if (resp.status != ipc::ReplyStatus::Ok)
+								{
+									LOG(ERROR) << "Error while setting device into motion compensation mode: Error code " << (int)resp.status;
+									LOG(ERROR) << "MCdeviceID: " << message.msg.dm_MotionCompensationMode.MCdeviceId << ", RTdeviceID: " << message.msg.dm_MotionCompensationMode.RTdeviceId;
+								}
 
-									if (resp.messageId != 0)
-									{
-										_this->sendReply(message.msg.dm_MotionCompensationMode.clientId, resp);
-									}
+								// Clients that poll the shared state see the new modes before they get the reply
+								driver->publishDeviceStates();
+
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.dm_MotionCompensationMode.clientId, resp);
 								}
-								break;
+							}
+							break;
 
-								case ipc::RequestType::DeviceManipulation_SetMotionCompensationProperties:
+							case ipc::RequestType::DeviceManipulation_SetMotionCompensationProperties:
+							{
+								TRACE_SPAN("DeviceManipulation_SetMotionCompensationProperties");
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.dm_SetMotionCompensationProperties.messageId;
+								auto serverDriver = ServerDriver::getInstance();
+								if (serverDriver)
 								{
-									ipc::Reply resp(ipc::ReplyType::GenericReply);
-									resp.messageId = message.msg.dm_SetMotionCompensationProperties.messageId;
-									auto serverDriver = ServerDriver::getInstance();
-									if (serverDriver)
-									{
-										LOG(INFO) << "Setting driver motion compensation properties:";
-										LOG(INFO) << "LPF_Beta: " << message.msg.dm_SetMotionCompensationProperties.LPFBeta;
-										LOG(INFO) << "samples: " << message.msg.dm_SetMotionCompensationProperties.samples;
-										LOG(INFO) << "set Zero: " << message.msg.dm_SetMotionCompensationProperties.setZero;
-										LOG(INFO) << "End of property listing";
+									LOG(INFO) << "Setting driver motion compensation properties:";
+									LOG(INFO) << "LPF_Beta: " << message.msg.dm_SetMotionCompensationProperties.LPFBeta;
+									LOG(INFO) << "samples: " << message.msg.dm_SetMotionCompensationProperties.samples;
+									LOG(INFO) << "set Zero: " << message.msg.dm_SetMotionCompensationProperties.setZero;
+									LOG(INFO) << "End of property listing";
 
-										serverDriver->motionCompensation().setLpfBeta(message.msg.dm_SetMotionCompensationProperties.LPFBeta);
-										serverDriver->motionCompensation().setAlpha(message.msg.dm_SetMotionCompensationProperties.samples);
-										serverDriver->motionCompensation().setZeroMode(message.msg.dm_SetMotionCompensationProperties.setZero);
+									serverDriver->motionCompensation().setLpfBeta(message.msg.dm_SetMotionCompensationProperties.LPFBeta);
+									serverDriver->motionCompensation().setAlpha(message.msg.dm_SetMotionCompensationProperties.samples);
+									serverDriver->motionCompensation().setZeroMode(message.msg.dm_SetMotionCompensationProperties.setZero);
 
-										resp.status = ipc::ReplyStatus::Ok;
-									}
-									else
-									{
-										resp.status = ipc::ReplyStatus::UnknownError;
-									}
+									resp.status = ipc::ReplyStatus::Ok;
+								}
+								else
+								{
+									resp.status = ipc::ReplyStatus::UnknownError;
+								}
 
-									if (resp.status != ipc::ReplyStatus::Ok)
-									{
-										LOG(ERROR) << "Error while setting motion compensation properties: Error code " << (int)resp.status;
-									}
+								if (resp.status != ipc::ReplyStatus::Ok)
+								{
+									LOG(ERROR) << "Error while setting motion compensation properties: Error code " << (int)resp.status;
+								}
 
-									if (resp.messageId != 0)
-									{
-										_this->sendReply(message.msg.dm_SetMotionCompensationProperties.clientId, resp);
-									}
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.dm_SetMotionCompensationProperties.clientId, resp);
 								}
-								break;
+							}
+							break;
 
-								case ipc::RequestType::DeviceManipulation_ResetRefZeroPose:
+							case ipc::RequestType::DeviceManipulation_ResetRefZeroPose:
+							{
+								TRACE_SPAN("DeviceManipulation_ResetRefZeroPose");
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.dm_SetMotionCompensationProperties.messageId;
+								auto serverDriver = ServerDriver::getInstance();
+								if (serverDriver)
 								{
-									ipc::Reply resp(ipc::ReplyType::GenericReply);
-									resp.messageId = message.msg.dm_SetMotionCompensationProperties.messageId;
-									auto serverDriver = ServerDriver::getInstance();
-									if (serverDriver)
-									{
-										LOG(INFO) << "Resetting reference zero pose";
+									LOG(INFO) << "Resetting reference zero pose";
 
-										serverDriver->motionCompensation().resetZeroPose();
+									serverDriver->motionCompensation().resetZeroPose();
+									serverDriver->publishDeviceStates();
 
-										resp.status = ipc::ReplyStatus::Ok;
-									}
-									else
-									{
-										resp.status = ipc::ReplyStatus::UnknownError;
-									}
+									resp.status = ipc::ReplyStatus::Ok;
+								}
+								else
+								{
+									resp.status = ipc::ReplyStatus::UnknownError;
+								}
 
-									if (resp.status != ipc::ReplyStatus::Ok)
-									{
-										LOG(ERROR) << "Error while setting motion compensation properties: Error code " << (int)resp.status;
-									}
+								if (resp.status != ipc::ReplyStatus::Ok)
+								{
+									LOG(ERROR) << "Error while setting motion compensation properties: Error code " << (int)resp.status;
+								}
 
-									if (resp.messageId != 0)
-									{
-										_this->sendReply(message.msg.dm_SetMotionCompensationProperties.clientId, resp);
-									}
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.dm_SetMotionCompensationProperties.clientId, resp);
 								}
-								break;
+							}
+							break;
 
-								case ipc::RequestType::DeviceManipulation_SetOffsets:
+							case ipc::RequestType::DeviceManipulation_SetOffsets:
+							{
+								TRACE_SPAN("DeviceManipulation_SetOffsets");
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.dm_SetOffsets.messageId;
+								auto serverDriver = ServerDriver::getInstance();
+								if (serverDriver)
 								{
-									ipc::Reply resp(ipc::ReplyType::GenericReply);
-									resp.messageId = message.msg.dm_SetOffsets.messageId;
-									auto serverDriver = ServerDriver::getInstance();
-									if (serverDriver)
-									{
-										serverDriver->motionCompensation().setOffsets(message.msg.dm_SetOffsets.offsets);
+									serverDriver->motionCompensation().setOffsets(message.msg.dm_SetOffsets.offsets);
 
-										resp.status = ipc::ReplyStatus::Ok;
+									resp.status = ipc::ReplyStatus::Ok;
+								}
+								else
+								{
+									resp.status = ipc::ReplyStatus::UnknownError;
+								}
+
+								if (resp.status != ipc::ReplyStatus::Ok)
+								{
+									LOG(ERROR) << "Error while setting offsets: Error code " << (int)resp.status;
+								}
+
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.dm_SetOffsets.clientId, resp);
+								}
+							}
+							break;
+
+							case ipc::RequestType::DebugLogger_Settings:
+							{
+								TRACE_SPAN("DebugLogger_Settings");
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.dl_Settings.messageId;
+								auto serverDriver = ServerDriver::getInstance();
+								if (serverDriver)
+								{
+									if (message.msg.dl_Settings.enabled)
+									{
+										if (!serverDriver->motionCompensation().StartDebugData(message.msg.dl_Settings.MaxDebugPoints))
+										{
+											LOG(INFO) << "Could not start debug logger: Motion Compensation must be enabled";
+											resp.status = ipc::ReplyStatus::InvalidId;
+										}
+										else
+										{
+											LOG(INFO) << "Debug logger enabled";
+											LOG(INFO) << "Max debug data points = " << message.msg.dl_Settings.MaxDebugPoints;
+											resp.status = ipc::ReplyStatus::Ok;
+										}
 									}
 									else
 									{
-										resp.status = ipc::ReplyStatus::UnknownError;
+										LOG(INFO) << "Debug logger disabled";
+										serverDriver->motionCompensation().StopDebugData();
+										resp.status = ipc::ReplyStatus::Ok;
 									}
+								}
+								else
+								{
+									resp.status = ipc::ReplyStatus::UnknownError;
+								}
 
-									if (resp.status != ipc::ReplyStatus::Ok)
-									{
-										LOG(ERROR) << "Error while setting offsets: Error code " << (int)resp.status;
-									}
+								if (resp.status != ipc::ReplyStatus::Ok)
+								{
+									LOG(ERROR) << "Error while starting debug logger: Error code " << (int)resp.status;
+								}
 
-									if (resp.messageId != 0)
-									{
-										_this->sendReply(message.msg.dm_SetOffsets.clientId, resp);
-									}
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.dl_Settings.clientId, resp);
 								}
-								break;
+							}
+							break;
 
-								case ipc::RequestType::DebugLogger_Settings:
+							case ipc::RequestType::PoseRecorder_Settings:
+							{
+								TRACE_SPAN("PoseRecorder_Settings");
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.pr_Settings.messageId;
+								auto serverDriver = ServerDriver::getInstance();
+								if (serverDriver)
 								{
-									ipc::Reply resp(ipc::ReplyType::GenericReply);
-									resp.messageId = message.msg.dl_Settings.messageId;
-									auto serverDriver = ServerDriver::getInstance();
-									if (serverDriver)
+									if (message.msg.pr_Settings.enabled)
 									{
-										if (message.msg.dl_Settings.enabled)
+										message.msg.pr_Settings.fileName[127] = '\0';
+										std::string fileName = message.msg.pr_Settings.fileName[0] != '\0' ? message.msg.pr_Settings.fileName : "PoseData.bin";
+
+										if (serverDriver->poseRecorder().Start(fileName))
 										{
-											/*if (!serverDriver->motionCompensation().StartDebugData())
-											{
-												LOG(INFO) << "Could not start debug logger: Motion Compensation must be enabled";
-												resp.status = ipc::ReplyStatus::InvalidId;
-											}
-											else
-											{
-												LOG(INFO) << "Debug logger enabled";
-												LOG(INFO) << "Max debug data points = " << message.msg.dl_Settings.MaxDebugPoints;
-												resp.status = ipc::ReplyStatus::Ok;
-											}	*/
 											resp.status = ipc::ReplyStatus::Ok;
 										}
 										else
 										{
-											LOG(INFO) << "Debug logger disabled";
-											//serverDriver->motionCompensation().StopDebugData();
-											resp.status = ipc::ReplyStatus::Ok;
+											resp.status = ipc::ReplyStatus::InvalidOperation;
 										}
 									}
 									else
 									{
-										resp.status = ipc::ReplyStatus::UnknownError;
+										serverDriver->poseRecorder().Stop();
+										resp.status = ipc::ReplyStatus::Ok;
 									}
+								}
+								else
+								{
+									resp.status = ipc::ReplyStatus::UnknownError;
+								}
+
+								if (resp.status != ipc::ReplyStatus::Ok)
+								{
+									LOG(ERROR) << "Error while setting pose recorder: Error code " << (int)resp.status;
+								}
+
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.pr_Settings.clientId, resp);
+								}
+							}
+							break;
+
+							case ipc::RequestType::DriverCounters_Get:
+							{
+								TRACE_SPAN("DriverCounters_Get");
+								ipc::Reply resp(ipc::ReplyType::DriverCounters);
+								resp.messageId = message.msg.ovr_GenericClientMessage.messageId;
+								auto serverDriver = ServerDriver::getInstance();
+								if (serverDriver)
+								{
+									serverDriver->motionCompensation().getCounters(resp.msg.dc_Counters.counters);
+									resp.status = ipc::ReplyStatus::Ok;
+								}
+								else
+								{
+									resp.status = ipc::ReplyStatus::UnknownError;
+								}
+
+								if (resp.status != ipc::ReplyStatus::Ok)
+								{
+									LOG(ERROR) << "Error while getting driver counters: Error code " << (int)resp.status;
+								}
+
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.ovr_GenericClientMessage.clientId, resp);
+								}
+							}
+							break;
+
+							case ipc::RequestType::Telemetry_Get:
+							{
+								TRACE_SPAN("Telemetry_Get");
+								ipc::Reply resp(ipc::ReplyType::Telemetry);
+								resp.messageId = message.msg.ovr_GenericClientMessage.messageId;
+								auto serverDriver = ServerDriver::getInstance();
+								if (serverDriver)
+								{
+									Telemetry_OVRMC_v1& telemetry = resp.msg.tm_Telemetry.telemetry;
+									serverDriver->motionCompensation().getTelemetry(telemetry);
+									serverDriver->latencyMonitor().intervalSummary(telemetry.HookCalls, telemetry.HookLatencyP50, telemetry.HookLatencyP90, telemetry.HookLatencyP99, telemetry.HookLatencyMax);
+									resp.status = ipc::ReplyStatus::Ok;
+								}
+								else
+								{
+									resp.status = ipc::ReplyStatus::UnknownError;
+								}
+
+								if (resp.status != ipc::ReplyStatus::Ok)
+								{
+									LOG(ERROR) << "Error while getting telemetry: Error code " << (int)resp.status;
+								}
+
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.ovr_GenericClientMessage.clientId, resp);
+								}
+							}
+							break;
+
+							case ipc::RequestType::NoiseStatistics_Get:
+							{
+								TRACE_SPAN("NoiseStatistics_Get");
+								ipc::Reply resp(ipc::ReplyType::NoiseStatistics);
+								resp.messageId = message.msg.ns_Get.messageId;
 
-									if (resp.status != ipc::ReplyStatus::Ok)
+								if (message.msg.ns_Get.OpenVRId >= vr::k_unMaxTrackedDeviceCount)
+								{
+									resp.status = ipc::ReplyStatus::InvalidId;
+								}
+								else
+								{
+									DeviceManipulationHandle* handle = driver->getDeviceManipulationHandleById(message.msg.ns_Get.OpenVRId);
+									if (!handle)
+									{
+										resp.status = ipc::ReplyStatus::NotFound;
+									}
+									else
 									{
-										LOG(ERROR) << "Error while starting debug logger: Error code " << (int)resp.status;
+										handle->noiseEstimator().GetStatistics(resp.msg.ns_Statistics.statistics);
+										if (message.msg.ns_Get.reset)
+										{
+											handle->noiseEstimator().Reset();
+										}
+										resp.status = ipc::ReplyStatus::Ok;
 									}
+								}
 
-									if (resp.messageId != 0)
+								if (resp.status != ipc::ReplyStatus::Ok)
+								{
+									LOG(ERROR) << "Error while getting noise statistics of device " << message.msg.ns_Get.OpenVRId << ": Error code " << (int)resp.status;
+								}
+
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.ns_Get.clientId, resp);
+								}
+							}
+							break;
+
+							case ipc::RequestType::Events_Subscribe:
+							{
+								TRACE_SPAN("Events_Subscribe");
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.ev_Subscribe.messageId;
+								_this->_subscribeEvents(message.msg.ev_Subscribe.clientId, message.msg.ev_Subscribe.eventMask);
+								resp.status = ipc::ReplyStatus::Ok;
+								LOG(INFO) << "Client " << message.msg.ev_Subscribe.clientId << " subscribed to driver events (mask " << message.msg.ev_Subscribe.eventMask << ")";
+
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.ev_Subscribe.clientId, resp);
+								}
+							}
+							break;
+
+							case ipc::RequestType::FlightRecorder_Dump:
+							{
+								TRACE_SPAN("FlightRecorder_Dump");
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.fr_Dump.messageId;
+								auto serverDriver = ServerDriver::getInstance();
+								if (serverDriver)
+								{
+									message.msg.fr_Dump.fileName[127] = '\0';
+
+									if (serverDriver->flightRecorder().Dump(message.msg.fr_Dump.fileName))
+									{
+										resp.status = ipc::ReplyStatus::Ok;
+									}
+									else
 									{
-										_this->sendReply(message.msg.dl_Settings.clientId, resp);
+										resp.status = ipc::ReplyStatus::InvalidOperation;
 									}
 								}
-								break;
+								else
+								{
+									resp.status = ipc::ReplyStatus::UnknownError;
+								}
 
-								default:
-									LOG(ERROR) << "Error in ipc server receive loop: Unknown message type (" << (int)message.type << ")";
-									break;
+								if (resp.status != ipc::ReplyStatus::Ok)
+								{
+									LOG(ERROR) << "Error while dumping flight recorder: Error code " << (int)resp.status;
+								}
+
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.fr_Dump.clientId, resp);
 								}
 							}
-							else
+							break;
+
+							case ipc::RequestType::Tracing_Control:
 							{
-								LOG(ERROR) << "Error in ipc server receive loop: received size is wrong (" << recv_size << " != " << sizeof(ipc::Request) << ")";
+								TRACE_SPAN("Tracing_Control");
+								ipc::Reply resp(ipc::ReplyType::GenericReply);
+								resp.messageId = message.msg.tr_Control.messageId;
+								trace::SpanTracer& tracer = trace::SpanTracer::instance();
+
+								if (message.msg.tr_Control.enabled)
+								{
+									tracer.Start();
+									LOG(INFO) << "Span tracing started";
+									resp.status = ipc::ReplyStatus::Ok;
+								}
+								else
+								{
+									tracer.Stop();
+									message.msg.tr_Control.fileName[127] = '\0';
+									std::string fileName = message.msg.tr_Control.fileName[0] ? message.msg.tr_Control.fileName : "driver_trace.json";
+
+									if (tracer.Export(fileName, "driver_vrmotioncompensation"))
+									{
+										LOG(INFO) << "Span tracing stopped, trace written to " << fileName << " (" << tracer.DroppedSpans() << " spans dropped)";
+										resp.status = ipc::ReplyStatus::Ok;
+									}
+									else
+									{
+										LOG(ERROR) << "Could not write trace file " << fileName;
+										resp.status = ipc::ReplyStatus::InvalidOperation;
+									}
+								}
+
+								if (resp.messageId != 0)
+								{
+									_this->sendReply(message.msg.tr_Control.clientId, resp);
+								}
+							}
+							break;
+
+							default:
+								LOG(ERROR) << "Error in ipc server receive loop: Unknown message type (" << (int)message.type << ")";
+								break;
 							}
 						}
 					}
@@ -443,7 +862,6 @@ namespace vrmotioncompensation
 						LOG(ERROR) << "Exception caught in ipc server receive loop: " << ex.what();
 					}
 				}
-				boost::interprocess::message_queue::remove(_this->_ipcQueueName.c_str());
 			}
 			catch (std::exception & ex)
 			{
@@ -453,18 +871,45 @@ namespace vrmotioncompensation
 			LOG(DEBUG) << "CServerDriver::_ipcThreadFunc: thread stopped";
 		}
 
-		void IpcShmCommunicator::sendReply(uint32_t clientId, const ipc::Reply& reply)
+		bool IpcShmCommunicator::sendReply(uint32_t clientId, const ipc::Reply& reply, uint32_t timeoutMs)
 		{
 			std::lock_guard<std::mutex> guard(_sendMutex);
 			auto i = _ipcEndpoints.find(clientId);
 			if (i != _ipcEndpoints.end())
 			{
-				i->second->send(&reply, sizeof(ipc::Reply), 0);
+				if (i->second->Push(reply, timeoutMs))
+				{
+					return true;
+				}
+				_logSendError(clientId, "is full");
+			}
+			else
+			{
+				_logSendError(clientId, "is unknown");
+			}
+			return false;
+		}
+
+		void IpcShmCommunicator::_logSendError(uint32_t clientId, const char* reason)
+		{
+			// A client that stopped reading fails every event, one line per interval is enough
+			auto now = std::chrono::steady_clock::now();
+			if (now - _lastSendErrorLog < std::chrono::milliseconds(DRIVER_SEND_ERROR_LOG_INTERVAL_MS))
+			{
+				_suppressedSendErrors++;
+				return;
+			}
+
+			if (_suppressedSendErrors > 0)
+			{
+				LOG(ERROR) << "Error while sending reply: clientId " << clientId << " " << reason << " (" << _suppressedSendErrors << " more failed sends since the last message)";
 			}
 			else
 			{
-				LOG(ERROR) << "Error while sending reply: Unknown clientId " << clientId;
+				LOG(ERROR) << "Error while sending reply: clientId " << clientId << " " << reason;
 			}
+			_lastSendErrorLog = now;
+			_suppressedSendErrors = 0;
 		}
 
 	} // end namespace driver
@@ -2,21 +2,32 @@
 
 #include <thread>
 #include <string>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <mutex>
 #include <memory>
-#include <boost/interprocess/ipc/message_queue.hpp>
+#include <openvr_driver.h>
+#include <ipc_protocol.h>
+#include <ipc_shmring.h>
 
+// Events a client has not received yet, older ones are dropped when it falls behind
+#define DRIVER_EVENT_QUEUE_SIZE 64
+
+// Events posted but not yet sorted into the subscriptions by the event thread, power of two
+#define DRIVER_EVENT_POST_QUEUE_SIZE 256
+
+// The event thread also looks for posted events when it missed a notification
+#define DRIVER_EVENT_POLL_MS 10
+
+// Failed sends are logged at most once per interval
+#define DRIVER_SEND_ERROR_LOG_INTERVAL_MS 1000
 
 // driver namespace
 namespace vrmotioncompensation
 {
-	// forward declarations
-	namespace ipc
-	{
-		struct Reply;
-	}
-
 	namespace driver
 	{
 		// forward declarations
@@ -30,13 +41,44 @@ namespace vrmotioncompensation
 		class IpcShmCommunicator
 		{
 		public:
+			IpcShmCommunicator();
+
 			void init(ServerDriver* driver);
 			void shutdown();
 
+			// Queues the event for every client that subscribed to its type. Can be called from any thread, the pose hooks included:
+			// it only claims a slot in a lock free queue, the event thread sorts the events into the subscriptions and sends them.
+			// A pending event of the same type and device is replaced instead of queueing a second one.
+			void postEvent(const DriverEvent_OVRMC_v1& Event);
+
 		private:
+			struct EventSubscription
+			{
+				uint32_t Mask = 0;
+				uint32_t Dropped = 0;
+				std::deque<DriverEvent_OVRMC_v1> Pending;
+			};
+
+			// Every slot carries the position it is free for (Sequence == position) or the position it was posted at (Sequence == position + 1)
+			struct PostedEvent
+			{
+				std::atomic<uint64_t> Sequence;
+				DriverEvent_OVRMC_v1 Event;
+			};
+
 			static void _ipcThreadFunc(IpcShmCommunicator* _this, ServerDriver* driver);
 
-			void sendReply(uint32_t clientId, const ipc::Reply& reply);
+			static void _eventThreadFunc(IpcShmCommunicator* _this);
+
+			bool sendReply(uint32_t clientId, const ipc::Reply& reply, uint32_t timeoutMs = IPC_SEND_TIMEOUT_MS);
+
+			// Called with _sendMutex held
+			void _logSendError(uint32_t clientId, const char* reason);
+
+			void _subscribeEvents(uint32_t clientId, uint32_t eventMask);
+
+			// Event thread only, called with _eventMutex held
+			void _sortPostedEvents();
 
 			std::mutex _sendMutex;
 			ServerDriver* _driver = nullptr;
@@ -45,7 +87,21 @@ namespace vrmotioncompensation
 			volatile bool _ipcThreadStopFlag = false;
 			std::string _ipcQueueName = "driver_vrmotioncompensation.server_queue";
 			uint32_t _ipcClientIdNext = 1;
-			std::map<uint32_t, std::shared_ptr<boost::interprocess::message_queue>> _ipcEndpoints;
+			std::map<uint32_t, std::shared_ptr<ipc::ClientRing>> _ipcEndpoints;	// Guarded by _sendMutex
+			std::chrono::steady_clock::time_point _lastSendErrorLog;				// Guarded by _sendMutex
+			uint32_t _suppressedSendErrors = 0;										// Guarded by _sendMutex
+
+			std::unique_ptr<PostedEvent[]> _postedEvents;
+			std::atomic<uint64_t> _postPosition = { 0 };
+			uint64_t _sortPosition = 0;
+			std::atomic<uint64_t> _postDropped = { 0 };
+
+			// Guards the subscriptions between the event thread and the ipc thread, the posting threads never take it
+			std::mutex _eventMutex;
+			std::condition_variable _eventCondition;
+			std::map<uint32_t, EventSubscription> _eventSubscriptions;
+			std::thread _eventThread;
+			bool _eventThreadStopFlag = false;
 
 			// This is not exactly multi-user safe, maybe I fix it in the future
 			uint32_t _setMotionCompensationClientId = 0;
@@ -0,0 +1,136 @@
+#include "AnomalyDetector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// Weights of the running velocity and noise estimates
+		static const double VelocityWeight = 0.2;
+		static const double VarianceWeight = 0.02;
+
+		AnomalyDetector::Result AnomalyDetector::Check(const vr::DriverPose_t& Pose, double Time, double (&Position)[3])
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				Position[i] = Pose.vecPosition[i];
+			}
+
+			if (_poses == 0)
+			{
+				_accept(Position, Pose.qRotation, Time, 0.0);
+				return Result::Accepted;
+			}
+
+			if (Time - _time > _settings.MaxGap)
+			{
+				_lastReason = "time gap";
+				_poses = 0;
+				_accept(Position, Pose.qRotation, Time, 0.0);
+				return Result::TimeGap;
+			}
+			double Interval = std::max(Time - _time, _settings.MinInterval);
+
+			// Deviation from the constant velocity prediction
+			double Prediction[3];
+			double Deviation[3];
+			double Distance = 0.0;
+			double DeviationLength = 0.0;
+			double Step = 0.0;
+			for (int i = 0; i < 3; i++)
+			{
+				Prediction[i] = _position[i] + _velocity[i] * Interval;
+				Deviation[i] = Position[i] - Prediction[i];
+				Distance += Deviation[i] * Deviation[i] / std::max(_variance[i], _settings.MinDeviation * _settings.MinDeviation);
+				DeviationLength += Deviation[i] * Deviation[i];
+				Step += (Position[i] - _position[i]) * (Position[i] - _position[i]);
+			}
+			Step = std::sqrt(Step);
+
+			// Part of the deviation that the noise does not explain
+			double Excess = Distance > _settings.SoftGate ? std::sqrt(DeviationLength) * (1.0 - std::sqrt(_settings.SoftGate / Distance)) : 0.0;
+
+			double Dot = Pose.qRotation.w * _rotation.w + Pose.qRotation.x * _rotation.x + Pose.qRotation.y * _rotation.y + Pose.qRotation.z * _rotation.z;
+			double Angle = 2.0 * std::acos(std::min(1.0, std::abs(Dot)));
+
+			// The noise and velocity estimates are not settled during the warmup, only the plain velocity gates apply
+			bool Warmup = _poses < _settings.WarmupPoses;
+			const char* Reason = nullptr;
+			if (Step / Interval > _settings.MaxVelocity)
+			{
+				Reason = "velocity";
+			}
+			else if (Angle / Interval > _settings.MaxAngularVelocity)
+			{
+				Reason = "angular velocity";
+			}
+			else if (!Warmup && 2.0 * Excess / (Interval * Interval) > _settings.MaxAcceleration)
+			{
+				Reason = "acceleration";
+			}
+			else if (!Warmup && Distance > _settings.HardGate)
+			{
+				Reason = "deviation";
+			}
+
+			if (Reason)
+			{
+				_lastReason = Reason;
+				if (++_consecutiveRejects <= _settings.MaxConsecutiveRejects)
+				{
+					return Result::Rejected;
+				}
+
+				// The tracker stayed at the new pose, start over from there
+				_poses = 0;
+				_accept(Position, Pose.qRotation, Time, 0.0);
+				return Result::Accepted;
+			}
+
+			Result Outcome = Result::Accepted;
+			if (!Warmup && Distance > _settings.SoftGate)
+			{
+				// Scale the deviation down to the soft gate
+				double Weight = std::sqrt(_settings.SoftGate / Distance);
+				for (int i = 0; i < 3; i++)
+				{
+					Position[i] = Prediction[i] + Weight * Deviation[i];
+				}
+				_lastReason = "deviation";
+				Outcome = Result::DownWeighted;
+			}
+
+			_accept(Position, Pose.qRotation, Time, Interval);
+			return Outcome;
+		}
+
+		void AnomalyDetector::_accept(const double(&Position)[3], const vr::HmdQuaternion_t& Rotation, double Time, double Interval)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				if (_poses == 0)
+				{
+					_velocity[i] = 0.0;
+					_variance[i] = _settings.MinDeviation * _settings.MinDeviation;
+				}
+				else
+				{
+					double Deviation = Position[i] - (_position[i] + _velocity[i] * Interval);
+					_variance[i] += VarianceWeight * (Deviation * Deviation - _variance[i]);
+					_velocity[i] += VelocityWeight * ((Position[i] - _position[i]) / Interval - _velocity[i]);
+				}
+				_position[i] = Position[i];
+			}
+
+			_rotation = Rotation;
+			_time = Time;
+			_consecutiveRejects = 0;
+			if (_poses < _settings.WarmupPoses)
+			{
+				_poses++;
+			}
+		}
+	}
+}
\ No newline at end of file
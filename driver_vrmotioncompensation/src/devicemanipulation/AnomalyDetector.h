@@ -0,0 +1,75 @@
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <cstdint>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		struct AnomalySettings
+		{
+			double MaxGap = 0.1;					// Seconds without a pose after which the tracker state is learned again
+			double MinInterval = 0.001;				// Poses that arrive closer together count as this far apart, the hook calls can bunch up
+			double MaxVelocity = 10.0;				// m/s between two poses
+			double MaxAcceleration = 2000.0;		// m/s^2 implied by the deviation from the predicted position beyond the soft gate
+			double MaxAngularVelocity = 40.0;		// rad/s between two poses
+			double SoftGate = 9.0;					// Squared Mahalanobis distance above which a position is pulled towards the prediction (3 sigma)
+			double HardGate = 100.0;				// Squared Mahalanobis distance above which a pose is rejected (10 sigma)
+			double MinDeviation = 0.001;			// Lower limit of the expected deviation from the prediction in m
+			uint32_t WarmupPoses = 20;				// Poses after a reset that are only used to learn the noise
+			uint32_t MaxConsecutiveRejects = 10;	// After this many rejects in a row the tracker is taken to really be at the new pose
+		};
+
+		// Checks every reference tracker pose in constant time before it reaches the filters.
+		// Positions are predicted with a constant velocity model. The deviation of the measured position is compared against the
+		// per axis noise learned from earlier poses (Mahalanobis distance), and velocity, acceleration and angular velocity are gated.
+		// Lighthouse reflections and occlusions show up as single pose teleports, which fail these checks.
+		// The prediction is not taken from the DEMA of the reference filter: with the default 100 samples the DEMA lags a swaying rig by
+		// centimeters, which would push ordinary motion past the gates, and its state depends on the user's filter settings.
+		class AnomalyDetector
+		{
+		public:
+			enum class Result
+			{
+				Accepted,
+				DownWeighted,		// Position was moved towards the prediction
+				Rejected,
+				TimeGap,			// Accepted, the previous pose is older than MaxGap
+			};
+
+			AnomalyDetector(const AnomalySettings& Settings = AnomalySettings()) : _settings(Settings)
+			{
+			}
+
+			// Time in seconds. Position receives the position to use, which differs from the pose for down weighted poses.
+			Result Check(const vr::DriverPose_t& Pose, double Time, double (&Position)[3]);
+
+			void Reset()
+			{
+				_poses = 0;
+			}
+
+			// Name of the check that failed last, for logging
+			const char* LastReason() const
+			{
+				return _lastReason;
+			}
+
+		private:
+			void _accept(const double(&Position)[3], const vr::HmdQuaternion_t& Rotation, double Time, double Interval);
+
+			AnomalySettings _settings;
+
+			uint32_t _poses = 0;
+			uint32_t _consecutiveRejects = 0;
+			double _time = 0.0;
+			double _position[3] = { 0, 0, 0 };
+			double _velocity[3] = { 0, 0, 0 };
+			double _variance[3] = { 0, 0, 0 };		// Running variance of the deviation from the prediction
+			vr::HmdQuaternion_t _rotation = { 1, 0, 0, 0 };
+			const char* _lastReason = "";
+		};
+	}
+}
\ No newline at end of file
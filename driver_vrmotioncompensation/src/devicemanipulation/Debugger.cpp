@@ -1,216 +1,317 @@
 #include "Debugger.h"
 #include "../logging.h"
 
-#include <iostream>
-#include <fstream>
+#include <algorithm>
 
 namespace vrmotioncompensation
 {
 	namespace driver
 	{
-		Debugger::Debugger()
+		static std::atomic<uint64_t> DebuggerInstances = { 0 };
+
+		Debugger::Debugger() : _instance(++DebuggerInstances)
 		{
 
 		}
 
 		Debugger::~Debugger()
 		{
-
+			Stop();
 		}
 
-		void Debugger::Start()
+		bool Debugger::Start(uint32_t MaxDebugPoints)
 		{
-			std::lock_guard<std::recursive_mutex> lockGuard(_mut);
+			if (IsRunning())
+			{
+				LOG(ERROR) << "Debug logger is already running";
+				return false;
+			}
 
-			DebugCounter = 0;
-			WroteToFile = false;
-			DebuggerRunning = true;
-			DebugTimer.start();
-			LOG(DEBUG) << "Logger started";
-		}
+			// The writer thread ends on its own once the last debug point was written
+			if (_writerThread.joinable())
+			{
+				_writerThread.join();
+			}
 
-		void Debugger::Stop()
-		{
-			std::lock_guard<std::recursive_mutex> lockGuard(_mut);
+			_maxPoints = MaxDebugPoints > 0 ? MaxDebugPoints : MAX_DEBUG_ENTRIES;
 
-			DebuggerRunning = false;
+			// Every debug point holds a few samples per thread, the writer drains the buffers long before they fill up
+			_bufferSize = MIN_DEBUG_BUFFER_SIZE;
+			while (_bufferSize < _maxPoints && _bufferSize < MAX_DEBUG_BUFFER_SIZE)
+			{
+				_bufferSize <<= 1;
+			}
 
-			LOG(DEBUG) << "Logger stopped";
-		}
+			{
+				std::lock_guard<std::mutex> lock(_buffersMutex);
+				for (auto& Buffer : _buffers)
+				{
+					_retiredBuffers.push_back(std::move(Buffer));
+				}
+				_buffers.clear();
+			}
 
-		bool Debugger::IsRunning()
-		{
-			return DebuggerRunning;
+			_generation.fetch_add(1, std::memory_order_relaxed);
+			_points = 0;
+			_droppedSamples = 0;
+			_startTime = std::chrono::steady_clock::now();
+			_writerStopFlag = false;
+			_running = true;
+			_writerThread = std::thread(_writerThreadFunc, this);
+
+			LOG(DEBUG) << "Logger started, max debug points = " << _maxPoints;
+
+			return true;
 		}
 
-		void Debugger::CountUp()
+		void Debugger::Stop()
 		{
-			std::lock_guard<std::recursive_mutex> lockGuard(_mut);
+			_running = false;
 
-			if (DebuggerRunning)
+			if (_writerThread.joinable())
 			{
-				DebugTiming[DebugCounter] = DebugTimer.seconds();
+				_writerStopFlag = true;
+				_writerThread.join();
 
-				if (DebugCounter >= MAX_DEBUG_ENTRIES - 1)
-				{
-					DebuggerRunning = false;
-				}
-				else
-				{
-					DebugCounter++;
-					Ref = Hmd = false;
-				}
+				LOG(DEBUG) << "Logger stopped, " << _droppedSamples << " samples dropped";
 			}
 		}
 
-		void Debugger::AddDebugData(vr::HmdVector3d_t Data, int ID)
+		void Debugger::CountUp()
 		{
-			std::lock_guard<std::recursive_mutex> lockGuard(_mut);
+			if (!IsRunning())
+			{
+				return;
+			}
+
+			_push(SampleType::Point, 0, 0.0, 0.0, 0.0, 0.0);
 
-			if (DebuggerRunning)
+			if (_points.fetch_add(1, std::memory_order_relaxed) + 1 >= _maxPoints)
 			{
-				DebugDataV3[ID].Data[DebugCounter] = Data;
-			}			
+				_running = false;
+			}
 		}
 
-		void Debugger::AddDebugData(vr::HmdQuaternion_t Data, int ID)
+		void Debugger::AddDebugData(const vr::HmdVector3d_t& Data, int ID)
 		{
-			std::lock_guard<std::recursive_mutex> lockGuard(_mut);
-
-			if (DebuggerRunning)
+			if (IsRunning())
 			{
-				DebugDataQ4[ID].Data[DebugCounter] = Data;
-			}			
+				_push(SampleType::Vector, ID, Data.v[0], Data.v[1], Data.v[2], 0.0);
+			}
 		}
 
-		void Debugger::AddDebugData(const double Data[3], int ID)
+		void Debugger::AddDebugData(const vr::HmdQuaternion_t& Data, int ID)
 		{
-			std::lock_guard<std::recursive_mutex> lockGuard(_mut);
-
-			if (DebuggerRunning)
+			if (IsRunning())
 			{
-				DebugDataV3[ID].Data[DebugCounter].v[0] = Data[0];
-				DebugDataV3[ID].Data[DebugCounter].v[1] = Data[1];
-				DebugDataV3[ID].Data[DebugCounter].v[2] = Data[2];
+				_push(SampleType::Quaternion, ID, Data.w, Data.x, Data.y, Data.z);
 			}
 		}
 
-		void Debugger::gotRef()
+		void Debugger::AddDebugData(const double Data[3], int ID)
 		{
-			Ref = true;
+			if (IsRunning())
+			{
+				_push(SampleType::Vector, ID, Data[0], Data[1], Data[2], 0.0);
+			}
 		}
 
-		void Debugger::gotHmd()
+		void Debugger::SetDebugNameQ4(std::string Name, int ID)
 		{
-			Hmd = true;
+			if (ID >= 0 && ID < MAX_DEBUG_QUATERNIONS && !IsRunning())
+			{
+				_q4Names[ID] = Name;
+			}
 		}
 
-		bool Debugger::hasRef()
+		void Debugger::SetDebugNameV3(std::string Name, int ID)
 		{
-			return Ref;
+			if (ID >= 0 && ID < MAX_DEBUG_VECTORS && !IsRunning())
+			{
+				_v3Names[ID] = Name;
+			}
 		}
 
-		bool Debugger::hasHmd()
+		void Debugger::_push(SampleType Type, int ID, double a, double b, double c, double d)
 		{
-			return Hmd;
-		}
+			ThreadBuffer* Buffer = _getThreadBuffer();
 
+			// Pairs with the writer thread: either it sees this flag and waits before the final drain, or this thread sees that the capture stopped
+			Buffer->Writing.store(true, std::memory_order_seq_cst);
+			if (!_running.load(std::memory_order_seq_cst))
+			{
+				Buffer->Writing.store(false, std::memory_order_release);
+				return;
+			}
 
-		void Debugger::SetDebugNameQ4(std::string Name, int ID)
-		{
-			std::lock_guard<std::recursive_mutex> lockGuard(_mut);
+			uint64_t Head = Buffer->Head.load(std::memory_order_relaxed);
+
+			if (Head - Buffer->Tail.load(std::memory_order_acquire) >= Buffer->Size)
+			{
+				_droppedSamples.fetch_add(1, std::memory_order_relaxed);
+				Buffer->Writing.store(false, std::memory_order_release);
+				return;
+			}
 
-			DebugDataQ4[ID].Name = Name;
-			DebugDataQ4[ID].InUse = true;
+			Sample& Entry = Buffer->Samples[Head & (Buffer->Size - 1)];
+			Entry.Time = std::chrono::duration<double>(std::chrono::steady_clock::now() - _startTime).count();
+			Entry.Type = Type;
+			Entry.ID = (uint32_t)ID;
+			Entry.Data[0] = a;
+			Entry.Data[1] = b;
+			Entry.Data[2] = c;
+			Entry.Data[3] = d;
+
+			Buffer->Head.store(Head + 1, std::memory_order_release);
+			Buffer->Writing.store(false, std::memory_order_release);
 		}
 
-		void Debugger::SetDebugNameV3(std::string Name, int ID)
+		Debugger::ThreadBuffer* Debugger::_getThreadBuffer()
 		{
-			std::lock_guard<std::recursive_mutex> lockGuard(_mut);
+			// Keyed by the instance number, the buffer is only touched while its debugger is known to be alive
+			thread_local uint64_t Owner = 0;
+			thread_local ThreadBuffer* Buffer = nullptr;
+
+			uint64_t Generation = _generation.load(std::memory_order_relaxed);
+			if (Owner != _instance || Buffer->Generation != Generation)
+			{
+				std::lock_guard<std::mutex> lock(_buffersMutex);
+				_buffers.push_back(std::make_unique<ThreadBuffer>(_bufferSize, Generation));
+				Buffer = _buffers.back().get();
+				Owner = _instance;
+			}
 
-			DebugDataV3[ID].Name = Name;
-			DebugDataV3[ID].InUse = true;
+			return Buffer;
 		}
 
-		void Debugger::WriteFile()
+		void Debugger::_writerThreadFunc(Debugger* _this)
 		{
-			std::lock_guard<std::recursive_mutex> lockGuard(_mut);
+			LOG(DEBUG) << "Debugger::_writerThreadFunc: thread started";
 
-			if (!WroteToFile && DebugCounter > 0)
+			// Quaternions first, then vectors, like the columns of the old MotionData.txt
+			std::vector<std::pair<std::string, uint32_t>> Channels;
+			std::vector<int> QuaternionChannel(MAX_DEBUG_QUATERNIONS, -1);
+			std::vector<int> VectorChannel(MAX_DEBUG_VECTORS, -1);
+			for (int i = 0; i < MAX_DEBUG_QUATERNIONS; i++)
 			{
-				LOG(DEBUG) << "Trying to write debug file...";
-
-				std::ofstream DebugFile;
-				DebugFile.open("MotionData.txt");
-
-				if (!DebugFile.bad())
+				if (!_this->_q4Names[i].empty())
 				{
-					unsigned int index = 1;
-
-					LOG(DEBUG) << "Writing " << DebugCounter << " debug points of data";
+					QuaternionChannel[i] = (int)Channels.size();
+					Channels.push_back({ _this->_q4Names[i], 4 });
+				}
+			}
+			for (int i = 0; i < MAX_DEBUG_VECTORS; i++)
+			{
+				if (!_this->_v3Names[i].empty())
+				{
+					VectorChannel[i] = (int)Channels.size();
+					Channels.push_back({ _this->_v3Names[i], 3 });
+				}
+			}
 
-					//Write title
-					DebugFile << "Time;";
+			trace::TraceWriter Trace;
+			if (!Trace.Open("MotionData.ovrmctrace", Channels))
+			{
+				LOG(ERROR) << "Could not write debug log";
+				_this->_running = false;
+				return;
+			}
 
-					//Quaternions
-					for (int i = 0; i < MAX_DEBUG_QUATERNIONS; i++)
+			// Latest value of every channel component, written out on every debug point
+			std::vector<uint32_t> FirstValue;
+			uint32_t ValueCount = 0;
+			for (auto& Channel : Channels)
+			{
+				FirstValue.push_back(ValueCount);
+				ValueCount += Channel.second;
+			}
+			std::vector<double> Values(ValueCount, 0.0);
+			std::vector<uint64_t> Updates(Channels.size(), 0);
+			std::vector<Sample> Batch;
+			uint64_t Points = 0;
+			double FirstTime = -1.0;
+			double LastTime = 0.0;
+
+			auto drain = [&]()
+			{
+				Batch.clear();
+				{
+					std::lock_guard<std::mutex> lock(_this->_buffersMutex);
+					for (auto& Buffer : _this->_buffers)
 					{
-						if (DebugDataQ4[i].InUse)
+						uint64_t Tail = Buffer->Tail.load(std::memory_order_relaxed);
+						uint64_t Head = Buffer->Head.load(std::memory_order_acquire);
+						for (; Tail != Head; Tail++)
 						{
-							DebugFile << DebugDataQ4[i].Name << "[" << index << ":4];";
-							index += 4;
+							Batch.push_back(Buffer->Samples[Tail & (Buffer->Size - 1)]);
 						}
+						Buffer->Tail.store(Tail, std::memory_order_release);
 					}
+				}
 
-					//Vectors
-					for (int i = 0; i < MAX_DEBUG_VECTORS; i++)
+				// Samples of different threads are merged by time
+				std::stable_sort(Batch.begin(), Batch.end(), [](const Sample& a, const Sample& b)
+				{
+					return a.Time < b.Time;
+				});
+
+				for (auto& Entry : Batch)
+				{
+					int Channel = -1;
+					if (Entry.Type == SampleType::Quaternion && Entry.ID < MAX_DEBUG_QUATERNIONS)
 					{
-						if (DebugDataV3[i].InUse)
-						{
-							DebugFile << DebugDataV3[i].Name << "[" << index << ":3];";
-							index += 3;
-						}
+						Channel = QuaternionChannel[Entry.ID];
 					}
-					DebugFile << std::endl;
-
-					//Write data
-					for (int i = 0; i < DebugCounter; i++)
+					else if (Entry.Type == SampleType::Vector && Entry.ID < MAX_DEBUG_VECTORS)
 					{
-						DebugFile << DebugTiming[i] << ";";
-				
-						for (int j = 0; j < MAX_DEBUG_QUATERNIONS; j++)
-						{
-							if (DebugDataQ4[j].InUse)
-							{
-								DebugFile << DebugDataQ4[j].Data[i].w << ";";
-								DebugFile << DebugDataQ4[j].Data[i].x << ";";
-								DebugFile << DebugDataQ4[j].Data[i].y << ";";
-								DebugFile << DebugDataQ4[j].Data[i].z << ";";
-							}
-						}
-				
-						for (int j = 0; j < MAX_DEBUG_VECTORS; j++)
+						Channel = VectorChannel[Entry.ID];
+					}
+					else if (Entry.Type == SampleType::Point)
+					{
+						Trace.Append(Entry.Time, Values.data());
+						if (FirstTime < 0.0)
 						{
-							if (DebugDataV3[j].InUse)
-							{
-								DebugFile << DebugDataV3[j].Data[i].v[0] << ";";
-								DebugFile << DebugDataV3[j].Data[i].v[1] << ";";
-								DebugFile << DebugDataV3[j].Data[i].v[2] << ";";
-							}
+							FirstTime = Entry.Time;
 						}
+						LastTime = Entry.Time;
+						Points++;
+					}
 
-						DebugFile << std::endl;
+					if (Channel >= 0)
+					{
+						std::copy(Entry.Data, Entry.Data + Channels[Channel].second, Values.begin() + FirstValue[Channel]);
+						Updates[Channel]++;
 					}
+				}
+			};
 
-					DebugFile.close();
+			while (!_this->_writerStopFlag && _this->IsRunning())
+			{
+				drain();
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
 
-					WroteToFile = true;
-				}
-				else
+			{
+				// A capturing thread that saw the capture running is still writing its sample, wait for it so the final drain gets it
+				std::lock_guard<std::mutex> lock(_this->_buffersMutex);
+				for (auto& Buffer : _this->_buffers)
 				{
-					LOG(ERROR) << "Could not write debug log";
+					while (Buffer->Writing.load(std::memory_order_acquire))
+					{
+						std::this_thread::yield();
+					}
 				}
 			}
+			drain();
+
+			double Duration = LastTime - FirstTime;
+			for (uint32_t i = 0; i < Channels.size(); i++)
+			{
+				Trace.SetRate(i, Duration > 0.0 ? (double)Updates[i] / Duration : 0.0);
+			}
+			Trace.Close();
+
+			LOG(DEBUG) << "Debugger::_writerThreadFunc: thread stopped, wrote " << Points << " debug points";
 		}
 	}
 }
\ No newline at end of file
@@ -1,105 +1,117 @@
 #pragma once
 
 #include <openvr_driver.h>
+#include <motiontrace.h>
 
-#include <boost/timer/timer.hpp>
-#include <boost/chrono/chrono.hpp>
-#include <boost/chrono/system_clocks.hpp>
-
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
+// Default number of debug points when the client does not send one
 #define MAX_DEBUG_ENTRIES 50000
 #define MAX_DEBUG_VECTORS 24
 #define MAX_DEBUG_QUATERNIONS 8
+// Limits of the per thread sample buffers, the buffer size is derived from MaxDebugPoints
+#define MIN_DEBUG_BUFFER_SIZE 1024
+#define MAX_DEBUG_BUFFER_SIZE 1048576
 
 namespace vrmotioncompensation
 {
 	namespace driver
 	{
+		// Captures named vector and quaternion channels into the binary trace MotionData.ovrmctrace (see motiontrace.h).
+		// Each thread that adds data gets its own single producer / single consumer buffer, so capturing never takes a lock.
+		// A background thread drains the buffers and compresses them into the trace. Every CountUp() call adds one point with the latest value of every channel.
 		class Debugger
 		{
-
 		private:
-
-			struct DebugData
+			enum class SampleType : uint32_t
 			{
-				std::string Name = "";
-				bool InUse = false;
+				Point,			// CountUp() was called
+				Vector,
+				Quaternion
 			};
 
-			struct DebugDataV3 : DebugData 
+			struct Sample
 			{
-				vr::HmdVector3d_t Data[MAX_DEBUG_ENTRIES];
+				double Time;
+				SampleType Type;
+				uint32_t ID;
+				double Data[4];
 			};
 
-			struct DebugDataQ4 : DebugData
+			struct ThreadBuffer
 			{
-				vr::HmdQuaternion_t Data[MAX_DEBUG_ENTRIES];
-			};
-
-			template< class Clock > class timer
-			{
-				typename Clock::time_point tstart;
-			public:
-				timer()
-				{
-				}
-				typename Clock::duration elapsed() const
-				{
-					return Clock::now() - tstart;
-				}
-				double seconds() const
-				{
-					return elapsed().count() * ((double)Clock::period::num / Clock::period::den);
-				}
-				void start()
+				ThreadBuffer(uint64_t Size, uint64_t Generation) : Size(Size), Generation(Generation), Samples(new Sample[Size])
 				{
-					tstart = Clock::now();
 				}
+
+				const uint64_t Size;				// Power of two
+				const uint64_t Generation;			// Capture the buffer was created for
+				std::atomic<uint64_t> Head = { 0 };	// Written by the capturing thread
+				std::atomic<uint64_t> Tail = { 0 };	// Written by the writer thread
+				std::atomic<bool> Writing = { false };	// Set by the capturing thread while it is inside _push()
+				std::unique_ptr<Sample[]> Samples;
 			};
 
 		public:		
 			Debugger();
 			~Debugger();
 
-			void Start();
+			// Channel names have to be set before the capture is started
+			bool Start(uint32_t MaxDebugPoints = MAX_DEBUG_ENTRIES);
 
 			void Stop();
 
-			bool IsRunning();
+			bool IsRunning() const
+			{
+				return _running.load(std::memory_order_relaxed);
+			}
 
 			void CountUp();
 
-			void AddDebugData(vr::HmdVector3d_t Data, int ID);
+			void AddDebugData(const vr::HmdVector3d_t& Data, int ID);
 
-			void AddDebugData(vr::HmdQuaternion_t Data, int ID);
+			void AddDebugData(const vr::HmdQuaternion_t& Data, int ID);
 
 			void AddDebugData(const double Data[3], int ID);
 
 			void SetDebugNameV3(std::string Name, int ID);
 			void SetDebugNameQ4(std::string Name, int ID);
 
-			void WriteFile();
+		private:
+			void _push(SampleType Type, int ID, double a, double b, double c, double d);
 
-			void gotRef();
-			void gotHmd();
-			bool hasRef();
-			bool hasHmd();
+			ThreadBuffer* _getThreadBuffer();
 
-		private:
-			int DebugCounter = 0;
-			DebugDataV3 DebugDataV3[MAX_DEBUG_VECTORS];
-			DebugDataQ4 DebugDataQ4[MAX_DEBUG_QUATERNIONS];
+			static void _writerThreadFunc(Debugger* _this);
+
+			// Never reused, so a thread cannot mistake a new debugger at the address of a destroyed one for the debugger it cached
+			const uint64_t _instance;
+
+			std::string _q4Names[MAX_DEBUG_QUATERNIONS];
+			std::string _v3Names[MAX_DEBUG_VECTORS];
 
-			timer<boost::chrono::high_resolution_clock> DebugTimer;
-			double DebugTiming[MAX_DEBUG_ENTRIES];
+			std::atomic<bool> _running = { false };
+			std::atomic<bool> _writerStopFlag = { false };
+			std::atomic<uint32_t> _points = { 0 };
+			std::atomic<uint64_t> _droppedSamples = { 0 };
+			uint32_t _maxPoints = MAX_DEBUG_ENTRIES;
+			uint64_t _bufferSize = MIN_DEBUG_BUFFER_SIZE;
+			std::atomic<uint64_t> _generation = { 0 };
+			std::chrono::steady_clock::time_point _startTime;
 
-			bool DebuggerRunning = false;
-			bool Ref = false;
-			bool Hmd = false;
-			bool WroteToFile = false;
+			std::thread _writerThread;
 
-			std::recursive_mutex _mut;
+			// Only locked when a thread adds its first sample of a capture and by the writer thread.
+			// Buffers of earlier captures are kept until destruction, a capturing thread may still hold a pointer to them.
+			std::mutex _buffersMutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> _buffers;
+			std::vector<std::unique_ptr<ThreadBuffer>> _retiredBuffers;
 		};
 	}
 }
\ No newline at end of file
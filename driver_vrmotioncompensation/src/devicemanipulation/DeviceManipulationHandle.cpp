@@ -1,15 +1,8 @@
 #include "DeviceManipulationHandle.h"
 
 #include "../driver/ServerDriver.h"
-#include "../hooks/IVRServerDriverHost004Hooks.h"
-#include "../hooks/IVRServerDriverHost005Hooks.h"
 
-#undef WIN32_LEAN_AND_MEAN
-#undef NOSOUND
-#include <Windows.h>
-// According to windows documentation mmsystem.h should be automatically included with Windows.h when WIN32_LEAN_AND_MEAN and NOSOUND are not defined
-// But it doesn't work so I have to include it manually
-#include <mmsystem.h>
+#include <chrono>
 
 
 namespace vrmotioncompensation
@@ -17,52 +10,47 @@ namespace vrmotioncompensation
 	namespace driver
 	{
 		DeviceManipulationHandle::DeviceManipulationHandle(const char* serial, vr::ETrackedDeviceClass eDeviceClass)
-			: m_isValid(true), m_parent(ServerDriver::getInstance()), m_motionCompensationManager(m_parent->motionCompensation()), m_eDeviceClass(eDeviceClass), m_serialNumber(serial)
+			: m_isValid(true), m_parent(ServerDriver::getInstance()), m_motionCompensationManager(m_parent->motionCompensation()), m_eDeviceClass(eDeviceClass),
+			m_openvrId(vr::k_unTrackedDeviceIndexInvalid), m_serialNumber(serial), m_deviceMode(MotionCompensationDeviceMode::Default)
+		{
+		}
+
+		DeviceManipulationHandle::DeviceManipulationHandle(const char* serial, vr::ETrackedDeviceClass eDeviceClass, MotionCompensationManager& motionCompensationManager)
+			: m_isValid(true), m_parent(nullptr), m_motionCompensationManager(motionCompensationManager), m_eDeviceClass(eDeviceClass),
+			m_openvrId(vr::k_unTrackedDeviceIndexInvalid), m_serialNumber(serial), m_deviceMode(MotionCompensationDeviceMode::Default)
 		{
 		}
 
 		void DeviceManipulationHandle::setValid(bool isValid)
 		{
-			m_isValid = isValid;
+			m_isValid.store(isValid, std::memory_order_release);
 		}
 
 		bool DeviceManipulationHandle::handlePoseUpdate(uint32_t& unWhichDevice, vr::DriverPose_t& newPose, uint32_t unPoseStructSize)
 		{
-			// THOMAS: This is what distinguishes the Reference Tracker device from other tracked devices: the MotionCompensationDeviceMode 
-			if (m_deviceMode == MotionCompensationDeviceMode::ReferenceTracker)
-			{ 
-				//Check if the pose is valid to prevent unwanted jitter and movement
-				if (newPose.poseIsValid && newPose.result == vr::TrackingResult_Running_OK)
-				{
-					//Set the Zero-Point for the reference tracker if not done yet
-					if (!m_motionCompensationManager.isZeroPoseValid())
-					{						
-						m_motionCompensationManager.setZeroPose(newPose);
-					}
-					else
-					{
-						//Update reference tracker position
-						m_motionCompensationManager.updateRefPose(newPose);
-					}
-				}
+			MotionCompensationCounters::Device* counters = m_motionCompensationManager.counters().device(unWhichDevice);
+			if (counters)
+			{
+				MotionCompensationCounters::increment(counters->PosesSeen);
 			}
-			// THOMAS: So theoretically, we should be able to set the controller MCDM to MotionCompensated, and it should automatically apply the compensation?
-			else if (m_deviceMode == MotionCompensationDeviceMode::MotionCompensated)
+
+			if (newPose.poseIsValid && newPose.result == vr::TrackingResult_Running_OK)
 			{
-				//Check if the pose is valid to prevent unwanted jitter and movement
-				if (newPose.poseIsValid && newPose.result == vr::TrackingResult_Running_OK)
-				{
-					m_motionCompensationManager.applyMotionCompensation(newPose);
-				}
+				double now = (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() / 1.0E6;
+				m_noiseEstimator.Update(newPose, now + newPose.poseTimeOffset);
 			}
 
+			// Mode read once, the ipc thread may change it while this pose is handled. The reference tracker is filtered on the system clock in microseconds.
+			long long now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			m_motionCompensationManager.handlePose(getDeviceMode(), newPose, now, counters);
+
 			return true;
 		}
 
 		// THOMAS: This gets called by the IPC thread to set whether the device is a Reference Tracker, nothing, or a device to be MotionCompensated
 		void DeviceManipulationHandle::setMotionCompensationDeviceMode(MotionCompensationDeviceMode DeviceMode)
 		{
-			m_deviceMode = DeviceMode;
+			m_deviceMode.store(DeviceMode, std::memory_order_release);
 		}
 	} // end namespace driver
 } // end namespace vrmotioncompensation
\ No newline at end of file
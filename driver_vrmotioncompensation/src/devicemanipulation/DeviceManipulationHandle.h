@@ -2,7 +2,11 @@
 
 #include <openvr_driver.h>
 #include <vrmotioncompensation_types.h>
-#include "../hooks/common.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include "MotionCompensationCounters.h"
+#include "NoiseEstimator.h"
 
 
 // driver namespace
@@ -16,27 +20,34 @@ namespace vrmotioncompensation
 		class MotionCompensationManager;
 
 
-		// Stores manipulation information about an Open VR device
+		// Stores manipulation information about an Open VR device.
+		// Validity, OpenVR id and device mode are read by the pose hook threads while the ipc thread changes them, so they are atomic.
 		class DeviceManipulationHandle
 		{
 		private:
-			bool m_isValid = false;
+			std::atomic<bool> m_isValid;
 			ServerDriver* m_parent;
 			MotionCompensationManager& m_motionCompensationManager;
 			vr::ETrackedDeviceClass m_eDeviceClass = vr::TrackedDeviceClass_Invalid;
-			uint32_t m_openvrId = vr::k_unTrackedDeviceIndexInvalid;
+			std::atomic<uint32_t> m_openvrId;
 			std::string m_serialNumber;
 
 			std::shared_ptr<InterfaceHooks> m_serverDriverHooks;
 
-			MotionCompensationDeviceMode m_deviceMode = MotionCompensationDeviceMode::Default;
+			std::atomic<MotionCompensationDeviceMode> m_deviceMode;
+
+			// Tracking noise of the raw poses, before any compensation is applied
+			NoiseEstimator m_noiseEstimator;
 
 		public:
 			DeviceManipulationHandle(const char* serial, vr::ETrackedDeviceClass eDeviceClass);
 
+			// Used outside of the driver (e.g. to replay recordings) where no ServerDriver instance exists
+			DeviceManipulationHandle(const char* serial, vr::ETrackedDeviceClass eDeviceClass, MotionCompensationManager& motionCompensationManager);
+
 			bool isValid() const
 			{
-				return m_isValid;
+				return m_isValid.load(std::memory_order_acquire);
 			}
 
 			void setValid(bool isValid);
@@ -48,12 +59,12 @@ namespace vrmotioncompensation
 
 			uint32_t openvrId() const
 			{
-				return m_openvrId;
+				return m_openvrId.load(std::memory_order_relaxed);
 			}
 
 			void setOpenvrId(uint32_t id)
 			{
-				m_openvrId = id;
+				m_openvrId.store(id, std::memory_order_relaxed);
 			}
 
 			const std::string& serialNumber()
@@ -68,13 +79,20 @@ namespace vrmotioncompensation
 
 			MotionCompensationDeviceMode getDeviceMode() const
 			{
-				return m_deviceMode;
+				return m_deviceMode.load(std::memory_order_acquire);
 			}
 
 			void setMotionCompensationDeviceMode(MotionCompensationDeviceMode DeviceMode);
 
+			NoiseEstimator& noiseEstimator()
+			{
+				return m_noiseEstimator;
+			}
+
+			// Counts the pose and feeds the noise estimator, MotionCompensationManager::handlePose() does the routing
 			bool handlePoseUpdate(uint32_t& unWhichDevice, vr::DriverPose_t& newPose, uint32_t unPoseStructSize);
 
+		private:
 			//vr::HmdVector3d_t ToEulerAngles(vr::HmdQuaternion_t q);
 		};
 	} // end namespace driver
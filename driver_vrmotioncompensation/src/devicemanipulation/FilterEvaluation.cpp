@@ -0,0 +1,227 @@
+#include "FilterEvaluation.h"
+#include "MotionCompensationManager.h"
+#include "PoseReplay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		FilterEvaluation::FilterEvaluation(const std::vector<PoseRecord>& Input, const std::vector<PoseRecord>& GroundTruth, double WarmupSeconds)
+			: _input(Input), _groundTruth(GroundTruth), _warmupSeconds(WarmupSeconds)
+		{
+		}
+
+		FilterScore FilterEvaluation::Evaluate(const FilterSettings& Settings) const
+		{
+			FilterScore Score;
+			Score.Settings = Settings;
+
+			if (_groundTruth.empty())
+			{
+				return Score;
+			}
+
+			MotionCompensationManager Manager(nullptr);
+			Manager.setLpfBeta(Settings.LPFBeta);
+			Manager.setAlpha(Settings.Samples);
+
+			PoseReplay Replay;
+			Replay.SetRecords(_input);
+
+			std::vector<PoseRecord> Output;
+			Replay.Run(Manager, false, &Output);
+
+			// Collect the compensated and the uncompensated HMD positions, in the same order as the ground truth
+			uint32_t HmdId = _groundTruth.front().OpenVRId;
+			uint64_t WarmupEnd = (uint64_t)(_warmupSeconds * 1.0E9);
+			std::vector<vr::HmdVector3d_t> Error;		// Compensated minus ground truth
+			std::vector<vr::HmdVector3d_t> Motion;		// Uncompensated minus ground truth, what the compensation has to remove
+			std::vector<vr::HmdVector3d_t> Correction;	// Uncompensated minus compensated, what the compensation did remove
+			size_t Index = 0;
+
+			for (size_t i = 0; i < Output.size() && Index < _groundTruth.size(); i++)
+			{
+				if (Output[i].OpenVRId != HmdId)
+				{
+					continue;
+				}
+
+				const PoseRecord& Truth = _groundTruth[Index++];
+				if (Output[i].Timestamp < WarmupEnd)
+				{
+					continue;
+				}
+
+				const double* Compensated = Output[i].Pose.vecPosition;
+				const double* Raw = _input[i].Pose.vecPosition;
+				const double* Ideal = Truth.Pose.vecPosition;
+
+				Error.push_back({ Compensated[0] - Ideal[0], Compensated[1] - Ideal[1], Compensated[2] - Ideal[2] });
+				Motion.push_back({ Raw[0] - Ideal[0], Raw[1] - Ideal[1], Raw[2] - Ideal[2] });
+				Correction.push_back({ Raw[0] - Compensated[0], Raw[1] - Compensated[1], Raw[2] - Compensated[2] });
+			}
+
+			size_t Count = Error.size();
+			if (Count < 3)
+			{
+				return Score;
+			}
+
+			// Residual error
+			double Sum = 0.0;
+			for (auto& e : Error)
+			{
+				Sum += e.v[0] * e.v[0] + e.v[1] * e.v[1] + e.v[2] * e.v[2];
+			}
+			Score.ResidualError = std::sqrt(Sum / (double)Count);
+
+			// Jitter
+			Sum = 0.0;
+			for (size_t i = 1; i + 1 < Count; i++)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					double d = Error[i + 1].v[j] - 2.0 * Error[i].v[j] + Error[i - 1].v[j];
+					Sum += d * d;
+				}
+			}
+			Score.Jitter = std::sqrt(Sum / (double)(Count - 2));
+
+			// Lag: the shift of the applied correction that matches the rig motion best
+			double SamplePeriod = (_groundTruth.back().Timestamp - _groundTruth.front().Timestamp) * 1.0E-9 / (double)(_groundTruth.size() - 1);
+			size_t MaxShift = std::min<size_t>(Count / 2, (size_t)(0.5 / SamplePeriod));
+			double BestSum = std::numeric_limits<double>::max();
+			size_t BestShift = 0;
+
+			for (size_t Shift = 0; Shift <= MaxShift; Shift++)
+			{
+				Sum = 0.0;
+				for (size_t i = 0; i + Shift < Count; i++)
+				{
+					for (int j = 0; j < 3; j++)
+					{
+						double d = Correction[i + Shift].v[j] - Motion[i].v[j];
+						Sum += d * d;
+					}
+				}
+				Sum /= (double)(Count - Shift);
+
+				if (Sum < BestSum)
+				{
+					BestSum = Sum;
+					BestShift = Shift;
+				}
+			}
+			Score.Lag = (double)BestShift * SamplePeriod;
+
+			return Score;
+		}
+
+		std::vector<FilterScore> FilterEvaluation::Evaluate(const std::vector<FilterSettings>& Settings, unsigned Threads) const
+		{
+			std::vector<FilterScore> Scores(Settings.size());
+			std::atomic<size_t> Next = { 0 };
+
+			if (Threads == 0)
+			{
+				Threads = std::max(1u, std::thread::hardware_concurrency());
+			}
+
+			std::vector<std::thread> Workers;
+			for (unsigned t = 0; t < Threads; t++)
+			{
+				Workers.emplace_back([&]()
+				{
+					for (size_t i = Next++; i < Settings.size(); i = Next++)
+					{
+						Scores[i] = Evaluate(Settings[i]);
+					}
+				});
+			}
+
+			for (auto& Worker : Workers)
+			{
+				Worker.join();
+			}
+
+			return Scores;
+		}
+
+		std::vector<FilterSettings> FilterEvaluation::Grid(double BetaMin, double BetaMax, unsigned BetaSteps, uint32_t SamplesMin, uint32_t SamplesMax, uint32_t SamplesStep)
+		{
+			std::vector<FilterSettings> Settings;
+
+			for (unsigned b = 0; b < BetaSteps; b++)
+			{
+				double Beta = BetaSteps > 1 ? BetaMin + (BetaMax - BetaMin) * (double)b / (double)(BetaSteps - 1) : BetaMin;
+
+				for (uint32_t Samples = SamplesMin; Samples <= SamplesMax; Samples += std::max(1u, SamplesStep))
+				{
+					Settings.push_back({ Beta, Samples });
+				}
+			}
+
+			return Settings;
+		}
+
+		std::vector<FilterSettings> FilterEvaluation::Random(double BetaMin, double BetaMax, uint32_t SamplesMin, uint32_t SamplesMax, unsigned Count, uint32_t Seed)
+		{
+			std::vector<FilterSettings> Settings;
+			std::mt19937 Generator(Seed);
+			std::uniform_real_distribution<double> Beta(BetaMin, BetaMax);
+			std::uniform_int_distribution<uint32_t> Samples(SamplesMin, std::max(SamplesMin, SamplesMax));
+
+			for (unsigned i = 0; i < Count; i++)
+			{
+				// Braced initializers are evaluated left to right, so the draws keep their order on every compiler
+				Settings.push_back({ Beta(Generator), Samples(Generator) });
+			}
+
+			return Settings;
+		}
+
+		std::vector<FilterScore> FilterEvaluation::ParetoFront(const std::vector<FilterScore>& Scores)
+		{
+			std::vector<FilterScore> Front;
+
+			for (auto& a : Scores)
+			{
+				bool Dominated = false;
+
+				for (auto& b : Scores)
+				{
+					if (b.Jitter <= a.Jitter && b.Lag <= a.Lag && b.ResidualError <= a.ResidualError &&
+						(b.Jitter < a.Jitter || b.Lag < a.Lag || b.ResidualError < a.ResidualError))
+					{
+						Dominated = true;
+						break;
+					}
+				}
+
+				if (!Dominated)
+				{
+					Front.push_back(a);
+				}
+			}
+
+			return Front;
+		}
+
+		std::string FilterEvaluation::ToSettingsIni(const FilterSettings& Settings)
+		{
+			std::stringstream ss;
+			ss << "[deviceManipulationSettings]" << std::endl;
+			ss << "motionCompensationLPFBeta=" << Settings.LPFBeta << std::endl;
+			ss << "motionCompensationSamples=" << Settings.Samples << std::endl;
+			return ss.str();
+		}
+	}
+}
\ No newline at end of file
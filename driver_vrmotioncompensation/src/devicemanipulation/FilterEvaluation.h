@@ -0,0 +1,60 @@
+#pragma once
+
+#include "PoseRecorder.h"
+
+#include <string>
+#include <vector>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// The user facing filter settings, see DeviceManipulation_SetMotionCompensationProperties
+		struct FilterSettings
+		{
+			double LPFBeta = 0.85;
+			uint32_t Samples = 12;
+		};
+
+		// Lower is better for all values
+		struct FilterScore
+		{
+			FilterSettings Settings;
+			double Jitter = 0.0;			// RMS of the second difference of the position error in m
+			double Lag = 0.0;				// Delay of the applied correction behind the rig motion in s
+			double ResidualError = 0.0;		// RMS position error against the ground truth in m
+		};
+
+		// Scores filter settings offline by replaying a pose stream and comparing the compensated HMD poses to the ground truth.
+		// Input and GroundTruth have the layout produced by the MotionGenerator.
+		class FilterEvaluation
+		{
+		public:
+			FilterEvaluation(const std::vector<PoseRecord>& Input, const std::vector<PoseRecord>& GroundTruth, double WarmupSeconds = 1.0);
+
+			FilterScore Evaluate(const FilterSettings& Settings) const;
+
+			// Evaluates all settings on Threads worker threads (0 = one per core). Workers pick the next unevaluated setting
+			// as soon as they are done, so slow and fast configurations balance out.
+			std::vector<FilterScore> Evaluate(const std::vector<FilterSettings>& Settings, unsigned Threads = 0) const;
+
+			// Settings on a LPFBeta x Samples grid
+			static std::vector<FilterSettings> Grid(double BetaMin, double BetaMax, unsigned BetaSteps, uint32_t SamplesMin, uint32_t SamplesMax, uint32_t SamplesStep);
+
+			// Count settings drawn uniformly from the same ranges, the same Seed gives the same settings.
+			// For the same number of evaluations every parameter gets Count distinct values instead of BetaSteps or the number of sample steps.
+			static std::vector<FilterSettings> Random(double BetaMin, double BetaMax, uint32_t SamplesMin, uint32_t SamplesMax, unsigned Count, uint32_t Seed = 1);
+
+			// Scores that are not beaten in every value by any other score
+			static std::vector<FilterScore> ParetoFront(const std::vector<FilterScore>& Scores);
+
+			// The settings in the format of the overlay's QSettings ini file
+			static std::string ToSettingsIni(const FilterSettings& Settings);
+
+		private:
+			std::vector<PoseRecord> _input;
+			std::vector<PoseRecord> _groundTruth;
+			double _warmupSeconds;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "FlightRecorder.h"
+#include "../logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		FlightRecorder::FlightRecorder() : _slots(new Slot[FLIGHT_RECORDER_BUFFER_SIZE])
+		{
+			_startTime = std::chrono::steady_clock::now();
+			_lastTriggeredDump = _startTime - std::chrono::seconds(FLIGHT_RECORDER_SECONDS);
+		}
+
+		FlightRecorder::~FlightRecorder()
+		{
+			Stop();
+		}
+
+		void FlightRecorder::Start()
+		{
+			if (_dumpThread.joinable())
+			{
+				return;
+			}
+
+			_threadStopFlag = false;
+			_dumpThread = std::thread(_dumpThreadFunc, this);
+		}
+
+		void FlightRecorder::Stop()
+		{
+			if (_dumpThread.joinable())
+			{
+				{
+					std::lock_guard<std::mutex> lock(_threadMutex);
+					_threadStopFlag = true;
+				}
+				_threadCondition.notify_one();
+				_dumpThread.join();
+			}
+		}
+
+		void FlightRecorder::Record(PoseRecordType Type, uint32_t OpenVRId, int HookVersion, MotionCompensationDeviceMode DeviceMode, const vr::DriverPose_t& Pose)
+		{
+			uint64_t Index = _head.fetch_add(1, std::memory_order_relaxed);
+			Slot& Entry = _slots[Index & (FLIGHT_RECORDER_BUFFER_SIZE - 1)];
+
+			// Mark the slot as being written, so Dump() skips it instead of reading a torn record
+			Entry.Sequence.store(2 * Index + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			Entry.Record.Timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _startTime).count();
+			Entry.Record.OpenVRId = OpenVRId;
+			Entry.Record.HookVersion = HookVersion;
+			Entry.Record.Type = Type;
+			Entry.Record.DeviceMode = DeviceMode;
+			Entry.Record.Pose = Pose;
+
+			Entry.Sequence.store(2 * Index + 2, std::memory_order_release);
+		}
+
+		bool FlightRecorder::Dump(std::string FileName)
+		{
+			// Only one dump at a time, the hook threads keep recording while the ring is copied
+			std::lock_guard<std::mutex> lock(_dumpMutex);
+
+			if (FileName.empty())
+			{
+				FileName = "FlightRecorder_" + std::to_string(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()) + ".bin";
+			}
+
+			uint64_t Head = _head.load(std::memory_order_acquire);
+			uint64_t First = Head > FLIGHT_RECORDER_BUFFER_SIZE ? Head - FLIGHT_RECORDER_BUFFER_SIZE : 0;
+			uint64_t Now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _startTime).count();
+			uint64_t Oldest = Now > (uint64_t)FLIGHT_RECORDER_SECONDS * 1000000000ull ? Now - (uint64_t)FLIGHT_RECORDER_SECONDS * 1000000000ull : 0;
+
+			std::vector<PoseRecord> Records;
+			Records.reserve((size_t)(Head - First));
+
+			for (uint64_t Index = First; Index < Head; Index++)
+			{
+				Slot& Entry = _slots[Index & (FLIGHT_RECORDER_BUFFER_SIZE - 1)];
+
+				// Skip slots that are being written or were already overwritten by a newer record
+				uint64_t Sequence = Entry.Sequence.load(std::memory_order_acquire);
+				if (Sequence != 2 * Index + 2)
+				{
+					continue;
+				}
+
+				PoseRecord Copy = Entry.Record;
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (Entry.Sequence.load(std::memory_order_relaxed) != Sequence)
+				{
+					continue;
+				}
+
+				if (Copy.Timestamp >= Oldest)
+				{
+					Records.push_back(Copy);
+				}
+			}
+
+			// Hook threads claim slots in order but may finish them out of order
+			std::stable_sort(Records.begin(), Records.end(), [](const PoseRecord& a, const PoseRecord& b)
+			{
+				return a.Timestamp < b.Timestamp;
+			});
+
+			std::ofstream File(FileName, std::ios::binary | std::ios::trunc);
+			if (!File.is_open())
+			{
+				LOG(ERROR) << "Could not open flight recorder file " << FileName;
+				return false;
+			}
+
+			writePoseRecordFileHeader(File);
+			if (!Records.empty())
+			{
+				File.write(reinterpret_cast<const char*>(Records.data()), Records.size() * sizeof(PoseRecord));
+			}
+			File.close();
+
+			LOG(INFO) << "Flight recorder dumped " << Records.size() << " records to " << FileName;
+
+			return true;
+		}
+
+		void FlightRecorder::Trigger(const char* Reason)
+		{
+			bool Expected = false;
+			if (_triggered.compare_exchange_strong(Expected, true, std::memory_order_acq_rel))
+			{
+				_triggerReason.store(Reason, std::memory_order_relaxed);
+				_threadCondition.notify_one();
+			}
+		}
+
+		void FlightRecorder::_dumpThreadFunc(FlightRecorder* _this)
+		{
+			LOG(DEBUG) << "FlightRecorder::_dumpThreadFunc: thread started";
+
+			std::unique_lock<std::mutex> lock(_this->_threadMutex);
+			while (!_this->_threadStopFlag)
+			{
+				// Trigger() must not take a lock, so wake up regularly in case a notification was missed
+				_this->_threadCondition.wait_for(lock, std::chrono::milliseconds(100));
+
+				if (_this->_threadStopFlag || !_this->_triggered.load(std::memory_order_acquire))
+				{
+					continue;
+				}
+
+				const char* Reason = _this->_triggerReason.load(std::memory_order_relaxed);
+				auto Now = std::chrono::steady_clock::now();
+
+				if (Now - _this->_lastTriggeredDump < std::chrono::seconds(FLIGHT_RECORDER_SECONDS))
+				{
+					LOG(DEBUG) << "Flight recorder trigger ignored, last dump was too recent (" << (Reason ? Reason : "unknown") << ")";
+				}
+				else
+				{
+					LOG(INFO) << "Flight recorder triggered: " << (Reason ? Reason : "unknown");
+
+					// Also capture what happens after the trigger
+					_this->_threadCondition.wait_for(lock, std::chrono::seconds(FLIGHT_RECORDER_TRIGGER_DELAY), [_this]() { return _this->_threadStopFlag; });
+
+					lock.unlock();
+					_this->Dump("");
+					lock.lock();
+
+					_this->_lastTriggeredDump = std::chrono::steady_clock::now();
+				}
+
+				_this->_triggered.store(false, std::memory_order_release);
+			}
+
+			LOG(DEBUG) << "FlightRecorder::_dumpThreadFunc: thread stopped";
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "PoseRecorder.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Records kept in memory, must be a power of two. At 2 records per pose this holds roughly 10 seconds of a HMD, two controllers and a reference tracker
+#define FLIGHT_RECORDER_BUFFER_SIZE 65536
+// Dumps only contain records of this many seconds before the dump
+#define FLIGHT_RECORDER_SECONDS 10
+// Automatic dumps are delayed by this many seconds so the file also shows what happened after the trigger
+#define FLIGHT_RECORDER_TRIGGER_DELAY 2
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// Always-on ring buffer of the last poses of all devices.
+		// Recording a pose claims a slot with one atomic increment and copies the record into the preallocated ring, nothing is ever allocated or locked.
+		// The ring is written to a pose recording file (same format as the PoseRecorder) when Dump() is called, or from a background thread after Trigger().
+		class FlightRecorder
+		{
+		public:
+			FlightRecorder();
+			~FlightRecorder();
+
+			// Starts / stops the thread that handles Trigger()
+			void Start();
+
+			void Stop();
+
+			void Record(PoseRecordType Type, uint32_t OpenVRId, int HookVersion, MotionCompensationDeviceMode DeviceMode, const vr::DriverPose_t& Pose);
+
+			// Writes the last FLIGHT_RECORDER_SECONDS to the given file. An empty file name creates FlightRecorder_<unix time>.bin
+			bool Dump(std::string FileName);
+
+			// Requests a dump from any thread without blocking, e.g. from a pose update hook when an anomaly is detected.
+			// Triggers are ignored while a triggered dump is pending or within FLIGHT_RECORDER_SECONDS of the last one.
+			void Trigger(const char* Reason);
+
+		private:
+			struct Slot
+			{
+				// 2 * index + 1 while the record is written, 2 * index + 2 once it is complete
+				std::atomic<uint64_t> Sequence = { 0 };
+				PoseRecord Record;
+			};
+
+			static void _dumpThreadFunc(FlightRecorder* _this);
+
+			std::chrono::steady_clock::time_point _startTime;
+			std::atomic<uint64_t> _head = { 0 };
+			std::unique_ptr<Slot[]> _slots;
+
+			std::atomic<bool> _triggered = { false };
+			std::atomic<const char*> _triggerReason = { nullptr };
+			std::chrono::steady_clock::time_point _lastTriggeredDump;
+
+			std::mutex _dumpMutex;
+			std::mutex _threadMutex;
+			std::condition_variable _threadCondition;
+			bool _threadStopFlag = false;
+			std::thread _dumpThread;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <openvr_driver.h>
+#include <vrmotioncompensation_types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// driver namespace
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// Event counters of the motion compensation. They are only ever incremented with relaxed atomics,
+		// so the pose update hooks can count without locking, and the IPC thread can take a snapshot at any time.
+		// The per device counters live in memory of their own until the driver moves them into shared memory with attachDevices().
+		class MotionCompensationCounters
+		{
+		public:
+			typedef SharedDeviceCounters_OVRMC_v1 Device;
+
+			MotionCompensationCounters() : _localDevices(new Device[vr::k_unMaxTrackedDeviceCount]()), _devices(_localDevices.get())
+			{
+			}
+
+			static void increment(std::atomic<uint64_t>& Counter)
+			{
+				Counter.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			// Returns nullptr for ids outside of the OpenVR device range
+			Device* device(uint32_t OpenVRId)
+			{
+				return OpenVRId < vr::k_unMaxTrackedDeviceCount ? &_devices[OpenVRId] : nullptr;
+			}
+
+			const Device* device(uint32_t OpenVRId) const
+			{
+				return OpenVRId < vr::k_unMaxTrackedDeviceCount ? &_devices[OpenVRId] : nullptr;
+			}
+
+			// Counts into Devices (vr::k_unMaxTrackedDeviceCount entries) from now on. Has to be called before the first pose is counted.
+			void attachDevices(Device* Devices)
+			{
+				_devices = Devices;
+			}
+
+			// Copies all counters. The copy is not atomic as a whole, counters may be off by the poses handled while copying.
+			void snapshot(MotionCompensationCounters_OVRMC_v1& Snapshot) const
+			{
+				Snapshot.RefPoseUpdates = RefPoseUpdates.load(std::memory_order_relaxed);
+				Snapshot.RefPoseStale = RefPoseStale.load(std::memory_order_relaxed);
+				Snapshot.ZeroPoseResets = ZeroPoseResets.load(std::memory_order_relaxed);
+				Snapshot.FilterResets = FilterResets.load(std::memory_order_relaxed);
+				Snapshot.RefPoseRejected = RefPoseRejected.load(std::memory_order_relaxed);
+				Snapshot.RefPoseDownWeighted = RefPoseDownWeighted.load(std::memory_order_relaxed);
+				Snapshot.RefPoseTimeGaps = RefPoseTimeGaps.load(std::memory_order_relaxed);
+			}
+
+			std::atomic<uint64_t> RefPoseUpdates{ 0 };
+			std::atomic<uint64_t> RefPoseStale{ 0 };
+			std::atomic<uint64_t> ZeroPoseResets{ 0 };
+			std::atomic<uint64_t> FilterResets{ 0 };
+			std::atomic<uint64_t> RefPoseRejected{ 0 };
+			std::atomic<uint64_t> RefPoseDownWeighted{ 0 };
+			std::atomic<uint64_t> RefPoseTimeGaps{ 0 };
+
+		private:
+			std::unique_ptr<Device[]> _localDevices;
+			Device* _devices;
+		};
+	}
+}
\ No newline at end of file
@@ -1,19 +1,19 @@
 #include "MotionCompensationManager.h"
 
-#include "DeviceManipulationHandle.h"
-#include "../driver/ServerDriver.h"
-
 #include <cmath>
-#include <boost/math/constants/constants.hpp>
+#include <cstring>
+#ifdef _WIN32
 #include <boost/interprocess/shared_memory_object.hpp>
+#endif
 
 // driver namespace
 namespace vrmotioncompensation
 {
 	namespace driver
 	{
-		MotionCompensationManager::MotionCompensationManager(ServerDriver* parent) : m_parent(parent)
+		MotionCompensationManager::MotionCompensationManager(MotionCompensationHost* host) : m_host(host)
 		{
+#ifdef _WIN32
 			try
 			{
 				// create shared memory
@@ -29,6 +29,22 @@ namespace vrmotioncompensation
 			{
 				LOG(ERROR) << "Could not create or open shared memory. Error code " << e.get_error_code();
 			}
+#else
+			// No named shared memory on this platform, keep the offsets in process memory
+			_Poffset = &_Offset;
+#endif
+
+			_Debugger.SetDebugNameQ4("RefRot", 0);
+			_Debugger.SetDebugNameQ4("HmdRot", 1);
+			_Debugger.SetDebugNameQ4("HmdRotCompensated", 2);
+			_Debugger.SetDebugNameV3("RefRaw", 0);
+			_Debugger.SetDebugNameV3("RefPos", 1);
+			_Debugger.SetDebugNameV3("FilterVel", 2);
+			_Debugger.SetDebugNameV3("FilterAcc", 3);
+			_Debugger.SetDebugNameV3("FilterRotVel", 4);
+			_Debugger.SetDebugNameV3("FilterRotAcc", 5);
+			_Debugger.SetDebugNameV3("HmdPos", 6);
+			_Debugger.SetDebugNameV3("HmdPosCompensated", 7);
 		}
 
 		// THOMAS: Don't reset the values if we're adding multiple MC devices? -> Should be fine if we add them all in short succession.
@@ -40,8 +56,12 @@ namespace vrmotioncompensation
 				_RefPoseValid = false;
 				_RefPoseValidCounter = 0;
 				_ZeroPoseValid = false;
+				_ResetPending.store(true, std::memory_order_release);
 				_Enabled = true;
 
+				MotionCompensationCounters::increment(_Counters.ZeroPoseResets);
+				MotionCompensationCounters::increment(_Counters.FilterResets);
+
 				setAlpha(_Samples);
 			}
 			else
@@ -66,22 +86,28 @@ namespace vrmotioncompensation
 			_RtDeviceID = RTdevice;
 			_RefPoseValid = false;
 			_ZeroPoseValid = false;
+			_ResetPending.store(true, std::memory_order_release);
+
+			MotionCompensationCounters::increment(_Counters.ZeroPoseResets);
+			MotionCompensationCounters::increment(_Counters.FilterResets);
 		}
 
 		void MotionCompensationManager::setAlpha(uint32_t samples)
 		{
-			_Samples = samples;
-			_Alpha = 2.0 / (1.0 + (double)samples);
+			_Samples.store(samples, std::memory_order_relaxed);
+			_FilterSettingsPending.store(true, std::memory_order_release);
 		}
 
 		void MotionCompensationManager::setZeroMode(bool setZero)
 		{
 			_SetZeroMode = setZero;
 
+			_PoseLock.lock();
 			_zeroVec(_RefVel);
 			_zeroVec(_RefRotVel);
 			_zeroVec(_RefAcc);
 			_zeroVec(_RefRotAcc);
+			_PoseLock.unlock();
 		}
 
 		void MotionCompensationManager::setOffsets(MMFstruct_OVRMC_v1 offsets)
@@ -93,15 +119,15 @@ namespace vrmotioncompensation
 
 			// Add the translation offset to the zero pose.
 			if (_ZeroPoseValid) {
-				LOG(DEBUG) << "Received offsets, updating Zero Pose. ";
-				_ZeroLock.lock();
-				_ZeroPos.v[0] = _OrigZeroPos.v[0] + _Offset.Translation.v[0];
-				_ZeroPos.v[1] = _OrigZeroPos.v[1] + _Offset.Translation.v[1];
-				_ZeroPos.v[2] = _OrigZeroPos.v[2] + _Offset.Translation.v[2];
-				LOG(DEBUG) << "OrigZeroPosX=" << _OrigZeroPos.v[0] << " OffsetX=" << _Offset.Translation.v[0] << " ZeroPosX=" << _ZeroPos.v[0];
-				LOG(DEBUG) << "OrigZeroPosY=" << _OrigZeroPos.v[1] << " OffsetY=" << _Offset.Translation.v[1] << " ZeroPosY=" << _ZeroPos.v[1];
-				LOG(DEBUG) << "OrigZeroPosZ=" << _OrigZeroPos.v[2] << " OffsetZ=" << _Offset.Translation.v[2] << " ZeroPosZ=" << _ZeroPos.v[2];
-				_ZeroLock.unlock();
+				ALOG(DEBUG, "Received offsets, updating Zero Pose. ");
+				_PoseLock.lock();
+				_ZeroPos.v[0] = (scalar_t)(_OrigZeroPos.v[0] + _Offset.Translation.v[0]);
+				_ZeroPos.v[1] = (scalar_t)(_OrigZeroPos.v[1] + _Offset.Translation.v[1]);
+				_ZeroPos.v[2] = (scalar_t)(_OrigZeroPos.v[2] + _Offset.Translation.v[2]);
+				ALOG(DEBUG, "OrigZeroPosX={} OffsetX={} ZeroPosX={}", _OrigZeroPos.v[0], _Offset.Translation.v[0], _ZeroPos.v[0]);
+				ALOG(DEBUG, "OrigZeroPosY={} OffsetY={} ZeroPosY={}", _OrigZeroPos.v[1], _Offset.Translation.v[1], _ZeroPos.v[1]);
+				ALOG(DEBUG, "OrigZeroPosZ={} OffsetZ={} ZeroPosZ={}", _OrigZeroPos.v[2], _Offset.Translation.v[2], _ZeroPos.v[2]);
+				_PoseLock.unlock();
 			}
 		}
 
@@ -113,31 +139,92 @@ namespace vrmotioncompensation
 		void MotionCompensationManager::resetZeroPose()
 		{
 			_ZeroPoseValid = false;
+			MotionCompensationCounters::increment(_Counters.ZeroPoseResets);
 		}
 
 		void MotionCompensationManager::setZeroPose(const vr::DriverPose_t& pose)
 		{
 			// convert pose from driver space to app space
-			vr::HmdQuaternion_t tmpConj = vrmath::quaternionConjugate(pose.qWorldFromDriverRotation);
+			quat_t qWorldFromDriver = vrmath::toQuat<scalar_t>(pose.qWorldFromDriverRotation);
 
 			// Save zero points
-			_ZeroLock.lock();
-			_ZeroPos = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, pose.vecPosition, false) + pose.vecWorldFromDriverTranslation;
-			LOG(INFO) << "ZeroPos set to x: " << _ZeroPos.v[0] << " y: " << _ZeroPos.v[1] << " z: " << _ZeroPos.v[2];
-			_ZeroRot = pose.qWorldFromDriverRotation * pose.qRotation;
-			LOG(INFO) << "ZeroRot Quaternion set to w: " << _ZeroPos.v[0] << " x: " << _ZeroPos.v[1] << " y: " << _ZeroPos.v[2] << " z: " << _ZeroPos.v[3];
+			_PoseLock.lock();
+			_ZeroPos = vrmath::quaternionRotateVector(qWorldFromDriver, vrmath::toVec3<scalar_t>(pose.vecPosition), false) + vrmath::toVec3<scalar_t>(pose.vecWorldFromDriverTranslation);
+			ALOG(INFO, "ZeroPos set to x: {} y: {} z: {}", _ZeroPos.v[0], _ZeroPos.v[1], _ZeroPos.v[2]);
+			_ZeroRot = qWorldFromDriver * vrmath::toQuat<scalar_t>(pose.qRotation);
+			ALOG(INFO, "ZeroRot Quaternion set to w: {} x: {} y: {} z: {}", _ZeroRot.w, _ZeroRot.x, _ZeroRot.y, _ZeroRot.z);
 
 			_ZeroPoseValid = true;
 			_OrigZeroPos.v[0] = _ZeroPos.v[0];
 			_OrigZeroPos.v[1] = _ZeroPos.v[1];
 			_OrigZeroPos.v[2] = _ZeroPos.v[2];
-			_ZeroLock.unlock();
+			_PoseLock.unlock();
 		}
 
 		// THOMAS: This function only applies to the reference tracker device.
 		// It gets called by the DeviceManipulationHandle if the MotionCompensationDeviceMode::ReferenceTracker flag is set for this device.
 		void MotionCompensationManager::updateRefPose(const vr::DriverPose_t& pose)
 		{
+			// Get current time in microseconds
+			long long now = std::chrono::duration_cast <std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+			updateRefPose(pose, now);
+		}
+
+		void MotionCompensationManager::updateRefPose(const vr::DriverPose_t& rawPose, long long now)
+		{
+			_RefUpdateLock.lock();
+			_updateRefPose(rawPose, now);
+			_RefUpdateLock.unlock();
+		}
+
+		void MotionCompensationManager::_updateRefPose(const vr::DriverPose_t& rawPose, long long now)
+		{
+			TRACE_SPAN("updateRefPose");
+
+			// The detector, the filters and the jitter estimate belong to the hook thread, resets and settings from the ipc thread are applied here
+			if (_ResetPending.exchange(false, std::memory_order_acquire))
+			{
+				_AnomalyDetector.Reset();
+				_JitterSamples = 0;
+			}
+
+			if (_FilterSettingsPending.exchange(false, std::memory_order_acquire))
+			{
+				_RefFilter.setAlpha(2.0 / (1.0 + (double)_Samples.load(std::memory_order_relaxed)));
+				_RefFilter.setLpfBeta(_LpfBeta.load(std::memory_order_relaxed));
+			}
+
+			// One set of settings for the whole pose
+			const uint32_t Samples = _Samples.load(std::memory_order_relaxed);
+			const double LpfBeta = _LpfBeta.load(std::memory_order_relaxed);
+			const bool SetZeroMode = _SetZeroMode.load(std::memory_order_relaxed);
+
+			// Reflections and occlusions can make the reference tracker jump for a single pose, catch that before it reaches the filters
+			vr::DriverPose_t pose = rawPose;
+			switch (_AnomalyDetector.Check(rawPose, (double)now / 1.0E6 + rawPose.poseTimeOffset, pose.vecPosition))
+			{
+				case AnomalyDetector::Result::Rejected:
+					MotionCompensationCounters::increment(_Counters.RefPoseRejected);
+					_reportAnomaly("reference pose rejected");
+					return;
+
+				case AnomalyDetector::Result::DownWeighted:
+					MotionCompensationCounters::increment(_Counters.RefPoseDownWeighted);
+					break;
+
+				case AnomalyDetector::Result::TimeGap:
+					MotionCompensationCounters::increment(_Counters.RefPoseTimeGaps);
+					_reportAnomaly("reference pose time gap");
+					_JitterSamples = 0;
+					break;
+
+				default:
+					break;
+			}
+
+			_updateJitter(pose.vecPosition);
+
 			// From https://github.com/ValveSoftware/driver_hydra/blob/master/drivers/driver_hydra/driver_hydra.cpp Line 835:
 			// "True acceleration is highly volatile, so it's not really reasonable to
 			// extrapolate much from it anyway.  Passing it as 0 from any driver should
@@ -152,108 +239,108 @@ namespace vrmotioncompensation
 
 			// Oculus devices do use acceleration. It also seems that the HMD uses theses values for render-prediction
 
-			vr::HmdVector3d_t Filter_vecPosition = { 0, 0, 0 };
-			vr::HmdVector3d_t Filter_vecVelocity = { 0, 0, 0 };
-			vr::HmdVector3d_t Filter_vecAcceleration = { 0, 0, 0 };
-			vr::HmdVector3d_t Filter_vecAngularVelocity = { 0, 0, 0 };
-			vr::HmdVector3d_t Filter_vecAngularAcceleration = { 0, 0, 0 };
-			vr::HmdVector3d_t RotEulerFilter = { 0, 0, 0 };
+			vec3_t Filter_vecPosition = { 0, 0, 0 };
+			vec3_t Filter_vecVelocity = { 0, 0, 0 };
+			vec3_t Filter_vecAcceleration = { 0, 0, 0 };
+			vec3_t Filter_vecAngularVelocity = { 0, 0, 0 };
+			vec3_t Filter_vecAngularAcceleration = { 0, 0, 0 };
+			vec3_t RotEulerFilter = { 0, 0, 0 };
+			quat_t Filter_rotPosition;
 
-			vr::HmdQuaternion_t tmpConj = vrmath::quaternionConjugate(pose.qWorldFromDriverRotation);
+			quat_t qWorldFromDriver = vrmath::toQuat<scalar_t>(pose.qWorldFromDriverRotation);
 
-			// Get current time in microseconds and convert it to seconds
-			long long now = std::chrono::duration_cast <std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			// Up to five vectors are rotated by the same quaternion, so convert it to a matrix once
+			mat33_t matWorldFromDriver = vrmath::quaternionToMatrix33(qWorldFromDriver);
+
+			// Convert time difference to seconds
 			double tdiff = (double)(now - _RefTrackerLastTime) / 1.0E6 + (pose.poseTimeOffset - _RefTrackerLastPose.poseTimeOffset);
 
 			// Position
 			// Add a exponential median average filter
-			if (_Samples >= 2)
+			if (Samples >= 2)
 			{
 				// ----------------------------------------------------------------------------------------------- //
 				// ----------------------------------------------------------------------------------------------- //
 				// Position
-				Filter_vecPosition.v[0] = DEMA(pose.vecPosition[0], 0);
-				Filter_vecPosition.v[1] = DEMA(pose.vecPosition[1], 1);
-				Filter_vecPosition.v[2] = DEMA(pose.vecPosition[2], 2);
+				Filter_vecPosition.v[0] = _RefFilter.DEMA(pose.vecPosition[0], 0);
+				Filter_vecPosition.v[1] = _RefFilter.DEMA(pose.vecPosition[1], 1);
+				Filter_vecPosition.v[2] = _RefFilter.DEMA(pose.vecPosition[2], 2);
 
 				// ----------------------------------------------------------------------------------------------- //
 				// ----------------------------------------------------------------------------------------------- //
 				// Velocity and acceleration
-				if (!_SetZeroMode)
+				if (!SetZeroMode)
 				{
-					Filter_vecVelocity.v[0] = vecVelocity(tdiff, Filter_vecPosition.v[0], _RefTrackerLastPose.vecPosition[0]);
-					Filter_vecVelocity.v[1] = vecVelocity(tdiff, Filter_vecPosition.v[1], _RefTrackerLastPose.vecPosition[1]);
-					Filter_vecVelocity.v[2] = vecVelocity(tdiff, Filter_vecPosition.v[2], _RefTrackerLastPose.vecPosition[2]);
+					Filter_vecVelocity.v[0] = (scalar_t)vecVelocity(tdiff, Filter_vecPosition.v[0], _RefTrackerLastPose.vecPosition[0]);
+					Filter_vecVelocity.v[1] = (scalar_t)vecVelocity(tdiff, Filter_vecPosition.v[1], _RefTrackerLastPose.vecPosition[1]);
+					Filter_vecVelocity.v[2] = (scalar_t)vecVelocity(tdiff, Filter_vecPosition.v[2], _RefTrackerLastPose.vecPosition[2]);
 
-					Filter_vecAcceleration.v[0] = vecAcceleration(tdiff, Filter_vecVelocity.v[0], _RefTrackerLastPose.vecVelocity[0]);
-					Filter_vecAcceleration.v[1] = vecAcceleration(tdiff, Filter_vecVelocity.v[1], _RefTrackerLastPose.vecVelocity[1]);
-					Filter_vecAcceleration.v[2] = vecAcceleration(tdiff, Filter_vecVelocity.v[2], _RefTrackerLastPose.vecVelocity[2]);
+					Filter_vecAcceleration.v[0] = (scalar_t)vecAcceleration(tdiff, Filter_vecVelocity.v[0], _RefTrackerLastPose.vecVelocity[0]);
+					Filter_vecAcceleration.v[1] = (scalar_t)vecAcceleration(tdiff, Filter_vecVelocity.v[1], _RefTrackerLastPose.vecVelocity[1]);
+					Filter_vecAcceleration.v[2] = (scalar_t)vecAcceleration(tdiff, Filter_vecVelocity.v[2], _RefTrackerLastPose.vecVelocity[2]);
 				}
 			}
 			else
 			{
-				_copyVec(Filter_vecPosition, pose.vecPosition);
-				_copyVec(Filter_vecVelocity, pose.vecVelocity);
+				Filter_vecPosition = vrmath::toVec3<scalar_t>(pose.vecPosition);
+				Filter_vecVelocity = vrmath::toVec3<scalar_t>(pose.vecVelocity);
 			}
 
 			// convert pose from driver space to app space
-			_RefLock.lock();
-			_RefPos = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, Filter_vecPosition, false) + pose.vecWorldFromDriverTranslation;
-			_RefLock.unlock();
+			vec3_t RefPos = vrmath::matMul33(matWorldFromDriver, Filter_vecPosition) + vrmath::toVec3<scalar_t>(pose.vecWorldFromDriverTranslation);
 
 			// ----------------------------------------------------------------------------------------------- //
 			// ----------------------------------------------------------------------------------------------- //
 			// Rotation
-			if (_LpfBeta <= 0.9999)
+			if (LpfBeta <= 0.9999)
 			{
-				// 1st stage
-				_Filter_rotPosition[0] = lowPassFilterQuaternion(pose.qRotation, _Filter_rotPosition[0]);
-
-				// 2nd stage
-				_Filter_rotPosition[1] = lowPassFilterQuaternion(_Filter_rotPosition[0], _Filter_rotPosition[1]);
-
+				// Both low pass stages
+				Filter_rotPosition = _RefFilter.filterRotation(pose.qRotation);
 
-				vr::HmdVector3d_t RotEulerFilter = toEulerAngles(_Filter_rotPosition[1]);
+				vec3_t RotEulerFilter = MotionFilter<scalar_t>::toEulerAngles(Filter_rotPosition);
 
-				if (!_SetZeroMode)
+				if (!SetZeroMode)
 				{
-					Filter_vecAngularVelocity.v[0] = rotVelocity(tdiff, RotEulerFilter.v[0], _RotEulerFilterOld.v[0]);
-					Filter_vecAngularVelocity.v[1] = rotVelocity(tdiff, RotEulerFilter.v[1], _RotEulerFilterOld.v[1]);
-					Filter_vecAngularVelocity.v[2] = rotVelocity(tdiff, RotEulerFilter.v[2], _RotEulerFilterOld.v[2]);
+					Filter_vecAngularVelocity.v[0] = (scalar_t)rotVelocity(tdiff, RotEulerFilter.v[0], _RotEulerFilterOld.v[0]);
+					Filter_vecAngularVelocity.v[1] = (scalar_t)rotVelocity(tdiff, RotEulerFilter.v[1], _RotEulerFilterOld.v[1]);
+					Filter_vecAngularVelocity.v[2] = (scalar_t)rotVelocity(tdiff, RotEulerFilter.v[2], _RotEulerFilterOld.v[2]);
 
-					Filter_vecAngularAcceleration.v[0] = vecAcceleration(tdiff, Filter_vecAngularVelocity.v[0], _RefTrackerLastPose.vecAngularVelocity[0]);
-					Filter_vecAngularAcceleration.v[1] = vecAcceleration(tdiff, Filter_vecAngularVelocity.v[1], _RefTrackerLastPose.vecAngularVelocity[1]);
-					Filter_vecAngularAcceleration.v[2] = vecAcceleration(tdiff, Filter_vecAngularVelocity.v[2], _RefTrackerLastPose.vecAngularVelocity[2]);
+					Filter_vecAngularAcceleration.v[0] = (scalar_t)vecAcceleration(tdiff, Filter_vecAngularVelocity.v[0], _RefTrackerLastPose.vecAngularVelocity[0]);
+					Filter_vecAngularAcceleration.v[1] = (scalar_t)vecAcceleration(tdiff, Filter_vecAngularVelocity.v[1], _RefTrackerLastPose.vecAngularVelocity[1]);
+					Filter_vecAngularAcceleration.v[2] = (scalar_t)vecAcceleration(tdiff, Filter_vecAngularVelocity.v[2], _RefTrackerLastPose.vecAngularVelocity[2]);
 				}
 			}
 			else
 			{
-				_Filter_rotPosition[1] = pose.qRotation;
+				Filter_rotPosition = _RefFilter.setRotation(pose.qRotation);
 
-				_copyVec(Filter_vecAngularVelocity, pose.vecAngularVelocity);
-				_copyVec(Filter_vecAngularAcceleration, pose.vecAngularAcceleration);
+				Filter_vecAngularVelocity = vrmath::toVec3<scalar_t>(pose.vecAngularVelocity);
+				Filter_vecAngularAcceleration = vrmath::toVec3<scalar_t>(pose.vecAngularAcceleration);
 			}
 
-			// calculate orientation difference and its inverse
-			vr::HmdQuaternion_t poseWorldRot = pose.qWorldFromDriverRotation * _Filter_rotPosition[1];
-			_RefLock.lock();
-			_ZeroLock.lock();
-			_RefRot = poseWorldRot * vrmath::quaternionConjugate(_ZeroRot);
-			_RefRotInv = vrmath::quaternionConjugate(_RefRot);
-			_ZeroLock.unlock();
-			_RefLock.unlock();
+			quat_t poseWorldRot = qWorldFromDriver * Filter_rotPosition;
 
-			if (!_SetZeroMode)
+			// Convert velocity and acceleration values into app space
+			vec3_t RefVel = vrmath::matMul33(matWorldFromDriver, Filter_vecVelocity);
+			vec3_t RefRotVel = vrmath::matMul33(matWorldFromDriver, Filter_vecAngularVelocity);
+
+			vec3_t RefAcc = vrmath::matMul33(matWorldFromDriver, Filter_vecAcceleration);
+			vec3_t RefRotAcc = vrmath::matMul33(matWorldFromDriver, Filter_vecAngularAcceleration);
+
+			// Publish the reference state at once. The orientation difference is taken under the lock, so it always belongs to the zero pose readers see with it.
+			_PoseLock.lock();
+			quat_t RefRot = poseWorldRot * vrmath::quaternionConjugate(_ZeroRot);
+			_RefPos = RefPos;
+			_RefRot = RefRot;
+			_RefRotInv = vrmath::quaternionConjugate(RefRot);
+			if (!SetZeroMode)
 			{
-				// Convert velocity and acceleration values into app space
-				_RefVelLock.lock();
-				_RefVel = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, Filter_vecVelocity, false);
-				_RefRotVel = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, Filter_vecAngularVelocity, false);
-
-				_RefAcc = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, Filter_vecAcceleration, false);
-				_RefRotAcc = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, Filter_vecAngularAcceleration, false);
-				_RefVelLock.unlock();
+				_RefVel = RefVel;
+				_RefRotVel = RefRotVel;
+				_RefAcc = RefAcc;
+				_RefRotAcc = RefRotAcc;
 			}
+			_PoseLock.unlock();
 
 			// ----------------------------------------------------------------------------------------------- //
 			// ----------------------------------------------------------------------------------------------- //
@@ -267,30 +354,139 @@ namespace vrmotioncompensation
 				_RefPoseValidCounter++;
 			}
 
+			// One debug point per reference pose, the HMD channels hold their latest value
+			if (_Debugger.IsRunning())
+			{
+				_Debugger.AddDebugData(pose.vecPosition, 0);
+				_Debugger.AddDebugData(vrmath::toHmdVector3d(RefPos), 1);
+				_Debugger.AddDebugData(vrmath::toHmdVector3d(Filter_vecVelocity), 2);
+				_Debugger.AddDebugData(vrmath::toHmdVector3d(Filter_vecAcceleration), 3);
+				_Debugger.AddDebugData(vrmath::toHmdVector3d(Filter_vecAngularVelocity), 4);
+				_Debugger.AddDebugData(vrmath::toHmdVector3d(Filter_vecAngularAcceleration), 5);
+				_Debugger.AddDebugData(vrmath::toHmdQuaternion(RefRot), 0);
+				_Debugger.CountUp();
+			}
+
 			// Save last rotation and pose
 			_RotEulerFilterOld = RotEulerFilter;
 			_RefTrackerLastPose = pose;
+
+			_PosesSinceRefUpdate.store(0, std::memory_order_relaxed);
+			MotionCompensationCounters::increment(_Counters.RefPoseUpdates);
+		}
+
+		void MotionCompensationManager::_updateJitter(const double(&Position)[3])
+		{
+			if (_JitterSamples >= 2)
+			{
+				// The second difference cancels motion that is smooth over three poses, for white noise of variance s^2 its variance is 6 s^2
+				double SquaredSum = 0.0;
+				for (int i = 0; i < 3; i++)
+				{
+					double Difference = Position[i] - 2.0 * _JitterLastPos[0][i] + _JitterLastPos[1][i];
+					SquaredSum += Difference * Difference;
+				}
+
+				double Variance = _RefJitterVariance.load(std::memory_order_relaxed);
+				Variance += _JitterAlpha * (SquaredSum / 6.0 - Variance);
+				_RefJitterVariance.store(Variance, std::memory_order_relaxed);
+			}
+			else
+			{
+				_JitterSamples++;
+			}
+
+			_copyVec(_JitterLastPos[1], _JitterLastPos[0]);
+			_copyVec(_JitterLastPos[0], Position);
+		}
+
+		void MotionCompensationManager::_reportAnomaly(const char* Event)
+		{
+			ALOG(DEBUG, "Anomaly detector: {} ({})", Event, _AnomalyDetector.LastReason());
+
+			// The flight recorder rate limits its dumps on its own
+			if (_AnomalyTriggersFlightRecorder && m_host)
+			{
+				m_host->onReferencePoseAnomaly(Event);
+			}
+		}
+
+		void MotionCompensationManager::handlePose(MotionCompensationDeviceMode deviceMode, vr::DriverPose_t& pose, long long now, MotionCompensationCounters::Device* counters)
+		{
+			// THOMAS: This is what distinguishes the Reference Tracker device from other tracked devices: the MotionCompensationDeviceMode 
+			if (deviceMode != MotionCompensationDeviceMode::ReferenceTracker && deviceMode != MotionCompensationDeviceMode::MotionCompensated)
+			{
+				return;
+			}
+
+			//Check if the pose is valid to prevent unwanted jitter and movement
+			if (!pose.poseIsValid || pose.result != vr::TrackingResult_Running_OK)
+			{
+				if (counters)
+				{
+					MotionCompensationCounters::increment(!pose.poseIsValid ? counters->RejectedPoseInvalid : counters->RejectedTrackingResult);
+				}
+				return;
+			}
+
+			if (deviceMode == MotionCompensationDeviceMode::ReferenceTracker)
+			{
+				//Set the Zero-Point for the reference tracker if not done yet
+				if (!isZeroPoseValid())
+				{
+					setZeroPose(pose);
+				}
+				else
+				{
+					//Update reference tracker position
+					updateRefPose(pose, now);
+				}
+			}
+			// THOMAS: So theoretically, we should be able to set the controller MCDM to MotionCompensated, and it should automatically apply the compensation?
+			else
+			{
+				bool compensated = applyMotionCompensation(pose);
+
+				if (counters)
+				{
+					MotionCompensationCounters::increment(compensated ? counters->Compensated : counters->PassedThrough);
+				}
+			}
 		}
 
 		// THOMAS: This gets called by the DeviceManipulationHandle if the device is to be compensated (MotionCompensationDeviceMode::MotionCompensated flag is set)
 		// The calculations get written to the pose variable directly, which is passed by reference from the ServerDriver.
 		bool MotionCompensationManager::applyMotionCompensation(vr::DriverPose_t& pose)
 		{
+			TRACE_SPAN("applyMotionCompensation");
+
 			if (_Enabled && _ZeroPoseValid && _RefPoseValid)
 			{
 				// All filter calculations are done within the function for the reference tracker, because the HMD position is updated 3x more often.
 				// Convert pose from driver space to app space
-				vr::HmdQuaternion_t tmpConj = vrmath::quaternionConjugate(pose.qWorldFromDriverRotation);
-				vr::HmdVector3d_t poseWorldPos = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, pose.vecPosition, false) + pose.vecWorldFromDriverTranslation;
+				quat_t qWorldFromDriver = vrmath::toQuat<scalar_t>(pose.qWorldFromDriverRotation);
+				quat_t tmpConj = vrmath::quaternionConjugate(qWorldFromDriver);
+				mat33_t matWorldFromDriver = vrmath::quaternionToMatrix33(qWorldFromDriver);
+				vec3_t vecWorldFromDriverTranslation = vrmath::toVec3<scalar_t>(pose.vecWorldFromDriverTranslation);
+				vec3_t poseWorldPos = vrmath::matMul33(matWorldFromDriver, vrmath::toVec3<scalar_t>(pose.vecPosition)) + vecWorldFromDriverTranslation;
 
 				// Do motion compensation
-				vr::HmdQuaternion_t poseWorldRot = pose.qWorldFromDriverRotation * pose.qRotation;
-				_RefLock.lock();
-				_ZeroLock.lock();
-				vr::HmdVector3d_t compensatedPoseWorldPos = _ZeroPos + vrmath::quaternionRotateVector(_RefRot, _RefRotInv, poseWorldPos - _RefPos, true);
-				_ZeroLock.unlock();
-				vr::HmdQuaternion_t compensatedPoseWorldRot = _RefRotInv * poseWorldRot;
-				_RefLock.unlock();
+				quat_t poseWorldRot = qWorldFromDriver * vrmath::toQuat<scalar_t>(pose.qRotation);
+				// Only copy the shared state while holding the lock, the math is done on the copies.
+				// Zero and reference pose are taken together, a pose never mixes a new zero pose with a reference computed against the old one.
+				_PoseLock.lock();
+				vec3_t ZeroPos = _ZeroPos;
+				vec3_t RefPos = _RefPos;
+				quat_t RefRot = _RefRot;
+				quat_t RefRotInv = _RefRotInv;
+				vec3_t RefVel = _RefVel;
+				vec3_t RefRotVel = _RefRotVel;
+				vec3_t RefAcc = _RefAcc;
+				vec3_t RefRotAcc = _RefRotAcc;
+				_PoseLock.unlock();
+
+				vec3_t compensatedPoseWorldPos = ZeroPos + vrmath::quaternionRotateVector(RefRot, poseWorldPos - RefPos, true);
+				quat_t compensatedPoseWorldRot = RefRotInv * poseWorldRot;
 
 				// Translate the motion ref Velocity / Acceleration values into driver space and directly subtract them
 				if (_SetZeroMode)
@@ -303,36 +499,138 @@ namespace vrmotioncompensation
 				else
 				{
 					// Translate the motion ref Velocity / Acceleration values into driver space and directly subtract them
-					_RefVelLock.lock();
-					vr::HmdVector3d_t tmpPosVel = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, _RefVel, true);
+					vec3_t tmpPosVel = vrmath::matMul33(RefVel, matWorldFromDriver);
 					pose.vecVelocity[0] -= tmpPosVel.v[0];
 					pose.vecVelocity[1] -= tmpPosVel.v[1];
 					pose.vecVelocity[2] -= tmpPosVel.v[2];
 
-					vr::HmdVector3d_t tmpRotVel = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, _RefRotVel, true);
+					vec3_t tmpRotVel = vrmath::matMul33(RefRotVel, matWorldFromDriver);
 					pose.vecAngularVelocity[0] -= tmpRotVel.v[0];
 					pose.vecAngularVelocity[1] -= tmpRotVel.v[1];
 					pose.vecAngularVelocity[2] -= tmpRotVel.v[2];
 
-					vr::HmdVector3d_t tmpPosAcc = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, _RefAcc, true);
+					vec3_t tmpPosAcc = vrmath::matMul33(RefAcc, matWorldFromDriver);
 					pose.vecAcceleration[0] -= tmpPosAcc.v[0];
 					pose.vecAcceleration[1] -= tmpPosAcc.v[1];
 					pose.vecAcceleration[2] -= tmpPosAcc.v[2];
 
-					vr::HmdVector3d_t tmpRotAcc = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, _RefRotAcc, true);
+					vec3_t tmpRotAcc = vrmath::matMul33(RefRotAcc, matWorldFromDriver);
 					pose.vecAngularAcceleration[0] -= tmpRotAcc.v[0];
 					pose.vecAngularAcceleration[1] -= tmpRotAcc.v[1];
 					pose.vecAngularAcceleration[2] -= tmpRotAcc.v[2];
-					_RefVelLock.unlock();
 				}
 
 
 				// convert back to driver space
-				pose.qRotation = tmpConj * compensatedPoseWorldRot;
-				vr::HmdVector3d_t adjPoseDriverPos = vrmath::quaternionRotateVector(pose.qWorldFromDriverRotation, tmpConj, compensatedPoseWorldPos - pose.vecWorldFromDriverTranslation, true);
-				_copyVec(pose.vecPosition, adjPoseDriverPos.v);
+				pose.qRotation = vrmath::toHmdQuaternion(tmpConj * compensatedPoseWorldRot);
+				vec3_t adjPoseDriverPos = vrmath::matMul33(compensatedPoseWorldPos - vecWorldFromDriverTranslation, matWorldFromDriver);
+				_copyVec(pose.vecPosition, adjPoseDriverPos);
+
+				if (_Debugger.IsRunning())
+				{
+					_Debugger.AddDebugData(vrmath::toHmdVector3d(poseWorldPos), 6);
+					_Debugger.AddDebugData(vrmath::toHmdVector3d(compensatedPoseWorldPos), 7);
+					_Debugger.AddDebugData(vrmath::toHmdQuaternion(poseWorldRot), 1);
+					_Debugger.AddDebugData(vrmath::toHmdQuaternion(compensatedPoseWorldRot), 2);
+				}
+
+				if (_PosesSinceRefUpdate.fetch_add(1, std::memory_order_relaxed) >= _RefPoseStalePoses)
+				{
+					MotionCompensationCounters::increment(_Counters.RefPoseStale);
+				}
+
+				return true;
+			}
+			return false;
+		}
+
+		bool MotionCompensationManager::StartDebugData(uint32_t MaxDebugPoints)
+		{
+			if (!_Enabled)
+			{
+				return false;
+			}
+
+			return _Debugger.Start(MaxDebugPoints);
+		}
+
+		void MotionCompensationManager::StopDebugData()
+		{
+			_Debugger.Stop();
+		}
+
+		void MotionCompensationManager::getReferencePose(vr::DriverPose_t& pose)
+		{
+			memset(&pose, 0, sizeof(vr::DriverPose_t));
+			pose.qWorldFromDriverRotation = { 1, 0, 0, 0 };
+			pose.qDriverFromHeadRotation = { 1, 0, 0, 0 };
+
+			_PoseLock.lock();
+			vec3_t RefPos = _RefPos;
+			quat_t RefRot = _RefRot;
+			vec3_t RefVel = _RefVel;
+			vec3_t RefRotVel = _RefRotVel;
+			vec3_t RefAcc = _RefAcc;
+			vec3_t RefRotAcc = _RefRotAcc;
+			_PoseLock.unlock();
+
+			_copyVec(pose.vecPosition, RefPos);
+			_copyVec(pose.vecVelocity, RefVel);
+			_copyVec(pose.vecAcceleration, RefAcc);
+			_copyVec(pose.vecAngularVelocity, RefRotVel);
+			_copyVec(pose.vecAngularAcceleration, RefRotAcc);
+			pose.qRotation = vrmath::toHmdQuaternion(RefRot);
+
+			pose.result = vr::TrackingResult_Running_OK;
+			pose.poseIsValid = _ZeroPoseValid && _RefPoseValid;
+			pose.deviceIsConnected = true;
+		}
+
+		void MotionCompensationManager::getCounters(MotionCompensationCounters_OVRMC_v1& Snapshot)
+		{
+			_Counters.snapshot(Snapshot);
+			Snapshot.Enabled = _Enabled;
+			Snapshot.ZeroPoseValid = _ZeroPoseValid;
+			Snapshot.RefPoseValid = _RefPoseValid;
+		}
+
+		void MotionCompensationManager::getTelemetry(Telemetry_OVRMC_v1& Telemetry)
+		{
+			memset(&Telemetry, 0, sizeof(Telemetry_OVRMC_v1));
+			Telemetry.TimestampMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+			_PoseLock.lock();
+			vec3_t ZeroPos = _ZeroPos;
+			vec3_t RefPos = _RefPos;
+			quat_t RefRot = _RefRot;
+			_PoseLock.unlock();
+
+			Telemetry.Enabled = _Enabled;
+			Telemetry.ZeroPoseValid = _ZeroPoseValid;
+			Telemetry.RefPoseValid = _RefPoseValid;
+			if (Telemetry.ZeroPoseValid && Telemetry.RefPoseValid)
+			{
+				_copyVec(Telemetry.RefOffset, RefPos - ZeroPos);
+				_copyVec(Telemetry.RefRotation, MotionFilter<scalar_t>::toEulerAngles(RefRot));
+				for (int i = 0; i < 3; i++)
+				{
+					Telemetry.RefRotation[i] *= 180.0 / boost::math::constants::pi<double>();
+				}
+			}
+			Telemetry.RefJitter = std::sqrt(_RefJitterVariance.load(std::memory_order_relaxed));
+
+			Telemetry.RefPoseUpdates = _Counters.RefPoseUpdates.load(std::memory_order_relaxed);
+			Telemetry.RefPoseRejected = _Counters.RefPoseRejected.load(std::memory_order_relaxed);
+			Telemetry.RefPoseTimeGaps = _Counters.RefPoseTimeGaps.load(std::memory_order_relaxed);
+			Telemetry.RefPoseStale = _Counters.RefPoseStale.load(std::memory_order_relaxed);
+			Telemetry.FilterResets = _Counters.FilterResets.load(std::memory_order_relaxed);
+			for (uint32_t i = 0; i < vr::k_unMaxTrackedDeviceCount; i++)
+			{
+				const MotionCompensationCounters::Device* Device = _Counters.device(i);
+				Telemetry.PosesSeen += Device->PosesSeen.load(std::memory_order_relaxed);
+				Telemetry.Compensated += Device->Compensated.load(std::memory_order_relaxed);
+				Telemetry.PassedThrough += Device->PassedThrough.load(std::memory_order_relaxed);
 			}
-			return true;
 		}
 
 		void MotionCompensationManager::runFrame()
@@ -383,14 +681,6 @@ namespace vrmotioncompensation
 			return NewVelocity;
 		}
 
-		// Low Pass Filter for 3d Vectors
-		double MotionCompensationManager::DEMA(const double RawData, int Axis)
-		{
-			_Filter_vecPosition[0].v[Axis] += _Alpha * (RawData - _Filter_vecPosition[1].v[Axis]);
-			_Filter_vecPosition[1].v[Axis] += _Alpha * (_Filter_vecPosition[0].v[Axis] - _Filter_vecPosition[1].v[Axis]);
-			return 2 * _Filter_vecPosition[0].v[Axis] - _Filter_vecPosition[1].v[Axis];
-		}
-
 		// Low Pass Filter for 3d Vectors
 		vr::HmdVector3d_t MotionCompensationManager::LPF(const double RawData[3], vr::HmdVector3d_t SmoothData)
 		{
@@ -415,84 +705,6 @@ namespace vrmotioncompensation
 			return RetVal;
 		}
 
-		// Low Pass Filter for quaternion
-		vr::HmdQuaternion_t MotionCompensationManager::lowPassFilterQuaternion(vr::HmdQuaternion_t RawData, vr::HmdQuaternion_t SmoothData)
-		{
-			return slerp(SmoothData, RawData, _LpfBeta);
-		}
-
-		// Spherical Linear Interpolation for Quaternions
-		vr::HmdQuaternion_t MotionCompensationManager::slerp(vr::HmdQuaternion_t q1, vr::HmdQuaternion_t q2, double lambda)
-		{
-			vr::HmdQuaternion_t qr;
-
-			double dotproduct = q1.x * q2.x + q1.y * q2.y + q1.z * q2.z + q1.w * q2.w;
-
-			// if q1 and q2 are the same, we can return either of the values
-			if (dotproduct >= 1.0 || dotproduct <= -1.0)
-			{
-				return q1;
-			}
-
-			double theta, st, sut, sout, coeff1, coeff2;
-
-			// algorithm adapted from Shoemake's paper
-			lambda = lambda / 2.0;
-
-			theta = (double)acos(dotproduct);
-			if (theta < 0.0) theta = -theta;
-
-			st = (double)sin(theta);
-			sut = (double)sin(lambda * theta);
-			sout = (double)sin((1 - lambda) * theta);
-			coeff1 = sout / st;
-			coeff2 = sut / st;
-
-			qr.x = coeff1 * q1.x + coeff2 * q2.x;
-			qr.y = coeff1 * q1.y + coeff2 * q2.y;
-			qr.z = coeff1 * q1.z + coeff2 * q2.z;
-			qr.w = coeff1 * q1.w + coeff2 * q2.w;
-
-
-			//Normalize
-			double norm = sqrt(qr.x * qr.x + qr.y * qr.y + qr.z * qr.z + qr.w * qr.w);
-			qr.x /= norm;
-			qr.y /= norm;
-			qr.z /= norm;
-
-			return qr;
-		}
-
-		// Convert Quaternion to Euler Angles in Radians
-		vr::HmdVector3d_t MotionCompensationManager::toEulerAngles(vr::HmdQuaternion_t q)
-		{
-			vr::HmdVector3d_t angles;
-
-			// roll (x-axis rotation)
-			double sinr_cosp = 2 * (q.w * q.x + q.y * q.z);
-			double cosr_cosp = 1 - 2 * (q.x * q.x + q.y * q.y);
-			angles.v[0] = std::atan2(sinr_cosp, cosr_cosp);
-
-			// pitch (y-axis rotation)
-			double sinp = 2 * (q.w * q.y - q.z * q.x);
-
-			if (std::abs(sinp) >= 1)
-			{
-				angles.v[1] = std::copysign(boost::math::constants::pi<double>() / 2, sinp); // use 90 degrees if out of range
-			}
-			else
-			{
-				angles.v[1] = std::asin(sinp);
-			}
-
-			// yaw (z-axis rotation)
-			double siny_cosp = 2 * (q.w * q.z + q.x * q.y);
-			double cosy_cosp = 1 - 2 * (q.y * q.y + q.z * q.z);
-			angles.v[2] = std::atan2(siny_cosp, cosy_cosp);
-
-			return angles;
-		}
-
 		// Returns the shortest difference between to angles
 		const double MotionCompensationManager::angleDifference(double Raw, double New)
 		{
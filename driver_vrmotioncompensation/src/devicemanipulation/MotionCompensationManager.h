@@ -3,67 +3,55 @@
 #include <openvr_driver.h>
 #include <vrmotioncompensation_types.h>
 #include <openvr_math.h>
+#include <tracespans.h>
 #include "../logging.h"
+#include "AnomalyDetector.h"
 #include "Debugger.h"
+#include "MotionFilter.h"
+#include "MotionCompensationCounters.h"
+#include "Spinlock.h"
 
 #include <boost/timer/timer.hpp>
 #include <boost/chrono/chrono.hpp>
 #include <boost/chrono/system_clocks.hpp>
+#ifdef _WIN32
 #include <boost/interprocess/windows_shared_memory.hpp>
 #include <boost/interprocess/mapped_region.hpp>
+#endif
+
+// Scalar type of the compensation math and of the reference tracker filter state.
+// Define VRMOTIONCOMPENSATION_SCALAR=float in the preprocessor definitions to build the single precision path.
+#ifndef VRMOTIONCOMPENSATION_SCALAR
+#define VRMOTIONCOMPENSATION_SCALAR double
+#endif
 
 // driver namespace
 namespace vrmotioncompensation
 {
 	namespace driver
 	{
-		// forward declarations
-		class ServerDriver;
-		class DeviceManipulationHandle;
-
-		class Spinlock
+		// What the manager needs from the driver around it. Keeps the manager free of the hooks and SteamVR, so it also builds in the tools and benchmarks.
+		class MotionCompensationHost
 		{
-			// Source: https://rigtorp.se/spinlock/
-			std::atomic<bool> lock_ = { 0 };
-
 		public:
-			void lock() noexcept
+			virtual ~MotionCompensationHost()
 			{
-				for (;;)
-				{
-					// Optimistically assume the lock is free on the first try
-					if (!lock_.exchange(true, std::memory_order_acquire))
-					{
-						return;
-					}
-					// Wait for lock to be released without generating cache misses
-					while (lock_.load(std::memory_order_relaxed))
-					{
-						// Issue X86 PAUSE or ARM YIELD instruction to reduce contention between
-						// hyper-threads
-						YieldProcessor();
-					}
-				}
 			}
 
-			bool try_lock() noexcept
-			{
-				// First do a relaxed load to check if lock is free in order to prevent
-				// unnecessary cache misses if someone does while(!try_lock())
-				return !lock_.load(std::memory_order_relaxed) &&
-					!lock_.exchange(true, std::memory_order_acquire);
-			}
-
-			void unlock() noexcept
-			{
-				lock_.store(false, std::memory_order_release);
-			}
+			// A reference pose was rejected or arrived after a time gap
+			virtual void onReferencePoseAnomaly(const char* Event) = 0;
 		};
 
 		class MotionCompensationManager
 		{
 		public:
-			MotionCompensationManager(ServerDriver* parent);
+			typedef VRMOTIONCOMPENSATION_SCALAR scalar_t;
+			typedef vrmath::vec3<scalar_t> vec3_t;
+			typedef vrmath::quat<scalar_t> quat_t;
+			typedef vrmath::mat33<scalar_t> mat33_t;
+
+			// host may be null, anomalies are only logged then
+			MotionCompensationManager(MotionCompensationHost* host);
 
 			bool setMotionCompensationMode(MotionCompensationMode Mode, int MCdevice, int RTdevice);
 
@@ -73,29 +61,41 @@ namespace vrmotioncompensation
 
 			MotionCompensationMode getMotionCompensationMode()
 			{
-				return _Mode;
+				return _Mode.load(std::memory_order_relaxed);
 			}
 
+			// The filter settings take effect with the next reference pose, the filter state belongs to the hook thread
 			void setAlpha(uint32_t samples);
 
 			void setLpfBeta(double NewBeta)
 			{
-				_LpfBeta = NewBeta;
+				_LpfBeta.store(NewBeta, std::memory_order_relaxed);
+				_FilterSettingsPending.store(true, std::memory_order_release);
 			}
 
 			double getLPFBeta()
 			{
-				return _LpfBeta;
+				return _LpfBeta.load(std::memory_order_relaxed);
 			}
 
 			int getMCdeviceID()
 			{
-				return _McDeviceID;
+				return _McDeviceID.load(std::memory_order_relaxed);
 			}
 
 			int getRTdeviceID()
 			{
-				return _RtDeviceID;
+				return _RtDeviceID.load(std::memory_order_relaxed);
+			}
+
+			bool isEnabled()
+			{
+				return _Enabled.load(std::memory_order_acquire);
+			}
+
+			bool isRefPoseValid()
+			{
+				return _RefPoseValid.load(std::memory_order_acquire);
 			}
 
 			void setZeroMode(bool setZero);
@@ -109,30 +109,69 @@ namespace vrmotioncompensation
 			void setZeroPose(const vr::DriverPose_t& pose);
 			
 			void updateRefPose(const vr::DriverPose_t& pose);
+
+			// Same as above, but with the time of the pose given in microseconds instead of read from the system clock.
+			// Used to feed recorded poses through the filters with reproducible results.
+			// Calls from different hook threads are serialized, while the reference tracker moves to another device both may report.
+			void updateRefPose(const vr::DriverPose_t& pose, long long now);
 			
+			// Returns false when the pose was left unchanged because compensation is disabled or has no valid zero or reference pose yet
 			bool applyMotionCompensation(vr::DriverPose_t& pose);
 
+			// Routes a raw pose by the mode of its device, the pose hook and PoseReplay both go through here.
+			// now is the time of the pose in microseconds, the counters of the device may be null.
+			void handlePose(MotionCompensationDeviceMode deviceMode, vr::DriverPose_t& pose, long long now, MotionCompensationCounters::Device* counters = nullptr);
+
 			void runFrame();
 
+			// Starts capturing the reference and compensation data into MotionData.ovrmctrace, fails when motion compensation is not enabled
+			bool StartDebugData(uint32_t MaxDebugPoints);
+
+			void StopDebugData();
+
+			MotionCompensationCounters& counters()
+			{
+				return _Counters;
+			}
+
+			// Lets rejected reference poses and time gaps trigger a flight recorder dump
+			void setAnomalyTriggersFlightRecorder(bool Enable)
+			{
+				_AnomalyTriggersFlightRecorder = Enable;
+			}
+
+			// Filtered reference tracker state in app space, qWorldFromDriverRotation is the identity
+			void getReferencePose(vr::DriverPose_t& pose);
+
+			// Copies the counters together with the current compensation state
+			void getCounters(MotionCompensationCounters_OVRMC_v1& Snapshot);
+
+			// Fills everything but the hook latencies, which belong to the LatencyMonitor
+			void getTelemetry(Telemetry_OVRMC_v1& Telemetry);
+
+			// Contention statistics of the lock around the zero and reference pose
+			const Spinlock& poseLock() const
+			{
+				return _PoseLock;
+			}
+
 		private:			
+			void _updateRefPose(const vr::DriverPose_t& pose, long long now);
+
+			void _reportAnomaly(const char* Event);
+
+			void _updateJitter(const double(&Position)[3]);
+
 			double vecVelocity(double time, const double vecPosition, const double Old_vecPosition);
 
 			double vecAcceleration(double time, const double vecVelocity, const double Old_vecVelocity);
 
 			double rotVelocity(double time, const double vecAngle, const double Old_vecAngle);
 
-			double DEMA(const double RawData, int Axis);
-
 			vr::HmdVector3d_t LPF(const double RawData[3], vr::HmdVector3d_t SmoothData);
 
 			vr::HmdVector3d_t LPF(vr::HmdVector3d_t RawData, vr::HmdVector3d_t SmoothData);
 
-			vr::HmdQuaternion_t lowPassFilterQuaternion(vr::HmdQuaternion_t RawData, vr::HmdQuaternion_t SmoothData);
-
-			vr::HmdQuaternion_t slerp(vr::HmdQuaternion_t q1, vr::HmdQuaternion_t q2, double lambda);
-
-			vr::HmdVector3d_t toEulerAngles(vr::HmdQuaternion_t q);
-
 			const double angleDifference(double angle1, double angle2);
 
 			vr::HmdVector3d_t transform(vr::HmdVector3d_t VecRotation, vr::HmdVector3d_t VecPosition, vr::HmdVector3d_t point);
@@ -186,53 +225,95 @@ namespace vrmotioncompensation
 				d.v[0] = d.v[1] = d.v[2] = 0.0;
 			}
 
-			ServerDriver* m_parent;
+			inline void _zeroVec(vec3_t & d)
+			{
+				d.v[0] = d.v[1] = d.v[2] = (scalar_t)0.0;
+			}
+
+			inline void _copyVec(double(&d)[3], const vec3_t & s)
+			{
+				d[0] = s.v[0];
+				d[1] = s.v[1];
+				d[2] = s.v[2];
+			}
 
+			MotionCompensationHost* m_host;
+
+#ifdef _WIN32
 			boost::interprocess::windows_shared_memory _shdmem;
 			boost::interprocess::mapped_region _region;
+#endif
 
-			int _McDeviceID = -1;
-			int _RtDeviceID = -1;
+			// Mode, devices and flags are written by the ipc thread and read by the hook threads
+			std::atomic<int> _McDeviceID = { -1 };
+			std::atomic<int> _RtDeviceID = { -1 };
 			long long _RefTrackerLastTime = -1;
 			vr::DriverPose_t _RefTrackerLastPose;
-			vr::HmdVector3d_t _RotEulerFilterOld = {0, 0, 0};
+			vec3_t _RotEulerFilterOld = {0, 0, 0};
+
+			// Filter settings as requested, _RefFilter picks them up in updateRefPose
+			std::atomic<double> _LpfBeta = { 0.2 };
+			std::atomic<uint32_t> _Samples = { 100 };
+			std::atomic<bool> _FilterSettingsPending = { false };
+			std::atomic<bool> _SetZeroMode = { false };
 
-			double _LpfBeta = 0.2;
-			double _Alpha = -1.0;
-			uint32_t _Samples = 100;
-			bool _SetZeroMode = false;
+			// Guards the zero pose and the published reference state, so readers always get one consistent set
+			Spinlock _PoseLock;
 
-			Spinlock _ZeroLock, _RefLock, _RefVelLock;
+			// Serializes updateRefPose, everything from _RefTrackerLastTime to the jitter estimate belongs to its holder
+			Spinlock _RefUpdateLock;
 
-			bool _Enabled = false;
-			MotionCompensationMode _Mode = MotionCompensationMode::Disabled;			
+			std::atomic<bool> _Enabled = { false };
+			std::atomic<MotionCompensationMode> _Mode = { MotionCompensationMode::Disabled };
 			
 			// Offset data
 			MMFstruct_OVRMC_v1 _Offset;
 			MMFstruct_OVRMC_v1* _Poffset = nullptr;
 
 			// Zero position
-			vr::HmdVector3d_t _ZeroPos = { 0, 0, 0 };
-			vr::HmdVector3d_t _OrigZeroPos = { 0, 0, 0 };
-			vr::HmdQuaternion_t _ZeroRot = { 1, 0, 0, 0 };
-			bool _ZeroPoseValid = false;
+			vec3_t _ZeroPos = { 0, 0, 0 };
+			vec3_t _OrigZeroPos = { 0, 0, 0 };
+			quat_t _ZeroRot = { 1, 0, 0, 0 };
+			std::atomic<bool> _ZeroPoseValid = { false };
 			
 			// Reference position
-			vr::HmdVector3d_t _RefPos = { 0, 0, 0 };
-			vr::HmdVector3d_t _Filter_vecPosition[2] = { 0, 0, 0 };
+			vec3_t _RefPos = { 0, 0, 0 };
+
+			vec3_t _RefVel = { 0, 0, 0 };
+			vec3_t _RefAcc = { 0, 0, 0 };
+
+			quat_t _RefRot = { 1, 0, 0, 0 };
+			quat_t _RefRotInv = { 1, 0, 0, 0 };
+
+			vec3_t _RefRotVel = { 0, 0, 0 };
+			vec3_t _RefRotAcc = { 0, 0, 0 };
+
+			// Reference tracker filter state
+			MotionFilter<scalar_t> _RefFilter;
+
+			std::atomic<bool> _RefPoseValid = { false };
+			std::atomic<int> _RefPoseValidCounter = { 0 };
+
+			// Screens the reference poses before they reach the filter
+			AnomalyDetector _AnomalyDetector;
+			bool _AnomalyTriggersFlightRecorder = true;
+
+			// Set by mode and reference tracker changes, the next updateRefPose resets the detector and the jitter estimate
+			std::atomic<bool> _ResetPending = { false };
 
-			vr::HmdVector3d_t _RefVel = { 0, 0, 0 };
-			vr::HmdVector3d_t _RefAcc = { 0, 0, 0 };
+			// Noise estimate of the raw reference position in driver space, exponentially averaged over about 1 / _JitterAlpha poses
+			static constexpr double _JitterAlpha = 0.01;
+			double _JitterLastPos[2][3] = { { 0, 0, 0 }, { 0, 0, 0 } };
+			uint32_t _JitterSamples = 0;
+			std::atomic<double> _RefJitterVariance = { 0.0 };
 
-			vr::HmdQuaternion_t _RefRot = { 1, 0, 0, 0 };
-			vr::HmdQuaternion_t _RefRotInv = { 1, 0, 0, 0 };
-			vr::HmdQuaternion_t _Filter_rotPosition[2] = { 1, 0, 0, 0 };
+			// A reference pose counts as stale when this many poses were compensated since its last update
+			static const uint32_t _RefPoseStalePoses = 100;
 
-			vr::HmdVector3d_t _RefRotVel = { 0, 0, 0 };
-			vr::HmdVector3d_t _RefRotAcc = { 0, 0, 0 };
+			std::atomic<uint32_t> _PosesSinceRefUpdate = { 0 };
+			MotionCompensationCounters _Counters;
 
-			bool _RefPoseValid = false;
-			int _RefPoseValidCounter = 0;
+			Debugger _Debugger;
 		};
 	}
 }
\ No newline at end of file
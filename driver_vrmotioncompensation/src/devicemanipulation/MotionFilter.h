@@ -0,0 +1,146 @@
+#pragma once
+
+#include <openvr_driver.h>
+#include <openvr_math.h>
+
+#include <cmath>
+#include <boost/math/constants/constants.hpp>
+
+// driver namespace
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// Filter state of the reference tracker, templated on the scalar type.
+		// Position is smoothed with a double exponential moving average (DEMA), rotation with a two stage slerp low pass.
+		template<typename T> class MotionFilter
+		{
+		public:
+			typedef T scalar_t;
+			typedef vrmath::vec3<T> vec3_t;
+			typedef vrmath::quat<T> quat_t;
+
+			void setAlpha(double alpha)
+			{
+				_Alpha = (T)alpha;
+			}
+
+			void setLpfBeta(double beta)
+			{
+				_LpfBeta = (T)beta;
+			}
+
+			// Double exponential moving average for one axis of the position
+			T DEMA(const double RawData, int Axis)
+			{
+				_Filter_vecPosition[0].v[Axis] += _Alpha * ((T)RawData - _Filter_vecPosition[1].v[Axis]);
+				_Filter_vecPosition[1].v[Axis] += _Alpha * (_Filter_vecPosition[0].v[Axis] - _Filter_vecPosition[1].v[Axis]);
+				return 2 * _Filter_vecPosition[0].v[Axis] - _Filter_vecPosition[1].v[Axis];
+			}
+
+			// Runs both low pass stages and returns the output of the 2nd stage
+			quat_t filterRotation(const vr::HmdQuaternion_t& RawData)
+			{
+				// 1st stage
+				_Filter_rotPosition[0] = lowPassFilterQuaternion(vrmath::toQuat<T>(RawData), _Filter_rotPosition[0]);
+
+				// 2nd stage
+				_Filter_rotPosition[1] = lowPassFilterQuaternion(_Filter_rotPosition[0], _Filter_rotPosition[1]);
+
+				return _Filter_rotPosition[1];
+			}
+
+			// Bypasses the rotation filter
+			quat_t setRotation(const vr::HmdQuaternion_t& RawData)
+			{
+				_Filter_rotPosition[1] = vrmath::toQuat<T>(RawData);
+
+				return _Filter_rotPosition[1];
+			}
+
+			// Low Pass Filter for quaternion
+			quat_t lowPassFilterQuaternion(quat_t RawData, quat_t SmoothData)
+			{
+				return slerp(SmoothData, RawData, _LpfBeta);
+			}
+
+			// Spherical Linear Interpolation for Quaternions
+			static quat_t slerp(quat_t q1, quat_t q2, T lambda)
+			{
+				quat_t qr;
+
+				T dotproduct = q1.x * q2.x + q1.y * q2.y + q1.z * q2.z + q1.w * q2.w;
+
+				// if q1 and q2 are the same, we can return either of the values
+				if (dotproduct >= (T)1.0 || dotproduct <= (T)-1.0)
+				{
+					return q1;
+				}
+
+				T theta, st, sut, sout, coeff1, coeff2;
+
+				// algorithm adapted from Shoemake's paper
+				lambda = lambda / (T)2.0;
+
+				theta = std::acos(dotproduct);
+				if (theta < (T)0.0) theta = -theta;
+
+				st = std::sin(theta);
+				sut = std::sin(lambda * theta);
+				sout = std::sin((1 - lambda) * theta);
+				coeff1 = sout / st;
+				coeff2 = sut / st;
+
+				qr.x = coeff1 * q1.x + coeff2 * q2.x;
+				qr.y = coeff1 * q1.y + coeff2 * q2.y;
+				qr.z = coeff1 * q1.z + coeff2 * q2.z;
+				qr.w = coeff1 * q1.w + coeff2 * q2.w;
+
+				//Normalize
+				T norm = std::sqrt(qr.x * qr.x + qr.y * qr.y + qr.z * qr.z + qr.w * qr.w);
+				qr.x /= norm;
+				qr.y /= norm;
+				qr.z /= norm;
+
+				return qr;
+			}
+
+			// Convert Quaternion to Euler Angles in Radians
+			static vec3_t toEulerAngles(quat_t q)
+			{
+				vec3_t angles;
+
+				// roll (x-axis rotation)
+				T sinr_cosp = 2 * (q.w * q.x + q.y * q.z);
+				T cosr_cosp = 1 - 2 * (q.x * q.x + q.y * q.y);
+				angles.v[0] = std::atan2(sinr_cosp, cosr_cosp);
+
+				// pitch (y-axis rotation)
+				T sinp = 2 * (q.w * q.y - q.z * q.x);
+
+				if (std::abs(sinp) >= 1)
+				{
+					angles.v[1] = std::copysign(boost::math::constants::pi<T>() / 2, sinp); // use 90 degrees if out of range
+				}
+				else
+				{
+					angles.v[1] = std::asin(sinp);
+				}
+
+				// yaw (z-axis rotation)
+				T siny_cosp = 2 * (q.w * q.z + q.x * q.y);
+				T cosy_cosp = 1 - 2 * (q.y * q.y + q.z * q.z);
+				angles.v[2] = std::atan2(siny_cosp, cosy_cosp);
+
+				return angles;
+			}
+
+		private:
+			T _Alpha = (T)-1.0;
+			T _LpfBeta = (T)0.2;
+
+			vec3_t _Filter_vecPosition[2] = { 0, 0, 0 };
+			quat_t _Filter_rotPosition[2] = { 1, 0, 0, 0 };
+		};
+	}
+}
@@ -0,0 +1,158 @@
+#include "MotionGenerator.h"
+
+#include <openvr_math.h>
+
+#include <cmath>
+#include <cstring>
+#include <boost/math/constants/constants.hpp>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		MotionGenerator::MotionGenerator(const MotionGeneratorSettings& Settings) : _settings(Settings), _random(Settings.Seed), _normal(0.0, 1.0), _uniform(0.0, 1.0)
+		{
+		}
+
+		GeneratedMotion MotionGenerator::Generate()
+		{
+			GeneratedMotion Result;
+
+			vr::HmdVector3d_t RigRestPosition;
+			vr::HmdQuaternion_t RigRestRotation;
+			_rigPose(0.0, RigRestPosition, RigRestRotation);
+
+			uint64_t HmdIndex = 0;
+			uint64_t TrackerIndex = 0;
+
+			// Merge both streams by time, the random walk has to be integrated in order
+			for (;;)
+			{
+				double HmdTime = (double)HmdIndex / _settings.HmdRate;
+				double TrackerTime = (double)TrackerIndex / _settings.TrackerRate;
+				bool IsHmd = HmdTime <= TrackerTime;
+				double Time = IsHmd ? HmdTime : TrackerTime;
+
+				if (Time > _settings.Duration)
+				{
+					break;
+				}
+
+				vr::HmdVector3d_t RigPosition;
+				vr::HmdQuaternion_t RigRotation;
+				_rigPose(Time, RigPosition, RigRotation);
+
+				const vr::HmdVector3d_t& Offset = IsHmd ? _settings.HmdOffset : _settings.TrackerOffset;
+				vr::HmdVector3d_t Position = RigPosition + vrmath::quaternionRotateVector(RigRotation, Offset);
+
+				if (IsHmd)
+				{
+					Result.Input.push_back(_makeRecord(Time, _settings.HmdId, MotionCompensationDeviceMode::MotionCompensated, Position, RigRotation));
+
+					vr::HmdVector3d_t IdealPosition = RigRestPosition + vrmath::quaternionRotateVector(RigRestRotation, Offset);
+					PoseRecord Ideal = _makeRecord(Time, _settings.HmdId, MotionCompensationDeviceMode::MotionCompensated, IdealPosition, RigRestRotation);
+					Ideal.Type = PoseRecordType::Compensated;
+					Result.GroundTruth.push_back(Ideal);
+
+					HmdIndex++;
+				}
+				else
+				{
+					Result.Input.push_back(_makeRecord(Time, _settings.TrackerId, MotionCompensationDeviceMode::ReferenceTracker, Position, RigRotation));
+
+					TrackerIndex++;
+				}
+
+				_applyNoise(Result.Input.back().Pose);
+			}
+
+			return Result;
+		}
+
+		void MotionGenerator::_rigPose(double Time, vr::HmdVector3d_t& Position, vr::HmdQuaternion_t& Rotation)
+		{
+			const double TwoPi = boost::math::constants::two_pi<double>();
+
+			double Roll = 0.0;
+			double Pitch = 0.0;
+			double Heave = 0.0;
+
+			// Bed tilt
+			if (_settings.TiltAngle != 0.0)
+			{
+				Pitch += _settings.TiltDuration > 0.0 ? _settings.TiltAngle * std::fmin(Time / _settings.TiltDuration, 1.0) : _settings.TiltAngle;
+			}
+
+			// Sway
+			double Phase = std::sin(TwoPi * _settings.SwayFrequency * Time);
+			Roll += _settings.SwayRoll * Phase;
+			Pitch += _settings.SwayPitch * Phase;
+			Heave += _settings.SwayHeave * Phase;
+
+			// Step
+			if (_settings.StepTime >= 0.0 && Time >= _settings.StepTime)
+			{
+				Pitch += _settings.StepPitch;
+				Heave += _settings.StepHeave;
+			}
+
+			// Random walk
+			if (_settings.RandomWalk > 0.0 && Time > _randomWalkTime)
+			{
+				double Sigma = _settings.RandomWalk * std::sqrt(Time - _randomWalkTime);
+				_randomWalk.v[0] += Sigma * _normal(_random);
+				_randomWalk.v[1] += Sigma * _normal(_random);
+				_randomWalk.v[2] += Sigma * _normal(_random);
+				_randomWalkTime = Time;
+			}
+
+			Position = { _randomWalk.v[0], _randomWalk.v[1] + Heave, _randomWalk.v[2] };
+			Rotation = vrmath::quaternionFromYawPitchRoll(0.0, Pitch, Roll);
+		}
+
+		PoseRecord MotionGenerator::_makeRecord(double Time, uint32_t OpenVRId, MotionCompensationDeviceMode DeviceMode, const vr::HmdVector3d_t& Position, const vr::HmdQuaternion_t& Rotation)
+		{
+			PoseRecord Entry;
+			memset(&Entry, 0, sizeof(PoseRecord));
+
+			Entry.Timestamp = (uint64_t)std::llround(Time * 1.0E9);
+			Entry.OpenVRId = OpenVRId;
+			Entry.Type = PoseRecordType::Raw;
+			Entry.DeviceMode = DeviceMode;
+
+			vr::DriverPose_t& Pose = Entry.Pose;
+			Pose.qWorldFromDriverRotation = { 1, 0, 0, 0 };
+			Pose.qDriverFromHeadRotation = { 1, 0, 0, 0 };
+			Pose.vecPosition[0] = Position.v[0];
+			Pose.vecPosition[1] = Position.v[1];
+			Pose.vecPosition[2] = Position.v[2];
+			Pose.qRotation = Rotation;
+			Pose.result = vr::TrackingResult_Running_OK;
+			Pose.poseIsValid = true;
+			Pose.deviceIsConnected = true;
+
+			return Entry;
+		}
+
+		void MotionGenerator::_applyNoise(vr::DriverPose_t& Pose)
+		{
+			if (_settings.PositionNoise > 0.0)
+			{
+				Pose.vecPosition[0] += _settings.PositionNoise * _normal(_random);
+				Pose.vecPosition[1] += _settings.PositionNoise * _normal(_random);
+				Pose.vecPosition[2] += _settings.PositionNoise * _normal(_random);
+			}
+
+			if (_settings.RotationNoise > 0.0)
+			{
+				Pose.qRotation = Pose.qRotation * vrmath::quaternionFromYawPitchRoll(_settings.RotationNoise * _normal(_random), _settings.RotationNoise * _normal(_random), _settings.RotationNoise * _normal(_random));
+			}
+
+			if (_settings.DropoutProbability > 0.0 && _uniform(_random) < _settings.DropoutProbability)
+			{
+				Pose.poseIsValid = false;
+				Pose.result = vr::TrackingResult_Running_OutOfRange;
+			}
+		}
+	}
+}
\ No newline at end of file
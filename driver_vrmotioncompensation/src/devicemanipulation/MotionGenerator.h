@@ -0,0 +1,83 @@
+#pragma once
+
+#include "PoseRecorder.h"
+
+#include <random>
+#include <vector>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// Describes the rig motion and the tracking imperfections. Angles are in radians, distances in meters.
+		struct MotionGeneratorSettings
+		{
+			double Duration = 10.0;				// Seconds
+			double HmdRate = 1100.0;			// Poses per second
+			double TrackerRate = 370.0;
+
+			uint32_t HmdId = 0;
+			uint32_t TrackerId = 1;
+
+			// Mounting points relative to the rig pivot
+			vr::HmdVector3d_t HmdOffset = { 0.0, 1.1, 0.0 };
+			vr::HmdVector3d_t TrackerOffset = { 0.0, 0.5, -0.3 };
+
+			// Slow bed tilt, pitch ramps from 0 to TiltAngle within TiltDuration
+			double TiltAngle = 0.0;
+			double TiltDuration = 5.0;
+
+			// Sinusoidal sway
+			double SwayRoll = 0.0;
+			double SwayPitch = 0.0;
+			double SwayHeave = 0.0;
+			double SwayFrequency = 1.0;			// Hz
+
+			// Step impulse at StepTime, disabled if negative
+			double StepTime = -1.0;
+			double StepPitch = 0.0;
+			double StepHeave = 0.0;
+
+			// Random walk of the rig position, standard deviation per sqrt(second)
+			double RandomWalk = 0.0;
+
+			// Measurement noise and dropouts, applied to every generated pose
+			double PositionNoise = 0.0;
+			double RotationNoise = 0.0;
+			double DropoutProbability = 0.0;
+
+			uint32_t Seed = 1;
+		};
+
+		struct GeneratedMotion
+		{
+			std::vector<PoseRecord> Input;			// HMD and tracker poses in time order, as they would be recorded
+			std::vector<PoseRecord> GroundTruth;	// Ideal compensated pose for every HMD pose in Input
+		};
+
+		// Generates reproducible pose streams of a seated user on a moving rig.
+		// The HMD sits on the rig without moving relative to it, so the ideal compensated HMD pose is its pose with the rig at rest.
+		class MotionGenerator
+		{
+		public:
+			MotionGenerator(const MotionGeneratorSettings& Settings);
+
+			GeneratedMotion Generate();
+
+		private:
+			void _rigPose(double Time, vr::HmdVector3d_t& Position, vr::HmdQuaternion_t& Rotation);
+
+			PoseRecord _makeRecord(double Time, uint32_t OpenVRId, MotionCompensationDeviceMode DeviceMode, const vr::HmdVector3d_t& Position, const vr::HmdQuaternion_t& Rotation);
+
+			void _applyNoise(vr::DriverPose_t& Pose);
+
+			MotionGeneratorSettings _settings;
+			std::mt19937 _random;
+			std::normal_distribution<double> _normal;
+			std::uniform_real_distribution<double> _uniform;
+
+			vr::HmdVector3d_t _randomWalk = { 0, 0, 0 };
+			double _randomWalkTime = 0.0;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "NoiseEstimator.h"
+
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		void NoiseEstimator::Update(const vr::DriverPose_t& Pose, double Time)
+		{
+			std::lock_guard<Spinlock> lock(_lock);
+
+			// Position relative to the first pose of the period, rotation as a small rotation vector in device space
+			double Values[6];
+			for (int j = 0; j < 2; j++)
+			{
+				double Distance = 0.0;
+				for (int i = 0; i < 3; i++)
+				{
+					Values[i] = Pose.vecPosition[i] - _anchorPosition[i];
+					Distance += Values[i] * Values[i];
+				}
+
+				const vr::HmdQuaternion_t& a = _anchorRotationInv;
+				const vr::HmdQuaternion_t& b = Pose.qRotation;
+				double w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+				double Sign = w < 0.0 ? -2.0 : 2.0;
+				Values[3] = Sign * (a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y);
+				Values[4] = Sign * (a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x);
+				Values[5] = Sign * (a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w);
+				double Angle = std::sqrt(Values[3] * Values[3] + Values[4] * Values[4] + Values[5] * Values[5]);
+
+				if (_running && Time - _lastTime <= _settings.MaxGap && Distance <= _settings.StationaryRadius * _settings.StationaryRadius && Angle <= _settings.StationaryAngle)
+				{
+					break;
+				}
+
+				// The device moved or tracking paused, this pose starts the next period
+				if (_running)
+				{
+					_finishRun();
+				}
+				_startRun(Pose, Time);
+			}
+
+			_run.Count++;
+			for (int i = 0; i < 6; i++)
+			{
+				double Delta = Values[i] - _run.Mean[i];
+				_run.Mean[i] += Delta / (double)_run.Count;
+				_run.M2[i] += Delta * (Values[i] - _run.Mean[i]);
+			}
+
+			_addAllan(Values);
+			_lastTime = Time;
+		}
+
+		void NoiseEstimator::Reset()
+		{
+			std::lock_guard<Spinlock> lock(_lock);
+
+			_totals = Totals();
+			_running = false;
+		}
+
+		void NoiseEstimator::GetStatistics(NoiseStatistics_OVRMC_v1& Statistics)
+		{
+			Totals Current;
+			{
+				std::lock_guard<Spinlock> lock(_lock);
+
+				Current = _totals;
+				if (_running && _run.Count >= _settings.MinPoses)
+				{
+					_addTotals(Current, _run, _runAllan, _lastTime - _runStart);
+				}
+			}
+
+			memset(&Statistics, 0, sizeof(NoiseStatistics_OVRMC_v1));
+			Statistics.Samples = Current.Samples;
+			Statistics.Runs = Current.Runs;
+			Statistics.Seconds = Current.Seconds;
+
+			// Every period loses one degree of freedom to its mean and has one interval less than poses
+			if (Current.Samples <= Current.Runs)
+			{
+				return;
+			}
+			double Intervals = (double)(Current.Samples - Current.Runs);
+
+			Statistics.MeanInterval = Current.Seconds / Intervals;
+			for (int i = 0; i < 3; i++)
+			{
+				Statistics.PositionStdDev[i] = std::sqrt(Current.M2[i] / Intervals);
+				Statistics.RotationStdDev[i] = std::sqrt(Current.M2[i + 3] / Intervals);
+			}
+
+			for (uint32_t k = 0; k < NOISE_ALLAN_LEVELS; k++)
+			{
+				Statistics.AllanTau[k] = (double)(1ull << k) * Statistics.MeanInterval;
+				Statistics.AllanPairs[k] = Current.Allan.Pairs[k];
+				if (Current.Allan.Pairs[k] > 0)
+				{
+					Statistics.PositionAllanDeviation[k] = std::sqrt(0.5 * Current.Allan.Position[k] / (double)Current.Allan.Pairs[k]);
+					Statistics.RotationAllanDeviation[k] = std::sqrt(0.5 * Current.Allan.Rotation[k] / (double)Current.Allan.Pairs[k]);
+				}
+			}
+		}
+
+		void NoiseEstimator::_startRun(const vr::DriverPose_t& Pose, double Time)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				_anchorPosition[i] = Pose.vecPosition[i];
+			}
+			_anchorRotationInv = { Pose.qRotation.w, -Pose.qRotation.x, -Pose.qRotation.y, -Pose.qRotation.z };
+
+			_run = Welford();
+			_runAllan = AllanSums();
+			for (auto& Level : _levels)
+			{
+				Level.HasHalf = false;
+				Level.HasPrevious = false;
+			}
+
+			_runStart = Time;
+			_lastTime = Time;
+			_running = true;
+		}
+
+		void NoiseEstimator::_finishRun()
+		{
+			if (_run.Count >= _settings.MinPoses)
+			{
+				_addTotals(_totals, _run, _runAllan, _lastTime - _runStart);
+			}
+			_running = false;
+		}
+
+		void NoiseEstimator::_addAllan(double (&Values)[6])
+		{
+			double Average[6];
+			memcpy(Average, Values, sizeof(Average));
+
+			for (uint32_t k = 0; k < NOISE_ALLAN_LEVELS; k++)
+			{
+				AllanLevel& Level = _levels[k];
+				if (Level.HasPrevious)
+				{
+					double Position = 0.0;
+					double Rotation = 0.0;
+					for (int i = 0; i < 3; i++)
+					{
+						double Delta = Average[i] - Level.Previous[i];
+						Position += Delta * Delta;
+						Delta = Average[i + 3] - Level.Previous[i + 3];
+						Rotation += Delta * Delta;
+					}
+					_runAllan.Position[k] += Position;
+					_runAllan.Rotation[k] += Rotation;
+					_runAllan.Pairs[k]++;
+				}
+				memcpy(Level.Previous, Average, sizeof(Average));
+				Level.HasPrevious = true;
+
+				// Every second average of this level completes one average of the next level
+				if (!Level.HasHalf)
+				{
+					memcpy(Level.Half, Average, sizeof(Average));
+					Level.HasHalf = true;
+					return;
+				}
+
+				for (int i = 0; i < 6; i++)
+				{
+					Average[i] = 0.5 * (Level.Half[i] + Average[i]);
+				}
+				Level.HasHalf = false;
+			}
+		}
+
+		void NoiseEstimator::_addTotals(Totals& Target, const Welford& Run, const AllanSums& Allan, double Seconds)
+		{
+			Target.Samples += Run.Count;
+			Target.Runs++;
+			Target.Seconds += Seconds;
+			for (int i = 0; i < 6; i++)
+			{
+				Target.M2[i] += Run.M2[i];
+			}
+
+			for (uint32_t k = 0; k < NOISE_ALLAN_LEVELS; k++)
+			{
+				Target.Allan.Position[k] += Allan.Position[k];
+				Target.Allan.Rotation[k] += Allan.Rotation[k];
+				Target.Allan.Pairs[k] += Allan.Pairs[k];
+			}
+		}
+	}
+}
\ No newline at end of file
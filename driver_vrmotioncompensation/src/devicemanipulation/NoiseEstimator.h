@@ -0,0 +1,97 @@
+#pragma once
+
+#include <openvr_driver.h>
+#include <vrmotioncompensation_types.h>
+#include "Spinlock.h"
+
+#include <cstdint>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		struct NoiseSettings
+		{
+			double StationaryRadius = 0.005;		// m a pose may be away from the first pose of a stationary period
+			double StationaryAngle = 0.01;			// rad a pose may be rotated against the first pose of a stationary period
+			double MaxGap = 0.1;					// Seconds without a pose that end a stationary period
+			uint32_t MinPoses = 50;					// Shorter stationary periods are discarded, they are most likely a slow movement
+		};
+
+		// Estimates the tracking noise of one device while it lies still, in constant time per pose.
+		// Every stationary period gets its own Welford mean and variance, the periods are pooled so that moving the device in between does not count as noise.
+		// Allan variance is computed for averaging times of 2^k poses with non overlapping averages. Each level pairs two averages of the level below,
+		// so level k is only touched every 2^k poses and a pose costs two level updates on average.
+		class NoiseEstimator
+		{
+		public:
+			NoiseEstimator(const NoiseSettings& Settings = NoiseSettings()) : _settings(Settings)
+			{
+			}
+
+			// Time in seconds, Pose in driver space. Only valid poses should be passed.
+			void Update(const vr::DriverPose_t& Pose, double Time);
+
+			void Reset();
+
+			// Current estimates, including the running stationary period once it is long enough
+			void GetStatistics(NoiseStatistics_OVRMC_v1& Statistics);
+
+		private:
+			struct Welford
+			{
+				uint64_t Count = 0;
+				double Mean[6] = { 0, 0, 0, 0, 0, 0 };
+				double M2[6] = { 0, 0, 0, 0, 0, 0 };
+			};
+
+			struct AllanLevel
+			{
+				double Half[6];						// First average of the pair that forms the next level
+				bool HasHalf = false;
+				double Previous[6];					// Last average, its difference to the next one is accumulated
+				bool HasPrevious = false;
+			};
+
+			struct AllanSums
+			{
+				double Position[NOISE_ALLAN_LEVELS];
+				double Rotation[NOISE_ALLAN_LEVELS];
+				uint64_t Pairs[NOISE_ALLAN_LEVELS];
+			};
+
+			// Everything collected over finished or running stationary periods
+			struct Totals
+			{
+				uint64_t Samples = 0;
+				uint32_t Runs = 0;
+				double Seconds = 0.0;
+				double M2[6] = { 0, 0, 0, 0, 0, 0 };
+				AllanSums Allan = {};
+			};
+
+			void _startRun(const vr::DriverPose_t& Pose, double Time);
+
+			void _finishRun();
+
+			void _addAllan(double (&Values)[6]);
+
+			static void _addTotals(Totals& Target, const Welford& Run, const AllanSums& Allan, double Seconds);
+
+			NoiseSettings _settings;
+			Spinlock _lock;
+
+			Totals _totals;
+
+			// Running stationary period
+			bool _running = false;
+			double _anchorPosition[3] = { 0, 0, 0 };
+			vr::HmdQuaternion_t _anchorRotationInv = { 1, 0, 0, 0 };
+			double _runStart = 0.0;
+			double _lastTime = 0.0;
+			Welford _run;
+			AllanLevel _levels[NOISE_ALLAN_LEVELS];
+			AllanSums _runAllan = {};
+		};
+	}
+}
\ No newline at end of file
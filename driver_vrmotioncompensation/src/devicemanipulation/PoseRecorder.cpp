@@ -0,0 +1,236 @@
+#include "PoseRecorder.h"
+#include "../logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		void writePoseRecordFileHeader(std::ostream& File)
+		{
+			PoseRecordFileHeader Header;
+			memset(&Header, 0, sizeof(Header));
+			memcpy(Header.Magic, "OVRMCPR", sizeof(Header.Magic));
+			Header.Version = POSE_RECORDER_FILE_VERSION;
+			Header.RecordSize = sizeof(PoseRecord);
+			File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+		}
+
+		bool readPoseRecordFileHeader(std::istream& File)
+		{
+			PoseRecordFileHeader Header;
+			File.read(reinterpret_cast<char*>(&Header), sizeof(Header));
+
+			if (!File || strncmp(Header.Magic, "OVRMCPR", sizeof(Header.Magic)) != 0)
+			{
+				LOG(ERROR) << "Not a pose recording";
+				return false;
+			}
+
+			if (Header.Version != POSE_RECORDER_FILE_VERSION || Header.RecordSize != sizeof(PoseRecord))
+			{
+				LOG(ERROR) << "Unsupported pose recording version " << Header.Version << " (record size " << Header.RecordSize << ")";
+				return false;
+			}
+
+			return true;
+		}
+
+		static std::atomic<uint64_t> PoseRecorderInstances = { 0 };
+
+		PoseRecorder::PoseRecorder() : _instance(++PoseRecorderInstances)
+		{
+
+		}
+
+		PoseRecorder::~PoseRecorder()
+		{
+			Stop();
+		}
+
+		bool PoseRecorder::Start(const std::string& FileName)
+		{
+			if (_writerThread.joinable())
+			{
+				LOG(ERROR) << "Pose recorder is already running";
+				return false;
+			}
+
+			std::ofstream File(FileName, std::ios::binary | std::ios::trunc);
+			if (!File.is_open())
+			{
+				LOG(ERROR) << "Could not open pose recording file " << FileName;
+				return false;
+			}
+
+			writePoseRecordFileHeader(File);
+			File.close();
+
+			{
+				// Discard whatever is left over from a previous recording
+				std::lock_guard<std::mutex> lock(_buffersMutex);
+				for (auto& Buffer : _buffers)
+				{
+					Buffer->Tail.store(Buffer->Head.load(std::memory_order_acquire), std::memory_order_release);
+				}
+			}
+
+			_droppedRecords = 0;
+			_startTime = std::chrono::steady_clock::now();
+			_writerStopFlag = false;
+			_writerThread = std::thread(_writerThreadFunc, this, FileName);
+			_running = true;
+
+			LOG(INFO) << "Pose recorder started, writing to " << FileName;
+
+			return true;
+		}
+
+		void PoseRecorder::Stop()
+		{
+			_running = false;
+
+			if (_writerThread.joinable())
+			{
+				{
+					// A hook thread that saw _running set is still writing its record, wait for it so the final drain gets it
+					std::lock_guard<std::mutex> lock(_buffersMutex);
+					for (auto& Buffer : _buffers)
+					{
+						while (Buffer->Writing.load(std::memory_order_acquire))
+						{
+							std::this_thread::yield();
+						}
+					}
+				}
+
+				_writerStopFlag = true;
+				_writerThread.join();
+
+				LOG(INFO) << "Pose recorder stopped, " << _droppedRecords << " records dropped";
+			}
+		}
+
+		void PoseRecorder::Record(PoseRecordType Type, uint32_t OpenVRId, int HookVersion, MotionCompensationDeviceMode DeviceMode, const vr::DriverPose_t& Pose)
+		{
+			if (!IsRunning())
+			{
+				return;
+			}
+
+			ThreadBuffer* Buffer = _getThreadBuffer();
+
+			// Pairs with Stop(): either it sees this flag and waits, or this thread sees that the recorder stopped
+			Buffer->Writing.store(true, std::memory_order_seq_cst);
+			if (!_running.load(std::memory_order_seq_cst))
+			{
+				Buffer->Writing.store(false, std::memory_order_release);
+				return;
+			}
+
+			uint64_t Head = Buffer->Head.load(std::memory_order_relaxed);
+
+			if (Head - Buffer->Tail.load(std::memory_order_acquire) >= POSE_RECORDER_BUFFER_SIZE)
+			{
+				_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+				Buffer->Writing.store(false, std::memory_order_release);
+				return;
+			}
+
+			PoseRecord& Entry = Buffer->Records[Head & (POSE_RECORDER_BUFFER_SIZE - 1)];
+			Entry.Timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _startTime).count();
+			Entry.OpenVRId = OpenVRId;
+			Entry.HookVersion = HookVersion;
+			Entry.Type = Type;
+			Entry.DeviceMode = DeviceMode;
+			Entry.Pose = Pose;
+
+			Buffer->Head.store(Head + 1, std::memory_order_release);
+			Buffer->Writing.store(false, std::memory_order_release);
+		}
+
+		PoseRecorder::ThreadBuffer* PoseRecorder::_getThreadBuffer()
+		{
+			// Buffers live as long as the recorder, so the cached pointers stay valid between recordings.
+			// The cache is keyed by the instance number, a thread may record for several recorders.
+			thread_local std::vector<std::pair<uint64_t, ThreadBuffer*>> Cache;
+
+			for (auto& Entry : Cache)
+			{
+				if (Entry.first == _instance)
+				{
+					return Entry.second;
+				}
+			}
+
+			ThreadBuffer* Buffer;
+			{
+				std::lock_guard<std::mutex> lock(_buffersMutex);
+				_buffers.push_back(std::make_unique<ThreadBuffer>());
+				Buffer = _buffers.back().get();
+			}
+			Cache.push_back({ _instance, Buffer });
+
+			return Buffer;
+		}
+
+		uint64_t PoseRecorder::_drainBuffers(std::ofstream& File)
+		{
+			uint64_t Written = 0;
+
+			{
+				// Buffers are only ever added, pick up the new ones and write without holding the lock
+				std::lock_guard<std::mutex> lock(_buffersMutex);
+				for (size_t i = _drainBuffersList.size(); i < _buffers.size(); i++)
+				{
+					_drainBuffersList.push_back(_buffers[i].get());
+				}
+			}
+
+			for (ThreadBuffer* Buffer : _drainBuffersList)
+			{
+				uint64_t Tail = Buffer->Tail.load(std::memory_order_relaxed);
+				uint64_t Head = Buffer->Head.load(std::memory_order_acquire);
+
+				while (Tail != Head)
+				{
+					// Write the contiguous part up to the end of the ring in one go
+					uint64_t Index = Tail & (POSE_RECORDER_BUFFER_SIZE - 1);
+					uint64_t Count = std::min<uint64_t>(Head - Tail, POSE_RECORDER_BUFFER_SIZE - Index);
+
+					File.write(reinterpret_cast<const char*>(&Buffer->Records[Index]), Count * sizeof(PoseRecord));
+
+					Tail += Count;
+					Written += Count;
+				}
+
+				Buffer->Tail.store(Tail, std::memory_order_release);
+			}
+
+			return Written;
+		}
+
+		void PoseRecorder::_writerThreadFunc(PoseRecorder* _this, std::string FileName)
+		{
+			LOG(DEBUG) << "PoseRecorder::_writerThreadFunc: thread started";
+
+			std::ofstream File(FileName, std::ios::binary | std::ios::app);
+			uint64_t Written = 0;
+
+			while (!_this->_writerStopFlag)
+			{
+				Written += _this->_drainBuffers(File);
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+
+			// Stop() waited for the hook threads, nothing is added after this drain
+			Written += _this->_drainBuffers(File);
+			File.close();
+
+			LOG(DEBUG) << "PoseRecorder::_writerThreadFunc: thread stopped, " << Written << " records written";
+		}
+	}
+}
\ No newline at end of file
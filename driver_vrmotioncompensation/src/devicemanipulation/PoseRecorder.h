@@ -0,0 +1,108 @@
+#pragma once
+
+#include <openvr_driver.h>
+#include <vrmotioncompensation_types.h>
+
+#include <atomic>
+#include <iosfwd>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records per hook thread, must be a power of two
+#define POSE_RECORDER_BUFFER_SIZE 8192
+#define POSE_RECORDER_FILE_VERSION 1
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		enum class PoseRecordType : uint32_t
+		{
+			Raw = 0,			// Pose as received from the device driver
+			Compensated = 1,	// Pose after it went through the DeviceManipulationHandle
+			Reference = 2,		// Filtered reference tracker state in app space (position, rotation and velocities), written by the FlightRecorder
+		};
+
+		// One entry of the binary pose stream
+		struct PoseRecord
+		{
+			uint64_t Timestamp;		// Monotonic time in nanoseconds since the recording was started
+			uint32_t OpenVRId;
+			int32_t HookVersion;	// Version of the IVRServerDriverHost interface that delivered the pose
+			PoseRecordType Type;
+			MotionCompensationDeviceMode DeviceMode;
+			vr::DriverPose_t Pose;
+		};
+
+		// Written once at the start of the file, followed by PoseRecord entries until the end of the file
+		struct PoseRecordFileHeader
+		{
+			char Magic[8];			// "OVRMCPR"
+			uint32_t Version;		// POSE_RECORDER_FILE_VERSION
+			uint32_t RecordSize;	// sizeof(PoseRecord)
+		};
+
+		// Header helpers shared by the recorder and the replay
+		void writePoseRecordFileHeader(std::ostream& File);
+
+		bool readPoseRecordFileHeader(std::istream& File);
+
+		// Captures the poses of all hooked devices into a binary file.
+		// Every hook thread gets its own single producer / single consumer ring buffer, so recording a pose never takes a lock.
+		// A background thread drains the buffers and writes them to disk. If it falls behind, new records are dropped and counted.
+		// Stop() waits for the hook threads that are still writing a record, so the final drain sees every record.
+		class PoseRecorder
+		{
+		public:
+			PoseRecorder();
+			~PoseRecorder();
+
+			bool Start(const std::string& FileName);
+
+			void Stop();
+
+			bool IsRunning() const
+			{
+				return _running.load(std::memory_order_relaxed);
+			}
+
+			void Record(PoseRecordType Type, uint32_t OpenVRId, int HookVersion, MotionCompensationDeviceMode DeviceMode, const vr::DriverPose_t& Pose);
+
+		private:
+			struct ThreadBuffer
+			{
+				std::atomic<uint64_t> Head = { 0 };	// Written by the hook thread
+				std::atomic<uint64_t> Tail = { 0 };	// Written by the writer thread
+				std::atomic<bool> Writing = { false };	// Set by the hook thread while it is inside Record()
+				PoseRecord Records[POSE_RECORDER_BUFFER_SIZE];
+			};
+
+			ThreadBuffer* _getThreadBuffer();
+
+			static void _writerThreadFunc(PoseRecorder* _this, std::string FileName);
+
+			uint64_t _drainBuffers(std::ofstream& File);
+
+			// Never reused, so a thread cannot mistake a new recorder at the address of a destroyed one for the recorder it cached
+			const uint64_t _instance;
+
+			std::atomic<bool> _running = { false };
+			std::atomic<bool> _writerStopFlag = { false };
+			std::atomic<uint64_t> _droppedRecords = { 0 };
+			std::chrono::steady_clock::time_point _startTime;
+
+			std::thread _writerThread;
+
+			// Only locked when a thread records its first pose, by Start() and Stop(), and by the writer thread to pick up new buffers
+			std::mutex _buffersMutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> _buffers;
+
+			// Writer thread only, the buffers it drains without holding _buffersMutex
+			std::vector<ThreadBuffer*> _drainBuffersList;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "PoseReplay.h"
+#include "MotionCompensationManager.h"
+#include "../logging.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		bool PoseReplay::Load(const std::string& FileName)
+		{
+			std::ifstream File(FileName, std::ios::binary);
+			if (!File.is_open())
+			{
+				LOG(ERROR) << "Could not open pose recording " << FileName;
+				return false;
+			}
+
+			if (!readPoseRecordFileHeader(File))
+			{
+				return false;
+			}
+
+			_records.clear();
+
+			PoseRecord Entry;
+			while (File.read(reinterpret_cast<char*>(&Entry), sizeof(PoseRecord)))
+			{
+				if (Entry.Type == PoseRecordType::Raw)
+				{
+					_records.push_back(Entry);
+				}
+			}
+
+			// Every hook thread has its own buffer, so the file is only ordered per thread
+			std::stable_sort(_records.begin(), _records.end(), [](const PoseRecord& a, const PoseRecord& b)
+			{
+				return a.Timestamp < b.Timestamp;
+			});
+
+			LOG(INFO) << "Loaded " << _records.size() << " poses from " << FileName;
+
+			return true;
+		}
+
+		PoseReplay::Statistics PoseReplay::Run(MotionCompensationManager& Manager, bool RealTime, std::vector<PoseRecord>* Output)
+		{
+			Statistics Stats;
+			int McDeviceID = -1;
+			int RtDeviceID = -1;
+
+			// The manager has to be in reference tracker mode before the first pose arrives
+			for (auto& Entry : _records)
+			{
+				if (Entry.DeviceMode == MotionCompensationDeviceMode::MotionCompensated && McDeviceID < 0)
+				{
+					McDeviceID = Entry.OpenVRId;
+				}
+				else if (Entry.DeviceMode == MotionCompensationDeviceMode::ReferenceTracker && RtDeviceID < 0)
+				{
+					RtDeviceID = Entry.OpenVRId;
+				}
+			}
+
+			if (RtDeviceID >= 0)
+			{
+				Manager.setMotionCompensationMode(MotionCompensationMode::ReferenceTracker, McDeviceID, RtDeviceID);
+			}
+
+			std::vector<double> Times;
+			Times.reserve(_records.size());
+
+			auto Start = std::chrono::steady_clock::now();
+			uint64_t FirstTimestamp = _records.empty() ? 0 : _records.front().Timestamp;
+
+			for (auto& Entry : _records)
+			{
+				if (RealTime)
+				{
+					std::this_thread::sleep_until(Start + std::chrono::nanoseconds(Entry.Timestamp - FirstTimestamp));
+				}
+
+				vr::DriverPose_t Pose = Entry.Pose;
+
+				auto CallStart = std::chrono::steady_clock::now();
+				_handlePose(Manager, Entry, Pose);
+				double CallMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - CallStart).count();
+
+				Times.push_back(CallMicroseconds);
+				Stats.Poses++;
+				Stats.MeanMicroseconds += CallMicroseconds;
+				if (CallMicroseconds > Stats.MaxMicroseconds)
+				{
+					Stats.MaxMicroseconds = CallMicroseconds;
+				}
+
+				if (Output)
+				{
+					PoseRecord Result = Entry;
+					Result.Type = PoseRecordType::Compensated;
+					Result.Pose = Pose;
+					Output->push_back(Result);
+				}
+			}
+
+			Stats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+			if (Stats.Poses > 0)
+			{
+				Stats.MeanMicroseconds /= (double)Stats.Poses;
+
+				auto P99 = Times.begin() + (Times.size() - 1) * 99 / 100;
+				std::nth_element(Times.begin(), P99, Times.end());
+				Stats.P99Microseconds = *P99;
+			}
+
+			LOG(INFO) << "Replayed " << Stats.Poses << " poses in " << Stats.Seconds << " s, " << Stats.MeanMicroseconds << " us mean, " << Stats.P99Microseconds << " us p99, " << Stats.MaxMicroseconds << " us max per pose";
+
+			return Stats;
+		}
+
+		// Same routing as the pose hook, but with the recorded time instead of the clock
+		void PoseReplay::_handlePose(MotionCompensationManager& Manager, const PoseRecord& Entry, vr::DriverPose_t& Pose)
+		{
+			// Recorded timestamps are nanoseconds, the manager takes microseconds
+			Manager.handlePose(Entry.DeviceMode, Pose, (long long)(Entry.Timestamp / 1000));
+		}
+
+		bool PoseReplay::Save(const std::string& FileName, const std::vector<PoseRecord>& Records)
+		{
+			std::ofstream File(FileName, std::ios::binary | std::ios::trunc);
+			if (!File.is_open())
+			{
+				LOG(ERROR) << "Could not open " << FileName;
+				return false;
+			}
+
+			writePoseRecordFileHeader(File);
+			File.write(reinterpret_cast<const char*>(Records.data()), Records.size() * sizeof(PoseRecord));
+
+			return File.good();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "PoseRecorder.h"
+
+#include <string>
+#include <vector>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// forward declarations
+		class MotionCompensationManager;
+
+		// Feeds a recording made by the PoseRecorder back through the MotionCompensationManager, routed by MotionCompensationManager::handlePose like the pose hook.
+		// Only raw poses are replayed, in the order they were recorded. The device modes are taken from the recording and the
+		// reference tracker is filtered with the recorded timestamps, so a replay gives the same result every time.
+		// Depends on the manager only, so it also runs in the offline tools.
+		class PoseReplay
+		{
+		public:
+			struct Statistics
+			{
+				uint64_t Poses = 0;
+				double Seconds = 0.0;				// Wall time of the whole replay
+				double MeanMicroseconds = 0.0;		// Time spent in the manager per pose
+				double P99Microseconds = 0.0;
+				double MaxMicroseconds = 0.0;
+			};
+
+			bool Load(const std::string& FileName);
+
+			const std::vector<PoseRecord>& Records() const
+			{
+				return _records;
+			}
+
+			// Replays records that did not come from a file, e.g. from the MotionGenerator
+			void SetRecords(const std::vector<PoseRecord>& Records)
+			{
+				_records = Records;
+			}
+
+			// RealTime keeps the recorded spacing between poses, otherwise poses are fed as fast as possible.
+			// The resulting poses are appended to Output as PoseRecordType::Compensated records if it is given.
+			Statistics Run(MotionCompensationManager& Manager, bool RealTime, std::vector<PoseRecord>* Output = nullptr);
+
+			static bool Save(const std::string& FileName, const std::vector<PoseRecord>& Records);
+
+		private:
+			static void _handlePose(MotionCompensationManager& Manager, const PoseRecord& Entry, vr::DriverPose_t& Pose);
+
+			std::vector<PoseRecord> _records;
+		};
+	}
+}
\ No newline at end of file
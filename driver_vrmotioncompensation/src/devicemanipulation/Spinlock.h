@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#else
+#include <thread>
+#endif
+
+// driver namespace
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// Issue X86 PAUSE or ARM YIELD instruction to reduce contention between hyper-threads
+		inline void spinlockPause() noexcept
+		{
+#if defined(_WIN32)
+			YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+			_mm_pause();
+#else
+			std::this_thread::yield();
+#endif
+		}
+
+		class Spinlock
+		{
+			// Source: https://rigtorp.se/spinlock/
+			std::atomic<bool> lock_ = { 0 };
+
+			// Contention statistics, only updated when the first attempt to take the lock failed
+			std::atomic<uint64_t> contentions_ = { 0 };
+			std::atomic<uint64_t> spins_ = { 0 };
+
+		public:
+			void lock() noexcept
+			{
+				uint64_t spins = 0;
+				bool contended = false;
+
+				for (;;)
+				{
+					// Optimistically assume the lock is free on the first try
+					if (!lock_.exchange(true, std::memory_order_acquire))
+					{
+						if (contended)
+						{
+							contentions_.fetch_add(1, std::memory_order_relaxed);
+							spins_.fetch_add(spins, std::memory_order_relaxed);
+						}
+						return;
+					}
+					contended = true;
+
+					// Wait for lock to be released without generating cache misses
+					while (lock_.load(std::memory_order_relaxed))
+					{
+						spinlockPause();
+						spins++;
+					}
+				}
+			}
+
+			bool try_lock() noexcept
+			{
+				// First do a relaxed load to check if lock is free in order to prevent
+				// unnecessary cache misses if someone does while(!try_lock())
+				return !lock_.load(std::memory_order_relaxed) &&
+					!lock_.exchange(true, std::memory_order_acquire);
+			}
+
+			void unlock() noexcept
+			{
+				lock_.store(false, std::memory_order_release);
+			}
+
+			// Number of lock() calls that had to wait
+			uint64_t contentions() const noexcept
+			{
+				return contentions_.load(std::memory_order_relaxed);
+			}
+
+			// Number of pause instructions issued while waiting
+			uint64_t spins() const noexcept
+			{
+				return spins_.load(std::memory_order_relaxed);
+			}
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "DeviceCounterMirror.h"
+#include "../logging.h"
+
+#include <cstring>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		DeviceCounterMirror::DeviceCounterMirror()
+		{
+#ifdef _WIN32
+			try
+			{
+				// create shared memory, clients open it read only
+				_shdmem = { boost::interprocess::open_or_create, "OVRMC_CountersMMFv1", boost::interprocess::read_write, sizeof(MMFstruct_Counters_OVRMC_v1) };
+				_region = { _shdmem, boost::interprocess::read_write };
+
+				_counters = static_cast<MMFstruct_Counters_OVRMC_v1*>(_region.get_address());
+				LOG(INFO) << "Shared memory OVRMC_CountersMMFv1 created";
+			}
+			catch (boost::interprocess::interprocess_exception& e)
+			{
+				LOG(ERROR) << "Could not create or open counter shared memory. Error code " << e.get_error_code();
+			}
+#else
+			_localCounters.reset(new MMFstruct_Counters_OVRMC_v1);
+			_counters = _localCounters.get();
+#endif
+
+			if (_counters)
+			{
+				// All members are integers, so zeroing the memory resets all counters
+				memset(static_cast<void*>(_counters), 0, sizeof(MMFstruct_Counters_OVRMC_v1));
+				_counters->Version = 1;
+				_counters->DeviceCount = vr::k_unMaxTrackedDeviceCount;
+			}
+		}
+
+		DeviceCounterMirror::~DeviceCounterMirror()
+		{
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <openvr_driver.h>
+#include <vrmotioncompensation_types.h>
+
+#include <memory>
+
+#ifdef _WIN32
+#include <boost/interprocess/windows_shared_memory.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#endif
+
+// driver namespace
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// Keeps the per device pose counters in the shared memory segment OVRMC_CountersMMFv1,
+		// clients read them there instead of asking for all devices in every counters reply.
+		class DeviceCounterMirror
+		{
+		public:
+			DeviceCounterMirror();
+			~DeviceCounterMirror();
+
+			// nullptr when the segment could not be created
+			SharedDeviceCounters_OVRMC_v1* devices()
+			{
+				return _counters ? _counters->Devices : nullptr;
+			}
+
+		private:
+#ifdef _WIN32
+			boost::interprocess::windows_shared_memory _shdmem;
+			boost::interprocess::mapped_region _region;
+#else
+			std::unique_ptr<MMFstruct_Counters_OVRMC_v1> _localCounters;
+#endif
+			MMFstruct_Counters_OVRMC_v1* _counters = nullptr;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "DeviceStateMirror.h"
+#include "../logging.h"
+
+#include <cstring>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		DeviceStateMirror::DeviceStateMirror() : _published(new DeviceStates_OVRMC_v1)
+		{
+#ifdef _WIN32
+			try
+			{
+				// create shared memory, clients open it read only
+				_shdmem = { boost::interprocess::open_or_create, "OVRMC_DeviceStateMMFv1", boost::interprocess::read_write, sizeof(MMFstruct_DeviceState_OVRMC_v1) };
+				_region = { _shdmem, boost::interprocess::read_write };
+
+				_states = static_cast<MMFstruct_DeviceState_OVRMC_v1*>(_region.get_address());
+				LOG(INFO) << "Shared memory OVRMC_DeviceStateMMFv1 created";
+			}
+			catch (boost::interprocess::interprocess_exception& e)
+			{
+				LOG(ERROR) << "Could not create or open device state shared memory. Error code " << e.get_error_code();
+			}
+#else
+			_localStates.reset(new MMFstruct_DeviceState_OVRMC_v1);
+			_states = _localStates.get();
+#endif
+
+			// Sequence 0 tells readers that nothing was published yet
+			memset(static_cast<void*>(_published.get()), 0, sizeof(DeviceStates_OVRMC_v1));
+			if (_states)
+			{
+				memset(static_cast<void*>(_states), 0, sizeof(MMFstruct_DeviceState_OVRMC_v1));
+				_states->Version = 1;
+				_states->DeviceCount = vr::k_unMaxTrackedDeviceCount;
+			}
+		}
+
+		DeviceStateMirror::~DeviceStateMirror()
+		{
+		}
+
+		void DeviceStateMirror::publish(const DeviceStates_OVRMC_v1& States)
+		{
+			if (!_states)
+			{
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(_publishMutex);
+
+			// Sequence and timestamp always differ, only the state itself counts
+			DeviceStates_OVRMC_v1& Last = *_published;
+			const uint64_t Now = States.TimestampMicroseconds;
+			bool Changed = _states->Sequence.load(std::memory_order_relaxed) == 0;
+
+			if (States.CompensationMode != Last.CompensationMode || States.MCdeviceId != Last.MCdeviceId || States.RTdeviceId != Last.RTdeviceId || States.Enabled != Last.Enabled)
+			{
+				_postEvent(DriverEventType::CompensationModeChanged, vr::k_unTrackedDeviceIndexInvalid, (uint32_t)States.CompensationMode, Now);
+				Changed = true;
+			}
+			if (States.ZeroPoseValid != Last.ZeroPoseValid)
+			{
+				_postEvent(DriverEventType::ZeroPoseValidChanged, vr::k_unTrackedDeviceIndexInvalid, States.ZeroPoseValid ? 1 : 0, Now);
+				Changed = true;
+			}
+			if (States.RefPoseValid != Last.RefPoseValid)
+			{
+				_postEvent(DriverEventType::RefPoseValidChanged, vr::k_unTrackedDeviceIndexInvalid, States.RefPoseValid ? 1 : 0, Now);
+				Changed = true;
+			}
+
+			for (uint32_t i = 0; i < vr::k_unMaxTrackedDeviceCount; i++)
+			{
+				const DeviceState_OVRMC_v1& a = States.Devices[i];
+				const DeviceState_OVRMC_v1& b = Last.Devices[i];
+				if (a.Valid != b.Valid || a.DeviceClass != b.DeviceClass || strncmp(a.Serial, b.Serial, DEVICE_STATE_SERIAL_LENGTH) != 0)
+				{
+					_postEvent(DriverEventType::DeviceActivated, i, a.Valid ? 1 : 0, Now, &a);
+					Changed = true;
+				}
+				else if (a.DeviceMode != b.DeviceMode)
+				{
+					_postEvent(DriverEventType::DeviceModeChanged, i, (uint32_t)a.DeviceMode, Now, &a);
+					Changed = true;
+				}
+			}
+
+			if (!Changed)
+			{
+				return;
+			}
+
+			memcpy(static_cast<void*>(&Last), &States, sizeof(DeviceStates_OVRMC_v1));
+			_states->write(States);
+		}
+
+		void DeviceStateMirror::_postEvent(DriverEventType Type, uint32_t OpenVRId, uint32_t Value, uint64_t Microseconds, const DeviceState_OVRMC_v1* Device)
+		{
+			if (!_eventHandler)
+			{
+				return;
+			}
+
+			DriverEvent_OVRMC_v1 Event;
+			memset(&Event, 0, sizeof(DriverEvent_OVRMC_v1));
+			Event.Type = Type;
+			Event.OpenVRId = OpenVRId;
+			Event.Value = Value;
+			Event.TimestampMicroseconds = Microseconds;
+			Event.DeviceClass = vr::TrackedDeviceClass_Invalid;
+			if (Device)
+			{
+				Event.DeviceClass = Device->DeviceClass;
+				memcpy(Event.Serial, Device->Serial, DEVICE_STATE_SERIAL_LENGTH);
+			}
+			_eventHandler(Event);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <openvr_driver.h>
+#include <vrmotioncompensation_types.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#ifdef _WIN32
+#include <boost/interprocess/windows_shared_memory.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#endif
+
+// driver namespace
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// Publishes the device and compensation state in the shared memory segment OVRMC_DeviceStateMMFv1,
+		// so clients can poll it without sending a request for every device.
+		class DeviceStateMirror
+		{
+		public:
+			DeviceStateMirror();
+			~DeviceStateMirror();
+
+			typedef std::function<void(const DriverEvent_OVRMC_v1&)> EventHandler;
+
+			// Receives an event for every change found by publish() and recordPose(). Set it before the hooks run.
+			void setEventHandler(EventHandler Handler)
+			{
+				_eventHandler = Handler;
+			}
+
+			// Writes the state when it differs from the last published one. Can be called from any thread.
+			void publish(const DeviceStates_OVRMC_v1& States);
+
+			// Called by the pose hooks, two relaxed stores while the pose validity stays the same
+			void recordPose(uint32_t OpenVRId, const vr::DriverPose_t& Pose, std::chrono::steady_clock::time_point Time)
+			{
+				if (!_states || OpenVRId >= vr::k_unMaxTrackedDeviceCount)
+				{
+					return;
+				}
+
+				uint64_t Microseconds = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Time.time_since_epoch()).count();
+				uint32_t PoseValid = Pose.poseIsValid && Pose.result == vr::TrackingResult_Running_OK ? 1 : 0;
+				_states->LastPoseMicroseconds[OpenVRId].store(Microseconds, std::memory_order_relaxed);
+
+				// Only the hook of this device writes its flag
+				if (_states->PoseValid[OpenVRId].load(std::memory_order_relaxed) != PoseValid)
+				{
+					_states->PoseValid[OpenVRId].store(PoseValid, std::memory_order_relaxed);
+					_postEvent(DriverEventType::DevicePoseValidChanged, OpenVRId, PoseValid, Microseconds);
+				}
+			}
+
+		private:
+			void _postEvent(DriverEventType Type, uint32_t OpenVRId, uint32_t Value, uint64_t Microseconds, const DeviceState_OVRMC_v1* Device = nullptr);
+
+			EventHandler _eventHandler;
+
+#ifdef _WIN32
+			boost::interprocess::windows_shared_memory _shdmem;
+			boost::interprocess::mapped_region _region;
+#else
+			std::unique_ptr<MMFstruct_DeviceState_OVRMC_v1> _localStates;
+#endif
+			MMFstruct_DeviceState_OVRMC_v1* _states = nullptr;
+
+			// Serializes the writers and remembers what was published last
+			std::mutex _publishMutex;
+			std::unique_ptr<DeviceStates_OVRMC_v1> _published;
+		};
+	}
+}
\ No newline at end of file
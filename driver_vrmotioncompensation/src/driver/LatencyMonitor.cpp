@@ -0,0 +1,105 @@
+#include "LatencyMonitor.h"
+#include "../logging.h"
+
+#include <cstring>
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		LatencyMonitor::LatencyMonitor()
+		{
+#ifdef _WIN32
+			try
+			{
+				// create shared memory, clients open it read only
+				_shdmem = { boost::interprocess::open_or_create, "OVRMC_LatencyMMFv1", boost::interprocess::read_write, sizeof(MMFstruct_Latency_OVRMC_v1) };
+				_region = { _shdmem, boost::interprocess::read_write };
+
+				_histograms = static_cast<MMFstruct_Latency_OVRMC_v1*>(_region.get_address());
+				LOG(INFO) << "Shared memory OVRMC_LatencyMMFv1 created";
+			}
+			catch (boost::interprocess::interprocess_exception& e)
+			{
+				LOG(ERROR) << "Could not create or open latency shared memory. Error code " << e.get_error_code();
+			}
+#else
+			_localHistograms.reset(new MMFstruct_Latency_OVRMC_v1);
+			_histograms = _localHistograms.get();
+#endif
+
+			if (_histograms)
+			{
+				// All members are integers, so zeroing the memory resets all histograms
+				memset(static_cast<void*>(_histograms), 0, sizeof(MMFstruct_Latency_OVRMC_v1));
+				_histograms->Version = 1;
+				_histograms->BucketCount = LATENCY_HISTOGRAM_BUCKETS;
+			}
+		}
+
+		LatencyMonitor::~LatencyMonitor()
+		{
+		}
+
+		void LatencyMonitor::intervalSummary(uint64_t& Calls, uint64_t& P50, uint64_t& P90, uint64_t& P99, uint64_t& Max)
+		{
+			Calls = P50 = P90 = P99 = Max = 0;
+			if (!_histograms)
+			{
+				return;
+			}
+
+			uint64_t Buckets[LATENCY_HISTOGRAM_BUCKETS] = {};
+			for (uint32_t Device = 0; Device < vr::k_unMaxTrackedDeviceCount; Device++)
+			{
+				for (uint32_t Version = 0; Version < LATENCY_HOOK_VERSIONS; Version++)
+				{
+					const LatencyHistogram_OVRMC_v1& Histogram = _histograms->Histograms[Device][Version];
+					if (Histogram.Count.load(std::memory_order_relaxed) == 0)
+					{
+						continue;
+					}
+
+					for (uint32_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+					{
+						Buckets[i] += Histogram.Buckets[i].load(std::memory_order_relaxed);
+					}
+				}
+			}
+
+			// Turn the running totals into the counts of this interval
+			std::lock_guard<std::mutex> lock(_intervalMutex);
+			for (uint32_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+			{
+				uint64_t Total = Buckets[i];
+				Buckets[i] = Total >= _intervalBuckets[i] ? Total - _intervalBuckets[i] : 0;
+				_intervalBuckets[i] = Total;
+				Calls += Buckets[i];
+			}
+
+			if (Calls == 0)
+			{
+				return;
+			}
+
+			const uint64_t Ranks[3] = { (uint64_t)(0.5 * Calls), (uint64_t)(0.9 * Calls), (uint64_t)(0.99 * Calls) };
+			uint64_t* Percentiles[3] = { &P50, &P90, &P99 };
+			uint64_t Seen = 0;
+			uint32_t Next = 0;
+			for (uint32_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+			{
+				if (Buckets[i] == 0)
+				{
+					continue;
+				}
+
+				Seen += Buckets[i];
+				while (Next < 3 && Seen > Ranks[Next])
+				{
+					*Percentiles[Next++] = LatencyHistogram_OVRMC_v1::bucketUpperBound(i);
+				}
+				Max = LatencyHistogram_OVRMC_v1::bucketUpperBound(i);
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <openvr_driver.h>
+#include <vrmotioncompensation_types.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+#ifdef _WIN32
+#include <boost/interprocess/windows_shared_memory.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#endif
+
+// driver namespace
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		// Measures how long the driver spends in each pose update hook, per device and hook version.
+		// The histograms live in the shared memory segment OVRMC_LatencyMMFv1 so that other processes can read them at any time.
+		class LatencyMonitor
+		{
+		public:
+			typedef std::chrono::steady_clock::time_point time_point;
+
+			LatencyMonitor();
+			~LatencyMonitor();
+
+			static time_point now()
+			{
+				return std::chrono::steady_clock::now();
+			}
+
+			// Adds the time since Start to the histogram of the device and hook version
+			void record(uint32_t OpenVRId, int HookVersion, time_point Start)
+			{
+				uint64_t Nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(now() - Start).count();
+				unsigned Version = (unsigned)(HookVersion - 4);
+
+				if (!_histograms || OpenVRId >= vr::k_unMaxTrackedDeviceCount || Version >= LATENCY_HOOK_VERSIONS)
+				{
+					return;
+				}
+
+				LatencyHistogram_OVRMC_v1& Histogram = _histograms->Histograms[OpenVRId][Version];
+				Histogram.Buckets[LatencyHistogram_OVRMC_v1::bucketIndex(Nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+				Histogram.SumNanoseconds.fetch_add(Nanoseconds, std::memory_order_relaxed);
+				Histogram.Count.fetch_add(1, std::memory_order_relaxed);
+
+				uint64_t Max = Histogram.MaxNanoseconds.load(std::memory_order_relaxed);
+				while (Nanoseconds > Max && !Histogram.MaxNanoseconds.compare_exchange_weak(Max, Nanoseconds, std::memory_order_relaxed))
+				{
+				}
+			}
+
+			const MMFstruct_Latency_OVRMC_v1* histograms() const
+			{
+				return _histograms;
+			}
+
+			// Merges the histograms of all devices and hook versions and summarizes the calls recorded since the previous call.
+			// Max is the upper bound of the highest bucket hit in that interval.
+			void intervalSummary(uint64_t& Calls, uint64_t& P50, uint64_t& P90, uint64_t& P99, uint64_t& Max);
+
+		private:
+#ifdef _WIN32
+			boost::interprocess::windows_shared_memory _shdmem;
+			boost::interprocess::mapped_region _region;
+#else
+			std::unique_ptr<MMFstruct_Latency_OVRMC_v1> _localHistograms;
+#endif
+			MMFstruct_Latency_OVRMC_v1* _histograms = nullptr;
+
+			// Merged bucket counts at the previous intervalSummary() call
+			std::mutex _intervalMutex;
+			uint64_t _intervalBuckets[LATENCY_HISTOGRAM_BUCKETS] = {};
+		};
+	}
+}
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "ServerDriver.h"
 #include "../devicemanipulation/DeviceManipulationHandle.h"
+#include "../hooks/InterfaceHooks.h"
+
+#include <algorithm>
+#include <chrono>
 
 namespace vrmotioncompensation
 {
@@ -11,8 +15,20 @@ namespace vrmotioncompensation
 		ServerDriver::ServerDriver() : m_motionCompensation(this)
 		{
 			singleton = this;
-			memset(_openvrIdDeviceManipulationHandle, 0, sizeof(DeviceManipulationHandle*) * vr::k_unMaxTrackedDeviceCount);  // Array of DeviceManipulationHandles. Set all of them to 0 at the start.
-			memset(_deviceVersionMap, 0, sizeof(int) * vr::k_unMaxTrackedDeviceCount);
+			// Array of DeviceManipulationHandles. Set all of them to 0 at the start.
+			for (uint32_t i = 0; i < vr::k_unMaxTrackedDeviceCount; i++)
+			{
+				_openvrIdDeviceManipulationHandle[i].store(nullptr, std::memory_order_relaxed);
+				_deviceVersionMap[i].store(0, std::memory_order_relaxed);
+			}
+			_deviceStatesDirty.store(false, std::memory_order_relaxed);
+
+			// Clients read the per device counters from shared memory
+			if (m_deviceCounterMirror.devices())
+			{
+				m_motionCompensation.counters().attachDevices(m_deviceCounterMirror.devices());
+			}
+			m_deviceStateMirror.setEventHandler([this](const DriverEvent_OVRMC_v1& Event) { shmCommunicator.postEvent(Event); });
 		}
 
 		ServerDriver::~ServerDriver()
@@ -23,18 +39,62 @@ namespace vrmotioncompensation
 		// This is called for every device that we are tracking. This calls the related DeviceManipulationHandle, which then handles the pose update according to device Mode (MC or RefTracker or nothing).
 		bool ServerDriver::hooksTrackedDevicePoseUpdated(void* serverDriverHost, int version, uint32_t& unWhichDevice, vr::DriverPose_t& newPose, uint32_t& unPoseStructSize)
 		{
-			if (_openvrIdDeviceManipulationHandle[unWhichDevice] && _openvrIdDeviceManipulationHandle[unWhichDevice]->isValid())
+			DeviceManipulationHandle* handle = unWhichDevice < vr::k_unMaxTrackedDeviceCount ? _openvrIdDeviceManipulationHandle[unWhichDevice].load(std::memory_order_acquire) : nullptr;
+			if (handle && handle->isValid())
 			{
-				if (_deviceVersionMap[unWhichDevice] == 0)
+				// The first host interface that reports a pose for this device wins, several hook threads may race for it
+				int usedVersion = _deviceVersionMap[unWhichDevice].load(std::memory_order_relaxed);
+				if (usedVersion == 0 && _deviceVersionMap[unWhichDevice].compare_exchange_strong(usedVersion, version, std::memory_order_relaxed))
 				{
-					_deviceVersionMap[unWhichDevice] = version;
+					usedVersion = version;
 				}
 
-				//LOG(TRACE) << "ServerDriver::hooksTrackedDevicePoseUpdated(version:" << version << ", deviceId:" << unWhichDevice << ", first used version: " << _deviceVersionMap[unWhichDevice] << ")";
+				//LOG(TRACE) << "ServerDriver::hooksTrackedDevicePoseUpdated(version:" << version << ", deviceId:" << unWhichDevice << ", first used version: " << usedVersion << ")";
 				
-				if (_deviceVersionMap[unWhichDevice] == version)
+				if (usedVersion == version)
 				{
-					return _openvrIdDeviceManipulationHandle[unWhichDevice]->handlePoseUpdate(unWhichDevice, newPose, unPoseStructSize);
+					TRACE_SPAN("hooksTrackedDevicePoseUpdated", unWhichDevice);
+					LatencyMonitor::time_point start = LatencyMonitor::now();
+					bool retval;
+
+					MotionCompensationDeviceMode deviceMode = handle->getDeviceMode();
+
+					m_flightRecorder.Record(PoseRecordType::Raw, unWhichDevice, version, deviceMode, newPose);
+
+					// The reference tracker sets the zero pose and makes the reference valid, subscribers should hear about it right away
+					bool zeroPoseValid = m_motionCompensation.isZeroPoseValid();
+					bool refPoseValid = m_motionCompensation.isRefPoseValid();
+
+					if (!m_poseRecorder.IsRunning())
+					{
+						retval = handle->handlePoseUpdate(unWhichDevice, newPose, unPoseStructSize);
+					}
+					else
+					{
+						m_poseRecorder.Record(PoseRecordType::Raw, unWhichDevice, version, deviceMode, newPose);
+						retval = handle->handlePoseUpdate(unWhichDevice, newPose, unPoseStructSize);
+						m_poseRecorder.Record(PoseRecordType::Compensated, unWhichDevice, version, deviceMode, newPose);
+					}
+
+					// Publishing locks and walks all devices, leave it to the next RunFrame
+					if (deviceMode == MotionCompensationDeviceMode::ReferenceTracker && (zeroPoseValid != m_motionCompensation.isZeroPoseValid() || refPoseValid != m_motionCompensation.isRefPoseValid()))
+					{
+						_deviceStatesDirty.store(true, std::memory_order_release);
+					}
+
+					m_flightRecorder.Record(PoseRecordType::Compensated, unWhichDevice, version, deviceMode, newPose);
+
+					if (deviceMode == MotionCompensationDeviceMode::ReferenceTracker)
+					{
+						vr::DriverPose_t refPose;
+						m_motionCompensation.getReferencePose(refPose);
+						m_flightRecorder.Record(PoseRecordType::Reference, unWhichDevice, version, deviceMode, refPose);
+					}
+
+					m_latencyMonitor.record(unWhichDevice, version, start);
+					m_deviceStateMirror.recordPose(unWhichDevice, newPose, start);
+
+					return retval;
 				}
 
 				//LOG(TRACE) << "ServerDriver::hooksTrackedDevicePoseUpdated called for wrong version, ignoring ";
@@ -49,10 +109,23 @@ namespace vrmotioncompensation
 
 			// Create ManipulationInfo entry
 			auto handle = std::make_shared<DeviceManipulationHandle>(pchDeviceSerialNumber, eDeviceClass);
-			_deviceManipulationHandles.insert({ pDriver, handle });
+			{
+				// Devices can be added from different driver threads
+				std::lock_guard<std::recursive_mutex> lock(_deviceManipulationHandlesMutex);
+				_deviceManipulationHandles.insert({ pDriver, handle });
+			}
 
 			// Hook into server driver interface
 			handle->setServerDriverHooks(InterfaceHooks::hookInterface(pDriver, "ITrackedDeviceServerDriver_005"));
+
+			DriverEvent_OVRMC_v1 event;
+			memset(&event, 0, sizeof(DriverEvent_OVRMC_v1));
+			event.Type = DriverEventType::DeviceAdded;
+			event.OpenVRId = vr::k_unTrackedDeviceIndexInvalid;
+			event.TimestampMicroseconds = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			event.DeviceClass = eDeviceClass;
+			memcpy(event.Serial, pchDeviceSerialNumber, std::min<size_t>(strlen(pchDeviceSerialNumber), DEVICE_STATE_SERIAL_LENGTH - 1));
+			shmCommunicator.postEvent(event);
 		}
 
 		// THOMAS: Gets called by the driver when a device is "Activated", whatever that means. Here the handle information is completed, and can be passed back to the IPC message upon request.
@@ -60,6 +133,14 @@ namespace vrmotioncompensation
 		{
 			LOG(TRACE) << "ServerDriver::hooksTrackedDeviceActivated(" << serverDriver << ", " << version << ", " << unObjectId << ")";
 
+			if (unObjectId >= vr::k_unMaxTrackedDeviceCount)
+			{
+				LOG(ERROR) << "ServerDriver::hooksTrackedDeviceActivated: invalid OpenVR Id " << unObjectId;
+				return;
+			}
+
+			std::lock_guard<std::recursive_mutex> lock(_deviceManipulationHandlesMutex);
+
 			// Search for the activated device
 			auto i = _deviceManipulationHandles.find(serverDriver);
 
@@ -67,28 +148,25 @@ namespace vrmotioncompensation
 			{
 				auto handle = i->second;
 				handle->setOpenvrId(unObjectId);
-				_openvrIdDeviceManipulationHandle[unObjectId] = handle.get();
+				_openvrIdDeviceManipulationHandle[unObjectId].store(handle.get(), std::memory_order_release);
 
-				//LOG(INFO) << "Successfully added device " << handle->serialNumber() << " (OpenVR Id: " << handle->openvrId() << ")";
-				LOG(INFO) << "Successfully added device " << _openvrIdDeviceManipulationHandle[unObjectId]->serialNumber() << " (OpenVR Id: " << _openvrIdDeviceManipulationHandle[unObjectId]->openvrId() << ")";
+				LOG(INFO) << "Successfully added device " << handle->serialNumber() << " (OpenVR Id: " << handle->openvrId() << ")";
 			}
+
+			publishDeviceStates();
 		}
 
 		vr::EVRInitError ServerDriver::Init(vr::IVRDriverContext* pDriverContext)
 		{
 			LOG(INFO) << "CServerDriver::Init()";
+			AsyncLogger::instance().Start();
 
 			// Initialize Hooking
 			InterfaceHooks::setServerDriver(this);
-			auto mhError = MH_Initialize();
-			if (mhError == MH_OK)
+			if (InterfaceHooks::initialize())
 			{
 				_driverContextHooks = InterfaceHooks::hookInterface(pDriverContext, "IVRDriverContext");
 			}
-			else
-			{
-				LOG(ERROR) << "Error while initializing minHook: " << MH_StatusToString(mhError);
-			}
 
 			LOG(DEBUG) << "Initialize driver context.";
 			VR_INIT_SERVER_DRIVER_CONTEXT(pDriverContext);
@@ -107,6 +185,7 @@ namespace vrmotioncompensation
 
 			// Start IPC thread
 			shmCommunicator.init(this);
+			m_flightRecorder.Start();
 			return vr::VRInitError_None;
 		}
 
@@ -114,37 +193,82 @@ namespace vrmotioncompensation
 		{
 			LOG(TRACE) << "ServerDriver::Cleanup()";
 			_driverContextHooks.reset();
-			MH_Uninitialize();
+			InterfaceHooks::shutdown();
 			shmCommunicator.shutdown();
+			m_poseRecorder.Stop();
+			m_flightRecorder.Stop();
+			AsyncLogger::instance().Stop();
 			VR_CLEANUP_SERVER_DRIVER_CONTEXT();
 		}
 
 		// Call frequency: ~93Hz
 		void ServerDriver::RunFrame()
 		{
+			// Catches the changes made by the pose hooks, like a new zero pose or the reference tracker becoming valid
+			if (_deviceStatesDirty.load(std::memory_order_relaxed) && _deviceStatesDirty.exchange(false, std::memory_order_acquire))
+			{
+				publishDeviceStates();
+			}
+		}
+
+		void ServerDriver::publishDeviceStates()
+		{
+			DeviceStates_OVRMC_v1 States;
+			memset(&States, 0, sizeof(DeviceStates_OVRMC_v1));
+			States.TimestampMicroseconds = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 
+			States.CompensationMode = m_motionCompensation.getMotionCompensationMode();
+			States.MCdeviceId = m_motionCompensation.getMCdeviceID();
+			States.RTdeviceId = m_motionCompensation.getRTdeviceID();
+			States.Enabled = m_motionCompensation.isEnabled();
+			States.ZeroPoseValid = m_motionCompensation.isZeroPoseValid();
+			States.RefPoseValid = m_motionCompensation.isRefPoseValid();
+
+			// The table is published with atomics, no need for the handle mutex
+			for (uint32_t i = 0; i < vr::k_unMaxTrackedDeviceCount; i++)
+			{
+				DeviceManipulationHandle* handle = _openvrIdDeviceManipulationHandle[i].load(std::memory_order_acquire);
+				if (!handle)
+				{
+					continue;
+				}
+
+				DeviceState_OVRMC_v1& State = States.Devices[i];
+				State.Valid = handle->isValid();
+				State.DeviceClass = handle->deviceClass();
+				State.DeviceMode = handle->getDeviceMode();
+				const std::string& Serial = handle->serialNumber();
+				memcpy(State.Serial, Serial.c_str(), std::min<size_t>(Serial.size(), DEVICE_STATE_SERIAL_LENGTH - 1));
+			}
+
+			m_deviceStateMirror.publish(States);
 		}
 
 		DeviceManipulationHandle* ServerDriver::getDeviceManipulationHandleById(uint32_t unWhichDevice)
 		{
-			LOG(TRACE) << "getDeviceByID: unWhichDevice: " << unWhichDevice;
+			ALOG(TRACE, "getDeviceByID: unWhichDevice: {}", unWhichDevice);
 
-			std::lock_guard<std::recursive_mutex> lock(_deviceManipulationHandlesMutex);
+			if (unWhichDevice >= vr::k_unMaxTrackedDeviceCount)
+			{
+				ALOG(ERROR, "unWhichDevice is out of range. unWhichDevice: {}", unWhichDevice);
+				return nullptr;
+			}
 
-			if (_openvrIdDeviceManipulationHandle[unWhichDevice]->isValid())
+			DeviceManipulationHandle* handle = _openvrIdDeviceManipulationHandle[unWhichDevice].load(std::memory_order_acquire);
+			if (handle)
 			{
-				if (_openvrIdDeviceManipulationHandle[unWhichDevice])
+				if (handle->isValid())
 				{
-					return _openvrIdDeviceManipulationHandle[unWhichDevice];
+					return handle;
 				}
 				else
 				{
-					LOG(ERROR) << "_openvrIdDeviceManipulationHandle[unWhichDevice] is NULL. unWhichDevice: " << unWhichDevice;
+					ALOG(ERROR, "_openvrIdDeviceManipulationHandle[unWhichDevice] is not valid. unWhichDevice: {}", unWhichDevice);
 				}
 			}
 			else
 			{
-				LOG(ERROR) << "_openvrIdDeviceManipulationHandle[unWhichDevice] is not valid. unWhichDevice: " << unWhichDevice;
+				ALOG(ERROR, "_openvrIdDeviceManipulationHandle[unWhichDevice] is NULL. unWhichDevice: {}", unWhichDevice);
 			}
 
 			return nullptr;
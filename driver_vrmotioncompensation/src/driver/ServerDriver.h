@@ -1,14 +1,21 @@
 #pragma once
 
+#include <atomic>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <openvr_driver.h>
 #include <vrmotioncompensation_types.h>
-#include "../hooks/common.h"
+#include <tracespans.h>
 #include "../logging.h"
 #include "../com/shm/driver_ipc_shm.h"
+#include "DeviceCounterMirror.h"
+#include "DeviceStateMirror.h"
+#include "LatencyMonitor.h"
 #include "../devicemanipulation/MotionCompensationManager.h"
+#include "../devicemanipulation/PoseRecorder.h"
+#include "../devicemanipulation/FlightRecorder.h"
 
 // driver namespace
 namespace vrmotioncompensation
@@ -28,7 +35,7 @@ namespace vrmotioncompensation
 		* Its the main entry point of the driver. It's a singleton which manages all devices owned by this driver,
 		* and also handles the whole "hacking into OpenVR" stuff.
 		*/
-		class ServerDriver : public vr::IServerTrackedDeviceProvider
+		class ServerDriver : public vr::IServerTrackedDeviceProvider, public MotionCompensationHost
 		{
 		public:
 			ServerDriver();
@@ -88,6 +95,34 @@ namespace vrmotioncompensation
 				return m_motionCompensation;
 			}
 
+			/* Hook latency related */
+			LatencyMonitor& latencyMonitor()
+			{
+				return m_latencyMonitor;
+			}
+
+			/* Shared device state related */
+			// Copies the device and compensation state into the shared memory mirror when it changed. Called after ipc requests that change it
+			// and by RunFrame when a pose hook marked the state dirty.
+			void publishDeviceStates();
+
+			/* Pose recording related */
+			PoseRecorder& poseRecorder()
+			{
+				return m_poseRecorder;
+			}
+
+			FlightRecorder& flightRecorder()
+			{
+				return m_flightRecorder;
+			}
+
+			//// from MotionCompensationHost ////
+			virtual void onReferencePoseAnomaly(const char* Event) override
+			{
+				m_flightRecorder.Trigger(Event);
+			}
+
 			//// function hooks related ////
 			void hooksTrackedDeviceAdded(void* serverDriverHost, int version, const char* pchDeviceSerialNumber, vr::ETrackedDeviceClass& eDeviceClass, void* pDriver);
 			void hooksTrackedDeviceActivated(void* serverDriver, int version, uint32_t unObjectId);
@@ -102,14 +137,28 @@ namespace vrmotioncompensation
 			IpcShmCommunicator shmCommunicator;
 
 			//// device manipulation related ////
+			// The mutex guards the map and serializes writers of the tables below. The pose hooks read the tables without a lock,
+			// entries are published with release stores and handles stay alive in the map until the driver is unloaded.
 			std::recursive_mutex _deviceManipulationHandlesMutex;
 			std::map<void*, std::shared_ptr<DeviceManipulationHandle>> _deviceManipulationHandles;
-			DeviceManipulationHandle* _openvrIdDeviceManipulationHandle[vr::k_unMaxTrackedDeviceCount];
-			int _deviceVersionMap[vr::k_unMaxTrackedDeviceCount];
+			std::atomic<DeviceManipulationHandle*> _openvrIdDeviceManipulationHandle[vr::k_unMaxTrackedDeviceCount];
+			std::atomic<int> _deviceVersionMap[vr::k_unMaxTrackedDeviceCount];
 
 			//// motion compensation related ////
 			MotionCompensationManager m_motionCompensation;
 
+			//// hook latency related ////
+			LatencyMonitor m_latencyMonitor;
+
+			//// shared device state related ////
+			DeviceCounterMirror m_deviceCounterMirror;
+			DeviceStateMirror m_deviceStateMirror;
+			std::atomic<bool> _deviceStatesDirty;
+
+			//// pose recording related ////
+			PoseRecorder m_poseRecorder;
+			FlightRecorder m_flightRecorder;
+
 			//// function hooks related ////
 			std::shared_ptr<InterfaceHooks> _driverContextHooks;
 		};
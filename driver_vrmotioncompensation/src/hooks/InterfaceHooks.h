@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		//forward declarations
+		class ServerDriver;
+
+		// Base of the hooks into the OpenVR interfaces. Kept apart from common.h so code that only holds hooks does not need MinHook.
+		class InterfaceHooks
+		{
+		public:
+			virtual ~InterfaceHooks()
+			{
+			}
+
+			// Sets up MinHook, has to succeed before any interface is hooked
+			static bool initialize();
+
+			static void shutdown();
+
+			static std::shared_ptr<InterfaceHooks> hookInterface(void* interfaceRef, std::string interfaceVersion);
+
+			static void setServerDriver(ServerDriver* driver)
+			{
+				serverDriver = driver;
+			}
+
+		protected:
+			static ServerDriver* serverDriver;
+		};
+	}
+}
\ No newline at end of file
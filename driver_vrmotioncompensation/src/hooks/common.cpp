@@ -14,6 +14,22 @@ namespace vrmotioncompensation
 	{
 		ServerDriver* InterfaceHooks::serverDriver = nullptr;
 
+		bool InterfaceHooks::initialize()
+		{
+			auto mhError = MH_Initialize();
+			if (mhError != MH_OK)
+			{
+				LOG(ERROR) << "Error while initializing minHook: " << MH_StatusToString(mhError);
+				return false;
+			}
+			return true;
+		}
+
+		void InterfaceHooks::shutdown()
+		{
+			MH_Uninitialize();
+		}
+
 		std::shared_ptr<InterfaceHooks> InterfaceHooks::hookInterface(void* interfaceRef, std::string interfaceVersion)
 		{
 			std::shared_ptr<InterfaceHooks> retval;
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <MinHook.h>
 #include "../logging.h"
+#include "InterfaceHooks.h"
 
 
 namespace vrmotioncompensation
@@ -37,11 +38,6 @@ namespace vrmotioncompensation
 		}
 
 
-		//forward declarations
-		class ServerDriver;
-		class IVRDriverContextHooks;
-		class IVRServerDriverHost004Hooks;
-
 		template<class T>
 		struct HookData
 		{
@@ -49,23 +45,5 @@ namespace vrmotioncompensation
 			void* targetFunc = nullptr;
 			T origFunc = nullptr;
 		};
-
-		class InterfaceHooks
-		{
-		public:
-			virtual ~InterfaceHooks()
-			{
-			}
-
-			static std::shared_ptr<InterfaceHooks> hookInterface(void* interfaceRef, std::string interfaceVersion);
-
-			static void setServerDriver(ServerDriver* driver)
-			{
-				serverDriver = driver;
-			}
-
-		protected:
-			static ServerDriver* serverDriver;
-		};
 	}
 }
\ No newline at end of file
@@ -12,3 +12,6 @@
 #define ELPP_NO_DEFAULT_LOG_FILE
 #include <easylogging++.h>
 #endif
+
+// Non-blocking logging for the pose paths
+#include "AsyncLogger.h"
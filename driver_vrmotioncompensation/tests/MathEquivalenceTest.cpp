@@ -0,0 +1,121 @@
+// Checks the scalar-generic vrmath helpers the compensation runs on against the HmdVector3d_t / HmdQuaternion_t math they replaced:
+// the cross product form of quaternionRotateVector and the rotation matrix cached by quaternionToMatrix33.
+#include <openvr_driver.h>
+#include <openvr_math.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// Rotations and positions of the size a tracked rig produces, with the special cases in front
+	struct Sample
+	{
+		vr::HmdQuaternion_t Rotation;
+		vr::HmdVector3d_t Vector;
+	};
+
+	std::vector<Sample> samples()
+	{
+		std::vector<Sample> Samples = {
+			{ { 1, 0, 0, 0 }, { 0.3, 1.2, -0.4 } },				// Identity
+			{ { 0, 1, 0, 0 }, { 0.3, 1.2, -0.4 } },				// Half turns, w = 0
+			{ { 0, 0, 1, 0 }, { 0.3, 1.2, -0.4 } },
+			{ { 0, 0, 0, 1 }, { 0.3, 1.2, -0.4 } },
+			{ { -1, 0, 0, 0 }, { 0.3, 1.2, -0.4 } },			// Same rotation as the identity
+			{ { 0.7071067811865476, 0, 0.7071067811865476, 0 }, { 0, 0, 0 } },
+		};
+
+		std::mt19937 Generator(26);
+		std::normal_distribution<double> Normal(0.0, 1.0);
+		std::uniform_real_distribution<double> Position(-3.0, 3.0);
+		for (int i = 0; i < 1000; i++)
+		{
+			vr::HmdQuaternion_t q = { Normal(Generator), Normal(Generator), Normal(Generator), Normal(Generator) };
+			double Norm = std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+			Samples.push_back({ { q.w / Norm, q.x / Norm, q.y / Norm, q.z / Norm }, { Position(Generator), Position(Generator), Position(Generator) } });
+		}
+
+		return Samples;
+	}
+
+	template<typename T> void expectNear(const vrmath::vec3<T>& Actual, const vr::HmdVector3d_t& Expected, double Tolerance, size_t Index)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			EXPECT_NEAR((double)Actual.v[j], Expected.v[j], Tolerance) << "sample " << Index << " axis " << j;
+		}
+	}
+
+	// Positions of up to a few meters, double keeps a few ulps of that, float about 1e-6 m
+	const double DoubleTolerance = 1e-12;
+	const double FloatTolerance = 1e-5;
+
+	template<typename T> void checkQuaternionRotate(double Tolerance)
+	{
+		std::vector<Sample> Samples = samples();
+		for (size_t i = 0; i < Samples.size(); i++)
+		{
+			vrmath::quat<T> q = vrmath::toQuat<T>(Samples[i].Rotation);
+			vrmath::quat<T> qInv = vrmath::quaternionConjugate(q);
+			vrmath::vec3<T> v = vrmath::toVec3<T>(Samples[i].Vector);
+
+			for (bool Reverse : { false, true })
+			{
+				vr::HmdVector3d_t Expected = vrmath::quaternionRotateVector(Samples[i].Rotation, Samples[i].Vector, Reverse);
+
+				expectNear(vrmath::quaternionRotateVector(q, v, Reverse), Expected, Tolerance, i);
+				expectNear(vrmath::quaternionRotateVector(q, qInv, v, Reverse), Expected, Tolerance, i);
+			}
+		}
+	}
+
+	template<typename T> void checkMatrixCache(double Tolerance)
+	{
+		std::vector<Sample> Samples = samples();
+		for (size_t i = 0; i < Samples.size(); i++)
+		{
+			vrmath::mat33<T> m = vrmath::quaternionToMatrix33(vrmath::toQuat<T>(Samples[i].Rotation));
+			vrmath::vec3<T> v = vrmath::toVec3<T>(Samples[i].Vector);
+
+			expectNear(vrmath::matMul33(m, v), vrmath::quaternionRotateVector(Samples[i].Rotation, Samples[i].Vector, false), Tolerance, i);
+			expectNear(vrmath::matMul33(v, m), vrmath::quaternionRotateVector(Samples[i].Rotation, Samples[i].Vector, true), Tolerance, i);
+		}
+	}
+}
+
+TEST(MathEquivalence, QuaternionRotateMatchesHmdMath)
+{
+	checkQuaternionRotate<double>(DoubleTolerance);
+}
+
+TEST(MathEquivalence, QuaternionRotateMatchesHmdMathInFloat)
+{
+	checkQuaternionRotate<float>(FloatTolerance);
+}
+
+TEST(MathEquivalence, MatrixCacheMatchesHmdMath)
+{
+	checkMatrixCache<double>(DoubleTolerance);
+}
+
+TEST(MathEquivalence, MatrixCacheMatchesHmdMathInFloat)
+{
+	checkMatrixCache<float>(FloatTolerance);
+}
+
+// The compensation rotates into app space and back with the same cached matrix, that must give the input again
+TEST(MathEquivalence, MatrixCacheRoundTrip)
+{
+	std::vector<Sample> Samples = samples();
+	for (size_t i = 0; i < Samples.size(); i++)
+	{
+		vrmath::mat33<double> m = vrmath::quaternionToMatrix33(vrmath::toQuat<double>(Samples[i].Rotation));
+		vrmath::vec3<double> v = vrmath::toVec3<double>(Samples[i].Vector);
+
+		expectNear(vrmath::matMul33(vrmath::matMul33(m, v), m), Samples[i].Vector, DoubleTolerance, i);
+	}
+}
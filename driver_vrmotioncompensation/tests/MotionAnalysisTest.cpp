@@ -0,0 +1,147 @@
+// Trace statistics against signals with known answers: the spectral peak of a sine, the Allan deviation slope of white noise
+// and the delay between two channels, which has to come out between the samples.
+#include <motionanalysis.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace vrmotioncompensation;
+using namespace vrmotioncompensation::trace;
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+
+	// Smooth motion with a sharp correlation peak, the frequencies share no common period within the searched lags
+	double motion(double Time, uint32_t Component)
+	{
+		return 0.010 * std::sin(2.0 * Pi * 7.3 * Time + Component)
+			+ 0.006 * std::sin(2.0 * Pi * 13.1 * Time + 2.0 * Component)
+			+ 0.004 * std::sin(2.0 * Pi * 23.7 * Time + 3.0 * Component);
+	}
+}
+
+TEST(MotionAnalysis, SpectrumPeaksAtSineFrequency)
+{
+	const double Rate = 1000.0;
+	const double Frequency = 50.0;
+	const double Amplitude = 0.02;
+	const size_t SegmentSize = 1024;
+
+	std::vector<double> Samples;
+	for (size_t i = 0; i < 16384; i++)
+	{
+		Samples.push_back(Amplitude * std::sin(2.0 * Pi * Frequency * (double)i / Rate) + 0.5);
+	}
+
+	std::vector<double> Spectrum = powerSpectrum(Samples, SegmentSize, Rate);
+	ASSERT_EQ(Spectrum.size(), SegmentSize / 2 + 1);
+
+	size_t Peak = 1;
+	double Power = 0.0;
+	for (size_t Bin = 1; Bin < Spectrum.size(); Bin++)
+	{
+		if (Spectrum[Bin] > Spectrum[Peak])
+		{
+			Peak = Bin;
+		}
+		Power += Spectrum[Bin];
+	}
+
+	const double Resolution = Rate / (double)SegmentSize;
+	EXPECT_NEAR((double)Peak * Resolution, Frequency, Resolution);
+
+	// The density integrates to the variance of the sine. The offset is removed per segment, only window leakage is left at DC.
+	EXPECT_NEAR(Power * Resolution, Amplitude * Amplitude / 2.0, Amplitude * Amplitude / 2.0 * 0.02);
+	EXPECT_LT(Spectrum[0], Spectrum[Peak] * 1e-3);
+
+	EXPECT_TRUE(powerSpectrum(std::vector<double>(SegmentSize - 1, 1.0), SegmentSize, Rate).empty());
+}
+
+TEST(MotionAnalysis, WhiteNoiseAllanSlopeIsMinusOneHalf)
+{
+	const double Sigma = 0.001;
+	const double Interval = 0.001;
+
+	std::mt19937 Generator(42);
+	std::normal_distribution<double> Noise(0.0, Sigma);
+	std::vector<double> Samples(1 << 16);
+	for (double& Sample : Samples)
+	{
+		Sample = Noise(Generator);
+	}
+
+	std::vector<AllanPoint> Allan = allanDeviation(Samples, Interval);
+	ASSERT_GE(Allan.size(), 8u);
+	EXPECT_DOUBLE_EQ(Allan[0].Tau, Interval);
+	EXPECT_DOUBLE_EQ(Allan[1].Tau, 2.0 * Interval);
+
+	// White noise averages down with the square root of the cluster size
+	EXPECT_NEAR(Allan[0].Deviation, Sigma, Sigma * 0.02);
+
+	// Least squares slope in log log, the largest clusters have too few terms to count
+	double SumX = 0.0;
+	double SumY = 0.0;
+	double SumXX = 0.0;
+	double SumXY = 0.0;
+	const size_t Count = Allan.size() - 3;
+	for (size_t i = 0; i < Count; i++)
+	{
+		double X = std::log(Allan[i].Tau);
+		double Y = std::log(Allan[i].Deviation);
+		SumX += X;
+		SumY += Y;
+		SumXX += X * X;
+		SumXY += X * Y;
+	}
+	double Slope = ((double)Count * SumXY - SumX * SumY) / ((double)Count * SumXX - SumX * SumX);
+	EXPECT_NEAR(Slope, -0.5, 0.05);
+}
+
+TEST(MotionAnalysis, CorrelationFindsDelayBetweenSamples)
+{
+	const std::string FileName = ::testing::TempDir() + "vrmc_motionanalysis_lag.ovrmctrace";
+	const double Interval = 0.001;
+	const double Delay = 0.0124;		// 12.4 samples
+
+	{
+		// The compensated pose moves against the reference, delayed
+		TraceWriter Writer;
+		ASSERT_TRUE(Writer.Open(FileName, { { "RefPos", 3 }, { "HmdPosCompensated", 3 } }));
+		double Values[6];
+		for (uint32_t Point = 0; Point < 8000; Point++)
+		{
+			double Time = Point * Interval;
+			for (uint32_t Component = 0; Component < 3; Component++)
+			{
+				Values[Component] = motion(Time, Component);
+				Values[3 + Component] = -motion(Time - Delay, Component);
+			}
+			Writer.Append(Time, Values);
+		}
+		ASSERT_TRUE(Writer.Close());
+	}
+
+	TraceReader Reader;
+	ASSERT_TRUE(Reader.Open(FileName));
+	TraceAnalysis Analysis;
+	ASSERT_TRUE(TraceAnalyzer().Analyze(Reader, Analysis));
+
+	ASSERT_EQ(Analysis.Correlations.size(), 1u);
+	const CorrelationResult& Result = Analysis.Correlations[0];
+	EXPECT_EQ(Result.Reference, "RefPos");
+	EXPECT_EQ(Result.Target, "HmdPosCompensated");
+	EXPECT_NEAR(Result.Lag, Delay, 0.1 * Interval);
+	EXPECT_LT(Result.Correlation, -0.95);
+
+	ASSERT_EQ(Analysis.Channels.size(), 2u);
+	EXPECT_EQ(Analysis.Channels[0].Updates, 8000u);
+	EXPECT_NEAR(Analysis.Channels[0].Rate, 1.0 / Interval, 1.0);
+
+	std::remove(FileName.c_str());
+}
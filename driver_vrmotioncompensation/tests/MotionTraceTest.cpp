@@ -0,0 +1,320 @@
+// Round trips of the motion trace columns and files, and a reader that refuses files that are cut short or do not match their headers.
+#include <motiontrace.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace vrmotioncompensation;
+using namespace vrmotioncompensation::trace;
+
+namespace
+{
+	uint64_t bitsOf(double Value)
+	{
+		uint64_t Bits;
+		memcpy(&Bits, &Value, sizeof(Bits));
+		return Bits;
+	}
+
+	double fromBits(uint64_t Bits)
+	{
+		double Value;
+		memcpy(&Value, &Bits, sizeof(Value));
+		return Value;
+	}
+
+	std::vector<double> roundTripTime(const std::vector<int64_t>& Nanoseconds)
+	{
+		std::vector<uint8_t> Column;
+		encodeTimeColumn(Column, Nanoseconds.data(), Nanoseconds.size());
+		std::vector<double> Out(Nanoseconds.size());
+		EXPECT_TRUE(decodeTimeColumn(Column.data(), Column.data() + Column.size(), Out.data(), Out.size()));
+		return Out;
+	}
+
+	// Values are compared bit by bit, NaN payloads and the sign of zero have to survive
+	void expectValuesRoundTrip(const std::vector<double>& Values)
+	{
+		std::vector<uint8_t> Column;
+		encodeValueColumn(Column, Values.data(), Values.size());
+		std::vector<double> Out(Values.size());
+		ASSERT_TRUE(decodeValueColumn(Column.data(), Column.data() + Column.size(), Out.data(), Out.size()));
+		for (size_t i = 0; i < Values.size(); i++)
+		{
+			EXPECT_EQ(bitsOf(Out[i]), bitsOf(Values[i])) << "value " << i;
+		}
+	}
+
+	std::string tracePath(const char* Name)
+	{
+		return ::testing::TempDir() + "vrmc_motiontrace_" + Name + ".ovrmctrace";
+	}
+
+	std::vector<uint8_t> readFile(const std::string& FileName)
+	{
+		std::ifstream File(FileName, std::ios::binary);
+		return std::vector<uint8_t>(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+	}
+
+	void writeFile(const std::string& FileName, const std::vector<uint8_t>& Data, size_t Size)
+	{
+		std::ofstream File(FileName, std::ios::binary | std::ios::trunc);
+		File.write(reinterpret_cast<const char*>(Data.data()), Size);
+	}
+
+	// A vector and a quaternion channel over more than two blocks, with NaN and negative zero in the values
+	const uint32_t TestPoints = MOTION_TRACE_BLOCK_SIZE * 2 + 100;
+
+	double testValue(uint32_t Point, uint32_t Column)
+	{
+		if (Point % 1000 == 7)
+		{
+			return Column % 2 ? -0.0 : std::numeric_limits<double>::quiet_NaN();
+		}
+		return std::sin(Point * 0.01 + Column) * (Column + 1);
+	}
+
+	void writeTestTrace(const std::string& FileName)
+	{
+		TraceWriter Writer;
+		ASSERT_TRUE(Writer.Open(FileName, { { "RefTracker", 3 }, { "RefRotation", 4 } }));
+		double Values[7];
+		for (uint32_t Point = 0; Point < TestPoints; Point++)
+		{
+			for (uint32_t Column = 0; Column < 7; Column++)
+			{
+				Values[Column] = testValue(Point, Column);
+			}
+			Writer.Append(Point * 0.001, Values);
+		}
+		Writer.SetRate(0, 1000.0);
+		ASSERT_TRUE(Writer.Close());
+	}
+}
+
+TEST(MotionTrace, TimeColumnRoundTrips)
+{
+	std::vector<std::vector<int64_t>> Cases = {
+		{ 0, 1000000, 2000000, 3000000, 4000000 },
+		{ 5000000000, 5001000000, 5001000000, 5001000000, 5003000000 },
+		// Running backwards, e.g. samples of several threads merged out of order
+		{ 3000000, 1000000, 2000000, -4000000, 7000000, 6999999 },
+		{ std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min(), 0, std::numeric_limits<int64_t>::max() },
+	};
+
+	for (auto& Nanoseconds : Cases)
+	{
+		std::vector<double> Out = roundTripTime(Nanoseconds);
+		for (size_t i = 0; i < Nanoseconds.size(); i++)
+		{
+			EXPECT_EQ(Out[i], (double)Nanoseconds[i] * 1.0E-9) << "time " << i;
+		}
+	}
+}
+
+TEST(MotionTrace, SteadyTimeTakesOneBytePerPoint)
+{
+	std::vector<int64_t> Nanoseconds;
+	for (int64_t i = 0; i < 1000; i++)
+	{
+		Nanoseconds.push_back(i * 1000000);
+	}
+
+	std::vector<uint8_t> Column;
+	encodeTimeColumn(Column, Nanoseconds.data(), Nanoseconds.size());
+
+	// The first delta is stored in full, every later one repeats it
+	EXPECT_LE(Column.size(), Nanoseconds.size() + 4);
+}
+
+TEST(MotionTrace, ValueColumnRoundTripsSpecialValues)
+{
+	expectValuesRoundTrip({
+		0.0, -0.0, 0.0, -0.0, -0.0,
+		std::numeric_limits<double>::quiet_NaN(), fromBits(0x7ff8000000000123ull), fromBits(0xfff0000000000001ull),
+		std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+		std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(),
+		1.0, 1.0, 1.0 + std::numeric_limits<double>::epsilon(), -1.0,
+	});
+}
+
+TEST(MotionTrace, EmptyColumnsRoundTrip)
+{
+	std::vector<uint8_t> Column;
+	encodeTimeColumn(Column, nullptr, 0);
+	encodeValueColumn(Column, nullptr, 0);
+	EXPECT_TRUE(Column.empty());
+	EXPECT_TRUE(decodeTimeColumn(Column.data(), Column.data(), nullptr, 0));
+	EXPECT_TRUE(decodeValueColumn(Column.data(), Column.data(), nullptr, 0));
+}
+
+TEST(MotionTrace, TruncatedColumnsFail)
+{
+	std::vector<int64_t> Nanoseconds = { 0, 1000000, 1000000000000, -5, 123456789 };
+	std::vector<double> Values = { 1.5, -0.0, 3.25e100, std::numeric_limits<double>::quiet_NaN(), 7.0 };
+
+	std::vector<uint8_t> TimeColumn;
+	std::vector<uint8_t> ValueColumn;
+	encodeTimeColumn(TimeColumn, Nanoseconds.data(), Nanoseconds.size());
+	encodeValueColumn(ValueColumn, Values.data(), Values.size());
+
+	std::vector<double> Out(Values.size());
+	for (size_t Size = 0; Size < TimeColumn.size(); Size++)
+	{
+		EXPECT_FALSE(decodeTimeColumn(TimeColumn.data(), TimeColumn.data() + Size, Out.data(), Out.size())) << "time cut at " << Size;
+	}
+	for (size_t Size = 0; Size < ValueColumn.size(); Size++)
+	{
+		EXPECT_FALSE(decodeValueColumn(ValueColumn.data(), ValueColumn.data() + Size, Out.data(), Out.size())) << "values cut at " << Size;
+	}
+}
+
+TEST(MotionTrace, MalformedColumnsFail)
+{
+	double Out;
+
+	// Eleven continuation bytes do not fit into 64 bits
+	std::vector<uint8_t> LongVarint(11, 0x80);
+	LongVarint.push_back(0x01);
+	EXPECT_FALSE(decodeTimeColumn(LongVarint.data(), LongVarint.data() + LongVarint.size(), &Out, 1));
+
+	// More leading and trailing zero bytes than a double has
+	std::vector<uint8_t> BadControl = { 0x99, 0, 0, 0, 0, 0, 0, 0, 0 };
+	EXPECT_FALSE(decodeValueColumn(BadControl.data(), BadControl.data() + BadControl.size(), &Out, 1));
+}
+
+TEST(MotionTrace, FileRoundTrips)
+{
+	const std::string FileName = tracePath("roundtrip");
+	writeTestTrace(FileName);
+
+	TraceReader Reader;
+	ASSERT_TRUE(Reader.Open(FileName));
+	ASSERT_EQ(Reader.Points(), TestPoints);
+	ASSERT_EQ(Reader.Channels().size(), 2u);
+	EXPECT_EQ(Reader.Channels()[0].Name, "RefTracker");
+	EXPECT_EQ(Reader.Channels()[0].Components, 3u);
+	EXPECT_EQ(Reader.Channels()[0].Rate, 1000.0);
+	EXPECT_EQ(Reader.Channels()[1].Name, "RefRotation");
+	EXPECT_EQ(Reader.Channels()[1].FirstColumn, 4u);
+	EXPECT_EQ(Reader.FindChannel("RefRotation"), 1);
+	EXPECT_EQ(Reader.FindChannel("Missing"), -1);
+	EXPECT_NEAR(Reader.Duration(), (TestPoints - 1) * 0.001, 1e-9);
+
+	std::vector<double> Time;
+	ASSERT_TRUE(Reader.ReadTime(Time));
+	for (uint32_t Point = 0; Point < TestPoints; Point++)
+	{
+		EXPECT_EQ(Time[Point], (double)(int64_t)(Point * 0.001 * 1.0E9) * 1.0E-9) << "point " << Point;
+	}
+
+	for (uint32_t Channel = 0; Channel < 2; Channel++)
+	{
+		for (uint32_t Component = 0; Component < Reader.Channels()[Channel].Components; Component++)
+		{
+			std::vector<double> Values;
+			ASSERT_TRUE(Reader.ReadColumn(Channel, Component, Values));
+			uint32_t Column = Reader.Channels()[Channel].FirstColumn - 1 + Component;
+			for (uint32_t Point = 0; Point < TestPoints; Point++)
+			{
+				ASSERT_EQ(bitsOf(Values[Point]), bitsOf(testValue(Point, Column))) << "point " << Point << " column " << Column;
+			}
+		}
+	}
+	std::vector<double> Values;
+	EXPECT_FALSE(Reader.ReadColumn(0, 3, Values));
+	EXPECT_FALSE(Reader.ReadColumn(2, 0, Values));
+
+	std::remove(FileName.c_str());
+}
+
+TEST(MotionTrace, EmptyTraceRoundTrips)
+{
+	const std::string FileName = tracePath("empty");
+	{
+		TraceWriter Writer;
+		ASSERT_TRUE(Writer.Open(FileName, { { "RefTracker", 3 } }));
+		ASSERT_TRUE(Writer.Close());
+	}
+
+	TraceReader Reader;
+	ASSERT_TRUE(Reader.Open(FileName));
+	EXPECT_EQ(Reader.Points(), 0u);
+	EXPECT_EQ(Reader.Channels().size(), 1u);
+	std::vector<double> Time;
+	EXPECT_TRUE(Reader.ReadTime(Time));
+	EXPECT_TRUE(Time.empty());
+
+	std::remove(FileName.c_str());
+}
+
+TEST(MotionTrace, TruncatedFilesAreRejected)
+{
+	const std::string FileName = tracePath("source");
+	const std::string CutName = tracePath("cut");
+	writeTestTrace(FileName);
+	std::vector<uint8_t> Data = readFile(FileName);
+	ASSERT_GT(Data.size(), sizeof(TraceFileHeader) + 2 * sizeof(TraceChannelHeader));
+
+	// Inside the file header, the channel headers, the first block header, the first block and the last block
+	const size_t Headers = sizeof(TraceFileHeader) + 2 * sizeof(TraceChannelHeader);
+	for (size_t Size : { (size_t)0, sizeof(TraceFileHeader) - 1, sizeof(TraceFileHeader) + 10, Headers + 3, Headers + sizeof(TraceBlockHeader) + 100, Data.size() - 1 })
+	{
+		writeFile(CutName, Data, Size);
+		TraceReader Reader;
+		EXPECT_FALSE(Reader.Open(CutName)) << "cut at " << Size;
+		EXPECT_EQ(Reader.Points(), 0u);
+		EXPECT_TRUE(Reader.Channels().empty());
+	}
+
+	std::remove(FileName.c_str());
+	std::remove(CutName.c_str());
+}
+
+TEST(MotionTrace, MalformedHeadersAreRejected)
+{
+	const std::string FileName = tracePath("source");
+	const std::string BadName = tracePath("bad");
+	writeTestTrace(FileName);
+	const std::vector<uint8_t> Data = readFile(FileName);
+
+	const size_t FirstChannel = sizeof(TraceFileHeader);
+	const size_t FirstBlock = sizeof(TraceFileHeader) + 2 * sizeof(TraceChannelHeader);
+	auto patched = [&](size_t Offset, uint32_t Value)
+	{
+		std::vector<uint8_t> Bad = Data;
+		memcpy(&Bad[Offset], &Value, sizeof(Value));
+		writeFile(BadName, Bad, Bad.size());
+		TraceReader Reader;
+		return Reader.Open(BadName);
+	};
+
+	EXPECT_FALSE(patched(0, 0x4b524f57));													// Magic
+	EXPECT_FALSE(patched(offsetof(TraceFileHeader, Version), MOTION_TRACE_VERSION + 1));
+	EXPECT_FALSE(patched(offsetof(TraceFileHeader, ChannelCount), 1000000));
+	EXPECT_FALSE(patched(offsetof(TraceFileHeader, ChannelCount), 1));						// Blocks hold more columns than the channels
+	EXPECT_FALSE(patched(FirstChannel + offsetof(TraceChannelHeader, Components), 0));
+	EXPECT_FALSE(patched(FirstChannel + offsetof(TraceChannelHeader, Components), 1000000));
+	EXPECT_FALSE(patched(FirstChannel + offsetof(TraceChannelHeader, Components), 0xffffffff));
+	EXPECT_FALSE(patched(FirstBlock + offsetof(TraceBlockHeader, Points), 0));
+	EXPECT_FALSE(patched(FirstBlock + offsetof(TraceBlockHeader, Points), 0xffffffff));		// More points than column bytes
+	EXPECT_FALSE(patched(FirstBlock + offsetof(TraceBlockHeader, Bytes), 0xffffffff));
+	EXPECT_FALSE(patched(FirstBlock + sizeof(TraceBlockHeader), 0xffffff));					// Size of the time column
+
+	// Unchanged it still opens
+	std::vector<uint8_t> Copy = Data;
+	writeFile(BadName, Copy, Copy.size());
+	TraceReader Reader;
+	EXPECT_TRUE(Reader.Open(BadName));
+
+	std::remove(FileName.c_str());
+	std::remove(BadName.c_str());
+}
@@ -0,0 +1,158 @@
+// Noise estimation on a synthetic tracker: stationary periods with known gaussian noise, separated by movement, a short stop and a tracking gap.
+// Only the stationary periods may count, and the pooled standard deviations have to match the noise that was added.
+#include <devicemanipulation/NoiseEstimator.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+using namespace vrmotioncompensation;
+using namespace vrmotioncompensation::driver;
+
+namespace
+{
+	const double Interval = 0.001;
+	const double PositionSigma = 0.0005;
+	const double RotationSigma = 0.001;
+
+	vr::HmdQuaternion_t multiply(const vr::HmdQuaternion_t& a, const vr::HmdQuaternion_t& b)
+	{
+		return {
+			a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+			a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+			a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+			a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+		};
+	}
+
+	class Tracker
+	{
+	public:
+		explicit Tracker(NoiseEstimator& Estimator) : _estimator(Estimator), _noise(0.0, 1.0)
+		{
+		}
+
+		// Poses around Position and Rotation, the rotation noise is a small rotation in device space
+		void Still(uint32_t Poses, const double (&Position)[3], const vr::HmdQuaternion_t& Rotation)
+		{
+			for (uint32_t i = 0; i < Poses; i++)
+			{
+				double Angle[3] = { RotationSigma * _noise(_generator), RotationSigma * _noise(_generator), RotationSigma * _noise(_generator) };
+				vr::HmdQuaternion_t Delta = { 1.0, 0.5 * Angle[0], 0.5 * Angle[1], 0.5 * Angle[2] };
+				double Norm = std::sqrt(Delta.w * Delta.w + Delta.x * Delta.x + Delta.y * Delta.y + Delta.z * Delta.z);
+				Delta = { Delta.w / Norm, Delta.x / Norm, Delta.y / Norm, Delta.z / Norm };
+
+				vr::DriverPose_t Pose = _pose();
+				for (int j = 0; j < 3; j++)
+				{
+					Pose.vecPosition[j] = Position[j] + PositionSigma * _noise(_generator);
+				}
+				Pose.qRotation = multiply(Rotation, Delta);
+				_feed(Pose);
+			}
+		}
+
+		// Every pose lands further from the last one than the stationary radius
+		void Move(uint32_t Poses, double (&Position)[3])
+		{
+			for (uint32_t i = 0; i < Poses; i++)
+			{
+				Position[0] += 0.006;
+				vr::DriverPose_t Pose = _pose();
+				for (int j = 0; j < 3; j++)
+				{
+					Pose.vecPosition[j] = Position[j];
+				}
+				_feed(Pose);
+			}
+		}
+
+		void Pause(double Seconds)
+		{
+			_time += Seconds;
+		}
+
+	private:
+		static vr::DriverPose_t _pose()
+		{
+			vr::DriverPose_t Pose = {};
+			Pose.qRotation = { 1, 0, 0, 0 };
+			Pose.poseIsValid = true;
+			Pose.result = vr::TrackingResult_Running_OK;
+			return Pose;
+		}
+
+		void _feed(const vr::DriverPose_t& Pose)
+		{
+			_estimator.Update(Pose, _time);
+			_time += Interval;
+		}
+
+		NoiseEstimator& _estimator;
+		std::mt19937 _generator{ 7 };
+		std::normal_distribution<double> _noise;
+		double _time = 100.0;
+	};
+}
+
+TEST(NoiseEstimator, PoolsStationaryRunsOnly)
+{
+	NoiseEstimator Estimator;
+	Tracker Device(Estimator);
+	const vr::HmdQuaternion_t Identity = { 1, 0, 0, 0 };
+	const vr::HmdQuaternion_t Tilted = { std::cos(0.25), 0, std::sin(0.25), 0 };
+
+	// A running period counts once it is long enough
+	double First[3] = { 0.1, 1.2, -0.3 };
+	Device.Still(100, First, Identity);
+	NoiseStatistics_OVRMC_v1 Statistics;
+	Estimator.GetStatistics(Statistics);
+	EXPECT_EQ(Statistics.Runs, 1u);
+	EXPECT_EQ(Statistics.Samples, 100u);
+
+	Device.Still(1900, First, Identity);
+
+	// Moving, a stop shorter than MinPoses, moving again
+	double Position[3] = { First[0], First[1], First[2] };
+	Device.Move(100, Position);
+	Position[0] += 0.01;
+	Device.Still(30, Position, Identity);
+	Device.Move(100, Position);
+
+	Position[0] += 0.01;
+	Device.Still(3000, Position, Tilted);
+	Device.Move(10, Position);
+
+	// A tracking gap splits a period even though the device did not move
+	Position[0] += 0.01;
+	Device.Still(1000, Position, Identity);
+	Device.Pause(0.5);
+	Device.Still(1000, Position, Identity);
+
+	Estimator.GetStatistics(Statistics);
+	EXPECT_EQ(Statistics.Runs, 4u);
+	EXPECT_EQ(Statistics.Samples, 7000u);
+	EXPECT_NEAR(Statistics.Seconds, (1999 + 2999 + 999 + 999) * Interval, 1e-6);
+	EXPECT_NEAR(Statistics.MeanInterval, Interval, 1e-9);
+
+	// Pooled around the mean of every period, so the different places and orientations do not add up as noise
+	for (int i = 0; i < 3; i++)
+	{
+		EXPECT_NEAR(Statistics.PositionStdDev[i], PositionSigma, PositionSigma * 0.05) << "axis " << i;
+		EXPECT_NEAR(Statistics.RotationStdDev[i], RotationSigma, RotationSigma * 0.05) << "axis " << i;
+	}
+
+	// White noise over three axes: sqrt(3) sigma at one pose, averaging 2^k poses divides the variance by 2^k
+	EXPECT_NEAR(Statistics.AllanTau[0], Interval, 1e-9);
+	EXPECT_NEAR(Statistics.PositionAllanDeviation[0], PositionSigma * std::sqrt(3.0), PositionSigma * std::sqrt(3.0) * 0.05);
+	EXPECT_NEAR(Statistics.RotationAllanDeviation[0], RotationSigma * std::sqrt(3.0), RotationSigma * std::sqrt(3.0) * 0.05);
+	EXPECT_NEAR(Statistics.PositionAllanDeviation[3], Statistics.PositionAllanDeviation[0] / std::sqrt(8.0), Statistics.PositionAllanDeviation[0] / std::sqrt(8.0) * 0.1);
+	EXPECT_GT(Statistics.AllanPairs[0], Statistics.AllanPairs[1]);
+
+	Estimator.Reset();
+	Estimator.GetStatistics(Statistics);
+	EXPECT_EQ(Statistics.Runs, 0u);
+	EXPECT_EQ(Statistics.Samples, 0u);
+	EXPECT_EQ(Statistics.PositionStdDev[0], 0.0);
+}
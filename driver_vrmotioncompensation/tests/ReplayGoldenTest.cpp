@@ -0,0 +1,285 @@
+// Replays the committed golden trace and compares the compensated HMD poses with the committed golden output.
+// Set VRMC_UPDATE_GOLDEN=1 to regenerate the trace and the output after an intended change of the results.
+// vrmc_tests_float runs the same cases on the single precision core, MatchesGoldenOutput then prints how far it is off the double results.
+#include <devicemanipulation/MotionCompensationManager.h>
+#include <devicemanipulation/MotionGenerator.h>
+#include <devicemanipulation/PoseReplay.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Largest allowed difference of any compared value relative to the largest value of its quantity (at least 1), loosened for the single precision build
+#ifndef VRMC_GOLDEN_TOLERANCE
+#define VRMC_GOLDEN_TOLERANCE 1e-9
+#endif
+
+using namespace vrmotioncompensation;
+using namespace vrmotioncompensation::driver;
+
+namespace
+{
+	const std::string TraceFile = VRMC_TEST_DATA_DIR "/golden_trace.ovrmcposes";
+	const std::string OutputFile = VRMC_TEST_DATA_DIR "/golden_output.csv";
+	const std::string BudgetFile = VRMC_TEST_DATA_DIR "/golden_budget.txt";
+
+	// Values compared per compensated pose, in the column order of the golden output
+	const int ValueCount = 19;
+
+	// Consecutive columns that hold one quantity
+	struct Quantity
+	{
+		const char* Name;
+		int Columns;
+	};
+
+	const Quantity Quantities[] = {
+		{ "Position", 3 },
+		{ "Rotation", 4 },
+		{ "Velocity", 3 },
+		{ "Acceleration", 3 },
+		{ "AngularVelocity", 3 },
+		{ "AngularAcceleration", 3 },
+	};
+	const int QuantityCount = sizeof(Quantities) / sizeof(Quantities[0]);
+
+	int quantityOf(int Column)
+	{
+		int Quantity = 0;
+		for (int First = Quantities[0].Columns; Column >= First; First += Quantities[++Quantity].Columns)
+		{
+		}
+		return Quantity;
+	}
+
+	void poseValues(const vr::DriverPose_t& Pose, double(&Values)[ValueCount])
+	{
+		int i = 0;
+		for (int j = 0; j < 3; j++) Values[i++] = Pose.vecPosition[j];
+		Values[i++] = Pose.qRotation.w;
+		Values[i++] = Pose.qRotation.x;
+		Values[i++] = Pose.qRotation.y;
+		Values[i++] = Pose.qRotation.z;
+		for (int j = 0; j < 3; j++) Values[i++] = Pose.vecVelocity[j];
+		for (int j = 0; j < 3; j++) Values[i++] = Pose.vecAcceleration[j];
+		for (int j = 0; j < 3; j++) Values[i++] = Pose.vecAngularVelocity[j];
+		for (int j = 0; j < 3; j++) Values[i++] = Pose.vecAngularAcceleration[j];
+	}
+
+	// Seated user on a swaying rig with some tracking noise, kept short and at low rates so the trace stays small
+	std::vector<PoseRecord> generateTrace()
+	{
+		MotionGeneratorSettings Settings;
+		Settings.Duration = 2.0;
+		Settings.HmdRate = 250.0;
+		Settings.TrackerRate = 125.0;
+		Settings.SwayRoll = 0.05;
+		Settings.SwayPitch = 0.1;
+		Settings.SwayHeave = 0.05;
+		Settings.SwayFrequency = 0.5;
+		Settings.PositionNoise = 0.0005;
+		Settings.RotationNoise = 0.001;
+		Settings.Seed = 29;
+
+		return MotionGenerator(Settings).Generate().Input;
+	}
+
+	PoseReplay::Statistics replay(PoseReplay& Replay, std::vector<PoseRecord>& Compensated)
+	{
+		MotionCompensationManager Manager(nullptr);
+		Manager.setAlpha(20);
+		Manager.setLpfBeta(0.2);
+		Manager.setAnomalyTriggersFlightRecorder(false);
+
+		std::vector<PoseRecord> Output;
+		PoseReplay::Statistics Stats = Replay.Run(Manager, false, &Output);
+
+		Compensated.clear();
+		for (auto& Entry : Output)
+		{
+			if (Entry.DeviceMode == MotionCompensationDeviceMode::MotionCompensated)
+			{
+				Compensated.push_back(Entry);
+			}
+		}
+
+		return Stats;
+	}
+
+	void writeGolden(const std::vector<PoseRecord>& Compensated)
+	{
+		std::ofstream File(OutputFile, std::ios::trunc);
+		File << "timestamp_ns,px,py,pz,qw,qx,qy,qz,vx,vy,vz,ax,ay,az,wx,wy,wz,awx,awy,awz\n";
+
+		char Line[64];
+		for (auto& Entry : Compensated)
+		{
+			double Values[ValueCount];
+			poseValues(Entry.Pose, Values);
+
+			File << Entry.Timestamp;
+			for (double Value : Values)
+			{
+				std::snprintf(Line, sizeof(Line), ",%.17g", Value);
+				File << Line;
+			}
+			File << "\n";
+		}
+	}
+
+	bool readGolden(std::vector<std::vector<double>>& Rows)
+	{
+		std::ifstream File(OutputFile);
+		std::string Line;
+		if (!std::getline(File, Line))
+		{
+			return false;
+		}
+
+		while (std::getline(File, Line))
+		{
+			std::vector<double> Row;
+			std::stringstream Stream(Line);
+			std::string Cell;
+			while (std::getline(Stream, Cell, ','))
+			{
+				Row.push_back(std::strtod(Cell.c_str(), nullptr));
+			}
+			Rows.push_back(Row);
+		}
+
+		return true;
+	}
+
+	// key=value lines
+	std::map<std::string, double> readBudget()
+	{
+		std::map<std::string, double> Budget;
+		std::ifstream File(BudgetFile);
+		std::string Line;
+		while (std::getline(File, Line))
+		{
+			auto Separator = Line.find('=');
+			if (Line.empty() || Line[0] == '#' || Separator == std::string::npos)
+			{
+				continue;
+			}
+			Budget[Line.substr(0, Separator)] = std::strtod(Line.c_str() + Separator + 1, nullptr);
+		}
+
+		return Budget;
+	}
+}
+
+TEST(ReplayGolden, MatchesGoldenOutput)
+{
+	// Only the double precision build writes the golden files, the single precision build is compared against them
+	const bool Update = std::getenv("VRMC_UPDATE_GOLDEN") && std::is_same<MotionCompensationManager::scalar_t, double>::value;
+	if (Update)
+	{
+		ASSERT_TRUE(PoseReplay::Save(TraceFile, generateTrace()));
+	}
+
+	PoseReplay Replay;
+	ASSERT_TRUE(Replay.Load(TraceFile));
+
+	std::vector<PoseRecord> Compensated;
+	replay(Replay, Compensated);
+	ASSERT_FALSE(Compensated.empty());
+
+	if (Update)
+	{
+		writeGolden(Compensated);
+	}
+
+	std::vector<std::vector<double>> Golden;
+	ASSERT_TRUE(readGolden(Golden));
+	ASSERT_EQ(Golden.size(), Compensated.size());
+
+	// Largest error and largest golden value per quantity, together they tell how far a build is off the golden results
+	double MaxError[QuantityCount] = {};
+	double MaxValue[QuantityCount] = {};
+	for (size_t i = 0; i < Compensated.size(); i++)
+	{
+		ASSERT_EQ(Golden[i].size(), (size_t)ValueCount + 1);
+		ASSERT_EQ((uint64_t)Golden[i][0], Compensated[i].Timestamp);
+
+		double Values[ValueCount];
+		poseValues(Compensated[i].Pose, Values);
+		for (int j = 0; j < ValueCount; j++)
+		{
+			const int Quantity = quantityOf(j);
+			double Error = std::abs(Values[j] - Golden[i][j + 1]);
+			MaxError[Quantity] = std::max(MaxError[Quantity], Error);
+			MaxValue[Quantity] = std::max(MaxValue[Quantity], std::abs(Golden[i][j + 1]));
+		}
+	}
+
+	for (int Quantity = 0; Quantity < QuantityCount; Quantity++)
+	{
+		RecordProperty(std::string("MaxError") + Quantities[Quantity].Name, std::to_string(MaxError[Quantity]));
+		RecordProperty(std::string("MaxValue") + Quantities[Quantity].Name, std::to_string(MaxValue[Quantity]));
+		std::printf("%-20s max error %.3g of max value %.3g\n", Quantities[Quantity].Name, MaxError[Quantity], MaxValue[Quantity]);
+
+		// Relative to the range of the quantity, the derivatives are much larger than the positions
+		EXPECT_LE(MaxError[Quantity], VRMC_GOLDEN_TOLERANCE * std::max(1.0, MaxValue[Quantity])) << Quantities[Quantity].Name;
+	}
+}
+
+TEST(ReplayGolden, IsDeterministic)
+{
+	PoseReplay Replay;
+	ASSERT_TRUE(Replay.Load(TraceFile));
+
+	std::vector<PoseRecord> First;
+	std::vector<PoseRecord> Second;
+	replay(Replay, First);
+	replay(Replay, Second);
+
+	ASSERT_EQ(First.size(), Second.size());
+	for (size_t i = 0; i < First.size(); i++)
+	{
+		double a[ValueCount];
+		double b[ValueCount];
+		poseValues(First[i].Pose, a);
+		poseValues(Second[i].Pose, b);
+		for (int j = 0; j < ValueCount; j++)
+		{
+			ASSERT_EQ(a[j], b[j]) << "pose " << i << " column " << j + 1;
+		}
+	}
+}
+
+TEST(ReplayGolden, StaysWithinTimeBudget)
+{
+	std::map<std::string, double> Budget = readBudget();
+	ASSERT_TRUE(Budget.count("mean_us") && Budget.count("p99_us"));
+
+	PoseReplay Replay;
+	ASSERT_TRUE(Replay.Load(TraceFile));
+
+	// Best of a few runs, so a single preemption of the test process does not fail it
+	PoseReplay::Statistics Best;
+	std::vector<PoseRecord> Compensated;
+	for (int Run = 0; Run < 5; Run++)
+	{
+		PoseReplay::Statistics Stats = replay(Replay, Compensated);
+		if (Run == 0 || Stats.MeanMicroseconds < Best.MeanMicroseconds)
+		{
+			Best = Stats;
+		}
+	}
+
+	RecordProperty("MeanMicroseconds", std::to_string(Best.MeanMicroseconds));
+	RecordProperty("P99Microseconds", std::to_string(Best.P99Microseconds));
+
+	EXPECT_LE(Best.MeanMicroseconds, Budget["mean_us"]);
+	EXPECT_LE(Best.P99Microseconds, Budget["p99_us"]);
+}
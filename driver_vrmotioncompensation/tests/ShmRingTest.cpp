@@ -0,0 +1,163 @@
+// Shared memory ring of the driver ipc: order across wraparounds, a full ring, a second consumer and producers that die or hang
+// between claiming a slot and publishing it. Producer and consumer live in this process, the ring does not tell the difference.
+#include <ipc_shmring.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+
+using namespace vrmotioncompensation;
+
+namespace
+{
+	struct Message
+	{
+		uint64_t Id;
+		uint64_t Payload[3];
+	};
+
+	typedef ipc::ShmRing<Message, 4> Ring;
+
+	// Runs of the tests must not meet in the shared memory namespace
+	std::string ringName()
+	{
+		return std::string("vrmotioncompensation.test.") + ::testing::UnitTest::GetInstance()->current_test_info()->name() + "."
+			+ std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+	}
+
+	Message message(uint64_t Id)
+	{
+		Message Result = { Id, { Id * 3, Id * 5, Id * 7 } };
+		return Result;
+	}
+
+	void expectMessage(const Message& Value, uint64_t Id)
+	{
+		EXPECT_EQ(Value.Id, Id);
+		EXPECT_EQ(Value.Payload[0], Id * 3);
+		EXPECT_EQ(Value.Payload[1], Id * 5);
+		EXPECT_EQ(Value.Payload[2], Id * 7);
+	}
+}
+
+TEST(ShmRing, KeepsOrderAcrossWraparounds)
+{
+	const std::string Name = ringName();
+	Ring Consumer(boost::interprocess::create_only, Name);
+	Ring Producer(boost::interprocess::open_only, Name);
+
+	const uint64_t Count = 1000;
+	std::thread Sender([&]()
+	{
+		for (uint64_t i = 0; i < Count; i++)
+		{
+			ASSERT_TRUE(Producer.Push(message(i), 1000));
+		}
+	});
+
+	Message Value;
+	for (uint64_t i = 0; i < Count; i++)
+	{
+		ASSERT_TRUE(Consumer.Pop(Value, 1000));
+		expectMessage(Value, i);
+	}
+	Sender.join();
+
+	EXPECT_FALSE(Consumer.TryPop(Value));
+	EXPECT_EQ(Consumer.SkippedSlots(), 0u);
+	EXPECT_EQ(Consumer.CorruptSlots(), 0u);
+}
+
+TEST(ShmRing, RefusesMessagesWhileFull)
+{
+	const std::string Name = ringName();
+	Ring Consumer(boost::interprocess::create_only, Name);
+	Ring Producer(boost::interprocess::open_only, Name);
+
+	for (uint64_t i = 0; i < 4; i++)
+	{
+		ASSERT_TRUE(Producer.Push(message(i), 0));
+	}
+	EXPECT_FALSE(Producer.TryEmplace([](Message& Value) { Value = message(4); }));
+	EXPECT_FALSE(Producer.Push(message(4), 10));
+
+	Message Value;
+	ASSERT_TRUE(Consumer.TryPop(Value));
+	expectMessage(Value, 0);
+	ASSERT_TRUE(Producer.Push(message(4), 0));
+
+	for (uint64_t i = 1; i <= 4; i++)
+	{
+		ASSERT_TRUE(Consumer.TryPop(Value));
+		expectMessage(Value, i);
+	}
+	EXPECT_FALSE(Consumer.Pop(Value, 10));
+}
+
+TEST(ShmRing, RefusesSecondConsumer)
+{
+	const std::string Name = ringName();
+	{
+		Ring Consumer(boost::interprocess::create_only, Name);
+		EXPECT_THROW(Ring(boost::interprocess::create_only, Name), std::runtime_error);
+	}
+
+	// Free again once the first consumer is gone
+	Ring Consumer(boost::interprocess::create_only, Name);
+	Ring Producer(boost::interprocess::open_only, Name);
+	EXPECT_TRUE(Producer.Push(message(1), 0));
+}
+
+TEST(ShmRing, SkipsSlotOfHangingProducer)
+{
+	const std::string Name = ringName();
+	Ring Consumer(boost::interprocess::create_only, Name);
+	Ring Producer(boost::interprocess::open_only, Name);
+
+	// Claims slot 0 and hangs before publishing it
+	std::promise<void> Claimed;
+	std::promise<void> Release;
+	std::future<bool> Hanging = std::async(std::launch::async, [&]()
+	{
+		return Producer.TryEmplace([&](Message& Value)
+		{
+			Claimed.set_value();
+			Release.get_future().wait();
+			Value = message(99);
+		});
+	});
+	Claimed.get_future().wait();
+	ASSERT_TRUE(Producer.Push(message(1), 0));
+
+	auto Start = std::chrono::steady_clock::now();
+	Message Value;
+	ASSERT_TRUE(Consumer.Pop(Value, 5000));
+	expectMessage(Value, 1);
+	EXPECT_GE(std::chrono::steady_clock::now() - Start, std::chrono::milliseconds(SHMRING_STUCK_SLOT_MS));
+	EXPECT_EQ(Consumer.SkippedSlots(), 1u);
+
+	// The next lap publishes slot 0 again before the hanging producer wakes up and writes its message over it
+	for (uint64_t i = 2; i <= 4; i++)
+	{
+		ASSERT_TRUE(Producer.Push(message(i), 0));
+	}
+	Release.set_value();
+	EXPECT_FALSE(Hanging.get());
+
+	for (uint64_t i = 2; i <= 3; i++)
+	{
+		ASSERT_TRUE(Consumer.TryPop(Value));
+		expectMessage(Value, i);
+	}
+	EXPECT_FALSE(Consumer.TryPop(Value));
+	EXPECT_EQ(Consumer.CorruptSlots(), 1u);
+
+	// The ring keeps working after the dropped message
+	ASSERT_TRUE(Producer.Push(message(5), 0));
+	ASSERT_TRUE(Consumer.TryPop(Value));
+	expectMessage(Value, 5);
+}
@@ -0,0 +1,16 @@
+#include <logging.h>
+
+#include <gtest/gtest.h>
+
+INITIALIZE_EASYLOGGINGPP
+
+int main(int argc, char** argv)
+{
+	el::Configurations Conf;
+	Conf.setToDefault();
+	Conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureAllLoggers(Conf);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
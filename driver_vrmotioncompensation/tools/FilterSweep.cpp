@@ -0,0 +1,151 @@
+// Scores LPFBeta / Samples settings on a generated swaying rig and prints one CSV line per setting.
+//   vrmc_filtersweep [--random <count>] [--seed <n>] [--beta <min> <max>] [--beta-steps <n>] [--samples <min> <max>] [--samples-step <n>]
+//                    [--duration <s>] [--noise <m>] [--threads <n>] [--ini <file>]
+// Without --random the settings form a grid. The pareto column marks the settings no other setting beats in jitter, lag and residual error,
+// --ini writes the one of them with the lowest residual error in the format of the overlay's settings file.
+#include <devicemanipulation/FilterEvaluation.h>
+#include <devicemanipulation/MotionGenerator.h>
+#include <logging.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace vrmotioncompensation::driver;
+
+static int usage()
+{
+	std::fprintf(stderr, "usage: vrmc_filtersweep [--random <count>] [--seed <n>] [--beta <min> <max>] [--beta-steps <n>] [--samples <min> <max>] [--samples-step <n>]\n"
+		"                        [--duration <s>] [--noise <m>] [--threads <n>] [--ini <file>]\n");
+	return 2;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned RandomCount = 0;
+	uint32_t Seed = 1;
+	double BetaMin = 0.05;
+	double BetaMax = 1.0;
+	unsigned BetaSteps = 20;
+	uint32_t SamplesMin = 2;
+	uint32_t SamplesMax = 100;
+	uint32_t SamplesStep = 5;
+	double Duration = 10.0;
+	double Noise = 0.0005;
+	unsigned Threads = 0;
+	std::string IniFile;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--random") == 0 && i + 1 < argc)
+		{
+			RandomCount = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			Seed = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--beta") == 0 && i + 2 < argc)
+		{
+			BetaMin = std::strtod(argv[++i], nullptr);
+			BetaMax = std::strtod(argv[++i], nullptr);
+		}
+		else if (std::strcmp(argv[i], "--beta-steps") == 0 && i + 1 < argc)
+		{
+			BetaSteps = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--samples") == 0 && i + 2 < argc)
+		{
+			SamplesMin = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			SamplesMax = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--samples-step") == 0 && i + 1 < argc)
+		{
+			SamplesStep = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc)
+		{
+			Duration = std::strtod(argv[++i], nullptr);
+		}
+		else if (std::strcmp(argv[i], "--noise") == 0 && i + 1 < argc)
+		{
+			Noise = std::strtod(argv[++i], nullptr);
+		}
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			Threads = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--ini") == 0 && i + 1 < argc)
+		{
+			IniFile = argv[++i];
+		}
+		else
+		{
+			return usage();
+		}
+	}
+
+	// The filters need at least two samples, LPFBeta 1 bypasses the rotation filter
+	if (BetaMin <= 0.0 || BetaMax > 1.0 || BetaMin > BetaMax || SamplesMin < 2 || SamplesMin > SamplesMax || Duration <= 1.0)
+	{
+		return usage();
+	}
+
+	el::Loggers::reconfigureAllLoggers(el::ConfigurationType::ToStandardOutput, "false");
+
+	MotionGeneratorSettings Motion;
+	Motion.Duration = Duration;
+	Motion.SwayRoll = 0.05;
+	Motion.SwayPitch = 0.1;
+	Motion.SwayHeave = 0.05;
+	Motion.SwayFrequency = 0.5;
+	Motion.PositionNoise = Noise;
+	Motion.RotationNoise = 2.0 * Noise;
+	Motion.Seed = Seed;
+	GeneratedMotion Generated = MotionGenerator(Motion).Generate();
+
+	std::vector<FilterSettings> Settings = RandomCount > 0
+		? FilterEvaluation::Random(BetaMin, BetaMax, SamplesMin, SamplesMax, RandomCount, Seed)
+		: FilterEvaluation::Grid(BetaMin, BetaMax, BetaSteps, SamplesMin, SamplesMax, SamplesStep);
+
+	FilterEvaluation Evaluation(Generated.Input, Generated.GroundTruth);
+	std::vector<FilterScore> Scores = Evaluation.Evaluate(Settings, Threads);
+	std::vector<FilterScore> Front = FilterEvaluation::ParetoFront(Scores);
+
+	auto OnFront = [&Front](const FilterScore& Score)
+	{
+		return std::any_of(Front.begin(), Front.end(), [&Score](const FilterScore& Other)
+		{
+			return Other.Settings.LPFBeta == Score.Settings.LPFBeta && Other.Settings.Samples == Score.Settings.Samples;
+		});
+	};
+
+	std::printf("beta,samples,jitter_m,lag_s,residual_m,pareto\n");
+	for (auto& Score : Scores)
+	{
+		std::printf("%.4f,%u,%.9g,%.6f,%.9g,%d\n", Score.Settings.LPFBeta, Score.Settings.Samples, Score.Jitter, Score.Lag, Score.ResidualError, OnFront(Score) ? 1 : 0);
+	}
+
+	if (!IniFile.empty() && !Front.empty())
+	{
+		auto Best = std::min_element(Front.begin(), Front.end(), [](const FilterScore& a, const FilterScore& b)
+		{
+			return a.ResidualError < b.ResidualError;
+		});
+
+		std::ofstream File(IniFile, std::ios::trunc);
+		File << FilterEvaluation::ToSettingsIni(Best->Settings);
+		if (!File)
+		{
+			std::fprintf(stderr, "could not write %s\n", IniFile.c_str());
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,247 @@
+// Stands in for the SteamVR host: calls the device and pose hooks of the ServerDriver from several threads while the
+// compensation mode is switched concurrently, like the ipc thread does it.
+//   vrmc_hookharness [--threads <n>] [--rate <calls per second>] [--seconds <s>] [--devices <n>] [--mode-interval <ms>]
+// --rate is the pose rate of all threads together, --mode-interval 0 disables the mode changes. Throughput and the latency of hooksTrackedDevicePoseUpdated are printed as key=value lines.
+#include <driver/ServerDriver.h>
+#include <devicemanipulation/DeviceManipulationHandle.h>
+#include <hooks/InterfaceHooks.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+INITIALIZE_EASYLOGGINGPP
+
+// No MinHook outside of SteamVR, the harness calls the hook entry points itself
+namespace vrmotioncompensation
+{
+	namespace driver
+	{
+		ServerDriver* InterfaceHooks::serverDriver = nullptr;
+
+		bool InterfaceHooks::initialize()
+		{
+			return true;
+		}
+
+		void InterfaceHooks::shutdown()
+		{
+		}
+
+		std::shared_ptr<InterfaceHooks> InterfaceHooks::hookInterface(void*, std::string)
+		{
+			return nullptr;
+		}
+	}
+}
+
+using namespace vrmotioncompensation;
+using namespace vrmotioncompensation::driver;
+
+// Same as IVRServerDriverHost006Hooks passes in
+#define HARNESS_HOST_VERSION 6
+
+static int usage()
+{
+	std::fprintf(stderr, "usage: vrmc_hookharness [--threads <n>] [--rate <calls per second>] [--seconds <s>] [--devices <n>] [--mode-interval <ms>]\n");
+	return 2;
+}
+
+static vr::DriverPose_t makePose(uint32_t OpenVRId, double Time)
+{
+	vr::DriverPose_t Pose;
+	std::memset(&Pose, 0, sizeof(vr::DriverPose_t));
+	Pose.poseIsValid = true;
+	Pose.deviceIsConnected = true;
+	Pose.result = vr::TrackingResult_Running_OK;
+	Pose.qWorldFromDriverRotation.w = 1.0;
+	Pose.qDriverFromHeadRotation.w = 1.0;
+
+	double Angle = 0.1 * std::sin(2.0 * 3.14159265358979 * 0.5 * Time);
+	Pose.qRotation.w = std::cos(Angle / 2.0);
+	Pose.qRotation.x = std::sin(Angle / 2.0);
+	Pose.vecPosition[0] = 0.1 * OpenVRId;
+	Pose.vecPosition[1] = 1.0 + 0.05 * std::sin(2.0 * 3.14159265358979 * 0.5 * Time);
+	return Pose;
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t Threads = 4;
+	double Rate = 6000.0;
+	double Seconds = 5.0;
+	uint32_t Devices = 8;
+	uint32_t ModeIntervalMs = 10;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			Threads = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+		{
+			Rate = std::strtod(argv[++i], nullptr);
+		}
+		else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+		{
+			Seconds = std::strtod(argv[++i], nullptr);
+		}
+		else if (std::strcmp(argv[i], "--devices") == 0 && i + 1 < argc)
+		{
+			Devices = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--mode-interval") == 0 && i + 1 < argc)
+		{
+			ModeIntervalMs = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else
+		{
+			return usage();
+		}
+	}
+
+	if (Threads == 0 || Rate <= 0.0 || Seconds <= 0.0 || Devices < 2 || Devices > vr::k_unMaxTrackedDeviceCount)
+	{
+		return usage();
+	}
+
+	el::Loggers::reconfigureAllLoggers(el::ConfigurationType::ToStandardOutput, "false");
+
+	// Like ServerDriver::Init, the hooks must not log on their own thread
+	AsyncLogger::instance().Start();
+	ServerDriver Driver;
+
+	// The addresses only serve as the ITrackedDeviceServerDriver keys of the handle map
+	std::vector<char> DeviceDrivers(Devices);
+	std::atomic<uint32_t> Activated(0);
+	std::atomic<bool> Running(true);
+	std::vector<std::vector<double>> Latencies(Threads);
+
+	auto Worker = [&](uint32_t Thread)
+	{
+		// Every thread adds and activates its share of the devices, then reports poses for them
+		std::vector<uint32_t> Own;
+		for (uint32_t Id = Thread; Id < Devices; Id += Threads)
+		{
+			std::string Serial = "HARNESS-" + std::to_string(Id);
+			vr::ETrackedDeviceClass Class = Id == 0 ? vr::TrackedDeviceClass_HMD : vr::TrackedDeviceClass_GenericTracker;
+			Driver.hooksTrackedDeviceAdded(nullptr, HARNESS_HOST_VERSION, Serial.c_str(), Class, &DeviceDrivers[Id]);
+			Driver.hooksTrackedDeviceActivated(&DeviceDrivers[Id], HARNESS_HOST_VERSION, Id);
+			Own.push_back(Id);
+			Activated++;
+		}
+
+		if (Own.empty())
+		{
+			return;
+		}
+
+		std::vector<double>& Samples = Latencies[Thread];
+		Samples.reserve((size_t)(Rate / Threads * Seconds * 1.1) + 16);
+
+		auto Period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(Threads / Rate));
+		auto Start = std::chrono::steady_clock::now();
+		auto Next = Start;
+		for (size_t Call = 0; Running.load(std::memory_order_relaxed); Call++)
+		{
+			uint32_t Id = Own[Call % Own.size()];
+			double Time = std::chrono::duration<double>(Next - Start).count();
+			vr::DriverPose_t Pose = makePose(Id, Time);
+			uint32_t PoseSize = sizeof(vr::DriverPose_t);
+
+			auto Before = std::chrono::steady_clock::now();
+			Driver.hooksTrackedDevicePoseUpdated(nullptr, HARNESS_HOST_VERSION, Id, Pose, PoseSize);
+			Samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Before).count());
+
+			Next += Period;
+			std::this_thread::sleep_until(Next);
+		}
+	};
+
+	auto Begin = std::chrono::steady_clock::now();
+	std::vector<std::thread> Workers;
+	for (uint32_t i = 0; i < Threads; i++)
+	{
+		Workers.emplace_back(Worker, i);
+	}
+
+	// Mode changes the way the ipc thread applies them, the compensated device moves around and compensation is switched off now and then
+	uint64_t ModeChanges = 0;
+	auto End = Begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(Seconds));
+	while (true)
+	{
+		// An interval of 0 runs without mode changes
+		auto Wake = ModeIntervalMs > 0 ? std::min(End, std::chrono::steady_clock::now() + std::chrono::milliseconds(ModeIntervalMs)) : End;
+		std::this_thread::sleep_until(Wake);
+		if (Wake >= End)
+		{
+			break;
+		}
+		if (Activated.load() < Devices)
+		{
+			continue;
+		}
+
+		uint32_t MCdeviceID = 1 + (uint32_t)(ModeChanges % (Devices - 1));
+		uint32_t RTdeviceID = MCdeviceID == Devices - 1 ? 1 : MCdeviceID + 1;
+		DeviceManipulationHandle* MCdevice = Driver.getDeviceManipulationHandleById(MCdeviceID);
+		DeviceManipulationHandle* RTdevice = Driver.getDeviceManipulationHandleById(RTdeviceID);
+		for (uint32_t Id = 0; Id < Devices; Id++)
+		{
+			Driver.getDeviceManipulationHandleById(Id)->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::Default);
+		}
+		if (ModeChanges % 4 == 3)
+		{
+			Driver.motionCompensation().setMotionCompensationMode(MotionCompensationMode::Disabled, -1, -1);
+		}
+		else
+		{
+			MCdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::MotionCompensated);
+			RTdevice->setMotionCompensationDeviceMode(MotionCompensationDeviceMode::ReferenceTracker);
+			Driver.motionCompensation().setMotionCompensationMode(MotionCompensationMode::ReferenceTracker, MCdeviceID, RTdeviceID);
+		}
+		Driver.publishDeviceStates();
+		ModeChanges++;
+	}
+
+	Running = false;
+	for (auto& Thread : Workers)
+	{
+		Thread.join();
+	}
+	double Elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - Begin).count();
+	AsyncLogger::instance().Stop();
+
+	std::vector<double> All;
+	for (auto& Samples : Latencies)
+	{
+		All.insert(All.end(), Samples.begin(), Samples.end());
+	}
+	std::sort(All.begin(), All.end());
+
+	auto Percentile = [&All](double P)
+	{
+		return All.empty() ? 0.0 : All[std::min(All.size() - 1, (size_t)(P * All.size()))];
+	};
+
+	std::printf("threads=%u\n", Threads);
+	std::printf("devices=%u\n", Devices);
+	std::printf("calls=%llu\n", (unsigned long long)All.size());
+	std::printf("seconds=%.6f\n", Elapsed);
+	std::printf("calls_per_second=%.0f\n", Elapsed > 0.0 ? (double)All.size() / Elapsed : 0.0);
+	std::printf("mode_changes=%llu\n", (unsigned long long)ModeChanges);
+	std::printf("p50_us=%.3f\n", Percentile(0.5));
+	std::printf("p99_us=%.3f\n", Percentile(0.99));
+	std::printf("p999_us=%.3f\n", Percentile(0.999));
+	std::printf("max_us=%.3f\n", All.empty() ? 0.0 : All.back());
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+// Replays a pose recording through the motion compensation and writes the compensated poses.
+//   vrmc_replay <recording> [<output>] [--realtime] [--samples <n>] [--beta <b>]
+// Without --realtime the poses are fed as fast as possible. The timing statistics are printed as key=value lines.
+#include <devicemanipulation/MotionCompensationManager.h>
+#include <devicemanipulation/PoseReplay.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace vrmotioncompensation::driver;
+
+static int usage()
+{
+	std::fprintf(stderr, "usage: vrmc_replay <recording> [<output>] [--realtime] [--samples <n>] [--beta <b>]\n");
+	return 2;
+}
+
+int main(int argc, char** argv)
+{
+	std::string Input;
+	std::string Output;
+	bool RealTime = false;
+	uint32_t Samples = 100;
+	double Beta = 0.2;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--realtime") == 0)
+		{
+			RealTime = true;
+		}
+		else if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+		{
+			Samples = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--beta") == 0 && i + 1 < argc)
+		{
+			Beta = std::strtod(argv[++i], nullptr);
+		}
+		else if (argv[i][0] == '-')
+		{
+			return usage();
+		}
+		else if (Input.empty())
+		{
+			Input = argv[i];
+		}
+		else if (Output.empty())
+		{
+			Output = argv[i];
+		}
+		else
+		{
+			return usage();
+		}
+	}
+
+	if (Input.empty())
+	{
+		return usage();
+	}
+
+	el::Loggers::reconfigureAllLoggers(el::ConfigurationType::ToStandardOutput, "false");
+
+	PoseReplay Replay;
+	if (!Replay.Load(Input))
+	{
+		std::fprintf(stderr, "could not load %s\n", Input.c_str());
+		return 1;
+	}
+
+	MotionCompensationManager Manager(nullptr);
+	Manager.setAlpha(Samples);
+	Manager.setLpfBeta(Beta);
+
+	std::vector<PoseRecord> Compensated;
+	PoseReplay::Statistics Stats = Replay.Run(Manager, RealTime, Output.empty() ? nullptr : &Compensated);
+
+	if (!Output.empty() && !PoseReplay::Save(Output, Compensated))
+	{
+		std::fprintf(stderr, "could not write %s\n", Output.c_str());
+		return 1;
+	}
+
+	std::printf("poses=%llu\n", (unsigned long long)Stats.Poses);
+	std::printf("seconds=%.6f\n", Stats.Seconds);
+	std::printf("mean_us=%.3f\n", Stats.MeanMicroseconds);
+	std::printf("p99_us=%.3f\n", Stats.P99Microseconds);
+	std::printf("max_us=%.3f\n", Stats.MaxMicroseconds);
+	std::printf("poses_per_second=%.0f\n", Stats.Seconds > 0.0 ? (double)Stats.Poses / Stats.Seconds : 0.0);
+
+	return 0;
+}
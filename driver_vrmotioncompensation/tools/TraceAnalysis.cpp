@@ -0,0 +1,108 @@
+// Prints the statistics of a motion trace (MotionData.ovrmctrace), the text to attach to a bug report.
+//   vrmc_traceanalysis <trace> [<summary>] [--window <s>] [--threshold <x>] [--spectrum <points>] [--max-lag <s>] [--correlate <reference> <target>]...
+// Without <summary> the report goes to stdout. Every --correlate replaces the default channel pairs of the lag estimation.
+#include <motionanalysis.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace vrmotioncompensation::trace;
+
+static int usage()
+{
+	std::fprintf(stderr, "usage: vrmc_traceanalysis <trace> [<summary>] [--window <s>] [--threshold <x>] [--spectrum <points>] [--max-lag <s>] [--correlate <reference> <target>]...\n");
+	return 2;
+}
+
+int main(int argc, char** argv)
+{
+	std::string Input;
+	std::string Output;
+	AnalysisSettings Settings;
+	bool DefaultCorrelations = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--window") == 0 && i + 1 < argc)
+		{
+			Settings.StationaryWindow = std::strtod(argv[++i], nullptr);
+		}
+		else if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+		{
+			Settings.StationaryThreshold = std::strtod(argv[++i], nullptr);
+		}
+		else if (std::strcmp(argv[i], "--spectrum") == 0 && i + 1 < argc)
+		{
+			Settings.SpectrumSize = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--max-lag") == 0 && i + 1 < argc)
+		{
+			Settings.MaxLag = std::strtod(argv[++i], nullptr);
+		}
+		else if (std::strcmp(argv[i], "--correlate") == 0 && i + 2 < argc)
+		{
+			if (DefaultCorrelations)
+			{
+				Settings.Correlations.clear();
+				DefaultCorrelations = false;
+			}
+			Settings.Correlations.push_back({ argv[i + 1], argv[i + 2] });
+			i += 2;
+		}
+		else if (argv[i][0] == '-')
+		{
+			return usage();
+		}
+		else if (Input.empty())
+		{
+			Input = argv[i];
+		}
+		else if (Output.empty())
+		{
+			Output = argv[i];
+		}
+		else
+		{
+			return usage();
+		}
+	}
+
+	if (Input.empty() || Settings.StationaryWindow <= 0.0 || Settings.MaxLag <= 0.0)
+	{
+		return usage();
+	}
+
+	TraceReader Reader;
+	if (!Reader.Open(Input))
+	{
+		std::fprintf(stderr, "could not open %s\n", Input.c_str());
+		return 1;
+	}
+
+	TraceAnalysis Analysis;
+	if (!TraceAnalyzer(Settings).Analyze(Reader, Analysis))
+	{
+		std::fprintf(stderr, "could not read %s\n", Input.c_str());
+		return 1;
+	}
+
+	if (Output.empty())
+	{
+		Analysis.WriteSummary(std::cout);
+		return 0;
+	}
+
+	std::ofstream File(Output, std::ios::trunc);
+	Analysis.WriteSummary(File);
+	if (!File)
+	{
+		std::fprintf(stderr, "could not write %s\n", Output.c_str());
+		return 1;
+	}
+
+	return 0;
+}
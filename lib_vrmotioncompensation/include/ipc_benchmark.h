@@ -0,0 +1,215 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/interprocess/ipc/message_queue.hpp>
+
+#include "ipc_protocol.h"
+
+
+// Round trip times of the ipc transport against the boost::interprocess::message_queue it replaced.
+// An echo thread answers every ipc::Request with an ipc::Reply, the same message sizes and queue setup the driver and the client use.
+// Both transports go through named shared memory, so the numbers also hold between processes up to scheduling.
+// RunShmRing(InFlight) keeps several requests outstanding like the asynchronous client calls, RequestsPerSecond shows what pipelining gains.
+namespace vrmotioncompensation
+{
+	namespace ipc
+	{
+		struct TransportBenchmarkResult
+		{
+			uint32_t RoundTrips = 0;
+			double RequestsPerSecond = 0.0;
+			double Mean = 0.0;			// Microseconds
+			double P50 = 0.0;
+			double P99 = 0.0;
+			double Max = 0.0;
+		};
+
+		class TransportBenchmark
+		{
+		public:
+			// PauseUs between round trips lets the receiver go to sleep like it does between overlay requests
+			TransportBenchmark(uint32_t RoundTrips = 10000, uint32_t PauseUs = 0) : _roundTrips(RoundTrips), _pauseUs(PauseUs)
+			{
+			}
+
+			// InFlight is limited to the reply ring, more would let the echo thread and the sender wait on each other.
+			// Throws when a message could not be sent or no reply came back within IPC_SEND_TIMEOUT_MS.
+			TransportBenchmarkResult RunShmRing(uint32_t InFlight = 1)
+			{
+				InFlight = std::max<uint32_t>(1, std::min<uint32_t>(InFlight, 64));
+
+				ServerRing Requests(boost::interprocess::create_only, "vrmotioncompensation.benchmark_requests");
+				ClientRing Replies(boost::interprocess::create_only, "vrmotioncompensation.benchmark_replies");
+				ServerRing RequestSender(boost::interprocess::open_only, "vrmotioncompensation.benchmark_requests");
+				ClientRing ReplySender(boost::interprocess::open_only, "vrmotioncompensation.benchmark_replies");
+
+				// Set by whichever side fails first, the other one stops instead of waiting for messages that never come
+				std::atomic<bool> Failed = { false };
+				std::thread Echo([&]()
+				{
+					Request Message;
+					for (uint32_t i = 0; i < _roundTrips && !Failed.load(std::memory_order_relaxed); )
+					{
+						if (Requests.Pop(Message, 50))
+						{
+							bool Sent = ReplySender.Emplace([&Message](Reply& Answer)
+							{
+								Answer.type = ReplyType::IPC_Ping;
+								Answer.messageId = Message.msg.ipc_Ping.messageId;
+								Answer.status = ReplyStatus::Ok;
+								Answer.msg.ipc_Ping.nonce = Message.msg.ipc_Ping.nonce;
+							}, IPC_SEND_TIMEOUT_MS);
+							if (!Sent)
+							{
+								Failed.store(true, std::memory_order_relaxed);
+								break;
+							}
+							i++;
+						}
+					}
+				});
+
+				std::vector<double> Times;
+				std::vector<std::chrono::steady_clock::time_point> SendTimes(_roundTrips);
+				Reply Answer;
+				uint32_t Sent = 0;
+				auto Begin = std::chrono::steady_clock::now();
+				for (uint32_t Received = 0; Received < _roundTrips && !Failed.load(std::memory_order_relaxed); Received++)
+				{
+					while (Sent < _roundTrips && Sent - Received < InFlight)
+					{
+						_pause();
+						uint32_t Id = Sent++;
+						SendTimes[Id] = std::chrono::steady_clock::now();
+						bool Queued = RequestSender.Emplace([Id](Request& Message)
+						{
+							Message.type = RequestType::IPC_Ping;
+							Message.msg.ipc_Ping.messageId = Id;
+							Message.msg.ipc_Ping.nonce = Id;
+						}, IPC_SEND_TIMEOUT_MS);
+						if (!Queued)
+						{
+							Failed.store(true, std::memory_order_relaxed);
+							break;
+						}
+					}
+					if (Failed.load(std::memory_order_relaxed) || !Replies.Pop(Answer, IPC_SEND_TIMEOUT_MS) || Answer.messageId >= _roundTrips)
+					{
+						Failed.store(true, std::memory_order_relaxed);
+						break;
+					}
+					Times.push_back(_elapsed(SendTimes[Answer.messageId]));
+				}
+				double Seconds = _elapsed(Begin) / 1e6;
+				Echo.join();
+
+				if (Failed.load(std::memory_order_relaxed))
+				{
+					throw std::runtime_error("Shared memory ring benchmark lost a message after " + std::to_string(Times.size()) + " round trips");
+				}
+
+				return _summarize(Times, Seconds);
+			}
+
+			TransportBenchmarkResult RunMessageQueue()
+			{
+				boost::interprocess::message_queue::remove("vrmotioncompensation.benchmark_requests_mq");
+				boost::interprocess::message_queue::remove("vrmotioncompensation.benchmark_replies_mq");
+				boost::interprocess::message_queue Requests(boost::interprocess::create_only, "vrmotioncompensation.benchmark_requests_mq", 100, sizeof(Request));
+				boost::interprocess::message_queue Replies(boost::interprocess::create_only, "vrmotioncompensation.benchmark_replies_mq", 100, sizeof(Reply));
+
+				std::thread Echo([&]()
+				{
+					Request Message;
+					uint64_t Size;
+					unsigned Priority;
+					for (uint32_t i = 0; i < _roundTrips; )
+					{
+						boost::posix_time::ptime Timeout = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(50);
+						if (Requests.timed_receive(&Message, sizeof(Request), Size, Priority, Timeout))
+						{
+							Reply Answer(ReplyType::IPC_Ping);
+							Answer.messageId = Message.msg.ipc_Ping.messageId;
+							Answer.status = ReplyStatus::Ok;
+							Answer.msg.ipc_Ping.nonce = Message.msg.ipc_Ping.nonce;
+							Replies.send(&Answer, sizeof(Reply), 0);
+							i++;
+						}
+					}
+				});
+
+				std::vector<double> Times;
+				auto Begin = std::chrono::steady_clock::now();
+				Request Message(RequestType::IPC_Ping);
+				Reply Answer;
+				uint64_t Size;
+				unsigned Priority;
+				for (uint32_t i = 0; i < _roundTrips; i++)
+				{
+					_pause();
+					auto Start = std::chrono::steady_clock::now();
+					Message.msg.ipc_Ping.messageId = i;
+					Message.msg.ipc_Ping.nonce = i;
+					Requests.send(&Message, sizeof(Request), 0);
+					Replies.receive(&Answer, sizeof(Reply), Size, Priority);
+					Times.push_back(_elapsed(Start));
+				}
+				double Seconds = _elapsed(Begin) / 1e6;
+				Echo.join();
+
+				boost::interprocess::message_queue::remove("vrmotioncompensation.benchmark_requests_mq");
+				boost::interprocess::message_queue::remove("vrmotioncompensation.benchmark_replies_mq");
+				return _summarize(Times, Seconds);
+			}
+
+		private:
+			void _pause()
+			{
+				if (_pauseUs > 0)
+				{
+					std::this_thread::sleep_for(std::chrono::microseconds(_pauseUs));
+				}
+			}
+
+			static double _elapsed(std::chrono::steady_clock::time_point Start)
+			{
+				return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+			}
+
+			static TransportBenchmarkResult _summarize(std::vector<double>& Times, double Seconds)
+			{
+				TransportBenchmarkResult Result;
+				if (Times.empty())
+				{
+					return Result;
+				}
+
+				std::sort(Times.begin(), Times.end());
+				double Sum = 0.0;
+				for (double Time : Times)
+				{
+					Sum += Time;
+				}
+				Result.RoundTrips = (uint32_t)Times.size();
+				Result.RequestsPerSecond = Seconds > 0.0 ? (double)Times.size() / Seconds : 0.0;
+				Result.Mean = Sum / (double)Times.size();
+				Result.P50 = Times[Times.size() / 2];
+				Result.P99 = Times[std::min(Times.size() - 1, Times.size() * 99 / 100)];
+				Result.Max = Times.back();
+				return Result;
+			}
+
+			uint32_t _roundTrips;
+			uint32_t _pauseUs;
+		};
+	}
+}
\ No newline at end of file
@@ -1,10 +1,17 @@
 #pragma once
 
 #include "vrmotioncompensation_types.h"
+#include "ipc_shmring.h"
 #include <utility>
 
 
-#define IPC_PROTOCOL_VERSION 3
+#define IPC_PROTOCOL_VERSION 14
+
+// How long a sender waits for room in a full ring
+#define IPC_SEND_TIMEOUT_MS 1000
+
+// How long a client waits for the reply to a request
+#define IPC_REPLY_TIMEOUT_MS 2000
 
 namespace vrmotioncompensation
 {
@@ -24,6 +31,13 @@ namespace vrmotioncompensation
 			DeviceManipulation_ResetRefZeroPose,
 			DeviceManipulation_SetOffsets,
 			DebugLogger_Settings,
+			PoseRecorder_Settings,
+			DriverCounters_Get,
+			FlightRecorder_Dump,
+			Tracing_Control,
+			Telemetry_Get,
+			NoiseStatistics_Get,
+			Events_Subscribe,
 		};
 
 		enum class ReplyType : uint32_t
@@ -32,7 +46,11 @@ namespace vrmotioncompensation
 			IPC_ClientConnect,
 			IPC_Ping,
 			GenericReply,
-			DeviceManipulation_GetDeviceInfo
+			DeviceManipulation_GetDeviceInfo,
+			DriverCounters,
+			Telemetry,
+			NoiseStatistics,
+			Event
 		};
 
 		enum class ReplyStatus : uint32_t
@@ -124,6 +142,44 @@ namespace vrmotioncompensation
 			bool enabled;
 		};
 
+		struct Request_PoseRecorder_Settings
+		{
+			uint32_t clientId;
+			uint32_t messageId;			// Used to associate with Reply
+			bool enabled;
+			char fileName[128];			// Empty for the default file name
+		};
+
+		struct Request_FlightRecorder_Dump
+		{
+			uint32_t clientId;
+			uint32_t messageId;			// Used to associate with Reply
+			char fileName[128];			// Empty for FlightRecorder_<unix time>.bin
+		};
+
+		struct Request_Tracing_Control
+		{
+			uint32_t clientId;
+			uint32_t messageId;			// Used to associate with Reply
+			bool enabled;				// Stopping writes the trace file
+			char fileName[128];			// Empty for driver_trace.json
+		};
+
+		struct Request_NoiseStatistics_Get
+		{
+			uint32_t clientId;
+			uint32_t messageId;			// Used to associate with Reply
+			uint32_t OpenVRId;
+			bool reset;					// Starts a new measurement after the reply was filled
+		};
+
+		struct Request_Events_Subscribe
+		{
+			uint32_t clientId;
+			uint32_t messageId;			// Used to associate with Reply
+			uint32_t eventMask;			// DRIVER_EVENT_MASK bits, 0 ends the subscription
+		};
+
 		struct Request
 		{
 			Request()
@@ -156,6 +212,11 @@ namespace vrmotioncompensation
 				Request_DeviceManipulation_ResetRefZeroPose dm_ResetRefZeroPose;
 				Request_DeviceManipulation_SetOffsets dm_SetOffsets;
 				Request_DebugLogger_Settings dl_Settings;
+				Request_PoseRecorder_Settings pr_Settings;
+				Request_FlightRecorder_Dump fr_Dump;
+				Request_Tracing_Control tr_Control;
+				Request_NoiseStatistics_Get ns_Get;
+				Request_Events_Subscribe ev_Subscribe;
 				MsgUnion()
 				{
 				}
@@ -180,6 +241,27 @@ namespace vrmotioncompensation
 			MotionCompensationDeviceMode deviceMode;
 		};
 
+		struct Reply_DriverCounters
+		{
+			MotionCompensationCounters_OVRMC_v1 counters;
+		};
+
+		struct Reply_Telemetry
+		{
+			Telemetry_OVRMC_v1 telemetry;
+		};
+
+		struct Reply_NoiseStatistics
+		{
+			NoiseStatistics_OVRMC_v1 statistics;
+		};
+
+		// Pushed by the driver with messageId 0
+		struct Reply_Event
+		{
+			DriverEvent_OVRMC_v1 event;
+		};
+
 		struct Reply
 		{
 			Reply()
@@ -202,11 +284,19 @@ namespace vrmotioncompensation
 				Reply_IPC_ClientConnect ipc_ClientConnect;
 				Reply_IPC_Ping ipc_Ping;
 				Reply_DeviceManipulation_GetDeviceInfo dm_deviceInfo;
+				Reply_DriverCounters dc_Counters;
+				Reply_Telemetry tm_Telemetry;
+				Reply_NoiseStatistics ns_Statistics;
+				Reply_Event ev_Event;
 				MsgUnion()
 				{
 				}
 			} msg;
 		};
 
+		// The driver creates the server ring, every client creates its own reply ring and passes the name with IPC_ClientConnect
+		typedef ShmRing<Request, 128> ServerRing;
+		typedef ShmRing<Reply, 64> ClientRing;
+
 	} // end namespace ipc
 } // end namespace vrmotioncompensation
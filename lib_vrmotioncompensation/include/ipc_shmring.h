@@ -0,0 +1,452 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/sync/named_semaphore.hpp>
+#ifdef _WIN32
+#include <boost/interprocess/windows_shared_memory.hpp>
+#else
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <sys/file.h>
+#endif
+
+// Consumer polls before it goes to sleep, replies usually arrive within a few microseconds
+#define SHMRING_SPIN_COUNT 200
+
+// "VRMC"
+#define SHMRING_MAGIC 0x434d5256
+
+// A slot that was claimed but not published for this long belongs to a producer that died or hangs, the consumer skips it
+#define SHMRING_STUCK_SLOT_MS 1000
+
+
+// Bounded ring of fixed size messages in shared memory, replaces boost::interprocess::message_queue for the driver ipc.
+//
+// Any number of producers, one consumer. Every slot carries the position it is free for (Sequence == position) or the position
+// it was published at (Sequence == position + 1), so producers only contend on one compare and swap and never take a lock.
+// A consumer that found the ring empty spins shortly and then sleeps on a named semaphore (a kernel event on Windows, a futex on Linux).
+// Producers only touch the semaphore while the consumer sleeps.
+//
+// A producer that dies between claiming a slot and publishing it would stop the consumer at that slot for good. The consumer skips
+// such a slot after SHMRING_STUCK_SLOT_MS and hands it to the next lap of the ring. A producer that was only suspended that long still
+// copies its message into the slot when it wakes up, possibly over the message of the next lap. So producers build the message aside
+// and copy it into the slot together with a checksum seeded with the position. The consumer checks its copy against the checksum and
+// drops what does not match, the late producer fails to publish and sends again.
+namespace vrmotioncompensation
+{
+	namespace ipc
+	{
+		template<typename T, uint32_t Capacity>
+		class ShmRing
+		{
+		private:
+			static_assert(std::is_trivially_copyable<T>::value, "ShmRing messages are copied bytewise");
+
+			struct Slot
+			{
+				std::atomic<uint64_t> Sequence;
+				uint64_t Checksum;						// Of Value and the position it was published at
+				T Value;
+			};
+
+			typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+			// Everything that lives in the shared memory segment
+			struct Layout
+			{
+				std::atomic<uint32_t> Magic;			// Written last by the creator
+				uint32_t SlotSize;						// sizeof(Slot)
+				uint32_t SlotCount;
+				std::atomic<uint32_t> Generation;		// Counted up by every creator, producers of an earlier one stop sending
+				alignas(64) std::atomic<uint64_t> EnqueuePosition;
+				alignas(64) std::atomic<uint64_t> DequeuePosition;
+				alignas(64) std::atomic<uint32_t> ConsumerSleeping;
+				alignas(64) Slot Slots[Capacity];
+			};
+
+		public:
+			// Consumer side, resets a ring left over from an earlier process and throws when another process still consumes it.
+			// Windows keeps the objects alive while any process still holds them, an old client may still have the server ring open.
+			// Only the consumer opens the owner object, so it exists exactly as long as the consumer lives.
+			// Linux keeps the segment until it is removed, also when its consumer died. The consumer holds an flock on it instead,
+			// which the kernel drops with the process. The segment is never removed while producers may still use it.
+			ShmRing(boost::interprocess::create_only_t, const std::string& Name) : _name(Name), _owner(true)
+			{
+#ifdef _WIN32
+				try
+				{
+					_ownerLock = boost::interprocess::windows_shared_memory(boost::interprocess::create_only, (Name + ".owner").c_str(), boost::interprocess::read_write, 1);
+				}
+				catch (boost::interprocess::interprocess_exception& e)
+				{
+					if (e.get_error_code() == boost::interprocess::already_exists_error)
+					{
+						throw std::runtime_error("Shared memory ring \"" + Name + "\" is in use by another process");
+					}
+					throw;
+				}
+				_shm = boost::interprocess::windows_shared_memory(boost::interprocess::open_or_create, Name.c_str(), boost::interprocess::read_write, sizeof(Layout));
+#else
+				_shm = boost::interprocess::shared_memory_object(boost::interprocess::open_or_create, Name.c_str(), boost::interprocess::read_write);
+				if (::flock(_shm.get_mapping_handle().handle, LOCK_EX | LOCK_NB) != 0)
+				{
+					throw std::runtime_error("Shared memory ring \"" + Name + "\" is in use by another process");
+				}
+				_shm.truncate(sizeof(Layout));
+#endif
+				_region = boost::interprocess::mapped_region(_shm, boost::interprocess::read_write);
+				if (_region.get_size() < sizeof(Layout))
+				{
+					throw std::runtime_error("Shared memory ring \"" + Name + "\" is still in use with another size");
+				}
+
+				// A semaphore count left over only causes one spurious wake up
+				boost::interprocess::named_semaphore::remove(_wakeupName().c_str());
+				_wakeup.reset(new boost::interprocess::named_semaphore(boost::interprocess::open_or_create, _wakeupName().c_str(), 0));
+
+				// Continue the generation of the ring left behind, so its producers notice that they talk to a dead consumer
+				Layout* Previous = static_cast<Layout*>(_region.get_address());
+				uint32_t Generation = Previous->Magic.load(std::memory_order_acquire) == SHMRING_MAGIC ? Previous->Generation.load(std::memory_order_relaxed) + 1 : 1;
+
+				_layout = new (_region.get_address()) Layout();
+				_layout->Generation.store(Generation, std::memory_order_relaxed);
+				_generation = Generation;
+				_layout->SlotSize = sizeof(Slot);
+				_layout->SlotCount = Capacity;
+				_layout->EnqueuePosition.store(0, std::memory_order_relaxed);
+				_layout->DequeuePosition.store(0, std::memory_order_relaxed);
+				_layout->ConsumerSleeping.store(0, std::memory_order_relaxed);
+				for (uint32_t i = 0; i < Capacity; i++)
+				{
+					_layout->Slots[i].Sequence.store(i, std::memory_order_relaxed);
+				}
+				_layout->Magic.store(SHMRING_MAGIC, std::memory_order_release);
+			}
+
+			// Producer side, throws when the ring does not exist or was built for other messages
+			ShmRing(boost::interprocess::open_only_t, const std::string& Name) : _name(Name), _owner(false)
+			{
+#ifdef _WIN32
+				_shm = boost::interprocess::windows_shared_memory(boost::interprocess::open_only, Name.c_str(), boost::interprocess::read_write);
+#else
+				_shm = boost::interprocess::shared_memory_object(boost::interprocess::open_only, Name.c_str(), boost::interprocess::read_write);
+#endif
+				_region = boost::interprocess::mapped_region(_shm, boost::interprocess::read_write);
+				if (_region.get_size() < sizeof(Layout))
+				{
+					throw std::runtime_error("Shared memory ring \"" + Name + "\" is too small");
+				}
+
+				_layout = static_cast<Layout*>(_region.get_address());
+				if (_layout->Magic.load(std::memory_order_acquire) != SHMRING_MAGIC || _layout->SlotSize != sizeof(Slot) || _layout->SlotCount != Capacity)
+				{
+					throw std::runtime_error("Shared memory ring \"" + Name + "\" has an incompatible layout");
+				}
+				_generation = _layout->Generation.load(std::memory_order_relaxed);
+
+				_wakeup.reset(new boost::interprocess::named_semaphore(boost::interprocess::open_only, _wakeupName().c_str()));
+			}
+
+			~ShmRing()
+			{
+				if (_owner)
+				{
+					_wakeup.reset();
+					boost::interprocess::named_semaphore::remove(_wakeupName().c_str());
+#ifndef _WIN32
+					boost::interprocess::shared_memory_object::remove(_name.c_str());
+#endif
+				}
+			}
+
+			ShmRing(const ShmRing&) = delete;
+			ShmRing& operator=(const ShmRing&) = delete;
+
+			// Construct(T&) fills a value-initialized message once a slot is claimed, the message is copied into the slot afterwards.
+			// Returns false when the ring is full, was created again by a new consumer or the slot was given up on as stuck.
+			template<typename F>
+			bool TryEmplace(F&& Construct)
+			{
+				if (_layout->Generation.load(std::memory_order_relaxed) != _generation)
+				{
+					return false;
+				}
+
+				Slot* Entry;
+				uint64_t Position = _layout->EnqueuePosition.load(std::memory_order_relaxed);
+				while (true)
+				{
+					Entry = &_layout->Slots[Position % Capacity];
+					int64_t Difference = (int64_t)Entry->Sequence.load(std::memory_order_acquire) - (int64_t)Position;
+					if (Difference == 0)
+					{
+						if (_layout->EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+						{
+							break;
+						}
+					}
+					else if (Difference < 0)
+					{
+						return false;
+					}
+					else
+					{
+						Position = _layout->EnqueuePosition.load(std::memory_order_relaxed);
+					}
+				}
+
+				Storage Message;
+				std::memset(&Message, 0, sizeof(Storage));
+				Construct(*new (&Message) T());
+				std::memcpy(&Entry->Value, &Message, sizeof(T));
+				Entry->Checksum = _checksum(Position, &Message);
+
+				// Fails when the consumer took this slot as stuck, the message is lost then and sent again in a new slot
+				uint64_t Expected = Position;
+				if (!Entry->Sequence.compare_exchange_strong(Expected, Position + 1, std::memory_order_release, std::memory_order_relaxed))
+				{
+					return false;
+				}
+
+				// Pairs with the fence in Pop, either the consumer sees the message or we see it sleeping
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (_layout->ConsumerSleeping.load(std::memory_order_relaxed) != 0 && _layout->ConsumerSleeping.exchange(0, std::memory_order_relaxed) != 0)
+				{
+					_wakeup->post();
+				}
+				return true;
+			}
+
+			// Waits up to TimeoutMs for a free slot
+			template<typename F>
+			bool Emplace(F&& Construct, uint32_t TimeoutMs)
+			{
+				auto Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TimeoutMs);
+				for (uint32_t i = 0; !TryEmplace(Construct); i++)
+				{
+					if (std::chrono::steady_clock::now() >= Deadline)
+					{
+						return false;
+					}
+
+					// A full ring means the consumer is busy or gone, no need to wake up quickly
+					if (i < SHMRING_SPIN_COUNT)
+					{
+						std::this_thread::yield();
+					}
+					else
+					{
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					}
+				}
+				return true;
+			}
+
+			bool Push(const T& Value, uint32_t TimeoutMs)
+			{
+				return Emplace([&Value](T& Target) { Target = Value; }, TimeoutMs);
+			}
+
+			// Consumer only. Consume(T&) gets a checked copy of the message, the slot is already released then.
+			template<typename F>
+			bool TryConsume(F&& Consume)
+			{
+				uint64_t Position = _layout->DequeuePosition.load(std::memory_order_relaxed);
+				while (true)
+				{
+					Slot* Entry = &_layout->Slots[Position % Capacity];
+					uint64_t Sequence = Entry->Sequence.load(std::memory_order_acquire);
+					if (Sequence != Position + 1)
+					{
+						// Claimed by a producer but not published yet
+						if (Sequence != Position || _layout->EnqueuePosition.load(std::memory_order_relaxed) <= Position || !_skipStuckSlot(Position, Entry))
+						{
+							return false;
+						}
+
+						Position++;
+						continue;
+					}
+
+					// A producer whose slot was skipped as stuck may still be writing into it
+					Storage Message;
+					std::memcpy(&Message, &Entry->Value, sizeof(T));
+					bool Valid = Entry->Checksum == _checksum(Position, &Message);
+
+					_layout->DequeuePosition.store(Position + 1, std::memory_order_relaxed);
+					Entry->Sequence.store(Position + Capacity, std::memory_order_release);
+					if (!Valid)
+					{
+						_corruptSlots++;
+						Position++;
+						continue;
+					}
+
+					Consume(*reinterpret_cast<T*>(&Message));
+					return true;
+				}
+			}
+
+			bool TryPop(T& Value)
+			{
+				return TryConsume([&Value](T& Source) { Value = Source; });
+			}
+
+			// Consumer only, waits up to TimeoutMs for a message
+			bool Pop(T& Value, uint32_t TimeoutMs)
+			{
+				for (uint32_t i = 0; i < SHMRING_SPIN_COUNT; i++)
+				{
+					if (TryPop(Value))
+					{
+						return true;
+					}
+					std::this_thread::yield();
+				}
+
+				boost::posix_time::ptime Deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(TimeoutMs);
+				while (true)
+				{
+					_layout->ConsumerSleeping.store(1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (TryPop(Value))
+					{
+						_cancelSleep();
+						return true;
+					}
+
+					// A claimed slot that is not published yet is checked again once it counts as stuck
+					boost::posix_time::ptime Wake = Deadline;
+					if (_stuckPosition == _layout->DequeuePosition.load(std::memory_order_relaxed))
+					{
+						auto Left = std::chrono::duration_cast<std::chrono::milliseconds>(_stuckSince + std::chrono::milliseconds(SHMRING_STUCK_SLOT_MS) - std::chrono::steady_clock::now());
+						Wake = std::min(Deadline, boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(std::max<int64_t>(Left.count(), 0) + 1));
+					}
+
+					if (!_wakeup->timed_wait(Wake))
+					{
+						_cancelSleep();
+						if (TryPop(Value))
+						{
+							return true;
+						}
+						if (Wake >= Deadline)
+						{
+							return false;
+						}
+						continue;
+					}
+
+					// A wake up that belonged to an earlier sleep
+					if (TryPop(Value))
+					{
+						return true;
+					}
+				}
+			}
+
+			const std::string& Name() const
+			{
+				return _name;
+			}
+
+			// Consumer only, slots given up because their producer never published them
+			uint64_t SkippedSlots() const
+			{
+				return _skippedSlots;
+			}
+
+			// Consumer only, messages dropped because a late producer wrote over them
+			uint64_t CorruptSlots() const
+			{
+				return _corruptSlots;
+			}
+
+		private:
+			std::string _wakeupName() const
+			{
+				return _name + ".wakeup";
+			}
+
+			// A producer that already cleared the flag has posted or is about to post, take that wake up so the next sleep is not cut short
+			void _cancelSleep()
+			{
+				if (_layout->ConsumerSleeping.exchange(0, std::memory_order_relaxed) == 0)
+				{
+					_wakeup->timed_wait(boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(100));
+				}
+			}
+
+			// FNV-1a over 64 bit words, seeded with the position so a message written for another lap of the ring does not match
+			static uint64_t _checksum(uint64_t Position, const Storage* Message)
+			{
+				const unsigned char* Bytes = reinterpret_cast<const unsigned char*>(Message);
+				uint64_t Hash = 0xcbf29ce484222325ull ^ Position;
+				for (size_t i = 0; i < sizeof(T); i += sizeof(uint64_t))
+				{
+					uint64_t Word = 0;
+					std::memcpy(&Word, Bytes + i, std::min(sizeof(uint64_t), sizeof(T) - i));
+					Hash = (Hash ^ Word) * 0x100000001b3ull;
+				}
+				return Hash;
+			}
+
+			// The slot at Position only counts as stuck when it stayed claimed for SHMRING_STUCK_SLOT_MS, returns true when it was skipped
+			bool _skipStuckSlot(uint64_t Position, Slot* Entry)
+			{
+				auto Now = std::chrono::steady_clock::now();
+				if (_stuckPosition != Position)
+				{
+					_stuckPosition = Position;
+					_stuckSince = Now;
+					return false;
+				}
+				if (Now - _stuckSince < std::chrono::milliseconds(SHMRING_STUCK_SLOT_MS))
+				{
+					return false;
+				}
+
+				uint64_t Expected = Position;
+				if (!Entry->Sequence.compare_exchange_strong(Expected, Position + Capacity, std::memory_order_relaxed, std::memory_order_relaxed))
+				{
+					return false;
+				}
+
+				_layout->DequeuePosition.store(Position + 1, std::memory_order_relaxed);
+				_skippedSlots++;
+				return true;
+			}
+
+			std::string _name;
+			bool _owner;
+			uint32_t _generation = 0;
+
+			// Consumer only
+			uint64_t _stuckPosition = UINT64_MAX;
+			std::chrono::steady_clock::time_point _stuckSince;
+			uint64_t _skippedSlots = 0;
+			uint64_t _corruptSlots = 0;
+#ifdef _WIN32
+			boost::interprocess::windows_shared_memory _ownerLock;
+			boost::interprocess::windows_shared_memory _shm;
+#else
+			boost::interprocess::shared_memory_object _shm;
+#endif
+			boost::interprocess::mapped_region _region;
+			std::unique_ptr<boost::interprocess::named_semaphore> _wakeup;
+			Layout* _layout = nullptr;
+		};
+	}
+}
\ No newline at end of file
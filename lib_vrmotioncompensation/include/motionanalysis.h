@@ -0,0 +1,645 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <future>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <motiontrace.h>
+
+// Statistics of a motion trace (MotionData.ovrmctrace), meant to be attached to bug reports instead of loading the data into a spreadsheet.
+//
+// Every channel is analyzed on its own update sequence. The debug logger repeats the last value of a channel on every debug point,
+// a point counts as an update of the channel when any of its components changed. Channels are analyzed in parallel.
+namespace vrmotioncompensation
+{
+	namespace trace
+	{
+		struct AnalysisSettings
+		{
+			double StationaryWindow = 0.5;			// Seconds per window of the stationary detection
+			double StationaryThreshold = 0.002;		// Largest peak to peak of any component in a stationary window (meters / quaternion units)
+			uint32_t SpectrumSize = 1024;			// Points per FFT segment, rounded up to a power of two
+			double HistogramBinWidth = 0.0005;		// Seconds per bin of the inter arrival histograms
+			uint32_t HistogramBins = 100;
+			double MaxLag = 0.25;					// Largest lag in seconds searched by the cross correlation
+
+			// Reference and target channel of every cross correlation
+			std::vector<std::pair<std::string, std::string>> Correlations = {
+				{ "RefPos", "HmdPosCompensated" },
+				{ "RefRaw", "HmdPos" },
+			};
+		};
+
+		struct IntervalHistogram
+		{
+			double BinWidth = 0.0;
+			std::vector<uint64_t> Bins;
+			uint64_t Overflow = 0;		// Intervals beyond the last bin
+			uint64_t Count = 0;
+			double Mean = 0.0;
+			double P50 = 0.0;
+			double P99 = 0.0;
+			double Max = 0.0;
+		};
+
+		struct JitterStats
+		{
+			double Rms = 0.0;			// Deviation from the window mean, over all stationary windows
+			double PeakToPeak = 0.0;	// Mean peak to peak of the stationary windows
+		};
+
+		struct AllanPoint
+		{
+			double Tau;
+			double Deviation;
+		};
+
+		struct ComponentAnalysis
+		{
+			JitterStats Jitter;
+			std::vector<AllanPoint> Allan;
+			std::vector<double> Spectrum;	// One sided power spectral density, bin i is at i * SpectrumResolution Hz
+			double PeakFrequency = 0.0;		// Strongest bin apart from DC
+			double PeakDensity = 0.0;
+		};
+
+		struct ChannelAnalysis
+		{
+			std::string Name;
+			uint64_t Updates = 0;
+			double Rate = 0.0;
+			double StationaryTime = 0.0;	// Seconds of the trace the channel was stationary
+			double SpectrumResolution = 0.0;
+			IntervalHistogram InterArrival;
+			std::vector<ComponentAnalysis> Components;
+		};
+
+		struct CorrelationResult
+		{
+			std::string Reference;
+			std::string Target;
+			double Lag = 0.0;				// Seconds the target trails the reference, negative if it leads
+			double Correlation = 0.0;		// Normalized correlation of the motion at that lag
+		};
+
+		struct TraceAnalysis
+		{
+			uint64_t Points = 0;
+			double Duration = 0.0;
+			IntervalHistogram PointInterArrival;
+			std::vector<ChannelAnalysis> Channels;
+			std::vector<CorrelationResult> Correlations;
+
+			void WriteSummary(std::ostream& Out) const
+			{
+				Out << "Points: " << Points << ", duration: " << Duration << " s\n";
+				Out << "Point interval: ";
+				writeHistogram(Out, PointInterArrival);
+
+				for (auto& Channel : Channels)
+				{
+					Out << "\n" << Channel.Name << ": " << Channel.Updates << " updates, " << Channel.Rate << " Hz, stationary for " << Channel.StationaryTime << " s\n";
+					Out << "  Update interval: ";
+					writeHistogram(Out, Channel.InterArrival);
+
+					for (size_t i = 0; i < Channel.Components.size(); i++)
+					{
+						const ComponentAnalysis& Component = Channel.Components[i];
+						Out << "  [" << i << "] jitter rms " << Component.Jitter.Rms << ", p-p " << Component.Jitter.PeakToPeak
+							<< ", spectral peak " << Component.PeakFrequency << " Hz (" << Component.PeakDensity << "/Hz), adev";
+						for (auto& Point : Component.Allan)
+						{
+							Out << " " << Point.Tau << "s:" << Point.Deviation;
+						}
+						Out << "\n";
+					}
+				}
+
+				if (!Correlations.empty())
+				{
+					Out << "\n";
+				}
+				for (auto& Entry : Correlations)
+				{
+					Out << Entry.Target << " vs " << Entry.Reference << ": lag " << Entry.Lag * 1000.0 << " ms, correlation " << Entry.Correlation << "\n";
+				}
+			}
+
+			static void writeHistogram(std::ostream& Out, const IntervalHistogram& Histogram)
+			{
+				Out << "mean " << Histogram.Mean * 1000.0 << " ms, p50 " << Histogram.P50 * 1000.0 << " ms, p99 " << Histogram.P99 * 1000.0
+					<< " ms, max " << Histogram.Max * 1000.0 << " ms, " << Histogram.Overflow << " beyond " << Histogram.BinWidth * Histogram.Bins.size() * 1000.0 << " ms\n";
+			}
+		};
+
+		// Analysis primitives
+
+		// In place radix 2 FFT, the size must be a power of two
+		inline void fft(std::vector<std::complex<double>>& Data, bool Inverse = false)
+		{
+			size_t Size = Data.size();
+			for (size_t i = 1, j = 0; i < Size; i++)
+			{
+				size_t Bit = Size >> 1;
+				for (; j & Bit; Bit >>= 1)
+				{
+					j ^= Bit;
+				}
+				j ^= Bit;
+				if (i < j)
+				{
+					std::swap(Data[i], Data[j]);
+				}
+			}
+
+			const double Pi = 3.14159265358979323846;
+			for (size_t Length = 2; Length <= Size; Length <<= 1)
+			{
+				double Angle = 2.0 * Pi / (double)Length * (Inverse ? 1.0 : -1.0);
+				std::complex<double> Step(std::cos(Angle), std::sin(Angle));
+				for (size_t i = 0; i < Size; i += Length)
+				{
+					std::complex<double> Twiddle(1.0, 0.0);
+					for (size_t j = 0; j < Length / 2; j++)
+					{
+						std::complex<double> Even = Data[i + j];
+						std::complex<double> Odd = Data[i + j + Length / 2] * Twiddle;
+						Data[i + j] = Even + Odd;
+						Data[i + j + Length / 2] = Even - Odd;
+						Twiddle *= Step;
+					}
+				}
+			}
+
+			if (Inverse)
+			{
+				for (auto& Value : Data)
+				{
+					Value /= (double)Size;
+				}
+			}
+		}
+
+		inline size_t nextPowerOfTwo(size_t Value)
+		{
+			size_t Result = 1;
+			while (Result < Value)
+			{
+				Result <<= 1;
+			}
+			return Result;
+		}
+
+		inline IntervalHistogram intervalHistogram(const std::vector<double>& Times, double BinWidth, uint32_t BinCount)
+		{
+			IntervalHistogram Result;
+			Result.BinWidth = BinWidth;
+			Result.Bins.assign(BinCount, 0);
+			if (Times.size() < 2)
+			{
+				return Result;
+			}
+
+			std::vector<double> Intervals(Times.size() - 1);
+			double Sum = 0.0;
+			for (size_t i = 1; i < Times.size(); i++)
+			{
+				double Interval = Times[i] - Times[i - 1];
+				Intervals[i - 1] = Interval;
+				Sum += Interval;
+
+				size_t Bin = BinWidth > 0.0 ? (size_t)(Interval / BinWidth) : BinCount;
+				if (Bin < BinCount)
+				{
+					Result.Bins[Bin]++;
+				}
+				else
+				{
+					Result.Overflow++;
+				}
+			}
+
+			Result.Count = Intervals.size();
+			Result.Mean = Sum / (double)Intervals.size();
+			std::sort(Intervals.begin(), Intervals.end());
+			Result.P50 = Intervals[Intervals.size() / 2];
+			Result.P99 = Intervals[std::min(Intervals.size() - 1, Intervals.size() * 99 / 100)];
+			Result.Max = Intervals.back();
+
+			return Result;
+		}
+
+		// Overlapping Allan deviation at octave spaced cluster sizes, Interval is the mean time between samples
+		inline std::vector<AllanPoint> allanDeviation(const std::vector<double>& Samples, double Interval)
+		{
+			std::vector<AllanPoint> Result;
+			size_t Count = Samples.size();
+
+			std::vector<double> Sum(Count + 1, 0.0);
+			for (size_t i = 0; i < Count; i++)
+			{
+				Sum[i + 1] = Sum[i] + Samples[i];
+			}
+
+			for (size_t Cluster = 1; Cluster * 4 <= Count; Cluster <<= 1)
+			{
+				double Variance = 0.0;
+				size_t Terms = Count - 2 * Cluster + 1;
+				for (size_t k = 0; k < Terms; k++)
+				{
+					double First = Sum[k + Cluster] - Sum[k];
+					double Second = Sum[k + 2 * Cluster] - Sum[k + Cluster];
+					double Difference = (Second - First) / (double)Cluster;
+					Variance += Difference * Difference;
+				}
+				Variance /= 2.0 * (double)Terms;
+				Result.push_back({ Interval * (double)Cluster, std::sqrt(Variance) });
+			}
+
+			return Result;
+		}
+
+		// Welch estimate with Hann windowed, half overlapping segments
+		inline std::vector<double> powerSpectrum(const std::vector<double>& Samples, size_t SegmentSize, double SampleRate)
+		{
+			std::vector<double> Result(SegmentSize / 2 + 1, 0.0);
+			if (Samples.size() < SegmentSize || SampleRate <= 0.0)
+			{
+				return {};
+			}
+
+			const double Pi = 3.14159265358979323846;
+			std::vector<double> Window(SegmentSize);
+			double WindowPower = 0.0;
+			for (size_t i = 0; i < SegmentSize; i++)
+			{
+				Window[i] = 0.5 - 0.5 * std::cos(2.0 * Pi * (double)i / (double)SegmentSize);
+				WindowPower += Window[i] * Window[i];
+			}
+
+			std::vector<std::complex<double>> Segment(SegmentSize);
+			size_t Segments = 0;
+			for (size_t Start = 0; Start + SegmentSize <= Samples.size(); Start += SegmentSize / 2)
+			{
+				double Mean = 0.0;
+				for (size_t i = 0; i < SegmentSize; i++)
+				{
+					Mean += Samples[Start + i];
+				}
+				Mean /= (double)SegmentSize;
+
+				for (size_t i = 0; i < SegmentSize; i++)
+				{
+					Segment[i] = std::complex<double>((Samples[Start + i] - Mean) * Window[i], 0.0);
+				}
+				fft(Segment);
+
+				for (size_t i = 0; i < Result.size(); i++)
+				{
+					Result[i] += std::norm(Segment[i]);
+				}
+				Segments++;
+			}
+
+			for (size_t i = 0; i < Result.size(); i++)
+			{
+				// Both halves of the spectrum are folded into the one sided density, apart from DC and Nyquist
+				double Scale = (i == 0 || i == SegmentSize / 2) ? 1.0 : 2.0;
+				Result[i] *= Scale / (SampleRate * WindowPower * (double)Segments);
+			}
+
+			return Result;
+		}
+
+		// Samples a column at evenly spaced times, holding the last value
+		inline std::vector<double> resample(const std::vector<double>& Times, const std::vector<double>& Values, double Start, double Interval, size_t Count)
+		{
+			std::vector<double> Result(Count);
+			size_t Index = 0;
+			for (size_t i = 0; i < Count; i++)
+			{
+				double Time = Start + Interval * (double)i;
+				while (Index + 1 < Times.size() && Times[Index + 1] <= Time)
+				{
+					Index++;
+				}
+				Result[i] = Values[Index];
+			}
+			return Result;
+		}
+
+		class TraceAnalyzer
+		{
+		public:
+			TraceAnalyzer(const AnalysisSettings& Settings = AnalysisSettings()) : _settings(Settings)
+			{
+				_settings.SpectrumSize = (uint32_t)nextPowerOfTwo(std::max<uint32_t>(Settings.SpectrumSize, 16));
+			}
+
+			bool Analyze(const TraceReader& Reader, TraceAnalysis& Result) const
+			{
+				Result = TraceAnalysis();
+				Result.Points = Reader.Points();
+				Result.Duration = Reader.Duration();
+
+				std::vector<double> Times;
+				if (!Reader.ReadTime(Times))
+				{
+					return false;
+				}
+				Result.PointInterArrival = intervalHistogram(Times, _settings.HistogramBinWidth, _settings.HistogramBins);
+
+				// The reader only reads from the mapping, every channel gets its own task
+				std::vector<std::future<bool>> Tasks;
+				Result.Channels.resize(Reader.Channels().size());
+				for (uint32_t i = 0; i < Reader.Channels().size(); i++)
+				{
+					Tasks.push_back(std::async(std::launch::async, [this, &Reader, &Times, &Result, i]()
+					{
+						return _analyzeChannel(Reader, i, Times, Result.Channels[i]);
+					}));
+				}
+
+				// Channels missing from the trace are skipped
+				std::vector<std::pair<int, int>> Pairs;
+				for (auto& Entry : _settings.Correlations)
+				{
+					int Reference = Reader.FindChannel(Entry.first);
+					int Target = Reader.FindChannel(Entry.second);
+					if (Reference >= 0 && Target >= 0)
+					{
+						Pairs.push_back({ Reference, Target });
+						Result.Correlations.push_back({ Entry.first, Entry.second });
+					}
+				}
+				for (size_t i = 0; i < Pairs.size(); i++)
+				{
+					Tasks.push_back(std::async(std::launch::async, [this, &Reader, &Times, &Result, &Pairs, i]()
+					{
+						return _correlate(Reader, (uint32_t)Pairs[i].first, (uint32_t)Pairs[i].second, Times, Result.Correlations[i]);
+					}));
+				}
+
+				bool Ok = true;
+				for (auto& Task : Tasks)
+				{
+					Ok = Task.get() && Ok;
+				}
+
+				return Ok;
+			}
+
+		private:
+			bool _analyzeChannel(const TraceReader& Reader, uint32_t ChannelIndex, const std::vector<double>& Times, ChannelAnalysis& Result) const
+			{
+				const TraceReader::Channel& Channel = Reader.Channels()[ChannelIndex];
+				Result.Name = Channel.Name;
+
+				std::vector<std::vector<double>> Columns(Channel.Components);
+				for (uint32_t i = 0; i < Channel.Components; i++)
+				{
+					if (!Reader.ReadColumn(ChannelIndex, i, Columns[i]))
+					{
+						return false;
+					}
+				}
+
+				// Keep the points where the channel was updated
+				std::vector<double> UpdateTimes;
+				std::vector<std::vector<double>> Samples(Channel.Components);
+				for (size_t Point = 0; Point < Times.size(); Point++)
+				{
+					bool Changed = Point == 0;
+					for (uint32_t i = 0; i < Channel.Components && !Changed; i++)
+					{
+						Changed = Columns[i][Point] != Columns[i][Point - 1];
+					}
+
+					if (Changed)
+					{
+						UpdateTimes.push_back(Times[Point]);
+						for (uint32_t i = 0; i < Channel.Components; i++)
+						{
+							Samples[i].push_back(Columns[i][Point]);
+						}
+					}
+				}
+
+				Result.Updates = UpdateTimes.size();
+				Result.InterArrival = intervalHistogram(UpdateTimes, _settings.HistogramBinWidth, _settings.HistogramBins);
+				Result.Components.resize(Channel.Components);
+				if (UpdateTimes.size() < 2)
+				{
+					return true;
+				}
+
+				double Duration = UpdateTimes.back() - UpdateTimes.front();
+				Result.Rate = Duration > 0.0 ? (double)(UpdateTimes.size() - 1) / Duration : 0.0;
+				double Interval = Result.Rate > 0.0 ? 1.0 / Result.Rate : 0.0;
+
+				_stationaryJitter(UpdateTimes, Samples, Result);
+
+				Result.SpectrumResolution = Result.Rate / (double)_settings.SpectrumSize;
+				for (uint32_t i = 0; i < Channel.Components; i++)
+				{
+					ComponentAnalysis& Component = Result.Components[i];
+					Component.Allan = allanDeviation(Samples[i], Interval);
+					Component.Spectrum = powerSpectrum(Samples[i], _settings.SpectrumSize, Result.Rate);
+					for (size_t Bin = 1; Bin < Component.Spectrum.size(); Bin++)
+					{
+						if (Component.Spectrum[Bin] > Component.PeakDensity)
+						{
+							Component.PeakDensity = Component.Spectrum[Bin];
+							Component.PeakFrequency = (double)Bin * Result.SpectrumResolution;
+						}
+					}
+				}
+
+				return true;
+			}
+
+			// Splits the updates into windows and measures the noise of the windows in which no component moved more than the threshold
+			void _stationaryJitter(const std::vector<double>& UpdateTimes, const std::vector<std::vector<double>>& Samples, ChannelAnalysis& Result) const
+			{
+				size_t Components = Samples.size();
+				std::vector<double> SquareSum(Components, 0.0);
+				std::vector<double> PeakToPeakSum(Components, 0.0);
+				size_t StationarySamples = 0;
+				size_t StationaryWindows = 0;
+
+				size_t Start = 0;
+				while (Start < UpdateTimes.size())
+				{
+					size_t End = Start + 1;
+					while (End < UpdateTimes.size() && UpdateTimes[End] - UpdateTimes[Start] < _settings.StationaryWindow)
+					{
+						End++;
+					}
+					if (End == UpdateTimes.size() || End - Start < 2)
+					{
+						break;
+					}
+
+					bool Stationary = true;
+					std::vector<double> PeakToPeak(Components);
+					for (size_t i = 0; i < Components && Stationary; i++)
+					{
+						auto Range = std::minmax_element(Samples[i].begin() + Start, Samples[i].begin() + End);
+						PeakToPeak[i] = *Range.second - *Range.first;
+						Stationary = PeakToPeak[i] < _settings.StationaryThreshold;
+					}
+
+					if (Stationary)
+					{
+						for (size_t i = 0; i < Components; i++)
+						{
+							double Mean = 0.0;
+							for (size_t j = Start; j < End; j++)
+							{
+								Mean += Samples[i][j];
+							}
+							Mean /= (double)(End - Start);
+							for (size_t j = Start; j < End; j++)
+							{
+								SquareSum[i] += (Samples[i][j] - Mean) * (Samples[i][j] - Mean);
+							}
+							PeakToPeakSum[i] += PeakToPeak[i];
+						}
+						StationarySamples += End - Start;
+						StationaryWindows++;
+						Result.StationaryTime += UpdateTimes[End] - UpdateTimes[Start];
+					}
+
+					Start = End;
+				}
+
+				if (StationaryWindows == 0)
+				{
+					return;
+				}
+				for (size_t i = 0; i < Components; i++)
+				{
+					Result.Components[i].Jitter.Rms = std::sqrt(SquareSum[i] / (double)StationarySamples);
+					Result.Components[i].Jitter.PeakToPeak = PeakToPeakSum[i] / (double)StationaryWindows;
+				}
+			}
+
+			// Cross correlates the motion of both channels around their mean on an even time grid, summed over the common components
+			bool _correlate(const TraceReader& Reader, uint32_t Reference, uint32_t Target, const std::vector<double>& Times, CorrelationResult& Result) const
+			{
+				if (Times.size() < 16)
+				{
+					return true;
+				}
+
+				double Interval = (Times.back() - Times.front()) / (double)(Times.size() - 1);
+				if (Interval <= 0.0)
+				{
+					return true;
+				}
+
+				size_t Count = Times.size();
+				size_t Size = nextPowerOfTwo(2 * Count);
+				std::vector<std::complex<double>> Spectrum(Size, 0.0);
+				double ReferenceEnergy = 0.0;
+				double TargetEnergy = 0.0;
+
+				uint32_t Components = std::min(Reader.Channels()[Reference].Components, Reader.Channels()[Target].Components);
+				std::vector<double> Column;
+				for (uint32_t i = 0; i < Components; i++)
+				{
+					std::vector<std::complex<double>> ReferenceMotion(Size, 0.0);
+					std::vector<std::complex<double>> TargetMotion(Size, 0.0);
+
+					if (!Reader.ReadColumn(Reference, i, Column))
+					{
+						return false;
+					}
+					ReferenceEnergy += _removeMean(resample(Times, Column, Times.front(), Interval, Count), ReferenceMotion);
+
+					if (!Reader.ReadColumn(Target, i, Column))
+					{
+						return false;
+					}
+					TargetEnergy += _removeMean(resample(Times, Column, Times.front(), Interval, Count), TargetMotion);
+
+					fft(ReferenceMotion);
+					fft(TargetMotion);
+					for (size_t j = 0; j < Size; j++)
+					{
+						Spectrum[j] += TargetMotion[j] * std::conj(ReferenceMotion[j]);
+					}
+				}
+
+				if (ReferenceEnergy <= 0.0 || TargetEnergy <= 0.0)
+				{
+					return true;
+				}
+
+				// Index k of the inverse transform holds the correlation of the target delayed by k samples, negative lags wrap around
+				fft(Spectrum, true);
+				long long MaxLag = std::min<long long>((long long)(_settings.MaxLag / Interval), (long long)Count - 1);
+				long long BestLag = 0;
+				double Best = 0.0;
+				auto at = [&](long long Lag)
+				{
+					return Spectrum[(size_t)((Lag + (long long)Size) % (long long)Size)].real();
+				};
+
+				// The compensated pose moves against the reference, the strongest correlation of either sign wins
+				for (long long Lag = -MaxLag; Lag <= MaxLag; Lag++)
+				{
+					if (std::abs(at(Lag)) > std::abs(Best))
+					{
+						Best = at(Lag);
+						BestLag = Lag;
+					}
+				}
+
+				// Parabolic interpolation between the neighbouring lags
+				double Offset = 0.0;
+				if (BestLag > -MaxLag && BestLag < MaxLag)
+				{
+					double Left = std::abs(at(BestLag - 1));
+					double Right = std::abs(at(BestLag + 1));
+					double Denominator = Left - 2.0 * std::abs(Best) + Right;
+					if (Denominator < 0.0)
+					{
+						Offset = 0.5 * (Left - Right) / Denominator;
+					}
+				}
+
+				Result.Lag = ((double)BestLag + Offset) * Interval;
+				Result.Correlation = Best / std::sqrt(ReferenceEnergy * TargetEnergy);
+				return true;
+			}
+
+			// Copies the samples without their mean into Out and returns their energy
+			static double _removeMean(const std::vector<double>& Samples, std::vector<std::complex<double>>& Out)
+			{
+				double Mean = 0.0;
+				for (double Value : Samples)
+				{
+					Mean += Value;
+				}
+				Mean /= (double)Samples.size();
+
+				double Energy = 0.0;
+				for (size_t i = 0; i < Samples.size(); i++)
+				{
+					Out[i] = Samples[i] - Mean;
+					Energy += (Samples[i] - Mean) * (Samples[i] - Mean);
+				}
+				return Energy;
+			}
+
+			AnalysisSettings _settings;
+		};
+	} // end namespace trace
+} // end namespace vrmotioncompensation
\ No newline at end of file
@@ -0,0 +1,592 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#define MOTION_TRACE_VERSION 1
+#define MOTION_TRACE_BLOCK_SIZE 4096		// Points per block
+#define MOTION_TRACE_NAME_LENGTH 48
+#define MOTION_TRACE_MAX_COMPONENTS 4
+
+
+// Columnar binary trace of motion data, written by the driver debug logger (MotionData.ovrmctrace).
+//
+// File layout:
+//   TraceFileHeader
+//   TraceChannelHeader[ChannelCount]
+//   Blocks until the end of the file, each one is a TraceBlockHeader followed by one column per channel component.
+//   Every column starts with its size in bytes (uint32_t).
+//
+// Every point has a time and one value per channel component. Columns are compressed independently and every block can be decoded on its own:
+//   Time is stored in nanoseconds as the zigzag varint of the difference between successive deltas (the first value of a block is stored as is).
+//   Values are XORed with the previous value of the same column, the result is stored as one control byte
+//   (leading zero bytes << 4 | trailing zero bytes) followed by the remaining bytes.
+namespace vrmotioncompensation
+{
+	namespace trace
+	{
+		struct TraceFileHeader
+		{
+			char Magic[8];				// "OVRMCTR"
+			uint32_t Version;			// MOTION_TRACE_VERSION
+			uint32_t ChannelCount;
+			uint64_t PointCount;
+			double Duration;			// Seconds between the first and the last point
+			uint32_t BlockSize;			// MOTION_TRACE_BLOCK_SIZE
+			uint32_t Reserved;
+		};
+
+		struct TraceChannelHeader
+		{
+			char Name[MOTION_TRACE_NAME_LENGTH];
+			uint32_t Components;		// 3 for vectors, 4 for quaternions (w, x, y, z), at most MOTION_TRACE_MAX_COMPONENTS
+			uint32_t Reserved;
+			double Rate;				// Updates per second of the channel over the whole trace
+		};
+
+		struct TraceBlockHeader
+		{
+			uint32_t Points;
+			uint32_t Bytes;				// Size of all columns of the block, including their size fields
+		};
+
+		// Compression primitives
+
+		inline void writeVarint(std::vector<uint8_t>& Out, uint64_t Value)
+		{
+			while (Value >= 0x80)
+			{
+				Out.push_back((uint8_t)(Value | 0x80));
+				Value >>= 7;
+			}
+			Out.push_back((uint8_t)Value);
+		}
+
+		inline const uint8_t* readVarint(const uint8_t* In, const uint8_t* End, uint64_t& Value)
+		{
+			Value = 0;
+			for (int Shift = 0; In < End && Shift < 64; Shift += 7)
+			{
+				uint8_t Byte = *In++;
+				Value |= (uint64_t)(Byte & 0x7f) << Shift;
+				if (!(Byte & 0x80))
+				{
+					return In;
+				}
+			}
+			return nullptr;
+		}
+
+		inline uint64_t zigzagEncode(int64_t Value)
+		{
+			return ((uint64_t)Value << 1) ^ (uint64_t)(Value >> 63);
+		}
+
+		inline int64_t zigzagDecode(uint64_t Value)
+		{
+			return (int64_t)(Value >> 1) ^ -(int64_t)(Value & 1);
+		}
+
+		// Differences wrap around in unsigned arithmetic, so any sequence of times round trips, also one that runs backwards
+		inline void encodeTimeColumn(std::vector<uint8_t>& Out, const int64_t* Nanoseconds, size_t Count)
+		{
+			uint64_t Previous = 0;
+			uint64_t PreviousDelta = 0;
+			for (size_t i = 0; i < Count; i++)
+			{
+				uint64_t Delta = (uint64_t)Nanoseconds[i] - Previous;
+				writeVarint(Out, zigzagEncode((int64_t)(Delta - PreviousDelta)));
+				Previous = (uint64_t)Nanoseconds[i];
+				PreviousDelta = Delta;
+			}
+		}
+
+		inline bool decodeTimeColumn(const uint8_t* In, const uint8_t* End, double* Out, size_t Count)
+		{
+			uint64_t Previous = 0;
+			uint64_t PreviousDelta = 0;
+			for (size_t i = 0; i < Count; i++)
+			{
+				uint64_t Value;
+				In = readVarint(In, End, Value);
+				if (!In)
+				{
+					return false;
+				}
+
+				PreviousDelta += (uint64_t)zigzagDecode(Value);
+				Previous += PreviousDelta;
+				Out[i] = (double)(int64_t)Previous * 1.0E-9;
+			}
+			return true;
+		}
+
+		inline void encodeValueColumn(std::vector<uint8_t>& Out, const double* Values, size_t Count)
+		{
+			uint64_t Previous = 0;
+			for (size_t i = 0; i < Count; i++)
+			{
+				uint64_t Bits;
+				memcpy(&Bits, &Values[i], sizeof(Bits));
+				uint64_t Xor = Bits ^ Previous;
+				Previous = Bits;
+
+				int Leading = 0;
+				while (Leading < 8 && ((Xor >> (56 - 8 * Leading)) & 0xff) == 0)
+				{
+					Leading++;
+				}
+				int Trailing = 0;
+				while (Leading + Trailing < 8 && ((Xor >> (8 * Trailing)) & 0xff) == 0)
+				{
+					Trailing++;
+				}
+
+				Out.push_back((uint8_t)(Leading << 4 | Trailing));
+				for (int Byte = Trailing; Byte < 8 - Leading; Byte++)
+				{
+					Out.push_back((uint8_t)(Xor >> (8 * Byte)));
+				}
+			}
+		}
+
+		inline bool decodeValueColumn(const uint8_t* In, const uint8_t* End, double* Out, size_t Count)
+		{
+			uint64_t Previous = 0;
+			for (size_t i = 0; i < Count; i++)
+			{
+				if (In >= End)
+				{
+					return false;
+				}
+
+				int Leading = *In >> 4;
+				int Trailing = *In & 0x0f;
+				In++;
+				if (Leading + Trailing > 8 || End - In < 8 - Leading - Trailing)
+				{
+					return false;
+				}
+
+				uint64_t Xor = 0;
+				for (int Byte = Trailing; Byte < 8 - Leading; Byte++)
+				{
+					Xor |= (uint64_t)*In++ << (8 * Byte);
+				}
+
+				Previous ^= Xor;
+				memcpy(&Out[i], &Previous, sizeof(Previous));
+			}
+			return true;
+		}
+
+		// Writes a trace point by point, blocks are compressed and written once they are full.
+		class TraceWriter
+		{
+		public:
+			~TraceWriter()
+			{
+				Close();
+			}
+
+			// Channels are given as name and component count
+			bool Open(const std::string& FileName, const std::vector<std::pair<std::string, uint32_t>>& Channels)
+			{
+				_file.open(FileName, std::ios::binary | std::ios::trunc);
+				if (!_file.is_open())
+				{
+					return false;
+				}
+
+				memset(&_header, 0, sizeof(_header));
+				memcpy(_header.Magic, "OVRMCTR", sizeof(_header.Magic));
+				_header.Version = MOTION_TRACE_VERSION;
+				_header.ChannelCount = (uint32_t)Channels.size();
+				_header.BlockSize = MOTION_TRACE_BLOCK_SIZE;
+
+				_channels.clear();
+				_valueCount = 0;
+				for (auto& Channel : Channels)
+				{
+					TraceChannelHeader ChannelHeader;
+					memset(&ChannelHeader, 0, sizeof(ChannelHeader));
+					snprintf(ChannelHeader.Name, MOTION_TRACE_NAME_LENGTH, "%s", Channel.first.c_str());
+					ChannelHeader.Components = Channel.second;
+					_channels.push_back(ChannelHeader);
+					_valueCount += Channel.second;
+				}
+
+				_time.clear();
+				_values.assign(_valueCount, std::vector<double>());
+				_firstTime = _lastTime = 0;
+
+				_writeHeaders();
+
+				return (bool)_file;
+			}
+
+			bool IsOpen() const
+			{
+				return _file.is_open();
+			}
+
+			// Values holds all components of all channels in channel order
+			void Append(double Time, const double* Values)
+			{
+				int64_t Nanoseconds = (int64_t)(Time * 1.0E9);
+				if (_header.PointCount == 0 && _time.empty())
+				{
+					_firstTime = Nanoseconds;
+				}
+				_lastTime = Nanoseconds;
+
+				_time.push_back(Nanoseconds);
+				for (uint32_t i = 0; i < _valueCount; i++)
+				{
+					_values[i].push_back(Values[i]);
+				}
+
+				if (_time.size() >= MOTION_TRACE_BLOCK_SIZE)
+				{
+					_writeBlock();
+				}
+			}
+
+			// Updates per second of a channel, stored in the header when the trace is closed
+			void SetRate(uint32_t Channel, double Rate)
+			{
+				if (Channel < _channels.size())
+				{
+					_channels[Channel].Rate = Rate;
+				}
+			}
+
+			bool Close()
+			{
+				if (!_file.is_open())
+				{
+					return false;
+				}
+
+				_writeBlock();
+
+				_header.Duration = (double)(_lastTime - _firstTime) * 1.0E-9;
+				_file.seekp(0);
+				_writeHeaders();
+
+				bool Ok = (bool)_file;
+				_file.close();
+				return Ok;
+			}
+
+		private:
+			void _writeHeaders()
+			{
+				_file.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+				if (!_channels.empty())
+				{
+					_file.write(reinterpret_cast<const char*>(_channels.data()), _channels.size() * sizeof(TraceChannelHeader));
+				}
+			}
+
+			void _appendColumn(std::vector<uint8_t>& Block, const std::vector<uint8_t>& Column)
+			{
+				uint32_t Size = (uint32_t)Column.size();
+				Block.insert(Block.end(), reinterpret_cast<const uint8_t*>(&Size), reinterpret_cast<const uint8_t*>(&Size) + sizeof(Size));
+				Block.insert(Block.end(), Column.begin(), Column.end());
+			}
+
+			void _writeBlock()
+			{
+				if (_time.empty())
+				{
+					return;
+				}
+
+				_block.clear();
+				_column.clear();
+				encodeTimeColumn(_column, _time.data(), _time.size());
+				_appendColumn(_block, _column);
+
+				for (auto& Values : _values)
+				{
+					_column.clear();
+					encodeValueColumn(_column, Values.data(), Values.size());
+					_appendColumn(_block, _column);
+					Values.clear();
+				}
+
+				TraceBlockHeader BlockHeader;
+				BlockHeader.Points = (uint32_t)_time.size();
+				BlockHeader.Bytes = (uint32_t)_block.size();
+				_file.write(reinterpret_cast<const char*>(&BlockHeader), sizeof(BlockHeader));
+				_file.write(reinterpret_cast<const char*>(_block.data()), _block.size());
+
+				_header.PointCount += _time.size();
+				_time.clear();
+			}
+
+			std::ofstream _file;
+			TraceFileHeader _header;
+			std::vector<TraceChannelHeader> _channels;
+			uint32_t _valueCount = 0;
+
+			int64_t _firstTime = 0;
+			int64_t _lastTime = 0;
+			std::vector<int64_t> _time;
+			std::vector<std::vector<double>> _values;
+			std::vector<uint8_t> _block;
+			std::vector<uint8_t> _column;
+		};
+
+		// Reads a trace through a read only memory mapping of the file.
+		// Open() only walks the block headers, columns are decoded straight from the mapping when they are requested.
+		// It rejects truncated files and headers that do not match the data, so every indexed column lies within the file.
+		class TraceReader
+		{
+		public:
+			struct Channel
+			{
+				std::string Name;
+				uint32_t Components;
+				uint32_t FirstColumn;	// Column of the first component, column 0 is the time
+				double Rate;
+			};
+
+			bool Open(const std::string& FileName)
+			{
+				if (!_open(FileName))
+				{
+					_channels.clear();
+					_blocks.clear();
+					_columnCount = 0;
+					_points = 0;
+					return false;
+				}
+				return true;
+			}
+
+			const std::vector<Channel>& Channels() const
+			{
+				return _channels;
+			}
+
+			// Index of the channel with the given name or -1
+			int FindChannel(const std::string& Name) const
+			{
+				for (size_t i = 0; i < _channels.size(); i++)
+				{
+					if (_channels[i].Name == Name)
+					{
+						return (int)i;
+					}
+				}
+				return -1;
+			}
+
+			uint64_t Points() const
+			{
+				return _points;
+			}
+
+			double Duration() const
+			{
+				return _header.Duration;
+			}
+
+			// Time of every point in seconds
+			bool ReadTime(std::vector<double>& Out) const
+			{
+				return _readColumn(0, Out);
+			}
+
+			bool ReadColumn(uint32_t ChannelIndex, uint32_t Component, std::vector<double>& Out) const
+			{
+				if (ChannelIndex >= _channels.size() || Component >= _channels[ChannelIndex].Components)
+				{
+					return false;
+				}
+				return _readColumn(_channels[ChannelIndex].FirstColumn + Component, Out);
+			}
+
+			// Writes the trace in the semicolon separated layout of the old MotionData.txt
+			bool WriteCsv(std::ostream& Out) const
+			{
+				std::vector<std::vector<double>> Columns(_columnCount);
+				for (uint32_t i = 0; i < _columnCount; i++)
+				{
+					if (!_readColumn(i, Columns[i]))
+					{
+						return false;
+					}
+				}
+
+				unsigned int Index = 1;
+				Out << "Time;";
+				for (auto& Entry : _channels)
+				{
+					Out << Entry.Name << "[" << Index << ":" << Entry.Components << "];";
+					Index += Entry.Components;
+				}
+				Out << "\n";
+
+				for (uint64_t Point = 0; Point < _points; Point++)
+				{
+					for (uint32_t i = 0; i < _columnCount; i++)
+					{
+						Out << Columns[i][Point] << ";";
+					}
+					Out << "\n";
+				}
+
+				return (bool)Out;
+			}
+
+		private:
+			bool _open(const std::string& FileName)
+			{
+				_channels.clear();
+				_blocks.clear();
+
+				try
+				{
+					_mapping = boost::interprocess::file_mapping(FileName.c_str(), boost::interprocess::read_only);
+					_region = boost::interprocess::mapped_region(_mapping, boost::interprocess::read_only);
+				}
+				catch (boost::interprocess::interprocess_exception&)
+				{
+					return false;
+				}
+
+				const uint8_t* Begin = static_cast<const uint8_t*>(_region.get_address());
+				const uint8_t* End = Begin + _region.get_size();
+
+				if ((size_t)(End - Begin) < sizeof(TraceFileHeader))
+				{
+					return false;
+				}
+				memcpy(&_header, Begin, sizeof(_header));
+				if (strncmp(_header.Magic, "OVRMCTR", sizeof(_header.Magic)) != 0 || _header.Version != MOTION_TRACE_VERSION)
+				{
+					return false;
+				}
+
+				const uint8_t* In = Begin + sizeof(TraceFileHeader);
+				if ((size_t)(End - In) < (size_t)_header.ChannelCount * sizeof(TraceChannelHeader))
+				{
+					return false;
+				}
+
+				_columnCount = 1;
+				for (uint32_t i = 0; i < _header.ChannelCount; i++)
+				{
+					TraceChannelHeader ChannelHeader;
+					memcpy(&ChannelHeader, In, sizeof(ChannelHeader));
+					In += sizeof(ChannelHeader);
+					ChannelHeader.Name[MOTION_TRACE_NAME_LENGTH - 1] = '\0';
+					if (ChannelHeader.Components == 0 || ChannelHeader.Components > MOTION_TRACE_MAX_COMPONENTS)
+					{
+						return false;
+					}
+
+					_channels.push_back({ ChannelHeader.Name, ChannelHeader.Components, _columnCount, ChannelHeader.Rate });
+					_columnCount += ChannelHeader.Components;
+				}
+
+				// Index the columns of every block
+				_points = 0;
+				while ((size_t)(End - In) >= sizeof(TraceBlockHeader))
+				{
+					TraceBlockHeader BlockHeader;
+					memcpy(&BlockHeader, In, sizeof(BlockHeader));
+					In += sizeof(BlockHeader);
+					if ((size_t)(End - In) < BlockHeader.Bytes)
+					{
+						return false;
+					}
+
+					Block Entry;
+					Entry.Points = BlockHeader.Points;
+					Entry.FirstPoint = _points;
+					const uint8_t* Column = In;
+					for (uint32_t i = 0; i < _columnCount; i++)
+					{
+						uint32_t Size;
+						if (In + BlockHeader.Bytes - Column < (ptrdiff_t)sizeof(Size))
+						{
+							return false;
+						}
+						memcpy(&Size, Column, sizeof(Size));
+						Column += sizeof(Size);
+						// Every point takes at least one byte in every column
+						if (In + BlockHeader.Bytes - Column < (ptrdiff_t)Size || Size < BlockHeader.Points)
+						{
+							return false;
+						}
+						Entry.Columns.push_back({ Column, Size });
+						Column += Size;
+					}
+					if (BlockHeader.Points == 0 || Column != In + BlockHeader.Bytes)
+					{
+						return false;
+					}
+
+					_blocks.push_back(std::move(Entry));
+					_points += BlockHeader.Points;
+					In += BlockHeader.Bytes;
+				}
+
+				// Left over bytes are a block cut short
+				return In == End;
+			}
+
+			struct ColumnData
+			{
+				const uint8_t* Data;
+				uint32_t Size;
+			};
+
+			struct Block
+			{
+				uint32_t Points;
+				uint64_t FirstPoint;
+				std::vector<ColumnData> Columns;
+			};
+
+			bool _readColumn(uint32_t Column, std::vector<double>& Out) const
+			{
+				Out.resize((size_t)_points);
+				for (auto& Entry : _blocks)
+				{
+					const ColumnData& Data = Entry.Columns[Column];
+					double* Destination = Out.data() + Entry.FirstPoint;
+					bool Ok = Column == 0
+						? decodeTimeColumn(Data.Data, Data.Data + Data.Size, Destination, Entry.Points)
+						: decodeValueColumn(Data.Data, Data.Data + Data.Size, Destination, Entry.Points);
+					if (!Ok)
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+
+			boost::interprocess::file_mapping _mapping;
+			boost::interprocess::mapped_region _region;
+
+			TraceFileHeader _header;
+			std::vector<Channel> _channels;
+			std::vector<Block> _blocks;
+			uint32_t _columnCount = 0;
+			uint64_t _points = 0;
+		};
+	} // end namespace trace
+} // end namespace vrmotioncompensation
\ No newline at end of file
@@ -459,4 +459,161 @@ namespace vrmath
 
 		return result;
 	}
+
+	// Scalar-generic vector and quaternion types.
+	// The OpenVR types above are always double precision. These are used wherever the precision of
+	// the compensation math and of the stored filter state can be chosen at compile time.
+	template<typename T> struct vec3
+	{
+		T v[3];
+	};
+
+	template<typename T> struct quat
+	{
+		T w, x, y, z;
+	};
+
+	template<typename T> inline vec3<T> toVec3(const double(&vector)[3])
+	{
+		return{ (T)vector[0], (T)vector[1], (T)vector[2] };
+	}
+
+	template<typename T> inline vec3<T> toVec3(const vr::HmdVector3d_t& vector)
+	{
+		return{ (T)vector.v[0], (T)vector.v[1], (T)vector.v[2] };
+	}
+
+	template<typename T> inline quat<T> toQuat(const vr::HmdQuaternion_t& q)
+	{
+		return{ (T)q.w, (T)q.x, (T)q.y, (T)q.z };
+	}
+
+	template<typename T> inline vr::HmdVector3d_t toHmdVector3d(const vec3<T>& vector)
+	{
+		return{ (double)vector.v[0], (double)vector.v[1], (double)vector.v[2] };
+	}
+
+	template<typename T> inline vr::HmdQuaternion_t toHmdQuaternion(const quat<T>& q)
+	{
+		return{ (double)q.w, (double)q.x, (double)q.y, (double)q.z };
+	}
+
+	template<typename T> inline quat<T> operator*(const quat<T>& lhs, const quat<T>& rhs)
+	{
+		return{
+			(lhs.w * rhs.w) - (lhs.x * rhs.x) - (lhs.y * rhs.y) - (lhs.z * rhs.z),
+			(lhs.w * rhs.x) + (lhs.x * rhs.w) + (lhs.y * rhs.z) - (lhs.z * rhs.y),
+			(lhs.w * rhs.y) + (lhs.y * rhs.w) + (lhs.z * rhs.x) - (lhs.x * rhs.z),
+			(lhs.w * rhs.z) + (lhs.z * rhs.w) + (lhs.x * rhs.y) - (lhs.y * rhs.x)
+		};
+	}
+
+	template<typename T> inline vec3<T> operator+(const vec3<T>& lhs, const vec3<T>& rhs)
+	{
+		return{
+			lhs.v[0] + rhs.v[0],
+			lhs.v[1] + rhs.v[1],
+			lhs.v[2] + rhs.v[2]
+		};
+	}
+
+	template<typename T> inline vec3<T> operator-(const vec3<T>& lhs, const vec3<T>& rhs)
+	{
+		return{
+			lhs.v[0] - rhs.v[0],
+			lhs.v[1] - rhs.v[1],
+			lhs.v[2] - rhs.v[2]
+		};
+	}
+
+	template<typename T> inline quat<T> quaternionConjugate(const quat<T>& q)
+	{
+		return{
+			q.w,
+			-q.x,
+			-q.y,
+			-q.z,
+		};
+	}
+
+	template<typename T> inline vec3<T> quaternionRotateVector(const quat<T>& q, const quat<T>& qInv, const vec3<T>& vector, bool reverse = false)
+	{
+		quat<T> pin = { (T)0, vector.v[0], vector.v[1], vector.v[2] };
+		quat<T> pout = reverse ? qInv * pin * q : q * pin * qInv;
+		return{ pout.x, pout.y, pout.z };
+	}
+
+	template<typename T> inline vec3<T> crossProduct(const vec3<T>& lhs, const vec3<T>& rhs)
+	{
+		return{
+			lhs.v[1] * rhs.v[2] - lhs.v[2] * rhs.v[1],
+			lhs.v[2] * rhs.v[0] - lhs.v[0] * rhs.v[2],
+			lhs.v[0] * rhs.v[1] - lhs.v[1] * rhs.v[0]
+		};
+	}
+
+	// Rotates a vector by a unit quaternion without building the two quaternion products:
+	// t = 2 * cross(q.xyz, v), v' = v + q.w * t + cross(q.xyz, t)
+	// The reverse rotation uses the conjugate, so no inverse has to be passed in.
+	template<typename T> inline vec3<T> quaternionRotateVector(const quat<T>& q, const vec3<T>& vector, bool reverse = false)
+	{
+		vec3<T> u = { q.x, q.y, q.z };
+		if (reverse)
+		{
+			u.v[0] = -u.v[0];
+			u.v[1] = -u.v[1];
+			u.v[2] = -u.v[2];
+		}
+
+		vec3<T> t = crossProduct(u, vector);
+		t.v[0] += t.v[0];
+		t.v[1] += t.v[1];
+		t.v[2] += t.v[2];
+
+		vec3<T> c = crossProduct(u, t);
+		return{
+			vector.v[0] + q.w * t.v[0] + c.v[0],
+			vector.v[1] + q.w * t.v[1] + c.v[1],
+			vector.v[2] + q.w * t.v[2] + c.v[2]
+		};
+	}
+
+	// 3x3 rotation matrix, used when many vectors are rotated by the same quaternion
+	template<typename T> struct mat33
+	{
+		T m[3][3];
+	};
+
+	// Converts a unit quaternion into a rotation matrix. matMul33(mat, v) rotates like quaternionRotateVector(q, v),
+	// matMul33(v, mat) multiplies with the transpose and rotates like quaternionRotateVector(q, v, true).
+	template<typename T> inline mat33<T> quaternionToMatrix33(const quat<T>& q)
+	{
+		T xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		T xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		T wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+		return{ {
+			{ 1 - 2 * (yy + zz), 2 * (xy - wz), 2 * (xz + wy) },
+			{ 2 * (xy + wz), 1 - 2 * (xx + zz), 2 * (yz - wx) },
+			{ 2 * (xz - wy), 2 * (yz + wx), 1 - 2 * (xx + yy) }
+		} };
+	}
+
+	template<typename T> inline vec3<T> matMul33(const mat33<T>& a, const vec3<T>& b)
+	{
+		return{
+			a.m[0][0] * b.v[0] + a.m[0][1] * b.v[1] + a.m[0][2] * b.v[2],
+			a.m[1][0] * b.v[0] + a.m[1][1] * b.v[1] + a.m[1][2] * b.v[2],
+			a.m[2][0] * b.v[0] + a.m[2][1] * b.v[1] + a.m[2][2] * b.v[2]
+		};
+	}
+
+	template<typename T> inline vec3<T> matMul33(const vec3<T>& a, const mat33<T>& b)
+	{
+		return{
+			a.v[0] * b.m[0][0] + a.v[1] * b.m[1][0] + a.v[2] * b.m[2][0],
+			a.v[0] * b.m[0][1] + a.v[1] * b.m[1][1] + a.v[2] * b.m[2][1],
+			a.v[0] * b.m[0][2] + a.v[1] * b.m[1][2] + a.v[2] * b.m[2][2]
+		};
+	}
 }
\ No newline at end of file
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/interprocess/detail/os_thread_functions.hpp>
+
+#define TRACE_SPANS_PER_THREAD 32768
+
+#define TRACE_SPAN_CONCAT_(a, b) a##b
+#define TRACE_SPAN_CONCAT(a, b) TRACE_SPAN_CONCAT_(a, b)
+
+// Records the enclosing scope as a span while tracing is on: TRACE_SPAN("updateRefPose") or TRACE_SPAN("hooksTrackedDevicePoseUpdated", deviceId)
+// The name has to be a string literal, spans only keep its address.
+#define TRACE_SPAN(...) vrmotioncompensation::trace::ScopedSpan TRACE_SPAN_CONCAT(_traceSpan, __LINE__)(__VA_ARGS__)
+
+
+// Timing spans in the Chrome trace event format, readable by chrome://tracing and ui.perfetto.dev.
+//
+// Every thread records into its own buffer, recording a span is two clock reads and a store. When tracing is off a span costs one relaxed load.
+// Files use the JSON array format without the closing bracket, which both viewers accept. Another process can append its spans to the same file,
+// the driver and the overlay share one timeline because both use the steady clock (QueryPerformanceCounter on Windows).
+namespace vrmotioncompensation
+{
+	namespace trace
+	{
+		struct Span
+		{
+			const char* Name;
+			int64_t Argument;		// Negative when the span has no argument
+			uint64_t Start;			// Nanoseconds of the steady clock
+			uint64_t End;
+		};
+
+		class SpanTracer
+		{
+		private:
+			struct SpanBuffer
+			{
+				SpanBuffer(uint32_t ThreadIndex) : ThreadIndex(ThreadIndex), Spans(new Span[TRACE_SPANS_PER_THREAD])
+				{
+				}
+
+				const uint32_t ThreadIndex;
+				std::atomic<uint32_t> Count = { 0 };	// Written by the owning thread only
+				std::atomic<bool> Writing = { false };	// Set while the owning thread records a span
+				std::unique_ptr<Span[]> Spans;
+			};
+
+		public:
+			// One tracer per module
+			static SpanTracer& instance()
+			{
+				static SpanTracer Instance;
+				return Instance;
+			}
+
+			static uint64_t now()
+			{
+				return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			}
+
+			// Discards the spans of the last run. Threads still recording a span of the last run are waited for before the buffers are reset.
+			void Start()
+			{
+				std::lock_guard<std::mutex> lock(_buffersMutex);
+				_running.store(false, std::memory_order_seq_cst);
+				for (auto& Buffer : _buffers)
+				{
+					while (Buffer->Writing.load(std::memory_order_seq_cst))
+					{
+						std::this_thread::yield();
+					}
+					Buffer->Count.store(0, std::memory_order_relaxed);
+				}
+				_dropped = 0;
+				_running.store(true, std::memory_order_release);
+			}
+
+			void Stop()
+			{
+				_running.store(false, std::memory_order_release);
+			}
+
+			bool IsRunning() const
+			{
+				return _running.load(std::memory_order_relaxed);
+			}
+
+			uint64_t DroppedSpans() const
+			{
+				return _dropped.load(std::memory_order_relaxed);
+			}
+
+			void Record(const char* Name, int64_t Argument, uint64_t Start, uint64_t End)
+			{
+				SpanBuffer* Buffer = _threadBuffer();
+				Buffer->Writing.store(true, std::memory_order_seq_cst);
+				if (!_running.load(std::memory_order_seq_cst))
+				{
+					Buffer->Writing.store(false, std::memory_order_release);
+					return;
+				}
+
+				uint32_t Count = Buffer->Count.load(std::memory_order_relaxed);
+				if (Count >= TRACE_SPANS_PER_THREAD)
+				{
+					_dropped.fetch_add(1, std::memory_order_relaxed);
+				}
+				else
+				{
+					Buffer->Spans[Count] = { Name, Argument, Start, End };
+					Buffer->Count.store(Count + 1, std::memory_order_release);
+				}
+				Buffer->Writing.store(false, std::memory_order_release);
+			}
+
+			// Writes the recorded spans with ProcessName as the name of this process. With Append the spans are added to a file written by Export before.
+			bool Export(const std::string& FileName, const std::string& ProcessName, bool Append = false) const
+			{
+				std::ofstream File(FileName, Append ? std::ios::app : std::ios::trunc);
+				if (!File)
+				{
+					return false;
+				}
+
+				unsigned long ProcessId = (unsigned long)boost::interprocess::ipcdetail::get_current_process_id();
+				if (!Append)
+				{
+					File << "[\n";
+				}
+				File << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << ProcessId << ",\"args\":{\"name\":\"" << ProcessName << "\"}},\n";
+
+				std::lock_guard<std::mutex> lock(_buffersMutex);
+				File.precision(3);
+				File << std::fixed;
+				for (auto& Buffer : _buffers)
+				{
+					uint32_t Count = Buffer->Count.load(std::memory_order_acquire);
+					for (uint32_t i = 0; i < Count; i++)
+					{
+						const Span& Entry = Buffer->Spans[i];
+						File << "{\"name\":\"" << Entry.Name << "\",\"ph\":\"X\",\"pid\":" << ProcessId << ",\"tid\":" << Buffer->ThreadIndex
+							<< ",\"ts\":" << (double)Entry.Start / 1000.0 << ",\"dur\":" << (double)(Entry.End - Entry.Start) / 1000.0;
+						if (Entry.Argument >= 0)
+						{
+							File << ",\"args\":{\"arg\":" << Entry.Argument << "}";
+						}
+						File << "},\n";
+					}
+				}
+
+				return (bool)File;
+			}
+
+		private:
+			SpanTracer()
+			{
+			}
+
+			// Buffers live as long as the tracer, a thread registers its buffer on its first span
+			SpanBuffer* _threadBuffer()
+			{
+				thread_local SpanBuffer* Buffer = nullptr;
+				if (!Buffer)
+				{
+					std::lock_guard<std::mutex> lock(_buffersMutex);
+					_buffers.push_back(std::unique_ptr<SpanBuffer>(new SpanBuffer((uint32_t)_buffers.size() + 1)));
+					Buffer = _buffers.back().get();
+				}
+				return Buffer;
+			}
+
+			std::atomic<bool> _running = { false };
+			std::atomic<uint64_t> _dropped = { 0 };
+			mutable std::mutex _buffersMutex;
+			std::vector<std::unique_ptr<SpanBuffer>> _buffers;
+		};
+
+		class ScopedSpan
+		{
+		public:
+			ScopedSpan(const char* Name, int64_t Argument = -1) : _name(Name), _argument(Argument), _start(0)
+			{
+				if (SpanTracer::instance().IsRunning())
+				{
+					_start = SpanTracer::now();
+				}
+			}
+
+			~ScopedSpan()
+			{
+				if (_start != 0)
+				{
+					SpanTracer::instance().Record(_name, _argument, _start, SpanTracer::now());
+				}
+			}
+
+			ScopedSpan(const ScopedSpan&) = delete;
+			ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+		private:
+			const char* _name;
+			int64_t _argument;
+			uint64_t _start;
+		};
+	} // end namespace trace
+} // end namespace vrmotioncompensation
\ No newline at end of file
@@ -2,6 +2,11 @@
 
 #include <stdint.h>
 #include <string>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <future>
 #include <mutex>
 #include <thread>
@@ -10,7 +15,10 @@
 #include <random>
 #include <string>
 #include <openvr.h>
-#include <boost/interprocess/ipc/message_queue.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#ifdef _WIN32
+#include <boost/interprocess/windows_shared_memory.hpp>
+#endif
 
 
 namespace vr
@@ -139,6 +147,11 @@ namespace vrmotioncompensation
 		using vrmotioncompensation_exception::vrmotioncompensation_exception;
 	};
 
+	class vrmotioncompensation_timeout : public vrmotioncompensation_exception
+	{
+		using vrmotioncompensation_exception::vrmotioncompensation_exception;
+	};
+
 
 	class VRMotionCompensation
 	{
@@ -146,6 +159,11 @@ namespace vrmotioncompensation
 		VRMotionCompensation(const std::string& driverQueue = "driver_vrmotioncompensation.server_queue", const std::string& clientQueue = "driver_vrmotioncompensation.client_queue.");
 		~VRMotionCompensation();
 
+		// Every call that waits for a reply gives up after IPC_REPLY_TIMEOUT_MS and throws vrmotioncompensation_timeout.
+		//
+		// Threading: replies arrive on an ipc thread, request and event handlers run one after another on a separate handler thread.
+		// Handlers may call every function of this object including the blocking ones and disconnect(), while they run later
+		// handlers wait. The object must not be destroyed from a handler.
 		void connect();
 		bool isConnected() const;
 		void disconnect();
@@ -162,7 +180,54 @@ namespace vrmotioncompensation
 
 		void setOffsets(MMFstruct_OVRMC_v1 offsets);
 
-		void startDebugLogger(bool enable, bool modal = true);
+		// Asynchronous variants of the calls above, any number of them can be in flight and the driver answers in order.
+		// The futures throw what the blocking calls throw, or vrmotioncompensation_timeout when no reply arrived within timeoutMs.
+		// Only a missing connection or a driver that stopped taking requests throws right away, the handler is not called then.
+		// Otherwise the handler gets its own future on the handler thread once the request completed, exactly once.
+		// The returned future holds the same result and can be ignored.
+		template<typename T>
+		using AsyncHandler = std::function<void(std::future<T>)>;
+
+		std::future<DeviceInfo> getDeviceInfoAsync(uint32_t deviceId, AsyncHandler<DeviceInfo> handler = nullptr, uint32_t timeoutMs = IPC_REPLY_TIMEOUT_MS);
+
+		std::future<void> setDeviceMotionCompensationModeAsync(uint32_t MCdeviceId, uint32_t RTdeviceId, MotionCompensationMode Mode, AsyncHandler<void> handler = nullptr, uint32_t timeoutMs = IPC_REPLY_TIMEOUT_MS);
+
+		std::future<void> setMotionCompensationSettingsAsync(double LPF_Beta, uint32_t samples, bool setZero, AsyncHandler<void> handler = nullptr, uint32_t timeoutMs = IPC_REPLY_TIMEOUT_MS);
+
+		std::future<void> setOffsetsAsync(MMFstruct_OVRMC_v1 offsets, AsyncHandler<void> handler = nullptr, uint32_t timeoutMs = IPC_REPLY_TIMEOUT_MS);
+
+		void startDebugLogger(bool enable, bool modal = true, uint32_t maxDebugPoints = 0);
+
+		void setPoseRecorder(bool enable, const std::string& fileName = "", bool modal = true);
+
+		void getDriverCounters(MotionCompensationCounters_OVRMC_v1& counters);
+
+		// Pose counters of one device, read from the shared memory of the driver without an ipc round trip.
+		// Throws when the driver does not publish them. Windows only, the segment OVRMC_CountersMMFv1 is a named Windows
+		// shared memory object and the driver keeps the counters in process memory elsewhere, so other platforms always throw.
+		void getDeviceCounters(uint32_t OpenVRId, DeviceCounters_OVRMC_v1& counters);
+
+		void dumpFlightRecorder(const std::string& fileName = "", bool modal = true);
+
+		// Snapshot of the reference motion, counters and hook latencies for live displays, meant to be polled a few times per second
+		void getTelemetry(Telemetry_OVRMC_v1& telemetry);
+
+		// Tracking noise of a device measured while it lay still, reset starts a new measurement afterwards
+		void getNoiseStatistics(uint32_t OpenVRId, NoiseStatistics_OVRMC_v1& statistics, bool reset = false);
+
+		// Called on the handler thread for every event the driver pushes, in the order the driver sent them
+		typedef std::function<void(const DriverEvent_OVRMC_v1&)> DriverEventHandler;
+
+		// Asks the driver to push the event types in eventMask (DRIVER_EVENT_MASK bits) as they happen, an empty mask ends the subscription
+		void subscribeEvents(uint32_t eventMask, DriverEventHandler handler);
+
+		// Device modes and compensation flags read from the shared memory of the driver, without an ipc round trip.
+		// Cheap enough to call every frame, throws when the driver does not publish its state.
+		// Windows only like getDeviceCounters(), elsewhere it always throws. subscribeEvents() delivers the same changes on every platform.
+		void getDeviceStates(DeviceStates_OVRMC_v1& states);
+
+		// Starts or stops span tracing in the driver. Stopping writes the driver spans to fileName (driver_trace.json when empty).
+		void setTracing(bool enable, const std::string& fileName = "", bool modal = true);
 
 	private:
 		std::recursive_mutex _mutex;
@@ -173,27 +238,79 @@ namespace vrmotioncompensation
 		std::thread _ipcThread;
 		static void _ipcThreadFunc(VRMotionCompensation* _this);
 
+		// Runs the user handlers, so a handler that waits for a reply does not hold up the ipc thread that delivers it.
+		// Started by the first connect() and stopped by the destructor, handlers of requests aborted by disconnect() still run.
+		std::thread _handlerThread;
+		std::mutex _handlerMutex;
+		std::condition_variable _handlerCondition;
+		std::deque<std::function<void()>> _handlerQueue;		// Guarded by _handlerMutex
+		bool _handlerThreadStop = false;						// Guarded by _handlerMutex
+		static void _handlerThreadFunc(VRMotionCompensation* _this);
+
+		// Queues call for the handler thread
+		void _dispatch(std::function<void()> call);
+
 		std::random_device _ipcRandomDevice;
 		std::uniform_int_distribution<uint32_t> _ipcRandomDist;
 
+		// Completes an asynchronous request, error is set when the request timed out or the connection closed.
+		// Called on the ipc thread or the thread that closes the connection, it only fulfills promises and dispatches user handlers.
+		typedef std::function<void(const ipc::Reply& reply, std::exception_ptr error)> _ipcReplyHandler;
+
 		struct _ipcPromiseMapEntry
 		{
-			_ipcPromiseMapEntry() : isValid(false)
-			{
-			}
-			_ipcPromiseMapEntry(std::promise<ipc::Reply>&& _promise, bool isValid = true)
-				: promise(std::move(_promise)), isValid(isValid)
+			_ipcPromiseMapEntry(_ipcReplyHandler&& _handler, std::chrono::steady_clock::time_point _deadline)
+				: handler(std::move(_handler)), deadline(_deadline)
 			{
 			}
-			bool isValid;
-			std::promise<ipc::Reply> promise;
+			_ipcReplyHandler handler;
+			std::chrono::steady_clock::time_point deadline;
 		};
 
+		// Throws when the server ring stays full
+		void _sendRequest(const ipc::Request& message);
+
+		// Sends a message with message id 0, the driver does not reply to it
+		void _sendFireAndForget(const ipc::Request& message);
+
+		// Sends message with a message id that is not in flight and calls handler with the reply, messageId is the id field of the message.
+		// When sending fails it throws, unless the request already expired while the send waited, its handler reported that instead.
+		void _sendAsyncRequest(ipc::Request& message, uint32_t& messageId, uint32_t timeoutMs, _ipcReplyHandler handler);
+
+		// Wraps _sendAsyncRequest, interpret turns the reply into the value of the future or throws
+		template<typename T, typename F>
+		std::future<T> _requestAsync(ipc::Request& message, uint32_t& messageId, uint32_t timeoutMs, AsyncHandler<T> handler, F interpret);
+
+		// Fails the asynchronous requests whose deadline passed, returns how long the ipc thread may sleep
+		uint32_t _expireRequests();
+
+		// Fails all asynchronous requests still in flight
+		void _abortRequests(const std::string& reason);
+
+		// Stops the ipc thread, fails the requests in flight and closes both queues
+		void _closeConnection(const std::string& reason);
+
 		std::map<uint32_t, _ipcPromiseMapEntry> _ipcPromiseMap;
+		std::chrono::steady_clock::time_point _ipcNextDeadline = std::chrono::steady_clock::time_point::max();		// Guarded by _mutex
+		DriverEventHandler _eventHandler;		// Guarded by _mutex
 		std::string _ipcServerQueueName;
 		std::string _ipcClientQueueName;
-		boost::interprocess::message_queue* _ipcServerQueue = nullptr;
-		boost::interprocess::message_queue* _ipcClientQueue = nullptr;
+		ipc::ServerRing* _ipcServerQueue = nullptr;
+		ipc::ClientRing* _ipcClientQueue = nullptr;
+
+		// Opened on the first getDeviceStates() call
+#ifdef _WIN32
+		boost::interprocess::windows_shared_memory _deviceStateMemory;
+#endif
+		boost::interprocess::mapped_region _deviceStateRegion;
+		const MMFstruct_DeviceState_OVRMC_v1* _deviceStates = nullptr;
+
+		// Opened on the first getDeviceCounters() call
+#ifdef _WIN32
+		boost::interprocess::windows_shared_memory _deviceCounterMemory;
+#endif
+		boost::interprocess::mapped_region _deviceCounterRegion;
+		const MMFstruct_Counters_OVRMC_v1* _deviceCounters = nullptr;
 	};
 
 } // end namespace vrmotioncompensation
\ No newline at end of file
@@ -1,6 +1,14 @@
 #pragma once
 
 #include <stdint.h>
+#include <atomic>
+#include <cstring>
+
+// The vr:: types used here belong to the part openvr.h and openvr_driver.h have in common. The two headers cannot be
+// included together, so the driver keeps the openvr_driver.h it included first and everyone else gets openvr.h.
+#if !defined(_OPENVR_API) && !defined(_OPENVR_DRIVER_API)
+#include <openvr.h>
+#endif
 
 
 namespace vrmotioncompensation
@@ -48,4 +56,291 @@ namespace vrmotioncompensation
 		}
 	};
 
+	// Per device pose counters of the driver, returned by VRMotionCompensation::getDeviceCounters()
+	struct DeviceCounters_OVRMC_v1
+	{
+		uint64_t PosesSeen;					// Pose updates handled by the driver
+		uint64_t Compensated;				// Poses that got motion compensation applied
+		uint64_t PassedThrough;				// Poses of a compensated device sent on unchanged, because no valid zero or reference pose was available
+		uint64_t RejectedPoseInvalid;		// Poses ignored because poseIsValid was false
+		uint64_t RejectedTrackingResult;	// Poses ignored because the tracking result was not TrackingResult_Running_OK
+	};
+
+	// Snapshot of the driver counters, returned by VRMotionCompensation::getDriverCounters().
+	// The per device counters are read from shared memory instead, they would make every ipc reply several kilobytes large.
+	struct MotionCompensationCounters_OVRMC_v1
+	{
+		uint64_t RefPoseUpdates;			// Reference tracker poses fed into the filters
+		uint64_t RefPoseStale;				// Poses compensated with a reference pose that has not been updated for a while
+		uint64_t ZeroPoseResets;			// Times the zero pose was invalidated
+		uint64_t FilterResets;				// Times the reference pose was invalidated and the filters had to settle again
+		uint64_t RefPoseRejected;			// Reference poses kept out of the filters by the anomaly detector
+		uint64_t RefPoseDownWeighted;		// Reference poses pulled towards the predicted position by the anomaly detector
+		uint64_t RefPoseTimeGaps;			// Reference poses that arrived after a gap in the tracking
+		bool Enabled;
+		bool ZeroPoseValid;
+		bool RefPoseValid;
+	};
+
+	// Live counters of one device, the pose hooks only ever increment them with relaxed atomics
+	struct SharedDeviceCounters_OVRMC_v1
+	{
+		std::atomic<uint64_t> PosesSeen;
+		std::atomic<uint64_t> Compensated;
+		std::atomic<uint64_t> PassedThrough;
+		std::atomic<uint64_t> RejectedPoseInvalid;
+		std::atomic<uint64_t> RejectedTrackingResult;
+
+		// Not atomic as a whole, counters may be off by the poses handled while copying
+		void read(DeviceCounters_OVRMC_v1& Target) const
+		{
+			Target.PosesSeen = PosesSeen.load(std::memory_order_relaxed);
+			Target.Compensated = Compensated.load(std::memory_order_relaxed);
+			Target.PassedThrough = PassedThrough.load(std::memory_order_relaxed);
+			Target.RejectedPoseInvalid = RejectedPoseInvalid.load(std::memory_order_relaxed);
+			Target.RejectedTrackingResult = RejectedTrackingResult.load(std::memory_order_relaxed);
+		}
+	};
+
+	// Per device pose counters, published by the driver in the shared memory segment OVRMC_CountersMMFv1
+	struct MMFstruct_Counters_OVRMC_v1
+	{
+		uint32_t Version;		// 1
+		uint32_t DeviceCount;	// vr::k_unMaxTrackedDeviceCount
+
+		SharedDeviceCounters_OVRMC_v1 Devices[vr::k_unMaxTrackedDeviceCount];
+	};
+
+	// Latency histograms of the pose update hooks, published by the driver in the shared memory segment OVRMC_LatencyMMFv1.
+	// Values are nanoseconds. Buckets are log-linear: every power of two is split into 2^LATENCY_HISTOGRAM_SUB_BUCKET_BITS buckets,
+	// so the relative error of a percentile is below 1 / 2^LATENCY_HISTOGRAM_SUB_BUCKET_BITS.
+	#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS 3
+	#define LATENCY_HISTOGRAM_BUCKETS 256
+	#define LATENCY_HOOK_VERSIONS 3		// IVRServerDriverHost004, 005 and 006
+
+	struct LatencyHistogram_OVRMC_v1
+	{
+		std::atomic<uint64_t> Count;
+		std::atomic<uint64_t> SumNanoseconds;
+		std::atomic<uint64_t> MaxNanoseconds;
+		std::atomic<uint64_t> Buckets[LATENCY_HISTOGRAM_BUCKETS];
+
+		static uint32_t bucketIndex(uint64_t Nanoseconds)
+		{
+			const uint64_t SubBuckets = 1ull << LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+			if (Nanoseconds < SubBuckets)
+			{
+				return (uint32_t)Nanoseconds;
+			}
+
+			uint32_t Exponent = 0;
+			while ((Nanoseconds >> Exponent) >= 2 * SubBuckets)
+			{
+				Exponent++;
+			}
+
+			uint64_t Index = (Exponent + 1) * SubBuckets + ((Nanoseconds >> Exponent) - SubBuckets);
+			return Index < LATENCY_HISTOGRAM_BUCKETS ? (uint32_t)Index : LATENCY_HISTOGRAM_BUCKETS - 1;
+		}
+
+		// Largest value that falls into the bucket
+		static uint64_t bucketUpperBound(uint32_t Index)
+		{
+			const uint64_t SubBuckets = 1ull << LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+			if (Index < SubBuckets)
+			{
+				return Index;
+			}
+
+			uint32_t Exponent = Index / (uint32_t)SubBuckets - 1;
+			return ((SubBuckets + Index % SubBuckets + 1) << Exponent) - 1;
+		}
+
+		// Percentile in the range 0..1, e.g. 0.99
+		uint64_t percentile(double Fraction) const
+		{
+			uint64_t Total = Count.load(std::memory_order_relaxed);
+			if (Total == 0)
+			{
+				return 0;
+			}
+
+			uint64_t Rank = (uint64_t)(Fraction * (double)Total);
+			uint64_t Seen = 0;
+			for (uint32_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+			{
+				Seen += Buckets[i].load(std::memory_order_relaxed);
+				if (Seen > Rank)
+				{
+					return bucketUpperBound(i);
+				}
+			}
+
+			return MaxNanoseconds.load(std::memory_order_relaxed);
+		}
+	};
+
+	struct MMFstruct_Latency_OVRMC_v1
+	{
+		uint32_t Version;		// 1
+		uint32_t BucketCount;	// LATENCY_HISTOGRAM_BUCKETS
+
+		// Indexed by OpenVR device id and hook version - 4
+		LatencyHistogram_OVRMC_v1 Histograms[vr::k_unMaxTrackedDeviceCount][LATENCY_HOOK_VERSIONS];
+	};
+
+	// Compact snapshot of the driver state for live displays, returned by VRMotionCompensation::getTelemetry().
+	// Counters are totals since the driver started, clients derive rates from the difference of two snapshots.
+	struct Telemetry_OVRMC_v1
+	{
+		uint64_t TimestampMicroseconds;		// Steady clock of the driver when the snapshot was taken
+		double RefOffset[3];				// Filtered reference position relative to the zero pose, meters in app space
+		double RefRotation[3];				// Filtered reference rotation relative to the zero pose as euler angles, degrees
+		double RefJitter;					// Noise of the raw reference position, RMS length of the noise vector in meters
+		uint64_t RefPoseUpdates;
+		uint64_t RefPoseRejected;
+		uint64_t RefPoseTimeGaps;
+		uint64_t RefPoseStale;
+		uint64_t FilterResets;
+		uint64_t PosesSeen;					// Summed over all devices
+		uint64_t Compensated;
+		uint64_t PassedThrough;
+		uint64_t HookCalls;					// Hook calls since the previous snapshot, the latencies below cover these calls only
+		uint64_t HookLatencyP50;			// Nanoseconds
+		uint64_t HookLatencyP90;
+		uint64_t HookLatencyP99;
+		uint64_t HookLatencyMax;
+		bool Enabled;
+		bool ZeroPoseValid;
+		bool RefPoseValid;
+	};
+
+	// Tracking noise of one device, measured while it lies still. Returned by VRMotionCompensation::getNoiseStatistics().
+	// Allan deviations are given for averaging times of 2^level poses, the lowest value marks the averaging time where noise stops falling and drift takes over.
+	#define NOISE_ALLAN_LEVELS 14
+
+	struct NoiseStatistics_OVRMC_v1
+	{
+		uint64_t Samples;									// Stationary poses that went into the estimates
+		uint32_t Runs;										// Stationary periods, each one is measured against its own mean
+		double Seconds;										// Total duration of the stationary periods
+		double MeanInterval;								// Seconds between two poses
+		double PositionStdDev[3];							// Meters, per axis of the driver space
+		double RotationStdDev[3];							// Radians, per axis of the device
+		double AllanTau[NOISE_ALLAN_LEVELS];				// Averaging time in seconds
+		double PositionAllanDeviation[NOISE_ALLAN_LEVELS];	// Meters, length over all three axes
+		double RotationAllanDeviation[NOISE_ALLAN_LEVELS];	// Radians, length over all three axes
+		uint64_t AllanPairs[NOISE_ALLAN_LEVELS];			// Averages compared for each level, few pairs mean an uncertain value
+	};
+
+	// Device and compensation state as the driver sees it, read by VRMotionCompensation::getDeviceStates() without an ipc round trip
+	#define DEVICE_STATE_SERIAL_LENGTH 64
+
+	struct DeviceState_OVRMC_v1
+	{
+		bool Valid;									// The driver has an activated device with this OpenVR id
+		vr::ETrackedDeviceClass DeviceClass;
+		MotionCompensationDeviceMode DeviceMode;
+		char Serial[DEVICE_STATE_SERIAL_LENGTH];
+		bool PoseValid;								// Last pose was valid and tracking was ok
+		uint64_t LastPoseMicroseconds;				// Steady clock of the driver, 0 before the first pose
+	};
+
+	struct DeviceStates_OVRMC_v1
+	{
+		uint32_t Sequence;							// Changes whenever the driver publishes a new state
+		uint64_t TimestampMicroseconds;				// Steady clock of the driver when the state was published
+		MotionCompensationMode CompensationMode;
+		int32_t MCdeviceId;
+		int32_t RTdeviceId;
+		bool Enabled;
+		bool ZeroPoseValid;
+		bool RefPoseValid;
+		DeviceState_OVRMC_v1 Devices[vr::k_unMaxTrackedDeviceCount];
+	};
+
+	// Changes the driver pushes to subscribed clients, see VRMotionCompensation::subscribeEvents()
+	enum class DriverEventType : uint32_t
+	{
+		None = 0,
+		DeviceAdded = 1,					// Serial and DeviceClass are set, the OpenVR id is not known yet
+		DeviceActivated = 2,				// Value is 1 when the device became valid, 0 when it was removed
+		DeviceModeChanged = 3,				// Value is the MotionCompensationDeviceMode
+		DevicePoseValidChanged = 4,			// Value is 1 when the device tracks again, 0 when tracking was lost
+		CompensationModeChanged = 5,		// Value is the MotionCompensationMode
+		ZeroPoseValidChanged = 6,			// Value is the new flag
+		RefPoseValidChanged = 7,			// Value is the new flag
+	};
+
+	#define DRIVER_EVENT_MASK(type) (1u << (uint32_t)(type))
+	#define DRIVER_EVENT_MASK_ALL 0xFFFFFFFEu
+
+	struct DriverEvent_OVRMC_v1
+	{
+		DriverEventType Type;
+		uint32_t OpenVRId;							// vr::k_unTrackedDeviceIndexInvalid for events that are not about one device
+		uint32_t Value;
+		uint32_t Coalesced;							// Events of the same type and device that were merged into this one, only the newest value is kept
+		uint32_t Dropped;							// Events lost before this one because the queue of the client was full
+		uint64_t TimestampMicroseconds;				// Steady clock of the driver
+		vr::ETrackedDeviceClass DeviceClass;
+		char Serial[DEVICE_STATE_SERIAL_LENGTH];
+	};
+
+	// Published by the driver in the shared memory segment OVRMC_DeviceStateMMFv1.
+	// States is guarded by a sequence lock: the driver makes Sequence odd, writes and makes it even again, readers retry when it was odd or changed.
+	// Pose times change with every pose and are kept outside of the lock, so the hooks never touch Sequence.
+	struct MMFstruct_DeviceState_OVRMC_v1
+	{
+		uint32_t Version;		// 1
+		uint32_t DeviceCount;	// vr::k_unMaxTrackedDeviceCount
+		std::atomic<uint32_t> Sequence;
+		DeviceStates_OVRMC_v1 States;
+		std::atomic<uint64_t> LastPoseMicroseconds[vr::k_unMaxTrackedDeviceCount];
+		std::atomic<uint32_t> PoseValid[vr::k_unMaxTrackedDeviceCount];
+
+		// Single writer
+		void write(const DeviceStates_OVRMC_v1& NewStates)
+		{
+			uint32_t Current = Sequence.load(std::memory_order_relaxed);
+			Sequence.store(Current + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			memcpy(static_cast<void*>(&States), &NewStates, sizeof(DeviceStates_OVRMC_v1));
+			States.Sequence = Current + 2;
+			Sequence.store(Current + 2, std::memory_order_release);
+		}
+
+		// Returns false when the writer kept changing the state or nothing was published yet
+		bool read(DeviceStates_OVRMC_v1& Target) const
+		{
+			for (int Attempt = 0; Attempt < 100; Attempt++)
+			{
+				uint32_t Before = Sequence.load(std::memory_order_acquire);
+				if (Before == 0)
+				{
+					return false;
+				}
+				if (Before & 1)
+				{
+					continue;
+				}
+
+				memcpy(&Target, static_cast<const void*>(&States), sizeof(DeviceStates_OVRMC_v1));
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (Sequence.load(std::memory_order_relaxed) != Before)
+				{
+					continue;
+				}
+
+				for (uint32_t i = 0; i < vr::k_unMaxTrackedDeviceCount; i++)
+				{
+					Target.Devices[i].LastPoseMicroseconds = LastPoseMicroseconds[i].load(std::memory_order_relaxed);
+					Target.Devices[i].PoseValid = PoseValid[i].load(std::memory_order_relaxed) != 0;
+				}
+				return true;
+			}
+			return false;
+		}
+	};
+
 } // end namespace vrmotioncompensation
\ No newline at end of file
@@ -1,8 +1,9 @@
 #include <vrmotioncompensation.h>
-#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <algorithm>
 #include <cstdlib>
 #include <functional>
 #include <iostream>
+#include <vector>
 #include <config.h>
 
 
@@ -17,6 +18,41 @@
 
 namespace vrmotioncompensation
 {
+	namespace
+	{
+		// Sets the value of an asynchronous request from its reply, void requests only check the reply
+		// copy gets the same value, it is the promise of the caller when promise belongs to a handler
+		template<typename T>
+		struct AsyncResult
+		{
+			template<typename F>
+			static void Set(std::promise<T>& promise, std::promise<T>* copy, const F& interpret, const ipc::Reply& reply)
+			{
+				T value = interpret(reply);
+				if (copy)
+				{
+					copy->set_value(value);
+				}
+				promise.set_value(std::move(value));
+			}
+		};
+
+		template<>
+		struct AsyncResult<void>
+		{
+			template<typename F>
+			static void Set(std::promise<void>& promise, std::promise<void>* copy, const F& interpret, const ipc::Reply& reply)
+			{
+				interpret(reply);
+				if (copy)
+				{
+					copy->set_value();
+				}
+				promise.set_value();
+			}
+		};
+	}
+
 // Receives and dispatches ipc messages
 	void VRMotionCompensation::_ipcThreadFunc(VRMotionCompensation* _this)
 	{
@@ -26,32 +62,44 @@ namespace vrmotioncompensation
 			try
 			{
 				ipc::Reply message;
-				uint64_t recv_size;
-				unsigned priority;
-				boost::posix_time::ptime timeout = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(50);
-				if (_this->_ipcClientQueue->timed_receive(&message, sizeof(ipc::Reply), recv_size, priority, timeout))
+				if (_this->_ipcClientQueue->Pop(message, _this->_expireRequests()))
 				{
-					if (recv_size == sizeof(ipc::Reply))
+					if (message.type == ipc::ReplyType::Event)
 					{
-						std::lock_guard<std::recursive_mutex> lock(_this->_mutex);
-						auto i = _this->_ipcPromiseMap.find(message.messageId);
-						if (i != _this->_ipcPromiseMap.end())
+						DriverEventHandler handler;
 						{
-							if (i->second.isValid)
+							std::lock_guard<std::recursive_mutex> lock(_this->_mutex);
+							handler = _this->_eventHandler;
+						}
+						if (handler)
+						{
+							DriverEvent_OVRMC_v1 event = message.msg.ev_Event.event;
+							_this->_dispatch([handler, event]()
 							{
-								i->second.promise.set_value(message);
-							}
-							else
+								handler(event);
+							});
+						}
+					}
+					else
+					{
+						_ipcReplyHandler handler;
+						{
+							std::lock_guard<std::recursive_mutex> lock(_this->_mutex);
+							auto i = _this->_ipcPromiseMap.find(message.messageId);
+							if (i != _this->_ipcPromiseMap.end())
 							{
-								_this->_ipcPromiseMap.erase(i); // nobody wants it, so we delete it
+								handler = std::move(i->second.handler);
+								_this->_ipcPromiseMap.erase(i);
 							}
 						}
+
+						// Asynchronous requests complete without the lock, the handler may send the next request
+						if (handler)
+						{
+							handler(message, nullptr);
+						}
 					}
 				}
-				else
-				{
-					std::this_thread::sleep_for(std::chrono::milliseconds(1));
-				}
 			}
 			catch (std::exception & ex)
 			{
@@ -61,6 +109,46 @@ namespace vrmotioncompensation
 		_this->_ipcThreadRunning = false;
 	}
 
+	void VRMotionCompensation::_handlerThreadFunc(VRMotionCompensation* _this)
+	{
+		std::unique_lock<std::mutex> lock(_this->_handlerMutex);
+		while (true)
+		{
+			_this->_handlerCondition.wait(lock, [_this]()
+			{
+				return _this->_handlerThreadStop || !_this->_handlerQueue.empty();
+			});
+
+			// Handlers still queued when the destructor stops the thread run first
+			if (_this->_handlerQueue.empty())
+			{
+				break;
+			}
+			std::function<void()> call = std::move(_this->_handlerQueue.front());
+			_this->_handlerQueue.pop_front();
+
+			lock.unlock();
+			try
+			{
+				call();
+			}
+			catch (std::exception & ex)
+			{
+				WRITELOG(ERROR, "Exception in handler: " << ex.what() << std::endl);
+			}
+			lock.lock();
+		}
+	}
+
+	void VRMotionCompensation::_dispatch(std::function<void()> call)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_handlerMutex);
+			_handlerQueue.push_back(std::move(call));
+		}
+		_handlerCondition.notify_one();
+	}
+
 	VRMotionCompensation::VRMotionCompensation(const std::string& serverQueue, const std::string& clientQueue) : _ipcServerQueueName(serverQueue), _ipcClientQueueName(clientQueue)
 	{
 	}
@@ -68,6 +156,16 @@ namespace vrmotioncompensation
 	VRMotionCompensation::~VRMotionCompensation()
 	{
 		disconnect();
+
+		if (_handlerThread.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> lock(_handlerMutex);
+				_handlerThreadStop = true;
+			}
+			_handlerCondition.notify_one();
+			_handlerThread.join();
+		}
 	}
 
 	bool VRMotionCompensation::isConnected() const
@@ -82,7 +180,7 @@ namespace vrmotioncompensation
 		// Open server-side message queue
 			try
 			{
-				_ipcServerQueue = new boost::interprocess::message_queue(boost::interprocess::open_only, _ipcServerQueueName.c_str());
+				_ipcServerQueue = new ipc::ServerRing(boost::interprocess::open_only, _ipcServerQueueName);
 			}
 			catch (std::exception & e)
 			{
@@ -96,13 +194,7 @@ namespace vrmotioncompensation
 			// Open client-side message queue
 			try
 			{
-				boost::interprocess::message_queue::remove(_ipcClientQueueName.c_str());
-				_ipcClientQueue = new boost::interprocess::message_queue(
-					boost::interprocess::create_only,
-					_ipcClientQueueName.c_str(),
-					100,					//max message number
-					sizeof(ipc::Reply)    //max message size
-				);
+				_ipcClientQueue = new ipc::ClientRing(boost::interprocess::create_only, _ipcClientQueueName);
 			}
 			catch (std::exception & e)
 			{
@@ -113,36 +205,36 @@ namespace vrmotioncompensation
 				ss << "Could not open client-side message queue: " << e.what();
 				throw vrmotioncompensation_connectionerror(ss.str());
 			}
-			// Start ipc thread
+			// Start ipc thread, the handler thread outlives disconnects
+			if (!_handlerThread.joinable())
+			{
+				_handlerThread = std::thread(_handlerThreadFunc, this);
+			}
 			_ipcThreadStop = false;
 			_ipcThread = std::thread(_ipcThreadFunc, this);
 			// Send ClientConnect message to server
 			ipc::Request message(ipc::RequestType::IPC_ClientConnect);
-			auto messageId = _ipcRandomDist(_ipcRandomDevice);
-			message.msg.ipc_ClientConnect.messageId = messageId;
 			message.msg.ipc_ClientConnect.ipcProcotolVersion = IPC_PROTOCOL_VERSION;
 			strncpy_s(message.msg.ipc_ClientConnect.queueName, _ipcClientQueueName.c_str(), 127);
 			message.msg.ipc_ClientConnect.queueName[127] = '\0';
-			std::promise<ipc::Reply> respPromise;
-			auto respFuture = respPromise.get_future();
+			// Wait for response
+			ipc::Reply resp;
+			try
 			{
-				std::lock_guard<std::recursive_mutex> lock(_mutex);
-				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+				resp = _requestAsync<ipc::Reply>(message, message.msg.ipc_ClientConnect.messageId, IPC_REPLY_TIMEOUT_MS, nullptr, [](const ipc::Reply& reply)
+				{
+					return reply;
+				}).get();
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
-			// Wait for response
-			auto resp = respFuture.get();
-			m_clientId = resp.msg.ipc_ClientConnect.clientId;
+			catch (...)
 			{
-				std::lock_guard<std::recursive_mutex> lock(_mutex);
-				_ipcPromiseMap.erase(messageId);
+				_closeConnection("Connection failed.");
+				throw;
 			}
+			m_clientId = resp.msg.ipc_ClientConnect.clientId;
 			if (resp.status != ipc::ReplyStatus::Ok)
 			{
-				delete _ipcServerQueue;
-				_ipcServerQueue = nullptr;
-				delete _ipcClientQueue;
-				_ipcClientQueue = nullptr;
+				_closeConnection("Connection rejected.");
 				std::stringstream ss;
 				ss << "Connection rejected by server: ";
 				if (resp.status == ipc::ReplyStatus::InvalidVersion)
@@ -150,7 +242,7 @@ namespace vrmotioncompensation
 					ss << "Incompatible ipc protocol versions (server: " << resp.msg.ipc_ClientConnect.ipcProcotolVersion << ", client: " << IPC_PROTOCOL_VERSION << ")";
 					throw vrmotioncompensation_invalidversion(ss.str());
 				}
-				else if (resp.status != ipc::ReplyStatus::Ok)
+				else
 				{
 					ss << "Error code " << (int)resp.status;
 					throw vrmotioncompensation_connectionerror(ss.str());
@@ -163,126 +255,287 @@ namespace vrmotioncompensation
 	{
 		if (_ipcServerQueue)
 		{
-			// Send disconnect message (so the server can free resources)
+			// Send disconnect message (so the server can free resources), the connection is closed whether the driver answers or not
 			ipc::Request message(ipc::RequestType::IPC_ClientDisconnect);
-			auto messageId = _ipcRandomDist(_ipcRandomDevice);
 			message.msg.ipc_ClientDisconnect.clientId = m_clientId;
-			message.msg.ipc_ClientDisconnect.messageId = messageId;
-			std::promise<ipc::Reply> respPromise;
-			auto respFuture = respPromise.get_future();
+			try
 			{
-				std::lock_guard<std::recursive_mutex> lock(_mutex);
-				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+				_requestAsync<void>(message, message.msg.ipc_ClientDisconnect.messageId, IPC_REPLY_TIMEOUT_MS, nullptr, [](const ipc::Reply&)
+				{
+				}).get();
 			}
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
-			auto resp = respFuture.get();
-			m_clientId = resp.msg.ipc_ClientConnect.clientId;
+			catch (std::exception & ex)
 			{
-				std::lock_guard<std::recursive_mutex> lock(_mutex);
-				_ipcPromiseMap.erase(messageId);
+				WRITELOG(WARNING, "Driver did not confirm the disconnect: " << ex.what() << std::endl);
 			}
-			// Stop ipc thread
-			if (_ipcThreadRunning)
+			_closeConnection("Connection closed.");
+		}
+	}
+
+	void VRMotionCompensation::_closeConnection(const std::string& reason)
+	{
+		// Stop ipc thread
+		if (_ipcThread.joinable())
+		{
+			_ipcThreadStop = true;
+			_ipcThread.join();
+		}
+		_abortRequests(reason);
+		// delete message queues
+		if (_ipcServerQueue)
+		{
+			delete _ipcServerQueue;
+			_ipcServerQueue = nullptr;
+		}
+		if (_ipcClientQueue)
+		{
+			delete _ipcClientQueue;
+			_ipcClientQueue = nullptr;
+		}
+	}
+
+	void VRMotionCompensation::_sendRequest(const ipc::Request& message)
+	{
+		if (!_ipcServerQueue->Push(message, IPC_SEND_TIMEOUT_MS))
+		{
+			throw vrmotioncompensation_connectionerror("Server is not receiving requests.");
+		}
+	}
+
+	void VRMotionCompensation::_sendFireAndForget(const ipc::Request& message)
+	{
+		if (!_ipcServerQueue)
+		{
+			throw vrmotioncompensation_connectionerror("No active connection.");
+		}
+		_sendRequest(message);
+	}
+
+	void VRMotionCompensation::_sendAsyncRequest(ipc::Request& message, uint32_t& messageId, uint32_t timeoutMs, _ipcReplyHandler handler)
+	{
+		if (!_ipcServerQueue)
+		{
+			throw vrmotioncompensation_connectionerror("No active connection.");
+		}
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+		uint32_t id;
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+			// With many requests in flight a random id can repeat, 0 asks the driver not to reply
+			do
 			{
-				_ipcThreadStop = true;
-				_ipcThread.join();
-			}
-			// delete message queues
-			if (_ipcServerQueue)
+				id = _ipcRandomDist(_ipcRandomDevice);
+			} while (id == 0 || _ipcPromiseMap.find(id) != _ipcPromiseMap.end());
+
+			_ipcPromiseMap.insert({ id, _ipcPromiseMapEntry(std::move(handler), deadline) });
+			if (deadline < _ipcNextDeadline)
 			{
-				delete _ipcServerQueue;
-				_ipcServerQueue = nullptr;
+				_ipcNextDeadline = deadline;
 			}
-			if (_ipcClientQueue)
+		}
+		messageId = id;
+
+		try
+		{
+			_sendRequest(message);
+		}
+		catch (...)
+		{
+			// With timeoutMs below IPC_SEND_TIMEOUT_MS the ipc thread may have expired the request while the send waited.
+			// Its handler has reported the timeout then, throwing as well would report the failure twice.
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			if (_ipcPromiseMap.erase(id) != 0)
 			{
-				delete _ipcClientQueue;
-				_ipcClientQueue = nullptr;
+				throw;
 			}
 		}
 	}
 
-	void VRMotionCompensation::ping(bool modal, bool enableReply)
+	template<typename T, typename F>
+	std::future<T> VRMotionCompensation::_requestAsync(ipc::Request& message, uint32_t& messageId, uint32_t timeoutMs, AsyncHandler<T> handler, F interpret)
 	{
-		if (_ipcServerQueue)
+		auto promise = std::make_shared<std::promise<T>>();
+		std::future<T> result = promise->get_future();
+
+		// A handler gets a future of its own with the same result, the one of the caller stays valid
+		std::shared_ptr<std::promise<T>> handlerPromise;
+		std::shared_ptr<std::future<T>> handlerFuture;
+		if (handler)
+		{
+			handlerPromise = std::make_shared<std::promise<T>>();
+			handlerFuture = std::make_shared<std::future<T>>(handlerPromise->get_future());
+		}
+
+		_sendAsyncRequest(message, messageId, timeoutMs, [this, promise, handlerPromise, handlerFuture, handler, interpret](const ipc::Reply& reply, std::exception_ptr error)
 		{
-			uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
-			uint64_t nonce = _ipcRandomDist(_ipcRandomDevice);
-			ipc::Request message(ipc::RequestType::IPC_Ping);
-			message.msg.ipc_Ping.clientId = m_clientId;
-			message.msg.ipc_Ping.messageId = messageId;
-			message.msg.ipc_Ping.nonce = nonce;
-			if (modal)
+			if (!error)
 			{
-				std::promise<ipc::Reply> respPromise;
-				auto respFuture = respPromise.get_future();
+				try
 				{
-					std::lock_guard<std::recursive_mutex> lock(_mutex);
-					_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+					AsyncResult<T>::Set(*promise, handlerPromise.get(), interpret, reply);
 				}
-				_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
-				auto resp = respFuture.get();
+				catch (...)
 				{
-					std::lock_guard<std::recursive_mutex> lock(_mutex);
-					_ipcPromiseMap.erase(messageId);
+					error = std::current_exception();
 				}
-				if (resp.status != ipc::ReplyStatus::Ok)
+			}
+			if (error)
+			{
+				promise->set_exception(error);
+				if (handlerPromise)
 				{
-					std::stringstream ss;
-					ss << "Error while pinging server: Error code " << (int)resp.status;
-					throw vrmotioncompensation_exception(ss.str());
+					handlerPromise->set_exception(error);
 				}
 			}
-			else
+
+			if (handler)
 			{
-				if (enableReply)
+				_dispatch([handler, handlerFuture]()
 				{
-					std::lock_guard<std::recursive_mutex> lock(_mutex);
-					message.msg.ipc_Ping.messageId = messageId;
-					_ipcPromiseMap.insert({ messageId, _ipcPromiseMapEntry() });
-				}
-				else
+					handler(std::move(*handlerFuture));
+				});
+			}
+		});
+		return result;
+	}
+
+	uint32_t VRMotionCompensation::_expireRequests()
+	{
+		auto now = std::chrono::steady_clock::now();
+		std::vector<_ipcReplyHandler> expired;
+		uint32_t waitMs = 50;
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			if (now >= _ipcNextDeadline)
+			{
+				_ipcNextDeadline = std::chrono::steady_clock::time_point::max();
+				for (auto i = _ipcPromiseMap.begin(); i != _ipcPromiseMap.end(); )
 				{
-					message.msg.ipc_Ping.messageId = 0;
+					if (i->second.deadline <= now)
+					{
+						expired.push_back(std::move(i->second.handler));
+						i = _ipcPromiseMap.erase(i);
+					}
+					else
+					{
+						if (i->second.deadline < _ipcNextDeadline)
+						{
+							_ipcNextDeadline = i->second.deadline;
+						}
+						++i;
+					}
 				}
-				_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+			}
+
+			if (_ipcNextDeadline != std::chrono::steady_clock::time_point::max())
+			{
+				auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(_ipcNextDeadline - now).count() + 1;
+				waitMs = (uint32_t)std::max<int64_t>(1, std::min<int64_t>(waitMs, remaining));
 			}
 		}
-		else
+
+		if (!expired.empty())
 		{
-			throw vrmotioncompensation_connectionerror("No active connection.");
+			auto error = std::make_exception_ptr(vrmotioncompensation_timeout("Driver did not reply in time."));
+			ipc::Reply none;
+			for (auto& handler : expired)
+			{
+				try
+				{
+					handler(none, error);
+				}
+				catch (std::exception & ex)
+				{
+					WRITELOG(ERROR, "Exception in request handler: " << ex.what() << std::endl);
+				}
+			}
 		}
+		return waitMs;
 	}
 
-	void VRMotionCompensation::getDeviceInfo(uint32_t OpenVRId, DeviceInfo& info)
+	void VRMotionCompensation::_abortRequests(const std::string& reason)
 	{
-		if (_ipcServerQueue)
+		std::vector<_ipcReplyHandler> aborted;
 		{
-			//Create message
-			ipc::Request message(ipc::RequestType::DeviceManipulation_GetDeviceInfo);			
-			memset(&message.msg, 0, sizeof(message.msg));
-			message.msg.ovr_GenericDeviceIdMessage.clientId = m_clientId;
-			message.msg.ovr_GenericDeviceIdMessage.OpenVRId = OpenVRId;
-
-			//Create random message ID
-			uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
-			message.msg.ovr_GenericDeviceIdMessage.messageId = messageId;
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			for (auto& i : _ipcPromiseMap)
+			{
+				aborted.push_back(std::move(i.second.handler));
+			}
+			_ipcPromiseMap.clear();
+			_ipcNextDeadline = std::chrono::steady_clock::time_point::max();
+		}
 
-			//Allocate memory for the reply
-			std::promise<ipc::Reply> respPromise;
-			auto respFuture = respPromise.get_future();
+		auto error = std::make_exception_ptr(vrmotioncompensation_connectionerror(reason));
+		ipc::Reply none;
+		for (auto& handler : aborted)
+		{
+			try
+			{
+				handler(none, error);
+			}
+			catch (std::exception & ex)
 			{
-				std::lock_guard<std::recursive_mutex> lock(_mutex);
-				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+				WRITELOG(ERROR, "Exception in request handler: " << ex.what() << std::endl);
 			}
+		}
+	}
 
-			//Send message
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+	void VRMotionCompensation::ping(bool modal, bool enableReply)
+	{
+		ipc::Request message(ipc::RequestType::IPC_Ping);
+		message.msg.ipc_Ping.clientId = m_clientId;
+		message.msg.ipc_Ping.messageId = 0;
+		message.msg.ipc_Ping.nonce = _ipcRandomDist(_ipcRandomDevice);
 
-			auto resp = respFuture.get();
+		auto interpret = [](const ipc::Reply& resp)
+		{
+			if (resp.status != ipc::ReplyStatus::Ok)
 			{
-				std::lock_guard<std::recursive_mutex> lock(_mutex);
-				_ipcPromiseMap.erase(messageId);
+				std::stringstream ss;
+				ss << "Error while pinging server: Error code " << (int)resp.status;
+				throw vrmotioncompensation_exception(ss.str());
 			}
+		};
+
+		if (modal)
+		{
+			_requestAsync<void>(message, message.msg.ipc_Ping.messageId, IPC_REPLY_TIMEOUT_MS, nullptr, interpret).get();
+		}
+		else if (enableReply)
+		{
+			// Nobody waits for the reply, the handler only drops it
+			_requestAsync<void>(message, message.msg.ipc_Ping.messageId, IPC_REPLY_TIMEOUT_MS, [](std::future<void>)
+			{
+			}, interpret);
+		}
+		else
+		{
+			_sendFireAndForget(message);
+		}
+	}
+
+	void VRMotionCompensation::getDeviceInfo(uint32_t OpenVRId, DeviceInfo& info)
+	{
+		info = getDeviceInfoAsync(OpenVRId).get();
+	}
+
+	std::future<DeviceInfo> VRMotionCompensation::getDeviceInfoAsync(uint32_t OpenVRId, AsyncHandler<DeviceInfo> handler, uint32_t timeoutMs)
+	{
+		//Create message
+		ipc::Request message(ipc::RequestType::DeviceManipulation_GetDeviceInfo);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.ovr_GenericDeviceIdMessage.clientId = m_clientId;
+		message.msg.ovr_GenericDeviceIdMessage.OpenVRId = OpenVRId;
+
+		return _requestAsync<DeviceInfo>(message, message.msg.ovr_GenericDeviceIdMessage.messageId, timeoutMs, handler, [OpenVRId](const ipc::Reply& resp)
+		{
+			DeviceInfo info;
+			info.OpenVRId = OpenVRId;
+			info.deviceClass = resp.msg.dm_deviceInfo.deviceClass;
+			info.deviceMode = MotionCompensationDeviceMode::Default;
 
 			//If there was an error, notify the user
 			std::stringstream ss;
@@ -291,40 +544,31 @@ namespace vrmotioncompensation
 			if (resp.status == ipc::ReplyStatus::Ok)
 			{
 				info.OpenVRId = resp.msg.dm_deviceInfo.OpenVRId;
-				info.deviceClass = resp.msg.dm_deviceInfo.deviceClass;
 				info.deviceMode = resp.msg.dm_deviceInfo.deviceMode;
 			}
-			else if (resp.status == ipc::ReplyStatus::NotFound)
-			{
-				info.deviceClass = resp.msg.dm_deviceInfo.deviceClass;
-			}
 			else if (resp.status == ipc::ReplyStatus::InvalidId)
 			{
 				ss << "Invalid device id";
 				throw vrmotioncompensation_invalidid(ss.str());
 			}
-			/*else if (resp.status == ipc::ReplyStatus::NotFound)
-			{
-				ss << "Device not found";
-				throw vrmotioncompensation_notfound(ss.str());
-			}*/
-			else if (resp.status != ipc::ReplyStatus::Ok)
+			else if (resp.status != ipc::ReplyStatus::NotFound)
 			{
 				ss << "Error code " << (int)resp.status;
 				throw vrmotioncompensation_exception(ss.str());
 			}
-		}
-		else
-		{
-			throw vrmotioncompensation_connectionerror("No active connection.");
-		}
+			return info;
+		});
 	}
 
 	void VRMotionCompensation::setDeviceMotionCompensationMode(uint32_t MCdeviceId, uint32_t RTdeviceId, MotionCompensationMode Mode, bool modal)
 	{
-		if (_ipcServerQueue)
+		if (modal)
+		{
+			setDeviceMotionCompensationModeAsync(MCdeviceId, RTdeviceId, Mode).get();
+		}
+		else
 		{
-			//Create message
+			//Create message, message id 0 asks for no reply
 			ipc::Request message(ipc::RequestType::DeviceManipulation_MotionCompensationMode);
 			memset(&message.msg, 0, sizeof(message.msg));
 			message.msg.dm_MotionCompensationMode.clientId = m_clientId;
@@ -333,268 +577,419 @@ namespace vrmotioncompensation
 			message.msg.dm_MotionCompensationMode.RTdeviceId = RTdeviceId;
 			message.msg.dm_MotionCompensationMode.CompensationMode = Mode;
 
-			if (modal)
-			{
-				//Create random message ID
-				uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
-				message.msg.dm_MotionCompensationMode.messageId = messageId;
-
-				//Allocate memory for the reply
-				std::promise<ipc::Reply> respPromise;
-				auto respFuture = respPromise.get_future();
-				{
-					std::lock_guard<std::recursive_mutex> lock(_mutex);
-					_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
-				}
-
-				//Send message
-				_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
-
-				auto resp = respFuture.get();
-				{
-					std::lock_guard<std::recursive_mutex> lock(_mutex);
-					_ipcPromiseMap.erase(messageId);
-				}
+			_sendFireAndForget(message);
+		}
+	}
 
-				//If there was an error, notify the user
-				std::stringstream ss;
-				ss << "Error while setting motion compensation mode: ";
+	std::future<void> VRMotionCompensation::setDeviceMotionCompensationModeAsync(uint32_t MCdeviceId, uint32_t RTdeviceId, MotionCompensationMode Mode, AsyncHandler<void> handler, uint32_t timeoutMs)
+	{
+		//Create message
+		ipc::Request message(ipc::RequestType::DeviceManipulation_MotionCompensationMode);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.dm_MotionCompensationMode.clientId = m_clientId;
+		message.msg.dm_MotionCompensationMode.MCdeviceId = MCdeviceId;
+		message.msg.dm_MotionCompensationMode.RTdeviceId = RTdeviceId;
+		message.msg.dm_MotionCompensationMode.CompensationMode = Mode;
+
+		return _requestAsync<void>(message, message.msg.dm_MotionCompensationMode.messageId, timeoutMs, handler, [](const ipc::Reply& resp)
+		{
+			//If there was an error, notify the user
+			std::stringstream ss;
+			ss << "Error while setting motion compensation mode: ";
 
-				if (resp.status == ipc::ReplyStatus::InvalidId)
-				{
-					ss << "Invalid device id";
-					throw vrmotioncompensation_invalidid(ss.str(), (int)resp.status);
-				}
-				else if (resp.status == ipc::ReplyStatus::NotFound)
-				{
-					ss << "Device not found";
-					throw vrmotioncompensation_notfound(ss.str(), (int)resp.status);
-				}
-				else if (resp.status != ipc::ReplyStatus::Ok)
-				{
-					ss << "Error code " << (int)resp.status;
-					throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
-				}
+			if (resp.status == ipc::ReplyStatus::InvalidId)
+			{
+				ss << "Invalid device id";
+				throw vrmotioncompensation_invalidid(ss.str(), (int)resp.status);
 			}
-			else
+			else if (resp.status == ipc::ReplyStatus::NotFound)
 			{
-				_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+				ss << "Device not found";
+				throw vrmotioncompensation_notfound(ss.str(), (int)resp.status);
 			}
-		}
-		else
-		{
-			throw vrmotioncompensation_connectionerror("No active connection.");
-		}
+			else if (resp.status != ipc::ReplyStatus::Ok)
+			{
+				ss << "Error code " << (int)resp.status;
+				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
+			}
+		});
 	}
 
 	void VRMotionCompensation::setMotionCompensationSettings(double LPF_Beta, uint32_t samples, bool setZero)
 	{
-		if (_ipcServerQueue)
+		setMotionCompensationSettingsAsync(LPF_Beta, samples, setZero).get();
+	}
+
+	std::future<void> VRMotionCompensation::setMotionCompensationSettingsAsync(double LPF_Beta, uint32_t samples, bool setZero, AsyncHandler<void> handler, uint32_t timeoutMs)
+	{
+		//Create message
+		ipc::Request message(ipc::RequestType::DeviceManipulation_SetMotionCompensationProperties);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.dm_SetMotionCompensationProperties.clientId = m_clientId;
+		message.msg.dm_SetMotionCompensationProperties.LPFBeta = LPF_Beta;
+		message.msg.dm_SetMotionCompensationProperties.samples = samples;
+		message.msg.dm_SetMotionCompensationProperties.setZero = setZero;
+
+		return _requestAsync<void>(message, message.msg.dm_SetMotionCompensationProperties.messageId, timeoutMs, handler, [](const ipc::Reply& resp)
 		{
-			//Create message
-			ipc::Request message(ipc::RequestType::DeviceManipulation_SetMotionCompensationProperties);
-			memset(&message.msg, 0, sizeof(message.msg));
-			message.msg.dm_SetMotionCompensationProperties.clientId = m_clientId;
-			message.msg.dm_SetMotionCompensationProperties.messageId = 0;
-			message.msg.dm_SetMotionCompensationProperties.LPFBeta = LPF_Beta;
-			message.msg.dm_SetMotionCompensationProperties.samples = samples;
-			message.msg.dm_SetMotionCompensationProperties.setZero = setZero;
+			//If there was an error, notify the user
+			if (resp.status != ipc::ReplyStatus::Ok)
+			{
+				std::stringstream ss;
+				ss << "Error while setting motion compensation settings: Error code " << (int)resp.status;
+				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
+			}
+		});
+	}
 
-			//Create random message ID
-			uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
-			message.msg.dm_SetMotionCompensationProperties.messageId = messageId;
+	void VRMotionCompensation::resetRefZeroPose()
+	{
+		// Create message
+		ipc::Request message(ipc::RequestType::DeviceManipulation_ResetRefZeroPose);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.dm_ResetRefZeroPose.clientId = m_clientId;
 
-			//Allocate memory for the reply
-			std::promise<ipc::Reply> respPromise;
-			auto respFuture = respPromise.get_future();
+		_requestAsync<void>(message, message.msg.dm_ResetRefZeroPose.messageId, IPC_REPLY_TIMEOUT_MS, nullptr, [](const ipc::Reply& resp)
+		{
+			// If there was an error, notify the user
+			if (resp.status != ipc::ReplyStatus::Ok)
 			{
-				std::lock_guard<std::recursive_mutex> lock(_mutex);
-				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+				std::stringstream ss;
+				ss << "Error while resetting the zero pose: Error code " << (int)resp.status;
+				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
 			}
+		}).get();
+	}
+
+	void VRMotionCompensation::setOffsets(MMFstruct_OVRMC_v1 offsets)
+	{
+		setOffsetsAsync(offsets).get();
+	}
 
-			//Send message
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
-			WRITELOG(INFO, "MC message created sending to driver" << std::endl);
+	std::future<void> VRMotionCompensation::setOffsetsAsync(MMFstruct_OVRMC_v1 offsets, AsyncHandler<void> handler, uint32_t timeoutMs)
+	{
+		//Create message
+		ipc::Request message(ipc::RequestType::DeviceManipulation_SetOffsets);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.dm_SetOffsets.clientId = m_clientId;
+		message.msg.dm_SetOffsets.offsets = offsets;
 
-			auto resp = respFuture.get();
+		return _requestAsync<void>(message, message.msg.dm_SetOffsets.messageId, timeoutMs, handler, [](const ipc::Reply& resp)
+		{
+			//If there was an error, notify the user
+			if (resp.status != ipc::ReplyStatus::Ok)
 			{
-				std::lock_guard<std::recursive_mutex> lock(_mutex);
-				_ipcPromiseMap.erase(messageId);
+				std::stringstream ss;
+				ss << "Error while setting offsets: Error code " << (int)resp.status;
+				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
 			}
+		});
+	}
 
+	void VRMotionCompensation::startDebugLogger(bool enable, bool modal, uint32_t maxDebugPoints)
+	{
+		//Create message
+		ipc::Request message(ipc::RequestType::DebugLogger_Settings);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.dl_Settings.clientId = m_clientId;
+		message.msg.dl_Settings.messageId = 0;
+		message.msg.dl_Settings.enabled = enable;
+		message.msg.dl_Settings.MaxDebugPoints = maxDebugPoints;
+
+		if (!modal)
+		{
+			_sendFireAndForget(message);
+			return;
+		}
+
+		_requestAsync<void>(message, message.msg.dl_Settings.messageId, IPC_REPLY_TIMEOUT_MS, nullptr, [](const ipc::Reply& resp)
+		{
 			//If there was an error, notify the user
 			std::stringstream ss;
-			ss << "Error while setting motion compensation mode: ";
+			ss << "Error while starting debug logger: ";
 
-			if (resp.status != ipc::ReplyStatus::Ok)
+			if (resp.status == ipc::ReplyStatus::InvalidId)
+			{
+				ss << "MC must be running";
+				throw vrmotioncompensation_invalidid(ss.str(), (int)resp.status);
+			}
+			else if (resp.status != ipc::ReplyStatus::Ok)
 			{
 				ss << "Error code " << (int)resp.status;
 				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
 			}
-		}
-		else
-		{
-			throw vrmotioncompensation_connectionerror("No active connection.");
-		}
+		}).get();
 	}
 
-	void VRMotionCompensation::resetRefZeroPose()
+	void VRMotionCompensation::setPoseRecorder(bool enable, const std::string& fileName, bool modal)
 	{
-		if (_ipcServerQueue)
+		//Create message
+		ipc::Request message(ipc::RequestType::PoseRecorder_Settings);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.pr_Settings.clientId = m_clientId;
+		message.msg.pr_Settings.messageId = 0;
+		message.msg.pr_Settings.enabled = enable;
+		strncpy_s(message.msg.pr_Settings.fileName, fileName.c_str(), 127);
+		message.msg.pr_Settings.fileName[127] = '\0';
+
+		if (!modal)
 		{
-			// Create message
-			ipc::Request message(ipc::RequestType::DeviceManipulation_ResetRefZeroPose);
-			memset(&message.msg, 0, sizeof(message.msg));
-			message.msg.dm_ResetRefZeroPose.clientId = m_clientId;
-			message.msg.dm_ResetRefZeroPose.messageId = 0;
-
+			_sendFireAndForget(message);
+			return;
+		}
 
-			// Create random message ID
-			uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
-			message.msg.dm_ResetRefZeroPose.messageId = messageId;
+		_requestAsync<void>(message, message.msg.pr_Settings.messageId, IPC_REPLY_TIMEOUT_MS, nullptr, [](const ipc::Reply& resp)
+		{
+			//If there was an error, notify the user
+			std::stringstream ss;
+			ss << "Error while setting pose recorder: ";
 
-			// Allocate memory for the reply
-			std::promise<ipc::Reply> respPromise;
-			auto respFuture = respPromise.get_future();
+			if (resp.status == ipc::ReplyStatus::InvalidOperation)
 			{
-				std::lock_guard<std::recursive_mutex> lock(_mutex);
-				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+				ss << "Recorder already running or file could not be opened";
+				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
 			}
-
-			// Send message
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
-			WRITELOG(INFO, "MC message created sending to driver" << std::endl);
-
-			auto resp = respFuture.get();
+			else if (resp.status != ipc::ReplyStatus::Ok)
 			{
-				std::lock_guard<std::recursive_mutex> lock(_mutex);
-				_ipcPromiseMap.erase(messageId);
+				ss << "Error code " << (int)resp.status;
+				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
 			}
+		}).get();
+	}
 
-			// If there was an error, notify the user
-			std::stringstream ss;
-			ss << "Error while setting motion compensation mode: ";
+	void VRMotionCompensation::getDriverCounters(MotionCompensationCounters_OVRMC_v1& counters)
+	{
+		//Create message
+		ipc::Request message(ipc::RequestType::DriverCounters_Get);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.ovr_GenericClientMessage.clientId = m_clientId;
 
+		counters = _requestAsync<MotionCompensationCounters_OVRMC_v1>(message, message.msg.ovr_GenericClientMessage.messageId, IPC_REPLY_TIMEOUT_MS, nullptr, [](const ipc::Reply& resp)
+		{
+			//If there was an error, notify the user
 			if (resp.status != ipc::ReplyStatus::Ok)
 			{
-				ss << "Error code " << (int)resp.status;
+				std::stringstream ss;
+				ss << "Error while getting driver counters: Error code " << (int)resp.status;
 				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
 			}
-		}
-		else
-		{
-			throw vrmotioncompensation_connectionerror("No active connection.");
-		}
+			return resp.msg.dc_Counters.counters;
+		}).get();
 	}
 
-	void VRMotionCompensation::setOffsets(MMFstruct_OVRMC_v1 offsets)
+	void VRMotionCompensation::getDeviceCounters(uint32_t OpenVRId, DeviceCounters_OVRMC_v1& counters)
 	{
-		if (_ipcServerQueue)
+		if (OpenVRId >= vr::k_unMaxTrackedDeviceCount)
 		{
-			//Create message
-			ipc::Request message(ipc::RequestType::DeviceManipulation_SetOffsets);
-			memset(&message.msg, 0, sizeof(message.msg));
-			message.msg.dm_SetOffsets.clientId = m_clientId;
-			message.msg.dm_SetOffsets.messageId = 0;
-			message.msg.dm_SetOffsets.offsets = offsets;
-
+			throw vrmotioncompensation_exception("Invalid device id", (int)ipc::ReplyStatus::InvalidId);
+		}
 
-			//Create random message ID
-			uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
-			message.msg.dm_SetOffsets.messageId = messageId;
+#ifdef _WIN32
+		if (!_deviceCounters)
+		{
+			try
+			{
+				_deviceCounterMemory = boost::interprocess::windows_shared_memory(boost::interprocess::open_only, "OVRMC_CountersMMFv1", boost::interprocess::read_only);
+				_deviceCounterRegion = boost::interprocess::mapped_region(_deviceCounterMemory, boost::interprocess::read_only);
+			}
+			catch (std::exception& e)
+			{
+				std::stringstream ss;
+				ss << "Could not open counter shared memory: " << e.what();
+				throw vrmotioncompensation_connectionerror(ss.str());
+			}
 
-			//Allocate memory for the reply
-			std::promise<ipc::Reply> respPromise;
-			auto respFuture = respPromise.get_future();
+			auto mirror = static_cast<const MMFstruct_Counters_OVRMC_v1*>(_deviceCounterRegion.get_address());
+			if (_deviceCounterRegion.get_size() < sizeof(MMFstruct_Counters_OVRMC_v1) || mirror->Version != 1 || mirror->DeviceCount != vr::k_unMaxTrackedDeviceCount)
 			{
-				std::lock_guard<std::recursive_mutex> lock(_mutex);
-				_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
+				_deviceCounterRegion = boost::interprocess::mapped_region();
+				throw vrmotioncompensation_invalidversion("Counter shared memory has an incompatible layout");
 			}
+			_deviceCounters = mirror;
+		}
+
+		_deviceCounters->Devices[OpenVRId].read(counters);
+#else
+		throw vrmotioncompensation_exception("Counter shared memory is only available on Windows");
+#endif
+	}
 
-			//Send message
-			_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
+	void VRMotionCompensation::getTelemetry(Telemetry_OVRMC_v1& telemetry)
+	{
+		//Create message
+		ipc::Request message(ipc::RequestType::Telemetry_Get);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.ovr_GenericClientMessage.clientId = m_clientId;
 
-			auto resp = respFuture.get();
+		telemetry = _requestAsync<Telemetry_OVRMC_v1>(message, message.msg.ovr_GenericClientMessage.messageId, IPC_REPLY_TIMEOUT_MS, nullptr, [](const ipc::Reply& resp)
+		{
+			//If there was an error, notify the user
+			if (resp.status != ipc::ReplyStatus::Ok)
 			{
-				std::lock_guard<std::recursive_mutex> lock(_mutex);
-				_ipcPromiseMap.erase(messageId);
+				std::stringstream ss;
+				ss << "Error while getting telemetry: Error code " << (int)resp.status;
+				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
 			}
+			return resp.msg.tm_Telemetry.telemetry;
+		}).get();
+	}
 
+	void VRMotionCompensation::getNoiseStatistics(uint32_t OpenVRId, NoiseStatistics_OVRMC_v1& statistics, bool reset)
+	{
+		//Create message
+		ipc::Request message(ipc::RequestType::NoiseStatistics_Get);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.ns_Get.clientId = m_clientId;
+		message.msg.ns_Get.OpenVRId = OpenVRId;
+		message.msg.ns_Get.reset = reset;
+
+		statistics = _requestAsync<NoiseStatistics_OVRMC_v1>(message, message.msg.ns_Get.messageId, IPC_REPLY_TIMEOUT_MS, nullptr, [](const ipc::Reply& resp)
+		{
 			//If there was an error, notify the user
-			std::stringstream ss;
-			ss << "Error while setting offsets: ";
-
 			if (resp.status != ipc::ReplyStatus::Ok)
 			{
-				ss << "Error code " << (int)resp.status;
+				std::stringstream ss;
+				ss << "Error while getting noise statistics: Error code " << (int)resp.status;
 				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
 			}
-		}
-		else
+			return resp.msg.ns_Statistics.statistics;
+		}).get();
+	}
+
+	void VRMotionCompensation::subscribeEvents(uint32_t eventMask, DriverEventHandler handler)
+	{
+		if (!_ipcServerQueue)
 		{
 			throw vrmotioncompensation_connectionerror("No active connection.");
 		}
+
+		// Set before subscribing, the first events can arrive before the reply
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			_eventHandler = eventMask != 0 ? handler : nullptr;
+		}
+
+		//Create message
+		ipc::Request message(ipc::RequestType::Events_Subscribe);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.ev_Subscribe.clientId = m_clientId;
+		message.msg.ev_Subscribe.eventMask = eventMask;
+
+		_requestAsync<void>(message, message.msg.ev_Subscribe.messageId, IPC_REPLY_TIMEOUT_MS, nullptr, [](const ipc::Reply& resp)
+		{
+			//If there was an error, notify the user
+			if (resp.status != ipc::ReplyStatus::Ok)
+			{
+				std::stringstream ss;
+				ss << "Error while subscribing to driver events: Error code " << (int)resp.status;
+				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
+			}
+		}).get();
 	}
 
-	void VRMotionCompensation::startDebugLogger(bool enable, bool modal)
+	void VRMotionCompensation::getDeviceStates(DeviceStates_OVRMC_v1& states)
 	{
-		if (_ipcServerQueue)
+#ifdef _WIN32
+		if (!_deviceStates)
 		{
-			//Create message
-			ipc::Request message(ipc::RequestType::DebugLogger_Settings);
-			memset(&message.msg, 0, sizeof(message.msg));
-			message.msg.dl_Settings.clientId = m_clientId;
-			message.msg.dl_Settings.messageId = 0;
-			message.msg.dl_Settings.enabled = enable;
-
-			if (modal)
+			try
+			{
+				_deviceStateMemory = boost::interprocess::windows_shared_memory(boost::interprocess::open_only, "OVRMC_DeviceStateMMFv1", boost::interprocess::read_only);
+				_deviceStateRegion = boost::interprocess::mapped_region(_deviceStateMemory, boost::interprocess::read_only);
+			}
+			catch (std::exception& e)
 			{
-				//Create random message ID
-				uint32_t messageId = _ipcRandomDist(_ipcRandomDevice);
-				message.msg.dl_Settings.messageId = messageId;
+				std::stringstream ss;
+				ss << "Could not open device state shared memory: " << e.what();
+				throw vrmotioncompensation_connectionerror(ss.str());
+			}
 
-				//Allocate memory for the reply
-				std::promise<ipc::Reply> respPromise;
-				auto respFuture = respPromise.get_future();
-				{
-					std::lock_guard<std::recursive_mutex> lock(_mutex);
-					_ipcPromiseMap.insert({ messageId, std::move(respPromise) });
-				}
+			auto mirror = static_cast<const MMFstruct_DeviceState_OVRMC_v1*>(_deviceStateRegion.get_address());
+			if (_deviceStateRegion.get_size() < sizeof(MMFstruct_DeviceState_OVRMC_v1) || mirror->Version != 1 || mirror->DeviceCount != vr::k_unMaxTrackedDeviceCount)
+			{
+				_deviceStateRegion = boost::interprocess::mapped_region();
+				throw vrmotioncompensation_invalidversion("Device state shared memory has an incompatible layout");
+			}
+			_deviceStates = mirror;
+		}
 
-				//Send message
-				_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
-				WRITELOG(INFO, "DL message created sending to driver" << std::endl);
+		if (!_deviceStates->read(states))
+		{
+			throw vrmotioncompensation_exception("Device state is not available");
+		}
+#else
+		throw vrmotioncompensation_exception("Device state shared memory is only available on Windows");
+#endif
+	}
 
-				auto resp = respFuture.get();
-				{
-					std::lock_guard<std::recursive_mutex> lock(_mutex);
-					_ipcPromiseMap.erase(messageId);
-				}
+	void VRMotionCompensation::dumpFlightRecorder(const std::string& fileName, bool modal)
+	{
+		//Create message
+		ipc::Request message(ipc::RequestType::FlightRecorder_Dump);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.fr_Dump.clientId = m_clientId;
+		message.msg.fr_Dump.messageId = 0;
+		strncpy_s(message.msg.fr_Dump.fileName, fileName.c_str(), 127);
+		message.msg.fr_Dump.fileName[127] = '\0';
+
+		if (!modal)
+		{
+			_sendFireAndForget(message);
+			return;
+		}
 
-				//If there was an error, notify the user
-				std::stringstream ss;
-				ss << "Error while starting debug logger: ";
+		_requestAsync<void>(message, message.msg.fr_Dump.messageId, IPC_REPLY_TIMEOUT_MS, nullptr, [](const ipc::Reply& resp)
+		{
+			//If there was an error, notify the user
+			std::stringstream ss;
+			ss << "Error while dumping flight recorder: ";
 
-				if (resp.status == ipc::ReplyStatus::InvalidId)
-				{
-					ss << "MC must be running";
-					throw vrmotioncompensation_invalidid(ss.str(), (int)resp.status);
-				}
-				else if (resp.status != ipc::ReplyStatus::Ok)
-				{
-					ss << "Error code " << (int)resp.status;
-					throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
-				}
+			if (resp.status == ipc::ReplyStatus::InvalidOperation)
+			{
+				ss << "File could not be written";
+				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
 			}
-			else
+			else if (resp.status != ipc::ReplyStatus::Ok)
 			{
-				_ipcServerQueue->send(&message, sizeof(ipc::Request), 0);
-				WRITELOG(INFO, "DL message created sending to driver" << std::endl);
+				ss << "Error code " << (int)resp.status;
+				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
 			}
-		}
-		else
+		}).get();
+	}
+
+	void VRMotionCompensation::setTracing(bool enable, const std::string& fileName, bool modal)
+	{
+		//Create message
+		ipc::Request message(ipc::RequestType::Tracing_Control);
+		memset(&message.msg, 0, sizeof(message.msg));
+		message.msg.tr_Control.clientId = m_clientId;
+		message.msg.tr_Control.messageId = 0;
+		message.msg.tr_Control.enabled = enable;
+		strncpy_s(message.msg.tr_Control.fileName, fileName.c_str(), 127);
+		message.msg.tr_Control.fileName[127] = '\0';
+
+		if (!modal)
 		{
-			throw vrmotioncompensation_connectionerror("No active connection.");
+			_sendFireAndForget(message);
+			return;
 		}
+
+		_requestAsync<void>(message, message.msg.tr_Control.messageId, IPC_REPLY_TIMEOUT_MS, nullptr, [](const ipc::Reply& resp)
+		{
+			//If there was an error, notify the user
+			std::stringstream ss;
+			ss << "Error while setting span tracing: ";
+
+			if (resp.status == ipc::ReplyStatus::InvalidOperation)
+			{
+				ss << "Trace file could not be written";
+				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
+			}
+			else if (resp.status != ipc::ReplyStatus::Ok)
+			{
+				ss << "Error code " << (int)resp.status;
+				throw vrmotioncompensation_exception(ss.str(), (int)resp.status);
+			}
+		}).get();
 	}
 } // end namespace vrmotioncompensation
\ No newline at end of file